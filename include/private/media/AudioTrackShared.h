@@ -234,6 +234,8 @@ struct audio_track_cblk_t
     volatile    int32_t     mFutex;     // event flag: down (P) by client,
                                         // up (V) by server or binderDied() or interrupt()
 #define CBLK_FUTEX_WAKE 1               // if event flag bit is set, then a deferred wake is pending
+#define CBLK_FUTEX_WAITER 2             // the upper bits count the client threads waiting on the
+                                        // futex: the server only wakes it when they are non-zero
 
 private:
 
@@ -303,6 +305,9 @@ public:
     uint32_t getStartThresholdInFrames() const;
     uint32_t setStartThresholdInFrames(uint32_t startThresholdInFrames);
 
+    // Number of futex waits (client) or wakes (server) issued for buffers by this proxy.
+    int64_t getFutexSyscallCount() const { return mFutexSyscalls; }
+
 protected:
     // These refer to shared memory, and are virtual addresses with respect to the current process.
     // They may have different virtual addresses within the other process.
@@ -316,6 +321,7 @@ protected:
     const bool      mClientInServer;    // true for OutputTrack, false for AudioTrack & AudioRecord
     bool            mIsShutdown;        // latch set to true when shared memory corruption detected
     size_t          mUnreleased;        // unreleased frames remaining from most recent obtainBuffer
+    int64_t         mFutexSyscalls;     // see getFutexSyscallCount()
 };
 
 // ----------------------------------------------------------------------------
@@ -426,6 +432,12 @@ public:
 
     virtual void stop() { }; // called by client in AudioTrack::stop()
 
+protected:
+    // Waits on the futex after a pending wake was consumed, at most ts or forever if NULL.
+    // The thread is counted as a waiter meanwhile. Returns with errno set as by the futex
+    // syscall, EWOULDBLOCK if the server posted a wake before the thread could wait.
+    void        waitForServer(const struct timespec *ts);
+
 private:
     // This is a copy of mCblk->mBufferSizeInFrames
     uint32_t   mBufferSizeInFrames;  // effective size of the buffer
@@ -650,7 +662,15 @@ public:
         return android_atomic_acquire_load((int32_t *)&mCblk->mBufferSizeInFrames);
     }
 
+    // Sets a flag for the client, such as CBLK_INVALID or CBLK_DISABLED, and wakes all its
+    // threads waiting on the futex, keeping their count.
+    void                signalClientFlag(int32_t flag);
+
 protected:
+    // Posts a wake to the client, with a futex syscall only if the wake is not already
+    // pending and a client thread is waiting.
+    void        wakeClient();
+
     size_t      mAvailToClient; // estimated frames available to client prior to releaseBuffer()
     int32_t     mFlush;         // our copy of cblk->u.mStreaming.mFlush, for streaming output only
     int64_t     mReleased;      // our copy of cblk->mServer, at 64 bit resolution
@@ -33,6 +33,16 @@
 #include <Codec2CommonUtils.h>
 #include <SimpleC2Component.h>
 
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#define USE_NEON_10BIT 1
+#else
+#define USE_NEON_10BIT 0
+#endif
+
+#if USE_NEON_10BIT
+#include <arm_neon.h>
+#endif
+
 namespace android {
 
 // libyuv version required for I410ToAB30Matrix and I210ToAB30Matrix.
@@ -86,56 +96,42 @@ void convertYUV420Planar16ToY410(uint32_t *dst, const uint16_t *srcY, const uint
                                  size_t srcVStride, size_t dstStride, size_t width, size_t height) {
     // Converting two lines at a time, slightly faster
     for (size_t y = 0; y < height; y += 2) {
-        uint32_t *dstTop = (uint32_t *)dst;
-        uint32_t *dstBot = (uint32_t *)(dst + dstStride);
-        uint16_t *ySrcTop = (uint16_t *)srcY;
-        uint16_t *ySrcBot = (uint16_t *)(srcY + srcYStride);
-        uint16_t *uSrc = (uint16_t *)srcU;
-        uint16_t *vSrc = (uint16_t *)srcV;
-
-        uint32_t u01, v01, y01, y23, y45, y67, uv0, uv1;
+        uint32_t *dstTop = dst;
+        uint32_t *dstBot = dst + dstStride;
+        const uint16_t *ySrcTop = srcY;
+        const uint16_t *ySrcBot = srcY + srcYStride;
+
         size_t x = 0;
-        for (; x < width - 3; x += 4) {
-            u01 = *((uint32_t *)uSrc);
-            uSrc += 2;
-            v01 = *((uint32_t *)vSrc);
-            vSrc += 2;
-
-            y01 = *((uint32_t *)ySrcTop);
-            ySrcTop += 2;
-            y23 = *((uint32_t *)ySrcTop);
-            ySrcTop += 2;
-            y45 = *((uint32_t *)ySrcBot);
-            ySrcBot += 2;
-            y67 = *((uint32_t *)ySrcBot);
-            ySrcBot += 2;
-
-            uv0 = (u01 & 0x3FF) | ((v01 & 0x3FF) << 20);
-            uv1 = (u01 >> 16) | ((v01 >> 16) << 20);
-
-            *dstTop++ = 3 << 30 | ((y01 & 0x3FF) << 10) | uv0;
-            *dstTop++ = 3 << 30 | ((y01 >> 16) << 10) | uv0;
-            *dstTop++ = 3 << 30 | ((y23 & 0x3FF) << 10) | uv1;
-            *dstTop++ = 3 << 30 | ((y23 >> 16) << 10) | uv1;
-
-            *dstBot++ = 3 << 30 | ((y45 & 0x3FF) << 10) | uv0;
-            *dstBot++ = 3 << 30 | ((y45 >> 16) << 10) | uv0;
-            *dstBot++ = 3 << 30 | ((y67 & 0x3FF) << 10) | uv1;
-            *dstBot++ = 3 << 30 | ((y67 >> 16) << 10) | uv1;
+#if USE_NEON_10BIT
+        // 8 pixels of both lines, sharing 4 chroma samples, at a time.
+        const uint16x4_t mask4 = vdup_n_u16(0x3FF);
+        const uint16x8_t mask8 = vdupq_n_u16(0x3FF);
+        const uint32x4_t alpha = vdupq_n_u32(3u << 30);
+        for (; x + 8 <= width; x += 8) {
+            uint16x4_t u = vand_u16(vld1_u16(srcU + x / 2), mask4);
+            uint16x4_t v = vand_u16(vld1_u16(srcV + x / 2), mask4);
+            uint32x4_t uv = vorrq_u32(vmovl_u16(u), vshlq_n_u32(vmovl_u16(v), 20));
+            uv = vorrq_u32(uv, alpha);
+            // Each chroma sample covers two horizontal pixels.
+            uint32x4x2_t uv2 = vzipq_u32(uv, uv);
+            uint16x8_t yTop = vandq_u16(vld1q_u16(ySrcTop + x), mask8);
+            uint16x8_t yBot = vandq_u16(vld1q_u16(ySrcBot + x), mask8);
+            vst1q_u32(dstTop + x, vorrq_u32(uv2.val[0], vshll_n_u16(vget_low_u16(yTop), 10)));
+            vst1q_u32(dstTop + x + 4,
+                      vorrq_u32(uv2.val[1], vshll_n_u16(vget_high_u16(yTop), 10)));
+            vst1q_u32(dstBot + x, vorrq_u32(uv2.val[0], vshll_n_u16(vget_low_u16(yBot), 10)));
+            vst1q_u32(dstBot + x + 4,
+                      vorrq_u32(uv2.val[1], vshll_n_u16(vget_high_u16(yBot), 10)));
         }
-
-        // There should be at most 2 more pixels to process. Note that we don't
-        // need to consider odd case as the buffer is always aligned to even.
-        if (x < width) {
-            u01 = *uSrc;
-            v01 = *vSrc;
-            y01 = *((uint32_t *)ySrcTop);
-            y45 = *((uint32_t *)ySrcBot);
-            uv0 = (u01 & 0x3FF) | ((v01 & 0x3FF) << 20);
-            *dstTop++ = ((y01 & 0x3FF) << 10) | uv0;
-            *dstTop++ = ((y01 >> 16) << 10) | uv0;
-            *dstBot++ = ((y45 & 0x3FF) << 10) | uv0;
-            *dstBot++ = ((y45 >> 16) << 10) | uv0;
+#endif  // USE_NEON_10BIT
+        // Note that we don't need to consider odd case as the buffer is always aligned to
+        // even.
+        for (; x < width; x += 2) {
+            uint32_t uv = 3u << 30 | (srcU[x / 2] & 0x3FF) | ((srcV[x / 2] & 0x3FF) << 20);
+            dstTop[x] = uv | ((ySrcTop[x] & 0x3FF) << 10);
+            dstTop[x + 1] = uv | ((ySrcTop[x + 1] & 0x3FF) << 10);
+            dstBot[x] = uv | ((ySrcBot[x] & 0x3FF) << 10);
+            dstBot[x + 1] = uv | ((ySrcBot[x + 1] & 0x3FF) << 10);
         }
 
         srcY += srcYStride * 2;
@@ -246,6 +242,79 @@ static const struct Coeffs GetCoeffsForAspects(const C2ColorAspectsStruct &aspec
 }
 
 #define CLIP3(min, v, max) (((v) < (min)) ? (min) : (((max) > (v)) ? (v) : (max)))
+
+namespace {
+
+// Packs one pixel. yMult already includes the rounding term. Shifting instead of
+// dividing by 1024 only differs for negative values, which are clipped to 0 anyway.
+inline uint32_t packRGBA1010102(int32_t yMult, int32_t u_b, int32_t uv_g, int32_t v_r) {
+    int32_t b = (yMult + u_b) >> 10;
+    int32_t g = (yMult + uv_g) >> 10;
+    int32_t r = (yMult + v_r) >> 10;
+    b = CLIP3(0, b, 1023);
+    g = CLIP3(0, g, 1023);
+    r = CLIP3(0, r, 1023);
+    return 3u << 30 | (b << 20) | (g << 10) | r;
+}
+
+// Converts columns [x, width) of two rows sharing one chroma row, two columns at a time.
+inline void convertRowPairToRGBA1010102(
+        uint32_t *dstTop, uint32_t *dstBot, const uint16_t *ySrcTop, const uint16_t *ySrcBot,
+        const uint16_t *uSrc, const uint16_t *vSrc, size_t x, size_t width,
+        const struct Coeffs &coeffs) {
+    for (; x < width; x += 2) {
+        int32_t u = uSrc[x / 2] - 512;
+        int32_t v = vSrc[x / 2] - 512;
+        int32_t u_b = u * coeffs._b_u;
+        int32_t uv_g = -u * coeffs._g_u - v * coeffs._g_v;
+        int32_t v_r = v * coeffs._r_v;
+
+        dstTop[x] = packRGBA1010102(
+                (ySrcTop[x] - coeffs._c16) * coeffs._y + 512, u_b, uv_g, v_r);
+        dstTop[x + 1] = packRGBA1010102(
+                (ySrcTop[x + 1] - coeffs._c16) * coeffs._y + 512, u_b, uv_g, v_r);
+        dstBot[x] = packRGBA1010102(
+                (ySrcBot[x] - coeffs._c16) * coeffs._y + 512, u_b, uv_g, v_r);
+        dstBot[x + 1] = packRGBA1010102(
+                (ySrcBot[x + 1] - coeffs._c16) * coeffs._y + 512, u_b, uv_g, v_r);
+    }
+}
+
+#if USE_NEON_10BIT
+
+inline uint32x4_t packRGBA1010102(
+        int32x4_t yMult, int32x4_t u_b, int32x4_t uv_g, int32x4_t v_r) {
+    const int32x4_t zero = vdupq_n_s32(0);
+    const int32x4_t max = vdupq_n_s32(1023);
+    uint32x4_t b = vreinterpretq_u32_s32(
+            vminq_s32(vmaxq_s32(vshrq_n_s32(vaddq_s32(yMult, u_b), 10), zero), max));
+    uint32x4_t g = vreinterpretq_u32_s32(
+            vminq_s32(vmaxq_s32(vshrq_n_s32(vaddq_s32(yMult, uv_g), 10), zero), max));
+    uint32x4_t r = vreinterpretq_u32_s32(
+            vminq_s32(vmaxq_s32(vshrq_n_s32(vaddq_s32(yMult, v_r), 10), zero), max));
+    uint32x4_t pixel = vorrq_u32(vshlq_n_u32(b, 20), vshlq_n_u32(g, 10));
+    return vorrq_u32(vorrq_u32(pixel, r), vdupq_n_u32(3u << 30));
+}
+
+// Converts 8 pixels of one row. The chroma terms are for pixels 0-3 and 4-7.
+inline void convertRowToRGBA1010102(
+        uint32_t *dst, const uint16_t *ySrc, const int32x4x2_t &u_b, const int32x4x2_t &uv_g,
+        const int32x4x2_t &v_r, const struct Coeffs &coeffs) {
+    const int32x4_t c16 = vdupq_n_s32(coeffs._c16);
+    const int32x4_t round = vdupq_n_s32(512);
+    uint16x8_t y = vld1q_u16(ySrc);
+    int32x4_t y0 = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(y))), c16);
+    int32x4_t y1 = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(y))), c16);
+    y0 = vmlaq_n_s32(round, y0, coeffs._y);
+    y1 = vmlaq_n_s32(round, y1, coeffs._y);
+    vst1q_u32(dst, packRGBA1010102(y0, u_b.val[0], uv_g.val[0], v_r.val[0]));
+    vst1q_u32(dst + 4, packRGBA1010102(y1, u_b.val[1], uv_g.val[1], v_r.val[1]));
+}
+
+#endif  // USE_NEON_10BIT
+
+}  // namespace
+
 void convertYUV420Planar16ToRGBA1010102(
         uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
         const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
@@ -257,80 +326,35 @@ void convertYUV420Planar16ToRGBA1010102(
 
     struct Coeffs coeffs = GetCoeffsForAspects(_aspects);
 
-    int32_t _y = coeffs._y;
-    int32_t _b_u = coeffs._b_u;
-    int32_t _neg_g_u = -coeffs._g_u;
-    int32_t _neg_g_v = -coeffs._g_v;
-    int32_t _r_v = coeffs._r_v;
-    int32_t _c16 = coeffs._c16;
-
     // Converting two lines at a time, slightly faster
     for (size_t y = 0; y < height; y += 2) {
-        uint32_t *dstTop = (uint32_t *)dst;
-        uint32_t *dstBot = (uint32_t *)(dst + dstStride);
-        uint16_t *ySrcTop = (uint16_t *)srcY;
-        uint16_t *ySrcBot = (uint16_t *)(srcY + srcYStride);
-        uint16_t *uSrc = (uint16_t *)srcU;
-        uint16_t *vSrc = (uint16_t *)srcV;
-
-        for (size_t x = 0; x < width; x += 2) {
-            int32_t u, v, y00, y01, y10, y11;
-            u = *uSrc - 512;
-            uSrc += 1;
-            v = *vSrc - 512;
-            vSrc += 1;
-
-            y00 = *ySrcTop - _c16;
-            ySrcTop += 1;
-            y01 = *ySrcTop - _c16;
-            ySrcTop += 1;
-            y10 = *ySrcBot - _c16;
-            ySrcBot += 1;
-            y11 = *ySrcBot - _c16;
-            ySrcBot += 1;
-
-            int32_t u_b = u * _b_u;
-            int32_t u_g = u * _neg_g_u;
-            int32_t v_g = v * _neg_g_v;
-            int32_t v_r = v * _r_v;
-
-            int32_t yMult, b, g, r;
-            yMult = y00 * _y + 512;
-            b = (yMult + u_b) / 1024;
-            g = (yMult + v_g + u_g) / 1024;
-            r = (yMult + v_r) / 1024;
-            b = CLIP3(0, b, 1023);
-            g = CLIP3(0, g, 1023);
-            r = CLIP3(0, r, 1023);
-            *dstTop++ = 3 << 30 | (b << 20) | (g << 10) | r;
-
-            yMult = y01 * _y + 512;
-            b = (yMult + u_b) / 1024;
-            g = (yMult + v_g + u_g) / 1024;
-            r = (yMult + v_r) / 1024;
-            b = CLIP3(0, b, 1023);
-            g = CLIP3(0, g, 1023);
-            r = CLIP3(0, r, 1023);
-            *dstTop++ = 3 << 30 | (b << 20) | (g << 10) | r;
-
-            yMult = y10 * _y + 512;
-            b = (yMult + u_b) / 1024;
-            g = (yMult + v_g + u_g) / 1024;
-            r = (yMult + v_r) / 1024;
-            b = CLIP3(0, b, 1023);
-            g = CLIP3(0, g, 1023);
-            r = CLIP3(0, r, 1023);
-            *dstBot++ = 3 << 30 | (b << 20) | (g << 10) | r;
-
-            yMult = y11 * _y + 512;
-            b = (yMult + u_b) / 1024;
-            g = (yMult + v_g + u_g) / 1024;
-            r = (yMult + v_r) / 1024;
-            b = CLIP3(0, b, 1023);
-            g = CLIP3(0, g, 1023);
-            r = CLIP3(0, r, 1023);
-            *dstBot++ = 3 << 30 | (b << 20) | (g << 10) | r;
+        uint32_t *dstTop = dst;
+        uint32_t *dstBot = dst + dstStride;
+        const uint16_t *ySrcTop = srcY;
+        const uint16_t *ySrcBot = srcY + srcYStride;
+
+        size_t x = 0;
+#if USE_NEON_10BIT
+        // 8 pixels of both lines, sharing 4 chroma samples, at a time.
+        const int32x4_t neutral = vdupq_n_s32(512);
+        for (; x + 8 <= width; x += 8) {
+            int32x4_t u = vsubq_s32(
+                    vreinterpretq_s32_u32(vmovl_u16(vld1_u16(srcU + x / 2))), neutral);
+            int32x4_t v = vsubq_s32(
+                    vreinterpretq_s32_u32(vmovl_u16(vld1_u16(srcV + x / 2))), neutral);
+            int32x4_t u_b = vmulq_n_s32(u, coeffs._b_u);
+            int32x4_t uv_g = vmlsq_n_s32(vmulq_n_s32(u, -coeffs._g_u), v, coeffs._g_v);
+            int32x4_t v_r = vmulq_n_s32(v, coeffs._r_v);
+            // Each chroma sample covers two horizontal pixels.
+            int32x4x2_t u_b2 = vzipq_s32(u_b, u_b);
+            int32x4x2_t uv_g2 = vzipq_s32(uv_g, uv_g);
+            int32x4x2_t v_r2 = vzipq_s32(v_r, v_r);
+            convertRowToRGBA1010102(dstTop + x, ySrcTop + x, u_b2, uv_g2, v_r2, coeffs);
+            convertRowToRGBA1010102(dstBot + x, ySrcBot + x, u_b2, uv_g2, v_r2, coeffs);
         }
+#endif  // USE_NEON_10BIT
+        convertRowPairToRGBA1010102(
+                dstTop, dstBot, ySrcTop, ySrcBot, srcU, srcV, x, width, coeffs);
 
         srcY += srcYStride * 2;
         srcU += srcUStride;
@@ -359,15 +383,10 @@ void convertYUV420Planar16ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, co
                                  size_t srcUStride, size_t srcVStride, size_t dstYStride,
                                  size_t dstUVStride, size_t width, size_t height,
                                  bool isMonochrome) {
-    for (size_t y = 0; y < height; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-            dstY[x] = (uint8_t)(srcY[x] >> 2);
-        }
-        srcY += srcYStride;
-        dstY += dstYStride;
-    }
-
+    // libyuv picks the SIMD row functions at runtime; for 10-bit input a scale of
+    // 16384 is the same as shifting right by 2.
     if (isMonochrome) {
+        libyuv::Convert16To8Plane(srcY, srcYStride, dstY, dstYStride, 16384, width, height);
         // Fill with neutral U/V values.
         for (size_t y = 0; y < (height + 1) / 2; ++y) {
             memset(dstV, kNeutralUVBitDepth8, (width + 1) / 2);
@@ -378,16 +397,8 @@ void convertYUV420Planar16ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, co
         return;
     }
 
-    for (size_t y = 0; y < (height + 1) / 2; ++y) {
-        for (size_t x = 0; x < (width + 1) / 2; ++x) {
-            dstU[x] = (uint8_t)(srcU[x] >> 2);
-            dstV[x] = (uint8_t)(srcV[x] >> 2);
-        }
-        srcU += srcUStride;
-        srcV += srcVStride;
-        dstU += dstUVStride;
-        dstV += dstUVStride;
-    }
+    libyuv::I010ToI420(srcY, srcYStride, srcU, srcUStride, srcV, srcVStride, dstY, dstYStride,
+                       dstU, dstUVStride, dstV, dstUVStride, width, height);
 }
 
 void convertYUV420Planar16ToP010(uint16_t *dstY, uint16_t *dstUV, const uint16_t *srcY,
@@ -395,6 +406,14 @@ void convertYUV420Planar16ToP010(uint16_t *dstY, uint16_t *dstUV, const uint16_t
                                  size_t srcUStride, size_t srcVStride, size_t dstYStride,
                                  size_t dstUVStride, size_t width, size_t height,
                                  bool isMonochrome) {
+#if LIBYUV_VERSION >= 1779
+    if (!isMonochrome) {
+        libyuv::I010ToP010(srcY, srcYStride, srcU, srcUStride, srcV, srcVStride, dstY, dstYStride,
+                           dstUV, dstUVStride, width, height);
+        return;
+    }
+    libyuv::ConvertToMSBPlane_16(srcY, srcYStride, dstY, dstYStride, width, height, 10);
+#else   // LIBYUV_VERSION < 1779
     for (size_t y = 0; y < height; ++y) {
         for (size_t x = 0; x < width; ++x) {
             dstY[x] = srcY[x] << 6;
@@ -402,6 +421,7 @@ void convertYUV420Planar16ToP010(uint16_t *dstY, uint16_t *dstUV, const uint16_t
         srcY += srcYStride;
         dstY += dstYStride;
     }
+#endif  // LIBYUV_VERSION >= 1779
 
     if (isMonochrome) {
         // Fill with neutral U/V values.
@@ -431,6 +451,9 @@ void convertP010ToYUV420Planar16(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
                                  size_t srcYStride, size_t srcUVStride, size_t dstYStride,
                                  size_t dstUStride, size_t dstVStride, size_t width,
                                  size_t height, bool isMonochrome) {
+#if LIBYUV_VERSION >= 1779
+    libyuv::ConvertToLSBPlane_16(srcY, srcYStride, dstY, dstYStride, width, height, 10);
+#else   // LIBYUV_VERSION < 1779
     for (size_t y = 0; y < height; ++y) {
         for (size_t x = 0; x < width; ++x) {
             dstY[x] = srcY[x] >> 6;
@@ -438,6 +461,7 @@ void convertP010ToYUV420Planar16(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
         srcY += srcYStride;
         dstY += dstYStride;
     }
+#endif  // LIBYUV_VERSION >= 1779
 
     if (isMonochrome) {
         // Fill with neutral U/V values.
@@ -452,6 +476,10 @@ void convertP010ToYUV420Planar16(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
         return;
     }
 
+#if LIBYUV_VERSION >= 1779
+    libyuv::SplitUVPlane_16(srcUV, srcUVStride, dstU, dstUStride, dstV, dstVStride,
+                            (width + 1) / 2, (height + 1) / 2, 10);
+#else   // LIBYUV_VERSION < 1779
     for (size_t y = 0; y < (height + 1) / 2; ++y) {
         for (size_t x = 0; x < (width + 1) / 2; ++x) {
             dstU[x] = srcUV[2 * x] >> 6;
@@ -461,6 +489,7 @@ void convertP010ToYUV420Planar16(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
         dstV += dstVStride;
         srcUV += srcUVStride;
     }
+#endif  // LIBYUV_VERSION >= 1779
 }
 
 static const int16_t bt709Matrix_10bit[2][3][3] = {
@@ -491,6 +520,8 @@ void convertRGBA1010102ToYUV420Planar16(uint16_t* dstY, uint16_t* dstU, uint16_t
                                          : bt2020Matrix_10bit[colorRange - 1];
 
     for (size_t y = 0; y < height; ++y) {
+        // Luma and chroma are computed in separate loops so that the luma loop,
+        // which has no per-pixel branches, can be vectorized.
         for (size_t x = 0; x < width; ++x) {
             b = (srcRGBA[x]  >> 20) & 0x3FF;
             g = (srcRGBA[x]  >> 10) & 0x3FF;
@@ -499,7 +530,13 @@ void convertRGBA1010102ToYUV420Planar16(uint16_t* dstY, uint16_t* dstU, uint16_t
             i32Y = ((r * weights[0][0] + g * weights[0][1] + b * weights[0][2] + 512) >> 10) +
                    zeroLvl;
             dstY[x] = CLIP3(zeroLvl, i32Y, maxLvlLuma);
-            if (y % 2 == 0 && x % 2 == 0) {
+        }
+        if (y % 2 == 0) {
+            for (size_t x = 0; x < width; x += 2) {
+                b = (srcRGBA[x]  >> 20) & 0x3FF;
+                g = (srcRGBA[x]  >> 10) & 0x3FF;
+                r = srcRGBA[x] & 0x3FF;
+
                 i32U = ((r * weights[1][0] + g * weights[1][1] + b * weights[1][2] + 512) >> 10) +
                        512;
                 i32V = ((r * weights[2][0] + g * weights[2][1] + b * weights[2][2] + 512) >> 10) +
@@ -632,29 +669,46 @@ void convertPlanar8ToYV12(uint8_t* dstY, uint8_t* dstU, uint8_t* dstV, const uin
     }
 }
 std::unique_ptr<C2Work> SimpleC2Component::WorkQueue::pop_front() {
-    std::unique_ptr<C2Work> work = std::move(mQueue.front().work);
-    mQueue.pop_front();
+    std::unique_ptr<C2Work> work = std::move(mQueue[mHead].work);
+    mHead = (mHead + 1) % mQueue.size();
+    --mSize;
     return work;
 }
 
+void SimpleC2Component::WorkQueue::push(Entry entry) {
+    if (mSize == mQueue.size()) {
+        std::vector<Entry> queue(mQueue.size() * 2);
+        for (size_t i = 0; i < mSize; ++i) {
+            queue[i] = std::move(mQueue[(mHead + i) % mQueue.size()]);
+        }
+        mQueue.swap(queue);
+        mHead = 0;
+    }
+    mQueue[(mHead + mSize) % mQueue.size()] = std::move(entry);
+    ++mSize;
+}
+
 void SimpleC2Component::WorkQueue::push_back(std::unique_ptr<C2Work> work) {
-    mQueue.push_back({ std::move(work), NO_DRAIN });
+    push({ std::move(work), NO_DRAIN });
 }
 
 bool SimpleC2Component::WorkQueue::empty() const {
-    return mQueue.empty();
+    return mSize == 0;
 }
 
 void SimpleC2Component::WorkQueue::clear() {
-    mQueue.clear();
+    while (mSize > 0) {
+        (void)pop_front();
+    }
+    mHead = 0;
 }
 
 uint32_t SimpleC2Component::WorkQueue::drainMode() const {
-    return mQueue.front().drainMode;
+    return mQueue[mHead].drainMode;
 }
 
 void SimpleC2Component::WorkQueue::markDrain(uint32_t drainMode) {
-    mQueue.push_back({ nullptr, drainMode });
+    push({ nullptr, drainMode });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -692,7 +746,14 @@ void SimpleC2Component::WorkHandler::onMessageReceived(const sp<AMessage> &msg)
     switch (msg->what()) {
         case kWhatProcess: {
             if (mRunning) {
-                if (thiz->processQueue()) {
+                // Processes a few works per message; other messages are
+                // still handled in between.
+                constexpr int kMaxWorksPerMessage = 8;
+                bool hasQueuedWork = true;
+                for (int i = 0; hasQueuedWork && i < kMaxWorksPerMessage; ++i) {
+                    hasQueuedWork = thiz->processQueue();
+                }
+                if (hasQueuedWork) {
                     (new AMessage(kWhatProcess, this))->post();
                 }
             } else {
@@ -710,21 +771,28 @@ void SimpleC2Component::WorkHandler::onMessageReceived(const sp<AMessage> &msg)
             break;
         }
         case kWhatStop: {
+            // Waits for a work being processed inline.
+            std::unique_lock<std::mutex> lock(thiz->mProcessLock);
             int32_t err = thiz->onStop();
             thiz->mOutputBlockPool.reset();
+            lock.unlock();
             Reply(msg, &err);
             break;
         }
         case kWhatReset: {
+            std::unique_lock<std::mutex> lock(thiz->mProcessLock);
             thiz->onReset();
             thiz->mOutputBlockPool.reset();
+            lock.unlock();
             mRunning = false;
             Reply(msg);
             break;
         }
         case kWhatRelease: {
+            std::unique_lock<std::mutex> lock(thiz->mProcessLock);
             thiz->onRelease();
             thiz->mOutputBlockPool.reset();
+            lock.unlock();
             mRunning = false;
             Reply(msg);
             break;
@@ -801,7 +869,8 @@ SimpleC2Component::SimpleC2Component(
     : mDummyReadView(DummyReadView()),
       mIntf(intf),
       mLooper(new ALooper),
-      mHandler(new WorkHandler) {
+      mHandler(new WorkHandler),
+      mProcessingThread(std::thread::id()) {
     mLooper->setName(intf->getName().c_str());
     (void)mLooper->registerHandler(mHandler);
     mLooper->start(false, false, ANDROID_PRIORITY_VIDEO);
@@ -846,12 +915,31 @@ c2_status_t SimpleC2Component::queue_nb(std::list<std::unique_ptr<C2Work>> * con
             items->pop_front();
         }
     }
-    if (queueWasEmpty) {
-        (new AMessage(WorkHandler::kWhatProcess, mHandler))->post();
+    if (!queueWasEmpty) {
+        // the handler has been woken up for the earlier works.
+        return C2_OK;
+    }
+    // In low latency mode, an idle component processes the works right away
+    // on this thread instead of waking up the handler. This does not apply
+    // when called back from the processing, e.g. from onWorkDone_nb.
+    if (mProcessingThread.load() != std::this_thread::get_id()
+            && isLowLatencyMode() && mProcessLock.try_lock()) {
+        std::unique_lock<std::mutex> lock(mProcessLock, std::adopt_lock);
+        if (!processQueue_l()) {
+            return C2_OK;
+        }
     }
+    (new AMessage(WorkHandler::kWhatProcess, mHandler))->post();
     return C2_OK;
 }
 
+bool SimpleC2Component::isLowLatencyMode() {
+    C2GlobalLowLatencyModeTuning lowLatency(C2_FALSE);
+    std::vector<std::unique_ptr<C2Param>> heapParams;
+    c2_status_t err = mIntf->query_vb({ &lowLatency }, {}, C2_DONT_BLOCK, &heapParams);
+    return err == C2_OK && lowLatency.value == C2_TRUE;
+}
+
 c2_status_t SimpleC2Component::announce_nb(const std::vector<C2WorkOutline> &items) {
     (void)items;
     return C2_OMITTED;
@@ -992,6 +1080,25 @@ std::list<std::unique_ptr<C2Work>> vec(std::unique_ptr<C2Work> &work) {
 
 }  // namespace
 
+void SimpleC2Component::reportWorkDone(std::unique_ptr<C2Work> work) {
+    if (mProcessingThread.load() == std::this_thread::get_id()) {
+        // reported once the current work is processed.
+        mDoneWorks.push_back(std::move(work));
+        return;
+    }
+    std::shared_ptr<C2Component::Listener> listener = mExecState.lock()->mListener;
+    listener->onWorkDone_nb(shared_from_this(), vec(work));
+}
+
+void SimpleC2Component::reportDoneWorks_l() {
+    while (!mDoneWorks.empty()) {
+        std::list<std::unique_ptr<C2Work>> works;
+        works.swap(mDoneWorks);
+        std::shared_ptr<C2Component::Listener> listener = mExecState.lock()->mListener;
+        listener->onWorkDone_nb(shared_from_this(), std::move(works));
+    }
+}
+
 void SimpleC2Component::finish(
         uint64_t frameIndex, std::function<void(const std::unique_ptr<C2Work> &)> fillWork) {
     std::unique_ptr<C2Work> work;
@@ -1006,8 +1113,7 @@ void SimpleC2Component::finish(
     }
     if (work) {
         fillWork(work);
-        std::shared_ptr<C2Component::Listener> listener = mExecState.lock()->mListener;
-        listener->onWorkDone_nb(shared_from_this(), vec(work));
+        reportWorkDone(std::move(work));
         ALOGV("returning pending work");
     }
 }
@@ -1032,13 +1138,25 @@ void SimpleC2Component::cloneAndSend(
     work->worklets.emplace_back(new C2Worklet);
     if (work) {
         fillWork(work);
-        std::shared_ptr<C2Component::Listener> listener = mExecState.lock()->mListener;
-        listener->onWorkDone_nb(shared_from_this(), vec(work));
+        reportWorkDone(std::move(work));
         ALOGV("cloned and sending work");
     }
 }
 
 bool SimpleC2Component::processQueue() {
+    std::lock_guard<std::mutex> lock(mProcessLock);
+    return processQueue_l();
+}
+
+bool SimpleC2Component::processQueue_l() {
+    mProcessingThread = std::this_thread::get_id();
+    bool hasQueuedWork = processWork_l();
+    reportDoneWorks_l();
+    mProcessingThread = std::thread::id();
+    return hasQueuedWork;
+}
+
+bool SimpleC2Component::processWork_l() {
     std::unique_ptr<C2Work> work;
     uint64_t generation;
     int32_t drainMode;
@@ -1104,6 +1222,7 @@ bool SimpleC2Component::processQueue() {
             return err;
         }();
         if (err != C2_OK) {
+            reportDoneWorks_l();
             Mutexed<ExecState>::Locked state(mExecState);
             std::shared_ptr<C2Component::Listener> listener = state->mListener;
             state.unlock();
@@ -1115,6 +1234,8 @@ bool SimpleC2Component::processQueue() {
     if (!work) {
         c2_status_t err = drain(drainMode, mOutputBlockPool);
         if (err != C2_OK) {
+            // the works drained so far are reported first.
+            reportDoneWorks_l();
             Mutexed<ExecState>::Locked state(mExecState);
             std::shared_ptr<C2Component::Listener> listener = state->mListener;
             state.unlock();
@@ -1154,19 +1275,13 @@ bool SimpleC2Component::processQueue() {
         work->result = C2_NOT_FOUND;
         queue.unlock();
 
-        Mutexed<ExecState>::Locked state(mExecState);
-        std::shared_ptr<C2Component::Listener> listener = state->mListener;
-        state.unlock();
-        listener->onWorkDone_nb(shared_from_this(), vec(work));
+        reportWorkDone(std::move(work));
         return hasQueuedWork;
     }
     if (work->workletsProcessed != 0u) {
         queue.unlock();
-        Mutexed<ExecState>::Locked state(mExecState);
         ALOGV("returning this work");
-        std::shared_ptr<C2Component::Listener> listener = state->mListener;
-        state.unlock();
-        listener->onWorkDone_nb(shared_from_this(), vec(work));
+        reportWorkDone(std::move(work));
     } else {
         ALOGV("queue pending work");
         work->input.buffers.clear();
@@ -1183,10 +1298,7 @@ bool SimpleC2Component::processQueue() {
         if (unexpected) {
             ALOGD("unexpected pending work");
             unexpected->result = C2_CORRUPTED;
-            Mutexed<ExecState>::Locked state(mExecState);
-            std::shared_ptr<C2Component::Listener> listener = state->mListener;
-            state.unlock();
-            listener->onWorkDone_nb(shared_from_this(), vec(unexpected));
+            reportWorkDone(std::move(unexpected));
         }
     }
     return hasQueuedWork;
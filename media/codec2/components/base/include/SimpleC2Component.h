@@ -17,8 +17,12 @@
 #ifndef SIMPLE_C2_COMPONENT_H_
 #define SIMPLE_C2_COMPONENT_H_
 
+#include <atomic>
 #include <list>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <C2Component.h>
 #include <C2Config.h>
@@ -43,6 +47,10 @@ void convertYUV420Planar8ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, con
                                 size_t dstUStride, size_t dstVStride, uint32_t width,
                                 uint32_t height, bool isMonochrome = false);
 
+void convertYUV420Planar16ToY410(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+                                 const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
+                                 size_t srcVStride, size_t dstStride, size_t width, size_t height);
+
 void convertYUV420Planar16ToY410OrRGBA1010102(
         uint32_t *dst, const uint16_t *srcY,
         const uint16_t *srcU, const uint16_t *srcV,
@@ -120,6 +128,10 @@ public:
     virtual std::shared_ptr<C2ComponentInterface> intf() override;
 
     // for handler
+    /**
+     * Processes the first queued work or drain, and returns whether more
+     * works are queued.
+     */
     bool processQueue();
 
 protected:
@@ -264,11 +276,28 @@ private:
     sp<ALooper> mLooper;
     sp<WorkHandler> mHandler;
 
+    // Held while a work is processed, either on the looper thread or inline
+    // on the queueing thread in low latency mode.
+    std::mutex mProcessLock;
+    // The thread holding mProcessLock, if any.
+    std::atomic<std::thread::id> mProcessingThread;
+    // Works done on the processing thread, reported together once the
+    // current work is processed. Guarded by mProcessLock.
+    std::list<std::unique_ptr<C2Work>> mDoneWorks;
+
+    bool processQueue_l();
+    bool processWork_l();
+    bool isLowLatencyMode();
+    void reportWorkDone(std::unique_ptr<C2Work> work);
+    void reportDoneWorks_l();
+
     class WorkQueue {
     public:
         typedef std::unordered_map<uint64_t, std::unique_ptr<C2Work>> PendingWork;
 
-        inline WorkQueue() : mFlush(false), mGeneration(0ul) {}
+        inline WorkQueue()
+            : mFlush(false), mGeneration(0ul),
+              mQueue(kInitialCapacity), mHead(0u), mSize(0u) {}
 
         inline uint64_t generation() const { return mGeneration; }
         inline void incGeneration() { ++mGeneration; mFlush = true; }
@@ -292,9 +321,17 @@ private:
             uint32_t drainMode;
         };
 
+        static constexpr size_t kInitialCapacity = 16u;
+
+        void push(Entry entry);
+
         bool mFlush;
         uint64_t mGeneration;
-        std::list<Entry> mQueue;
+        // Ring of queued entries. The storage only grows, so queueing works
+        // does not allocate once the pipeline is primed.
+        std::vector<Entry> mQueue;
+        size_t mHead;
+        size_t mSize;
         PendingWork mPendingWork;
     };
     Mutexed<WorkQueue> mWorkQueue;
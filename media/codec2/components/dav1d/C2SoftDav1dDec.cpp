@@ -18,6 +18,7 @@
 #define LOG_TAG "C2SoftDav1dDec"
 #include <android-base/properties.h>
 #include <cutils/properties.h>
+#include <cmath>
 #include <thread>
 
 #include <C2Debug.h>
@@ -42,6 +43,41 @@ constexpr char COMPONENT_NAME[] = CODECNAME;
 
 constexpr size_t kMinInputBufferSize = 2 * 1024 * 1024;
 
+constexpr uint32_t kMaxThreadCount = 16;
+constexpr int kMaxFrameDelay = 8;
+
+static int GetCPUCoreCount() {
+    int cpuCoreCount = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    // _SC_NPROC_ONLN must be defined...
+    cpuCoreCount = sysconf(_SC_NPROC_ONLN);
+#endif
+    CHECK(cpuCoreCount >= 1);
+    ALOGV("Number of CPU cores: %d", cpuCoreCount);
+    return cpuCoreCount;
+}
+
+// Returns the number of threads to use for a thread budget configured by the client.
+static int GetNumThreads(uint32_t threadCount) {
+    if (threadCount > 0) {
+        return threadCount;
+    }
+    int32_t numThreads =
+            android::base::GetIntProperty(NUM_THREADS_DAV1D_PROPERTY, NUM_THREADS_DAV1D_DEFAULT);
+    if (numThreads > 0) {
+        return numThreads;
+    }
+    return std::max(GetCPUCoreCount() / 2, 1);  // use up to half the cores by default.
+}
+
+// Returns the number of frames dav1d decodes in parallel. This is what dav1d picks by default,
+// computed here so that it can be reported as the output delay of the component.
+static int GetFrameDelay(int numThreads) {
+    return std::min((int)std::ceil(std::sqrt(numThreads)), kMaxFrameDelay);
+}
+
 class C2SoftDav1dDec::IntfImpl : public SimpleInterface<void>::BaseParams {
   public:
     explicit IntfImpl(const std::shared_ptr<C2ReflectorHelper>& helper)
@@ -239,6 +275,29 @@ class C2SoftDav1dDec::IntfImpl : public SimpleInterface<void>::BaseParams {
                              .withFields({C2F(mPixelFormat, value).oneOf(pixelFormats)})
                              .withSetter((Setter<decltype(*mPixelFormat)>::StrictValueWithNoDeps))
                              .build());
+
+        addParameter(DefineParam(mThreadCount, C2_PARAMKEY_THREAD_COUNT)
+                             .withDefault(new C2GlobalThreadCountTuning(0u))
+                             .withFields({C2F(mThreadCount, value).inRange(0, kMaxThreadCount)})
+                             .withSetter(Setter<decltype(*mThreadCount)>::StrictValueWithNoDeps)
+                             .build());
+
+        // Frames decoded in parallel are completed out of order, after later inputs have been
+        // queued.
+        addParameter(DefineParam(mActualOutputDelay, C2_PARAMKEY_OUTPUT_DELAY)
+                             .withDefault(new C2PortActualDelayTuning::output(
+                                     GetFrameDelay(GetNumThreads(0u))))
+                             .withFields({C2F(mActualOutputDelay, value)
+                                                  .inRange(0, kMaxFrameDelay)})
+                             .calculatedAs(OutputDelaySetter, mThreadCount)
+                             .build());
+    }
+
+    static C2R OutputDelaySetter(bool mayBlock, C2P<C2PortActualDelayTuning::output>& me,
+                                 const C2P<C2GlobalThreadCountTuning>& threadCount) {
+        (void)mayBlock;
+        me.set().value = GetFrameDelay(GetNumThreads(threadCount.v.value));
+        return C2R::Ok();
     }
 
     static C2R SizeSetter(bool mayBlock, const C2P<C2StreamPictureSizeInfo::output>& oldMe,
@@ -356,6 +415,8 @@ class C2SoftDav1dDec::IntfImpl : public SimpleInterface<void>::BaseParams {
         return mPixelFormat;
     }
 
+    uint32_t getThreadCount_l() const { return mThreadCount->value; }
+
     static C2R HdrStaticInfoSetter(bool mayBlock, C2P<C2StreamHdrStaticInfo::output>& me) {
         (void)mayBlock;
         if (me.v.mastering.red.x > 1) {
@@ -410,6 +471,7 @@ class C2SoftDav1dDec::IntfImpl : public SimpleInterface<void>::BaseParams {
     std::shared_ptr<C2StreamHdr10PlusInfo::input> mHdr10PlusInfoInput;
     std::shared_ptr<C2StreamHdr10PlusInfo::output> mHdr10PlusInfoOutput;
     std::shared_ptr<C2StreamHdrStaticInfo::output> mHdrStaticInfo;
+    std::shared_ptr<C2GlobalThreadCountTuning> mThreadCount;
 };
 
 C2SoftDav1dDec::C2SoftDav1dDec(const char* name, c2_node_id_t id,
@@ -491,19 +553,6 @@ c2_status_t C2SoftDav1dDec::onFlush_sm() {
     return C2_OK;
 }
 
-static int GetCPUCoreCount() {
-    int cpuCoreCount = 1;
-#if defined(_SC_NPROCESSORS_ONLN)
-    cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
-#else
-    // _SC_NPROC_ONLN must be defined...
-    cpuCoreCount = sysconf(_SC_NPROC_ONLN);
-#endif
-    CHECK(cpuCoreCount >= 1);
-    ALOGV("Number of CPU cores: %d", cpuCoreCount);
-    return cpuCoreCount;
-}
-
 bool C2SoftDav1dDec::initDecoder() {
 #ifdef FILE_DUMP_ENABLE
     mC2SoftDav1dDump.initDumping();
@@ -511,28 +560,28 @@ bool C2SoftDav1dDec::initDecoder() {
     mSignalledError = false;
     mSignalledOutputEos = false;
     mHalPixelFormat = HAL_PIXEL_FORMAT_YV12;
+    uint32_t threadCount;
     {
         IntfImpl::Lock lock = mIntf->lock();
         mPixelFormatInfo = mIntf->getPixelFormat_l();
+        threadCount = mIntf->getThreadCount_l();
     }
 
     const char* version = dav1d_version();
 
     Dav1dSettings lib_settings;
     dav1d_default_settings(&lib_settings);
-    int cpu_count = GetCPUCoreCount();
-    lib_settings.n_threads = std::max(cpu_count / 2, 1);  // use up to half the cores by default.
-
-    int32_t numThreads =
-            android::base::GetIntProperty(NUM_THREADS_DAV1D_PROPERTY, NUM_THREADS_DAV1D_DEFAULT);
-    if (numThreads > 0) lib_settings.n_threads = numThreads;
+    lib_settings.n_threads = GetNumThreads(threadCount);
+    // Matches the output delay reported by the interface.
+    lib_settings.max_frame_delay = GetFrameDelay(lib_settings.n_threads);
 
     int res = 0;
     if ((res = dav1d_open(&mDav1dCtx, &lib_settings))) {
         ALOGE("dav1d_open failed. status: %d.", res);
         return false;
     } else {
-        ALOGD("dav1d_open succeeded(n_threads=%d,version=%s).", lib_settings.n_threads, version);
+        ALOGD("dav1d_open succeeded(n_threads=%d,max_frame_delay=%d,version=%s).",
+              lib_settings.n_threads, lib_settings.max_frame_delay, version);
     }
 
     return true;
@@ -598,8 +647,10 @@ void C2SoftDav1dDec::finishWork(uint64_t index, const std::unique_ptr<C2Work>& w
     }
 }
 
-static void freeCallback(const uint8_t */*data*/, void */*cookie*/) {
-    return;
+// Unmaps an input buffer once dav1d no longer references it. With frame threading this can
+// be after process() returned for that input.
+static void freeCallback(const uint8_t */*data*/, void *cookie) {
+    delete static_cast<C2ReadView *>(cookie);
 }
 
 void C2SoftDav1dDec::process(const std::unique_ptr<C2Work>& work,
@@ -656,9 +707,11 @@ void C2SoftDav1dDec::process(const std::unique_ptr<C2Work>& work,
 
             Dav1dData data;
 
-            res = dav1d_data_wrap(&data, bitstream, inSize, freeCallback, nullptr);
+            C2ReadView *inputView = new C2ReadView(rView);
+            res = dav1d_data_wrap(&data, bitstream, inSize, freeCallback, inputView);
             if (res != 0) {
                 ALOGE("Decoder wrap error %s!", strerror(DAV1D_ERR(res)));
+                delete inputView;
                 i_ret = -1;
             } else {
                 data.m.timestamp = in_frameIndex;
@@ -931,16 +984,14 @@ bool C2SoftDav1dDec::outputBuffer(const std::shared_ptr<C2BlockPool>& pool,
         // outputBuffer.",img.m.timestamp,img.m.timestamp);
     } else {
         res = dav1d_get_picture(mDav1dCtx, &img);
-        if (res == 0) {
-            // ALOGD("Got a picture(out_frameIndex=%ld,timestamp=%ld) from dav1d for
-            // outputBuffer.",img.m.timestamp,img.m.timestamp);
-        } else {
-            ALOGE("failed to get a picture from dav1d for outputBuffer.");
-        }
+        // ALOGD("Got a picture(out_frameIndex=%ld,timestamp=%ld) from dav1d for
+        // outputBuffer.",img.m.timestamp,img.m.timestamp);
     }
 
     if (res == DAV1D_ERR(EAGAIN)) {
-        ALOGD("Not enough data to output a picture.");
+        // Expected while frames are decoded in parallel; the work is finished once its
+        // picture is output.
+        ALOGV("Not enough data to output a picture.");
         return false;
     }
     if (res != 0) {
@@ -48,6 +48,48 @@ constexpr char COMPONENT_NAME[] = CODECNAME;
 
 constexpr size_t kMinInputBufferSize = 2 * 1024 * 1024;
 
+constexpr uint32_t kMaxThreadCount = 16;
+constexpr uint32_t kMaxFrameDelay = 8;
+
+static int GetCPUCoreCount() {
+  int cpuCoreCount = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+  cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+  // _SC_NPROC_ONLN must be defined...
+  cpuCoreCount = sysconf(_SC_NPROC_ONLN);
+#endif
+  CHECK(cpuCoreCount >= 1);
+  ALOGV("Number of CPU cores: %d", cpuCoreCount);
+  return cpuCoreCount;
+}
+
+// Returns the number of threads to use for a thread budget configured by the client.
+static int GetNumThreads(uint32_t threadCount) {
+  if (threadCount > 0) {
+    return threadCount;
+  }
+  int threads = GetCPUCoreCount();
+  int32_t numThreads = android::base::GetIntProperty(kNumThreadsProperty, 0);
+  if (numThreads > 0 && numThreads < threads) {
+    threads = numThreads;
+  }
+  return threads;
+}
+
+// Returns the number of frames that can be in flight in frame parallel mode,
+// which libgav1 uses when it has more than one thread.
+static uint32_t GetFrameDelay(int numThreads) {
+  return numThreads > 1 ? std::min((uint32_t)numThreads, kMaxFrameDelay) : 0u;
+}
+
+// Unmaps an input buffer once libgav1 no longer references it. In frame
+// parallel mode this can be after process() returned for that input.
+static void ReleaseInputBuffer(void * /* callbackPrivateData */,
+                               void *bufferPrivateData) {
+  delete static_cast<C2ReadView *>(bufferPrivateData);
+}
+
 class C2SoftGav1Dec::IntfImpl : public SimpleInterface<void>::BaseParams {
  public:
   explicit IntfImpl(const std::shared_ptr<C2ReflectorHelper> &helper)
@@ -244,6 +286,31 @@ class C2SoftGav1Dec::IntfImpl : public SimpleInterface<void>::BaseParams {
             .withFields({C2F(mPixelFormat, value).oneOf(pixelFormats)})
             .withSetter((Setter<decltype(*mPixelFormat)>::StrictValueWithNoDeps))
             .build());
+
+    addParameter(
+            DefineParam(mThreadCount, C2_PARAMKEY_THREAD_COUNT)
+            .withDefault(new C2GlobalThreadCountTuning(0u))
+            .withFields({C2F(mThreadCount, value).inRange(0, kMaxThreadCount)})
+            .withSetter(Setter<decltype(*mThreadCount)>::StrictValueWithNoDeps)
+            .build());
+
+    // Frames decoded in parallel are completed out of order, after later
+    // inputs have been queued.
+    addParameter(
+            DefineParam(mActualOutputDelay, C2_PARAMKEY_OUTPUT_DELAY)
+            .withDefault(new C2PortActualDelayTuning::output(
+                    GetFrameDelay(GetNumThreads(0u))))
+            .withFields({C2F(mActualOutputDelay, value).inRange(0, kMaxFrameDelay)})
+            .calculatedAs(OutputDelaySetter, mThreadCount)
+            .build());
+  }
+
+  static C2R OutputDelaySetter(bool mayBlock,
+                               C2P<C2PortActualDelayTuning::output> &me,
+                               const C2P<C2GlobalThreadCountTuning> &threadCount) {
+    (void)mayBlock;
+    me.set().value = GetFrameDelay(GetNumThreads(threadCount.v.value));
+    return C2R::Ok();
   }
 
   static C2R SizeSetter(bool mayBlock,
@@ -367,6 +434,8 @@ class C2SoftGav1Dec::IntfImpl : public SimpleInterface<void>::BaseParams {
   // unsafe getters
   std::shared_ptr<C2StreamPixelFormatInfo::output> getPixelFormat_l() const { return mPixelFormat; }
 
+  uint32_t getThreadCount_l() const { return mThreadCount->value; }
+
   static C2R HdrStaticInfoSetter(bool mayBlock, C2P<C2StreamHdrStaticInfo::output> &me) {
     (void)mayBlock;
     if (me.v.mastering.red.x > 1) {
@@ -421,6 +490,7 @@ class C2SoftGav1Dec::IntfImpl : public SimpleInterface<void>::BaseParams {
   std::shared_ptr<C2StreamHdr10PlusInfo::input> mHdr10PlusInfoInput;
   std::shared_ptr<C2StreamHdr10PlusInfo::output> mHdr10PlusInfoOutput;
   std::shared_ptr<C2StreamHdrStaticInfo::output> mHdrStaticInfo;
+  std::shared_ptr<C2GlobalThreadCountTuning> mThreadCount;
 };
 
 C2SoftGav1Dec::C2SoftGav1Dec(const char *name, c2_node_id_t id,
@@ -459,6 +529,8 @@ void C2SoftGav1Dec::onReset() {
 void C2SoftGav1Dec::onRelease() { destroyDecoder(); }
 
 c2_status_t C2SoftGav1Dec::onFlush_sm() {
+  // This drops the frames still being decoded in frame parallel mode.
+  mFramesInFlight = 0;
   Libgav1StatusCode status = mCodecCtx->SignalEOS();
   if (status != kLibgav1StatusOk) {
     ALOGE("Failed to flush av1 decoder. status: %d.", status);
@@ -480,26 +552,15 @@ c2_status_t C2SoftGav1Dec::onFlush_sm() {
   return C2_OK;
 }
 
-static int GetCPUCoreCount() {
-  int cpuCoreCount = 1;
-#if defined(_SC_NPROCESSORS_ONLN)
-  cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
-#else
-  // _SC_NPROC_ONLN must be defined...
-  cpuCoreCount = sysconf(_SC_NPROC_ONLN);
-#endif
-  CHECK(cpuCoreCount >= 1);
-  ALOGV("Number of CPU cores: %d", cpuCoreCount);
-  return cpuCoreCount;
-}
-
 bool C2SoftGav1Dec::initDecoder() {
   mSignalledError = false;
   mSignalledOutputEos = false;
   mHalPixelFormat = HAL_PIXEL_FORMAT_YV12;
+  uint32_t threadCount;
   {
       IntfImpl::Lock lock = mIntf->lock();
       mPixelFormatInfo = mIntf->getPixelFormat_l();
+      threadCount = mIntf->getThreadCount_l();
   }
   mCodecCtx.reset(new libgav1::Decoder());
 
@@ -509,11 +570,15 @@ bool C2SoftGav1Dec::initDecoder() {
   }
 
   libgav1::DecoderSettings settings = {};
-  settings.threads = GetCPUCoreCount();
-  int32_t numThreads = android::base::GetIntProperty(kNumThreadsProperty, 0);
-  if (numThreads > 0 && numThreads < settings.threads) {
-    settings.threads = numThreads;
-  }
+  settings.threads = GetNumThreads(threadCount);
+  // Decode several frames in parallel when there are threads for it. Frames
+  // are then only dequeued when the decoder is full or drained, so dequeueing
+  // blocks until the oldest frame is decoded.
+  mFrameParallel = settings.threads > 1;
+  mFramesInFlight = 0;
+  settings.frame_parallel = mFrameParallel;
+  settings.blocking_dequeue = mFrameParallel;
+  settings.release_input_buffer = ReleaseInputBuffer;
 
   ALOGV("Using libgav1 AV1 software decoder.");
   Libgav1StatusCode status = mCodecCtx->Init(&settings);
@@ -539,9 +604,10 @@ void fillEmptyWork(const std::unique_ptr<C2Work> &work) {
   work->workletsProcessed = 1u;
 }
 
-void C2SoftGav1Dec::finishWork(uint64_t index,
-                               const std::unique_ptr<C2Work> &work,
-                               const std::shared_ptr<C2GraphicBlock> &block) {
+void C2SoftGav1Dec::finishWork(
+    uint64_t index, const std::unique_ptr<C2Work> &work,
+    const std::shared_ptr<C2GraphicBlock> &block,
+    std::vector<std::unique_ptr<C2Param>> *configUpdate) {
   std::shared_ptr<C2Buffer> buffer =
       createGraphicBuffer(block, C2Rect(mWidth, mHeight));
   {
@@ -564,7 +630,19 @@ void C2SoftGav1Dec::finishWork(uint64_t index,
   if (work && c2_cntr64_t(index) == work->input.ordinal.frameIndex) {
     fillWork(work);
   } else {
-    finish(index, fillWork);
+    // The config updates gathered while outputting the frame belong to the
+    // work of the frame.
+    auto frameConfigUpdate =
+        std::make_shared<std::vector<std::unique_ptr<C2Param>>>();
+    frameConfigUpdate->swap(*configUpdate);
+    finish(index, [fillWork, frameConfigUpdate](
+                      const std::unique_ptr<C2Work> &work) {
+      fillWork(work);
+      for (std::unique_ptr<C2Param> &param : *frameConfigUpdate) {
+        work->worklets.front()->output.configUpdate.push_back(
+            std::move(param));
+      }
+    });
   }
 }
 
@@ -612,9 +690,14 @@ void C2SoftGav1Dec::process(const std::unique_ptr<C2Work> &work,
     mTimeStart = systemTime();
     nsecs_t delay = mTimeStart - mTimeEnd;
 
-    const Libgav1StatusCode status =
-        mCodecCtx->EnqueueFrame(bitstream, inSize, frameIndex,
-                                /*buffer_private_data=*/nullptr);
+    C2ReadView *inputView = new C2ReadView(rView);
+    Libgav1StatusCode status =
+        mCodecCtx->EnqueueFrame(bitstream, inSize, frameIndex, inputView);
+    if (status == kLibgav1StatusTryAgain) {
+      // All frame threads are busy; output the oldest frame to make room.
+      (void)outputBuffer(pool, work);
+      status = mCodecCtx->EnqueueFrame(bitstream, inSize, frameIndex, inputView);
+    }
 
     mTimeEnd = systemTime();
     nsecs_t decodeTime = mTimeEnd - mTimeStart;
@@ -622,15 +705,21 @@ void C2SoftGav1Dec::process(const std::unique_ptr<C2Work> &work,
 
     if (status != kLibgav1StatusOk) {
       ALOGE("av1 decoder failed to decode frame. status: %d.", status);
+      delete inputView;
       work->result = C2_CORRUPTED;
       work->workletsProcessed = 1u;
       mSignalledError = true;
       return;
     }
-
+    if (mFrameParallel) {
+      ++mFramesInFlight;
+    }
   }
 
-  (void)outputBuffer(pool, work);
+  // In frame parallel mode the work stays pending until its frame is output.
+  if (!mFrameParallel) {
+    (void)outputBuffer(pool, work);
+  }
 
   if (eos) {
     drainInternal(DRAIN_COMPONENT_WITH_EOS, pool, work);
@@ -762,15 +851,21 @@ bool C2SoftGav1Dec::allocTmpFrameBuffer(size_t size) {
 
 bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
                                  const std::unique_ptr<C2Work> &work) {
-  if (!(work && pool)) return false;
+  if (!pool) return false;
 
   const libgav1::DecoderBuffer *buffer;
   const Libgav1StatusCode status = mCodecCtx->DequeueFrame(&buffer);
 
   if (status != kLibgav1StatusOk && status != kLibgav1StatusNothingToDequeue) {
     ALOGE("av1 decoder DequeueFrame failed. status: %d.", status);
+    mFramesInFlight = 0;
     return false;
   }
+  if (status == kLibgav1StatusNothingToDequeue) {
+    mFramesInFlight = 0;
+  } else if (mFramesInFlight > 0) {
+    --mFramesInFlight;
+  }
 
   // |buffer| can be NULL if status was equal to kLibgav1StatusOk or
   // kLibgav1StatusNothingToDequeue. This is not an error. This could mean one
@@ -781,6 +876,16 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
     return false;
   }
 
+  // drain() has no work of its own. The output info of the frame is then
+  // gathered on a placeholder, and goes to the work of the frame in
+  // finishWork().
+  std::unique_ptr<C2Work> placeholder;
+  if (!work) {
+    placeholder.reset(new C2Work);
+    placeholder->worklets.emplace_back(new C2Worklet);
+  }
+  const std::unique_ptr<C2Work> &outWork = work ? work : placeholder;
+
   const int width = buffer->displayed_width[0];
   const int height = buffer->displayed_height[0];
   if (width != mWidth || height != mHeight) {
@@ -791,20 +896,20 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
     std::vector<std::unique_ptr<C2SettingResult>> failures;
     c2_status_t err = mIntf->config({&size}, C2_MAY_BLOCK, &failures);
     if (err == C2_OK) {
-      work->worklets.front()->output.configUpdate.push_back(
+      outWork->worklets.front()->output.configUpdate.push_back(
           C2Param::Copy(size));
     } else {
       ALOGE("Config update size failed");
       mSignalledError = true;
-      work->result = C2_CORRUPTED;
-      work->workletsProcessed = 1u;
+      outWork->result = C2_CORRUPTED;
+      outWork->workletsProcessed = 1u;
       return false;
     }
   }
 
   getVuiParams(buffer);
-  getHDRStaticParams(buffer, work);
-  getHDR10PlusInfoData(buffer, work);
+  getHDRStaticParams(buffer, outWork);
+  getHDR10PlusInfoData(buffer, outWork);
 
 #if LIBYUV_VERSION < 1779
   if (buffer->bitdepth == 10 &&
@@ -812,8 +917,8 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
         buffer->image_format == libgav1::kImageFormatMonochrome400)) {
     ALOGE("image_format %d not supported for 10bit", buffer->image_format);
     mSignalledError = true;
-    work->workletsProcessed = 1u;
-    work->result = C2_CORRUPTED;
+    outWork->workletsProcessed = 1u;
+    outWork->result = C2_CORRUPTED;
     return false;
   }
 #endif
@@ -839,8 +944,8 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
         (buffer->image_format != libgav1::kImageFormatYuv420)) {
         ALOGE("Only YUV420 output is supported when targeting RGBA_1010102");
       mSignalledError = true;
-      work->result = C2_OMITTED;
-      work->workletsProcessed = 1u;
+      outWork->result = C2_OMITTED;
+      outWork->workletsProcessed = 1u;
       return false;
     }
 #endif
@@ -851,13 +956,13 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
     std::vector<std::unique_ptr<C2SettingResult>> failures;
     c2_status_t err = mIntf->config({&pixelFormat }, C2_MAY_BLOCK, &failures);
     if (err == C2_OK) {
-      work->worklets.front()->output.configUpdate.push_back(
+      outWork->worklets.front()->output.configUpdate.push_back(
           C2Param::Copy(pixelFormat));
     } else {
       ALOGE("Config update pixelFormat failed");
       mSignalledError = true;
-      work->workletsProcessed = 1u;
-      work->result = C2_CORRUPTED;
+      outWork->workletsProcessed = 1u;
+      outWork->result = C2_CORRUPTED;
       return UNKNOWN_ERROR;
     }
     mHalPixelFormat = format;
@@ -874,7 +979,7 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
 
   if (err != C2_OK) {
     ALOGE("fetchGraphicBlock for Output failed with status %d", err);
-    work->result = err;
+    outWork->result = err;
     return false;
   }
 
@@ -882,7 +987,7 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
 
   if (wView.error()) {
     ALOGE("graphic view map failed %d", wView.error());
-    work->result = C2_CORRUPTED;
+    outWork->result = C2_CORRUPTED;
     return false;
   }
 
@@ -927,7 +1032,7 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
                 const bool needFill = tmpSize > mTmpFrameBufferSize;
                 if (!allocTmpFrameBuffer(tmpSize)) {
                     ALOGE("Error allocating temp conversion buffer (%zu bytes)", tmpSize);
-                    setError(work, C2_NO_MEMORY);
+                    setError(outWork, C2_NO_MEMORY);
                     return false;
                 }
                 srcU = srcV = mTmpFrameBuffer.get();
@@ -956,7 +1061,7 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
             const size_t tmpSize = dstYStride * mHeight + dstUStride * align(mHeight, 2);
             if (!allocTmpFrameBuffer(tmpSize)) {
                 ALOGE("Error allocating temp conversion buffer (%zu bytes)", tmpSize);
-                setError(work, C2_NO_MEMORY);
+                setError(outWork, C2_NO_MEMORY);
                 return false;
             }
             uint16_t *const tmpY = mTmpFrameBuffer.get();
@@ -992,7 +1097,7 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
             const size_t tmpSize = dstYStride * mHeight + dstUStride * align(mHeight, 2);
             if (!allocTmpFrameBuffer(tmpSize)) {
                 ALOGE("Error allocating temp conversion buffer (%zu bytes)", tmpSize);
-                setError(work, C2_NO_MEMORY);
+                setError(outWork, C2_NO_MEMORY);
                 return false;
             }
             uint16_t *const tmpY = mTmpFrameBuffer.get();
@@ -1041,7 +1146,8 @@ bool C2SoftGav1Dec::outputBuffer(const std::shared_ptr<C2BlockPool> &pool,
                                    isMonochrome);
     }
   }
-  finishWork(buffer->user_private_data, work, std::move(block));
+  finishWork(buffer->user_private_data, work, std::move(block),
+             &outWork->worklets.front()->output.configUpdate);
   block = nullptr;
   return true;
 }
@@ -1058,6 +1164,12 @@ c2_status_t C2SoftGav1Dec::drainInternal(
     return C2_OMITTED;
   }
 
+  // SignalEOS() drops the frames still being decoded in frame parallel mode,
+  // so output them first.
+  while (mFramesInFlight > 0) {
+    (void)outputBuffer(pool, work);
+  }
+
   const Libgav1StatusCode status = mCodecCtx->SignalEOS();
   if (status != kLibgav1StatusOk) {
     ALOGE("Failed to flush av1 decoder. status: %d.", status);
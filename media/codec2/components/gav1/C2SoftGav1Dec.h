@@ -62,6 +62,10 @@ struct C2SoftGav1Dec : public SimpleC2Component {
   uint32_t mHeight;
   bool mSignalledOutputEos;
   bool mSignalledError;
+  // Whether frames are decoded in parallel, and how many of them have been
+  // enqueued but not dequeued yet.
+  bool mFrameParallel = false;
+  int mFramesInFlight = 0;
   // Used during 10-bit I444/I422 to 10-bit P010 & 8-bit I420 conversions.
   std::unique_ptr<uint16_t[]> mTmpFrameBuffer;
   size_t mTmpFrameBufferSize = 0;
@@ -100,11 +104,15 @@ struct C2SoftGav1Dec : public SimpleC2Component {
                   const std::unique_ptr<C2Work> &work);
   void getVuiParams(const libgav1::DecoderBuffer *buffer);
   void destroyDecoder();
+  // Outputs |block| to the work of frame |index|, along with |configUpdate|
+  // when that is not |work|.
   void finishWork(uint64_t index, const std::unique_ptr<C2Work>& work,
-                  const std::shared_ptr<C2GraphicBlock>& block);
+                  const std::shared_ptr<C2GraphicBlock>& block,
+                  std::vector<std::unique_ptr<C2Param>>* configUpdate);
   // Sets |work->result| and mSignalledError. Returns false.
   void setError(const std::unique_ptr<C2Work> &work, c2_status_t error);
   bool allocTmpFrameBuffer(size_t size);
+  // |work| is null when called from drain().
   bool outputBuffer(const std::shared_ptr<C2BlockPool>& pool,
                     const std::unique_ptr<C2Work>& work);
   c2_status_t drainInternal(uint32_t drainMode,
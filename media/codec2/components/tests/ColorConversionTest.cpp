@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "ColorConversionTest"
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <Codec2CommonUtils.h>
+#include <SimpleC2Component.h>
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+using namespace android;
+
+// Checks that the pixel conversion helpers of SimpleC2Component are bit-exact with
+// straightforward per-pixel implementations, for sizes that exercise both the
+// vectorized bodies and the scalar tails.
+
+namespace {
+
+constexpr uint16_t kNeutralUV10 = 512;
+// Extra elements at the end of each row, which must not be written.
+constexpr size_t kPadding = 7;
+constexpr uint16_t kGuard16 = 0xDEAD;
+constexpr uint8_t kGuard8 = 0xA5;
+
+std::vector<uint16_t> makePlane10(size_t stride, size_t height, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<uint16_t> dist(0, 1023);
+    std::vector<uint16_t> plane(stride * height);
+    for (uint16_t &sample : plane) {
+        sample = dist(gen);
+    }
+    return plane;
+}
+
+void referenceYUV420Planar16ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV,
+                                   const uint16_t *srcY, const uint16_t *srcU,
+                                   const uint16_t *srcV, size_t srcYStride, size_t srcUVStride,
+                                   size_t dstYStride, size_t dstUVStride, size_t width,
+                                   size_t height, bool isMonochrome) {
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            dstY[y * dstYStride + x] = srcY[y * srcYStride + x] >> 2;
+        }
+    }
+    for (size_t y = 0; y < (height + 1) / 2; ++y) {
+        for (size_t x = 0; x < (width + 1) / 2; ++x) {
+            dstU[y * dstUVStride + x] = isMonochrome ? 128 : srcU[y * srcUVStride + x] >> 2;
+            dstV[y * dstUVStride + x] = isMonochrome ? 128 : srcV[y * srcUVStride + x] >> 2;
+        }
+    }
+}
+
+void referenceYUV420Planar16ToP010(uint16_t *dstY, uint16_t *dstUV, const uint16_t *srcY,
+                                   const uint16_t *srcU, const uint16_t *srcV,
+                                   size_t srcYStride, size_t srcUVStride, size_t dstYStride,
+                                   size_t dstUVStride, size_t width, size_t height,
+                                   bool isMonochrome) {
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            dstY[y * dstYStride + x] = srcY[y * srcYStride + x] << 6;
+        }
+    }
+    for (size_t y = 0; y < (height + 1) / 2; ++y) {
+        for (size_t x = 0; x < (width + 1) / 2; ++x) {
+            uint16_t u = isMonochrome ? kNeutralUV10 : srcU[y * srcUVStride + x];
+            uint16_t v = isMonochrome ? kNeutralUV10 : srcV[y * srcUVStride + x];
+            dstUV[y * dstUVStride + 2 * x] = u << 6;
+            dstUV[y * dstUVStride + 2 * x + 1] = v << 6;
+        }
+    }
+}
+
+void referenceP010ToYUV420Planar16(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
+                                   const uint16_t *srcY, const uint16_t *srcUV,
+                                   size_t srcYStride, size_t srcUVStride, size_t dstYStride,
+                                   size_t dstUVStride, size_t width, size_t height,
+                                   bool isMonochrome) {
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            dstY[y * dstYStride + x] = srcY[y * srcYStride + x] >> 6;
+        }
+    }
+    for (size_t y = 0; y < (height + 1) / 2; ++y) {
+        for (size_t x = 0; x < (width + 1) / 2; ++x) {
+            dstU[y * dstUVStride + x] =
+                    isMonochrome ? kNeutralUV10 : srcUV[y * srcUVStride + 2 * x] >> 6;
+            dstV[y * dstUVStride + x] =
+                    isMonochrome ? kNeutralUV10 : srcUV[y * srcUVStride + 2 * x + 1] >> 6;
+        }
+    }
+}
+
+void referenceYUV420Planar16ToY410(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+                                   const uint16_t *srcV, size_t srcYStride, size_t srcUVStride,
+                                   size_t dstStride, size_t width, size_t height) {
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            uint32_t u = srcU[(y / 2) * srcUVStride + x / 2];
+            uint32_t v = srcV[(y / 2) * srcUVStride + x / 2];
+            dst[y * dstStride + x] = 3u << 30 | (v << 20) | (srcY[y * srcYStride + x] << 10) | u;
+        }
+    }
+}
+
+// Full range BT.709, see GetCoeffsForAspects().
+void referenceYUV420Planar16ToRGBA1010102(uint32_t *dst, const uint16_t *srcY,
+                                          const uint16_t *srcU, const uint16_t *srcV,
+                                          size_t srcYStride, size_t srcUVStride,
+                                          size_t dstStride, size_t width, size_t height) {
+    const int32_t cy = 1024, cRV = 1613, cGU = 192, cGV = 479, cBU = 1900;
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            int32_t u = srcU[(y / 2) * srcUVStride + x / 2] - 512;
+            int32_t v = srcV[(y / 2) * srcUVStride + x / 2] - 512;
+            int32_t yMult = srcY[y * srcYStride + x] * cy + 512;
+            int32_t b = std::clamp((yMult + u * cBU) / 1024, 0, 1023);
+            int32_t g = std::clamp((yMult - u * cGU - v * cGV) / 1024, 0, 1023);
+            int32_t r = std::clamp((yMult + v * cRV) / 1024, 0, 1023);
+            dst[y * dstStride + x] = 3u << 30 | (b << 20) | (g << 10) | r;
+        }
+    }
+}
+
+class ColorConversionTest
+    : public ::testing::TestWithParam<std::tuple<size_t /* width */, size_t /* height */>> {
+  public:
+    void SetUp() override {
+        std::tie(mWidth, mHeight) = GetParam();
+        mYStride = mWidth + kPadding;
+        mUVStride = (mWidth + 1) / 2 + kPadding;
+        mUVHeight = (mHeight + 1) / 2;
+    }
+
+  protected:
+    size_t mWidth;
+    size_t mHeight;
+    size_t mYStride;
+    size_t mUVStride;
+    size_t mUVHeight;
+};
+
+}  // namespace
+
+TEST_P(ColorConversionTest, Planar16ToYV12) {
+    const std::vector<uint16_t> srcY = makePlane10(mYStride, mHeight, 1);
+    const std::vector<uint16_t> srcU = makePlane10(mUVStride, mUVHeight, 2);
+    const std::vector<uint16_t> srcV = makePlane10(mUVStride, mUVHeight, 3);
+    for (bool isMonochrome : {false, true}) {
+        std::vector<uint8_t> y(mYStride * mHeight, kGuard8), refY(y);
+        std::vector<uint8_t> u(mUVStride * mUVHeight, kGuard8), refU(u), v(u), refV(u);
+        convertYUV420Planar16ToYV12(y.data(), u.data(), v.data(), srcY.data(), srcU.data(),
+                                    srcV.data(), mYStride, mUVStride, mUVStride, mYStride,
+                                    mUVStride, mWidth, mHeight, isMonochrome);
+        referenceYUV420Planar16ToYV12(refY.data(), refU.data(), refV.data(), srcY.data(),
+                                      srcU.data(), srcV.data(), mYStride, mUVStride, mYStride,
+                                      mUVStride, mWidth, mHeight, isMonochrome);
+        EXPECT_EQ(refY, y) << "monochrome " << isMonochrome;
+        EXPECT_EQ(refU, u) << "monochrome " << isMonochrome;
+        EXPECT_EQ(refV, v) << "monochrome " << isMonochrome;
+    }
+}
+
+TEST_P(ColorConversionTest, Planar16ToP010) {
+    const std::vector<uint16_t> srcY = makePlane10(mYStride, mHeight, 4);
+    const std::vector<uint16_t> srcU = makePlane10(mUVStride, mUVHeight, 5);
+    const std::vector<uint16_t> srcV = makePlane10(mUVStride, mUVHeight, 6);
+    const size_t dstUVStride = mUVStride * 2;
+    for (bool isMonochrome : {false, true}) {
+        std::vector<uint16_t> y(mYStride * mHeight, kGuard16), refY(y);
+        std::vector<uint16_t> uv(dstUVStride * mUVHeight, kGuard16), refUV(uv);
+        convertYUV420Planar16ToP010(y.data(), uv.data(), srcY.data(), srcU.data(), srcV.data(),
+                                    mYStride, mUVStride, mUVStride, mYStride, dstUVStride,
+                                    mWidth, mHeight, isMonochrome);
+        referenceYUV420Planar16ToP010(refY.data(), refUV.data(), srcY.data(), srcU.data(),
+                                      srcV.data(), mYStride, mUVStride, mYStride, dstUVStride,
+                                      mWidth, mHeight, isMonochrome);
+        EXPECT_EQ(refY, y) << "monochrome " << isMonochrome;
+        EXPECT_EQ(refUV, uv) << "monochrome " << isMonochrome;
+    }
+}
+
+TEST_P(ColorConversionTest, P010ToPlanar16) {
+    const size_t srcUVStride = mUVStride * 2;
+    std::vector<uint16_t> srcY = makePlane10(mYStride, mHeight, 7);
+    std::vector<uint16_t> srcUV = makePlane10(srcUVStride, mUVHeight, 8);
+    for (uint16_t &sample : srcY) {
+        sample <<= 6;
+    }
+    for (uint16_t &sample : srcUV) {
+        sample <<= 6;
+    }
+    for (bool isMonochrome : {false, true}) {
+        std::vector<uint16_t> y(mYStride * mHeight, kGuard16), refY(y);
+        std::vector<uint16_t> u(mUVStride * mUVHeight, kGuard16), refU(u), v(u), refV(u);
+        convertP010ToYUV420Planar16(y.data(), u.data(), v.data(), srcY.data(), srcUV.data(),
+                                    mYStride, srcUVStride, mYStride, mUVStride, mUVStride,
+                                    mWidth, mHeight, isMonochrome);
+        referenceP010ToYUV420Planar16(refY.data(), refU.data(), refV.data(), srcY.data(),
+                                      srcUV.data(), mYStride, srcUVStride, mYStride, mUVStride,
+                                      mWidth, mHeight, isMonochrome);
+        EXPECT_EQ(refY, y) << "monochrome " << isMonochrome;
+        EXPECT_EQ(refU, u) << "monochrome " << isMonochrome;
+        EXPECT_EQ(refV, v) << "monochrome " << isMonochrome;
+    }
+}
+
+TEST_P(ColorConversionTest, Planar16ToY410) {
+    // The conversion works on pairs of lines and columns.
+    if (mWidth % 2 || mHeight % 2) {
+        GTEST_SKIP() << "odd size";
+    }
+    const std::vector<uint16_t> srcY = makePlane10(mYStride, mHeight, 13);
+    const std::vector<uint16_t> srcU = makePlane10(mUVStride, mUVHeight, 14);
+    const std::vector<uint16_t> srcV = makePlane10(mUVStride, mUVHeight, 15);
+    std::vector<uint32_t> y410(mYStride * mHeight, kGuard16), refY410(y410);
+    convertYUV420Planar16ToY410(y410.data(), srcY.data(), srcU.data(), srcV.data(), mYStride,
+                                mUVStride, mUVStride, mYStride, mWidth, mHeight);
+    referenceYUV420Planar16ToY410(refY410.data(), srcY.data(), srcU.data(), srcV.data(),
+                                  mYStride, mUVStride, mYStride, mWidth, mHeight);
+    EXPECT_EQ(refY410, y410);
+}
+
+TEST_P(ColorConversionTest, Planar16ToRGBA1010102) {
+    if (!isAtLeastT()) {
+        GTEST_SKIP() << "Y410 is used before T";
+    }
+    // The conversion works on pairs of lines and columns.
+    if (mWidth % 2 || mHeight % 2) {
+        GTEST_SKIP() << "odd size";
+    }
+    const std::vector<uint16_t> srcY = makePlane10(mYStride, mHeight, 9);
+    const std::vector<uint16_t> srcU = makePlane10(mUVStride, mUVHeight, 10);
+    const std::vector<uint16_t> srcV = makePlane10(mUVStride, mUVHeight, 11);
+    std::shared_ptr<C2ColorAspectsStruct> aspects = std::make_shared<C2ColorAspectsStruct>(
+            C2Color::RANGE_FULL, C2Color::PRIMARIES_BT709, C2Color::TRANSFER_SRGB,
+            C2Color::MATRIX_BT709);
+    std::vector<uint32_t> rgba(mYStride * mHeight, kGuard16), refRgba(rgba);
+    convertYUV420Planar16ToY410OrRGBA1010102(rgba.data(), srcY.data(), srcU.data(), srcV.data(),
+                                             mYStride, mUVStride, mUVStride, mYStride, mWidth,
+                                             mHeight, aspects);
+    referenceYUV420Planar16ToRGBA1010102(refRgba.data(), srcY.data(), srcU.data(), srcV.data(),
+                                         mYStride, mUVStride, mYStride, mWidth, mHeight);
+    EXPECT_EQ(refRgba, rgba);
+}
+
+TEST_P(ColorConversionTest, RGBA1010102ToPlanar16) {
+    // The destination planes are packed and the conversion works on pairs of lines.
+    if (mWidth % 2 || mHeight % 2) {
+        GTEST_SKIP() << "odd size";
+    }
+    std::mt19937 gen(12);
+    std::vector<uint32_t> src(mYStride * mHeight);
+    for (uint32_t &pixel : src) {
+        pixel = gen();
+    }
+    for (C2Color::matrix_t matrix : {C2Color::MATRIX_BT709, C2Color::MATRIX_BT2020}) {
+        for (C2Color::range_t range : {C2Color::RANGE_FULL, C2Color::RANGE_LIMITED}) {
+            std::vector<uint16_t> yuv(mWidth * mHeight * 3 / 2, kGuard16);
+            convertRGBA1010102ToYUV420Planar16(
+                    yuv.data(), yuv.data() + mWidth * mHeight,
+                    yuv.data() + mWidth * mHeight * 5 / 4, src.data(), mYStride, mWidth,
+                    mHeight, matrix, range);
+
+            static const int16_t bt709[2][3][3] = {
+                { { 218, 732, 74 }, { -117, -395, 512 }, { 512, -465, -47 } },
+                { { 186, 627, 63 }, { -103, -345, 448 }, { 448, -407, -41 } },
+            };
+            static const int16_t bt2020[2][3][3] = {
+                { { 269, 694, 61 }, { -143, -369, 512 }, { 512, -471, -41 } },
+                { { 230, 594, 52 }, { -125, -323, 448 }, { 448, -412, -36 } },
+            };
+            const int rangeIndex = range == C2Color::RANGE_FULL ? 0 : 1;
+            const int16_t (*weights)[3] =
+                    matrix == C2Color::MATRIX_BT709 ? bt709[rangeIndex] : bt2020[rangeIndex];
+            const int32_t zero = range == C2Color::RANGE_FULL ? 0 : 64;
+            const int32_t maxLuma = range == C2Color::RANGE_FULL ? 1023 : 940;
+            const int32_t maxChroma = range == C2Color::RANGE_FULL ? 1023 : 960;
+            for (size_t y = 0; y < mHeight; ++y) {
+                for (size_t x = 0; x < mWidth; ++x) {
+                    uint32_t pixel = src[y * mYStride + x];
+                    int32_t b = (pixel >> 20) & 0x3FF, g = (pixel >> 10) & 0x3FF,
+                            r = pixel & 0x3FF;
+                    int32_t luma = ((r * weights[0][0] + g * weights[0][1] + b * weights[0][2] +
+                                     512) >> 10) + zero;
+                    ASSERT_EQ(std::clamp(luma, zero, maxLuma), yuv[y * mWidth + x])
+                            << "Y at " << x << "," << y;
+                    if (x % 2 || y % 2) {
+                        continue;
+                    }
+                    size_t chroma = (y / 2) * (mWidth / 2) + x / 2;
+                    int32_t u = ((r * weights[1][0] + g * weights[1][1] + b * weights[1][2] +
+                                  512) >> 10) + 512;
+                    int32_t v = ((r * weights[2][0] + g * weights[2][1] + b * weights[2][2] +
+                                  512) >> 10) + 512;
+                    ASSERT_EQ(std::clamp(u, zero, maxChroma), yuv[mWidth * mHeight + chroma])
+                            << "U at " << x << "," << y;
+                    ASSERT_EQ(std::clamp(v, zero, maxChroma),
+                              yuv[mWidth * mHeight * 5 / 4 + chroma])
+                            << "V at " << x << "," << y;
+                }
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        ColorConversion, ColorConversionTest,
+        ::testing::Values(std::make_tuple(2, 2), std::make_tuple(6, 4), std::make_tuple(17, 9),
+                          std::make_tuple(22, 6), std::make_tuple(64, 32), std::make_tuple(1920, 1080),
+                          std::make_tuple(3840, 2160)));
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int status = RUN_ALL_TESTS();
+    ALOGV("Test result = %d\n", status);
+    return status;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the pixel conversion helpers software codecs use to copy 10-bit
+// frames in and out of their output buffers, for 1080p and 4K frames.
+
+#include <memory>
+#include <vector>
+
+#include <SimpleC2Component.h>
+#include <benchmark/benchmark.h>
+
+using namespace android;
+
+namespace {
+
+struct Frame {
+    explicit Frame(size_t width, size_t height)
+        : width(width), height(height),
+          y(width * height, 0x155), u(width * height / 4, 0x200), v(width * height / 4, 0x1FF) {}
+
+    size_t width;
+    size_t height;
+    std::vector<uint16_t> y;
+    std::vector<uint16_t> u;
+    std::vector<uint16_t> v;
+};
+
+}  // namespace
+
+static void BM_Planar16ToRGBA1010102(benchmark::State& state) {
+    const Frame frame(state.range(0), state.range(1));
+    std::vector<uint32_t> dst(frame.width * frame.height);
+    std::shared_ptr<C2ColorAspectsStruct> aspects = std::make_shared<C2ColorAspectsStruct>(
+            C2Color::RANGE_LIMITED, C2Color::PRIMARIES_BT2020, C2Color::TRANSFER_ST2084,
+            C2Color::MATRIX_BT2020);
+    for (auto _ : state) {
+        convertYUV420Planar16ToY410OrRGBA1010102(
+                dst.data(), frame.y.data(), frame.u.data(), frame.v.data(), frame.width,
+                frame.width / 2, frame.width / 2, frame.width, frame.width, frame.height,
+                aspects);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frame.width * frame.height);
+}
+
+static void BM_Planar16ToY410(benchmark::State& state) {
+    const Frame frame(state.range(0), state.range(1));
+    std::vector<uint32_t> dst(frame.width * frame.height);
+    for (auto _ : state) {
+        convertYUV420Planar16ToY410(
+                dst.data(), frame.y.data(), frame.u.data(), frame.v.data(), frame.width,
+                frame.width / 2, frame.width / 2, frame.width, frame.width, frame.height);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frame.width * frame.height);
+}
+
+static void BM_Planar16ToP010(benchmark::State& state) {
+    const Frame frame(state.range(0), state.range(1));
+    std::vector<uint16_t> dst(frame.width * frame.height * 3 / 2);
+    for (auto _ : state) {
+        convertYUV420Planar16ToP010(
+                dst.data(), dst.data() + frame.width * frame.height, frame.y.data(),
+                frame.u.data(), frame.v.data(), frame.width, frame.width / 2, frame.width / 2,
+                frame.width, frame.width, frame.width, frame.height, false /* isMonochrome */);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frame.width * frame.height);
+}
+
+static void BM_Planar16ToYV12(benchmark::State& state) {
+    const Frame frame(state.range(0), state.range(1));
+    std::vector<uint8_t> dst(frame.width * frame.height * 3 / 2);
+    for (auto _ : state) {
+        uint8_t *dstU = dst.data() + frame.width * frame.height;
+        convertYUV420Planar16ToYV12(
+                dst.data(), dstU, dstU + frame.width * frame.height / 4, frame.y.data(),
+                frame.u.data(), frame.v.data(), frame.width, frame.width / 2, frame.width / 2,
+                frame.width, frame.width / 2, frame.width, frame.height,
+                false /* isMonochrome */);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frame.width * frame.height);
+}
+
+static void BM_P010ToPlanar16(benchmark::State& state) {
+    const Frame frame(state.range(0), state.range(1));
+    // Reuse the Y plane as the interleaved chroma plane of the source.
+    std::vector<uint16_t> dst(frame.width * frame.height * 3 / 2);
+    for (auto _ : state) {
+        uint16_t *dstU = dst.data() + frame.width * frame.height;
+        convertP010ToYUV420Planar16(
+                dst.data(), dstU, dstU + frame.width * frame.height / 4, frame.y.data(),
+                frame.y.data(), frame.width, frame.width, frame.width, frame.width / 2,
+                frame.width / 2, frame.width, frame.height, false /* isMonochrome */);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frame.width * frame.height);
+}
+
+static void BM_RGBA1010102ToPlanar16(benchmark::State& state) {
+    const size_t width = state.range(0);
+    const size_t height = state.range(1);
+    const std::vector<uint32_t> src(width * height, 0xC0155155);
+    std::vector<uint16_t> dst(width * height * 3 / 2);
+    for (auto _ : state) {
+        uint16_t *dstU = dst.data() + width * height;
+        convertRGBA1010102ToYUV420Planar16(
+                dst.data(), dstU, dstU + width * height / 4, src.data(), width, width, height,
+                C2Color::MATRIX_BT2020, C2Color::RANGE_LIMITED);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * width * height);
+}
+
+BENCHMARK(BM_Planar16ToRGBA1010102)->Args({1920, 1080})->Args({3840, 2160});
+BENCHMARK(BM_Planar16ToY410)->Args({1920, 1080})->Args({3840, 2160});
+BENCHMARK(BM_Planar16ToP010)->Args({1920, 1080})->Args({3840, 2160});
+BENCHMARK(BM_Planar16ToYV12)->Args({1920, 1080})->Args({3840, 2160});
+BENCHMARK(BM_P010ToPlanar16)->Args({1920, 1080})->Args({3840, 2160});
+BENCHMARK(BM_RGBA1010102ToPlanar16)->Args({1920, 1080})->Args({3840, 2160});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_NULL_C2_COMPONENT_H_
+#define ANDROID_NULL_C2_COMPONENT_H_
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <C2Config.h>
+#include <SimpleC2Component.h>
+
+namespace android {
+
+// An interface with no parameters other than the low latency mode.
+class NullInterface : public C2ComponentInterface {
+  public:
+    explicit NullInterface(bool lowLatency) : mLowLatency(lowLatency) {}
+
+    C2String getName() const override { return "c2.android.null.test"; }
+    c2_node_id_t getId() const override { return 0; }
+
+    c2_status_t query_vb(
+            const std::vector<C2Param*> &stackParams,
+            const std::vector<C2Param::Index> &heapParamIndices,
+            c2_blocking_t mayBlock,
+            std::vector<std::unique_ptr<C2Param>>* const heapParams) const override {
+        (void)mayBlock;
+        (void)heapParams;
+        c2_status_t err = heapParamIndices.empty() ? C2_OK : C2_BAD_INDEX;
+        for (C2Param *param : stackParams) {
+            if (param->index() == C2GlobalLowLatencyModeTuning::PARAM_TYPE) {
+                C2GlobalLowLatencyModeTuning::From(param)->value =
+                        mLowLatency ? C2_TRUE : C2_FALSE;
+            } else {
+                param->invalidate();
+                err = C2_BAD_INDEX;
+            }
+        }
+        return err;
+    }
+
+    c2_status_t config_vb(
+            const std::vector<C2Param*> &params,
+            c2_blocking_t mayBlock,
+            std::vector<std::unique_ptr<C2SettingResult>>* const failures) override {
+        (void)mayBlock;
+        (void)failures;
+        return params.empty() ? C2_OK : C2_BAD_INDEX;
+    }
+
+    c2_status_t createTunnel_sm(c2_node_id_t) override { return C2_OMITTED; }
+    c2_status_t releaseTunnel_sm(c2_node_id_t) override { return C2_OMITTED; }
+
+    c2_status_t querySupportedParams_nb(
+            std::vector<std::shared_ptr<C2ParamDescriptor>> * const params) const override {
+        params->clear();
+        return C2_OK;
+    }
+
+    c2_status_t querySupportedValues_vb(
+            std::vector<C2FieldSupportedValuesQuery> &fields,
+            c2_blocking_t mayBlock) const override {
+        (void)mayBlock;
+        for (C2FieldSupportedValuesQuery &query : fields) {
+            query.status = C2_BAD_INDEX;
+        }
+        return fields.empty() ? C2_OK : C2_BAD_INDEX;
+    }
+
+  private:
+    const bool mLowLatency;
+};
+
+// A component doing no work, so that only the SimpleC2Component overhead
+// remains. When holding, works are kept pending until drained.
+class NullComponent : public SimpleC2Component {
+  public:
+    NullComponent(bool lowLatency, bool hold)
+        : SimpleC2Component(std::make_shared<NullInterface>(lowLatency)), mHold(hold) {}
+
+    // The thread which processed the last work.
+    std::thread::id processThread() const { return mProcessThread; }
+
+  protected:
+    c2_status_t onInit() override { return C2_OK; }
+    c2_status_t onStop() override { return C2_OK; }
+    void onReset() override {}
+    void onRelease() override {}
+    c2_status_t onFlush_sm() override {
+        mHeld.clear();
+        return C2_OK;
+    }
+
+    void process(const std::unique_ptr<C2Work> &work,
+                 const std::shared_ptr<C2BlockPool> &pool) override {
+        (void)pool;
+        mProcessThread = std::this_thread::get_id();
+        if (mHold) {
+            mHeld.push_back(work->input.ordinal.frameIndex.peeku());
+            return;
+        }
+        work->result = C2_OK;
+        work->workletsProcessed = 1u;
+    }
+
+    c2_status_t drain(uint32_t drainMode, const std::shared_ptr<C2BlockPool> &pool) override {
+        (void)drainMode;
+        (void)pool;
+        for (uint64_t frameIndex : mHeld) {
+            finish(frameIndex, [](const std::unique_ptr<C2Work> &work) {
+                work->result = C2_OK;
+                work->workletsProcessed = 1u;
+            });
+        }
+        mHeld.clear();
+        return C2_OK;
+    }
+
+  private:
+    const bool mHold;
+    std::vector<uint64_t> mHeld;
+    std::atomic<std::thread::id> mProcessThread;
+};
+
+inline std::list<std::unique_ptr<C2Work>> makeWork(uint64_t frameIndex) {
+    std::list<std::unique_ptr<C2Work>> items;
+    std::unique_ptr<C2Work> work(new C2Work);
+    work->input.ordinal.frameIndex = frameIndex;
+    work->input.ordinal.timestamp = frameIndex * 33333;
+    work->worklets.emplace_back(new C2Worklet);
+    items.push_back(std::move(work));
+    return items;
+}
+
+}  // namespace android
+
+#endif  // ANDROID_NULL_C2_COMPONENT_H_
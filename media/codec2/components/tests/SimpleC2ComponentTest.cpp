@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "SimpleC2ComponentTest"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include "NullC2Component.h"
+
+using namespace android;
+
+namespace {
+
+constexpr auto kTimeout = std::chrono::seconds(5);
+
+class Listener : public C2Component::Listener {
+  public:
+    void onWorkDone_nb(std::weak_ptr<C2Component> component,
+                       std::list<std::unique_ptr<C2Work>> workItems) override {
+        (void)component;
+        std::lock_guard<std::mutex> lock(mLock);
+        ++mCallbacks;
+        for (const std::unique_ptr<C2Work> &work : workItems) {
+            mFrameIndices.push_back(work->input.ordinal.frameIndex.peeku());
+        }
+        mCond.notify_all();
+    }
+
+    void onTripped_nb(std::weak_ptr<C2Component> component,
+                      std::vector<std::shared_ptr<C2SettingResult>> settingResult) override {
+        (void)component;
+        (void)settingResult;
+    }
+
+    void onError_nb(std::weak_ptr<C2Component> component, uint32_t errorCode) override {
+        (void)component;
+        ALOGE("onError_nb %u", errorCode);
+    }
+
+    bool waitForWorks(size_t works) {
+        std::unique_lock<std::mutex> lock(mLock);
+        return mCond.wait_for(
+                lock, kTimeout, [this, works] { return mFrameIndices.size() >= works; });
+    }
+
+    size_t callbacks() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mCallbacks;
+    }
+
+    // The frame indices of the done works, in the order they were reported.
+    std::vector<uint64_t> frameIndices() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mFrameIndices;
+    }
+
+  private:
+    std::mutex mLock;
+    std::condition_variable mCond;
+    size_t mCallbacks = 0;
+    std::vector<uint64_t> mFrameIndices;
+};
+
+}  // namespace
+
+class SimpleC2ComponentTest : public ::testing::TestWithParam<bool /* lowLatency */> {};
+
+// Works queued one at a time are processed inline on the queueing thread of an
+// idle low latency component, and reported before queue_nb() returns.
+// Otherwise they are processed on the component thread.
+TEST_P(SimpleC2ComponentTest, ProcessesIdleLowLatencyWorkInline) {
+    constexpr int kNumFrames = 4;
+    const bool lowLatency = GetParam();
+    std::shared_ptr<NullComponent> component =
+            std::make_shared<NullComponent>(lowLatency, false /* hold */);
+    std::shared_ptr<Listener> listener = std::make_shared<Listener>();
+    ASSERT_EQ(C2_OK, component->setListener_vb(listener, C2_MAY_BLOCK));
+    ASSERT_EQ(C2_OK, component->start());
+
+    for (int i = 0; i < kNumFrames; ++i) {
+        std::list<std::unique_ptr<C2Work>> items = makeWork(i);
+        ASSERT_EQ(C2_OK, component->queue_nb(&items));
+        if (lowLatency) {
+            EXPECT_EQ(size_t(i + 1), listener->frameIndices().size());
+        }
+        ASSERT_TRUE(listener->waitForWorks(i + 1));
+        if (lowLatency) {
+            EXPECT_EQ(std::this_thread::get_id(), component->processThread());
+        } else {
+            EXPECT_NE(std::this_thread::get_id(), component->processThread());
+        }
+    }
+
+    EXPECT_EQ(C2_OK, component->stop());
+    EXPECT_EQ(C2_OK, component->release());
+}
+
+// Works queued at once, more than the work queue initially holds, are all
+// reported in queueing order.
+TEST_P(SimpleC2ComponentTest, ReportsQueuedWorksInOrder) {
+    constexpr int kNumFrames = 100;
+    const bool lowLatency = GetParam();
+    std::shared_ptr<NullComponent> component =
+            std::make_shared<NullComponent>(lowLatency, false /* hold */);
+    std::shared_ptr<Listener> listener = std::make_shared<Listener>();
+    ASSERT_EQ(C2_OK, component->setListener_vb(listener, C2_MAY_BLOCK));
+    ASSERT_EQ(C2_OK, component->start());
+
+    std::list<std::unique_ptr<C2Work>> items;
+    for (int i = 0; i < kNumFrames; ++i) {
+        items.splice(items.end(), makeWork(i));
+    }
+    ASSERT_EQ(C2_OK, component->queue_nb(&items));
+    ASSERT_TRUE(listener->waitForWorks(kNumFrames));
+
+    std::vector<uint64_t> frameIndices = listener->frameIndices();
+    ASSERT_EQ(size_t(kNumFrames), frameIndices.size());
+    for (int i = 0; i < kNumFrames; ++i) {
+        EXPECT_EQ(uint64_t(i), frameIndices[i]);
+    }
+
+    EXPECT_EQ(C2_OK, component->stop());
+    EXPECT_EQ(C2_OK, component->release());
+}
+
+// Works finished together, e.g. by a drain, are reported in one onWorkDone_nb().
+TEST_P(SimpleC2ComponentTest, DrainedWorksAreCoalesced) {
+    constexpr int kNumHeld = 16;
+    const bool lowLatency = GetParam();
+    std::shared_ptr<NullComponent> component =
+            std::make_shared<NullComponent>(lowLatency, true /* hold */);
+    std::shared_ptr<Listener> listener = std::make_shared<Listener>();
+    ASSERT_EQ(C2_OK, component->setListener_vb(listener, C2_MAY_BLOCK));
+    ASSERT_EQ(C2_OK, component->start());
+
+    for (int i = 0; i < kNumHeld; ++i) {
+        std::list<std::unique_ptr<C2Work>> items = makeWork(i);
+        ASSERT_EQ(C2_OK, component->queue_nb(&items));
+    }
+    ASSERT_EQ(C2_OK, component->drain_nb(C2Component::DRAIN_COMPONENT_WITH_EOS));
+    ASSERT_TRUE(listener->waitForWorks(kNumHeld));
+    EXPECT_EQ(1u, listener->callbacks());
+
+    EXPECT_EQ(C2_OK, component->stop());
+    EXPECT_EQ(C2_OK, component->release());
+}
+
+INSTANTIATE_TEST_SUITE_P(SimpleC2Component, SimpleC2ComponentTest, ::testing::Bool());
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int status = RUN_ALL_TESTS();
+    ALOGV("Test result = %d\n", status);
+    return status;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the time from queue_nb() to onWorkDone_nb() for one frame at a time with a
+// component doing no work, which is the overhead SimpleC2Component adds to each frame.
+
+#include <condition_variable>
+#include <mutex>
+
+#include <benchmark/benchmark.h>
+
+#include "NullC2Component.h"
+
+using namespace android;
+
+namespace {
+
+class Listener : public C2Component::Listener {
+  public:
+    void onWorkDone_nb(std::weak_ptr<C2Component> component,
+                       std::list<std::unique_ptr<C2Work>> workItems) override {
+        (void)component;
+        std::lock_guard<std::mutex> lock(mLock);
+        mWorks += workItems.size();
+        mCond.notify_all();
+    }
+
+    void onTripped_nb(std::weak_ptr<C2Component> component,
+                      std::vector<std::shared_ptr<C2SettingResult>> settingResult) override {
+        (void)component;
+        (void)settingResult;
+    }
+
+    void onError_nb(std::weak_ptr<C2Component> component, uint32_t errorCode) override {
+        (void)component;
+        (void)errorCode;
+    }
+
+    void waitForWorks(size_t works) {
+        std::unique_lock<std::mutex> lock(mLock);
+        mCond.wait(lock, [this, works] { return mWorks >= works; });
+    }
+
+  private:
+    std::mutex mLock;
+    std::condition_variable mCond;
+    size_t mWorks = 0;
+};
+
+}  // namespace
+
+static void BM_PerFrameOverhead(benchmark::State &state) {
+    const bool lowLatency = state.range(0);
+    std::shared_ptr<NullComponent> component =
+            std::make_shared<NullComponent>(lowLatency, false /* hold */);
+    std::shared_ptr<Listener> listener = std::make_shared<Listener>();
+    if (component->setListener_vb(listener, C2_MAY_BLOCK) != C2_OK
+            || component->start() != C2_OK) {
+        state.SkipWithError("cannot start the component");
+        return;
+    }
+
+    uint64_t frameIndex = 0;
+    for (auto _ : state) {
+        std::list<std::unique_ptr<C2Work>> items = makeWork(frameIndex++);
+        if (component->queue_nb(&items) != C2_OK) {
+            state.SkipWithError("queue_nb failed");
+            break;
+        }
+        listener->waitForWorks(frameIndex);
+    }
+
+    component->stop();
+    component->release();
+}
+
+BENCHMARK(BM_PerFrameOverhead)->ArgName("lowLatency")->Arg(0)->Arg(1)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -284,6 +284,9 @@ enum C2ParamIndexKind : C2Param::type_index_t {
 
     // allow tunnel peek behavior to be unspecified for app compatibility
     kParamIndexTunnelPeekMode, // tunnel mode, enum
+
+    // thread budget of software components
+    kParamIndexThreadCount, // uint32
 };
 
 }
@@ -888,6 +891,15 @@ typedef C2GlobalParam<C2Tuning, C2EasyBoolValue, kParamIndexLowLatencyMode>
         C2GlobalLowLatencyModeTuning;
 constexpr char C2_PARAMKEY_LOW_LATENCY_MODE[] = "algo.low-latency";
 
+/**
+ * Maximum number of threads a software component may use for processing.
+ * 0 lets the component choose based on the device. The value is applied when the component is
+ * started.
+ */
+typedef C2GlobalParam<C2Tuning, C2Uint32Value, kParamIndexThreadCount>
+        C2GlobalThreadCountTuning;
+constexpr char C2_PARAMKEY_THREAD_COUNT[] = "algo.thread-count";
+
 /**
  * Reference characteristics.
  *
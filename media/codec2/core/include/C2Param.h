@@ -1214,6 +1214,9 @@ public:
 
     inline bool isReadOnly() const { return _mAttrib & IS_READ_ONLY; }
 
+    /// Returns whether this parameter is const. The value of a const parameter never changes.
+    inline bool isConst() const { return (_mAttrib & IS_CONST) == IS_CONST; }
+
     inline bool isVisible() const { return !(_mAttrib & IS_HIDDEN); }
 
     inline bool isPublic() const { return !(_mAttrib & IS_INTERNAL); }
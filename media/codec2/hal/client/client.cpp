@@ -69,11 +69,13 @@
 #include <system/window.h> // for NATIVE_WINDOW_QUERY_*
 #include <media/stagefright/foundation/ADebug.h> // for asString(status_t)
 
+#include <algorithm>
 #include <deque>
 #include <iterator>
 #include <limits>
 #include <map>
 #include <mutex>
+#include <set>
 #include <sstream>
 #include <thread>
 #include <type_traits>
@@ -781,17 +783,97 @@ c2_status_t Codec2ConfigurableClient::AidlImpl::querySupportedValues(
     return status;
 }
 
+// Codec2ConfigurableClient::ParamCache
+
+// Caches the supported param descriptors, and the values of the const params,
+// which cannot change. Queries for cached params are served without a
+// transaction.
+struct Codec2ConfigurableClient::ParamCache {
+    // Copies the descriptors to |params| if they are cached.
+    bool getDescriptors(std::vector<std::shared_ptr<C2ParamDescriptor>>* const params) {
+        std::scoped_lock lock{mMutex};
+        if (!mDescriptorsCached) {
+            return false;
+        }
+        params->insert(params->end(), mDescriptors.begin(), mDescriptors.end());
+        return true;
+    }
+
+    void setDescriptors(const std::vector<std::shared_ptr<C2ParamDescriptor>> &descriptors) {
+        std::scoped_lock lock{mMutex};
+        mDescriptors = descriptors;
+        mConstTypes.clear();
+        for (const std::shared_ptr<C2ParamDescriptor> &desc : mDescriptors) {
+            if (desc && desc->isConst()) {
+                mConstTypes.insert(desc->index().type());
+            }
+        }
+        mDescriptorsCached = true;
+    }
+
+    // Fills the cached stack params and appends copies of the cached heap
+    // params to |cachedHeapParams|. The params that are not cached are
+    // returned in |remoteStackParams| and |remoteHeapParamIndices|.
+    void lookup(
+            const std::vector<C2Param*> &stackParams,
+            const std::vector<C2Param::Index> &heapParamIndices,
+            std::vector<C2Param*> *remoteStackParams,
+            std::vector<C2Param::Index> *remoteHeapParamIndices,
+            std::vector<std::unique_ptr<C2Param>> *cachedHeapParams) {
+        std::scoped_lock lock{mMutex};
+        for (C2Param *param : stackParams) {
+            auto it = param ? mConstParams.find(param->index()) : mConstParams.end();
+            if (it == mConstParams.end() || !param->updateFrom(*it->second)) {
+                remoteStackParams->push_back(param);
+            }
+        }
+        for (const C2Param::Index &index : heapParamIndices) {
+            auto it = mConstParams.find(index);
+            if (it == mConstParams.end()) {
+                remoteHeapParamIndices->push_back(index);
+            } else {
+                cachedHeapParams->push_back(C2Param::Copy(*it->second));
+            }
+        }
+    }
+
+    // Caches the values of the const params among |params|.
+    template <typename T>
+    void store(const std::vector<T> &params) {
+        std::scoped_lock lock{mMutex};
+        if (mConstTypes.empty()) {
+            return;
+        }
+        for (const T &param : params) {
+            if (param && *param && mConstTypes.count(param->index().type()) > 0) {
+                mConstParams[param->index()] = C2Param::Copy(*param);
+            }
+        }
+    }
+
+private:
+    std::mutex mMutex;
+    bool mDescriptorsCached = false;
+    std::vector<std::shared_ptr<C2ParamDescriptor>> mDescriptors;
+    std::set<uint32_t> mConstTypes;
+    std::map<uint32_t, std::unique_ptr<C2Param>> mConstParams;
+};
+
 // Codec2ConfigurableClient
 
 Codec2ConfigurableClient::Codec2ConfigurableClient(const sp<HidlBase> &hidlBase)
-    : mImpl(new Codec2ConfigurableClient::HidlImpl(hidlBase)) {
+    : mImpl(new Codec2ConfigurableClient::HidlImpl(hidlBase)),
+      mCache(new ParamCache) {
 }
 
 Codec2ConfigurableClient::Codec2ConfigurableClient(
         const std::shared_ptr<AidlBase> &aidlBase)
-    : mImpl(new Codec2ConfigurableClient::AidlImpl(aidlBase)) {
+    : mImpl(new Codec2ConfigurableClient::AidlImpl(aidlBase)),
+      mCache(new ParamCache) {
 }
 
+Codec2ConfigurableClient::~Codec2ConfigurableClient() = default;
+
 const C2String& Codec2ConfigurableClient::getName() const {
     return mImpl->getName();
 }
@@ -801,7 +883,49 @@ c2_status_t Codec2ConfigurableClient::query(
         const std::vector<C2Param::Index> &heapParamIndices,
         c2_blocking_t mayBlock,
         std::vector<std::unique_ptr<C2Param>>* const heapParams) const {
-    return mImpl->query(stackParams, heapParamIndices, mayBlock, heapParams);
+    std::vector<C2Param*> remoteStackParams;
+    std::vector<C2Param::Index> remoteHeapParamIndices;
+    std::vector<std::unique_ptr<C2Param>> cachedHeapParams;
+    mCache->lookup(stackParams, heapParamIndices,
+                   &remoteStackParams, &remoteHeapParamIndices, &cachedHeapParams);
+
+    c2_status_t status = C2_OK;
+    std::vector<std::unique_ptr<C2Param>> remoteHeapParams;
+    if (!remoteStackParams.empty() || !remoteHeapParamIndices.empty()) {
+        status = mImpl->query(remoteStackParams, remoteHeapParamIndices, mayBlock,
+                              heapParams ? &remoteHeapParams : nullptr);
+        mCache->store(remoteStackParams);
+        mCache->store(remoteHeapParams);
+    }
+    if (!heapParams) {
+        return status;
+    }
+    if (cachedHeapParams.empty()) {
+        std::move(remoteHeapParams.begin(), remoteHeapParams.end(),
+                  std::back_inserter(*heapParams));
+        return status;
+    }
+    // Return the heap params in the order they were requested in.
+    for (const C2Param::Index &index : heapParamIndices) {
+        for (std::vector<std::unique_ptr<C2Param>> *source :
+                {&cachedHeapParams, &remoteHeapParams}) {
+            auto it = std::find_if(source->begin(), source->end(),
+                    [index](const std::unique_ptr<C2Param> &param) {
+                        return param && param->index() == index;
+                    });
+            if (it != source->end()) {
+                heapParams->push_back(std::move(*it));
+                source->erase(it);
+                break;
+            }
+        }
+    }
+    for (std::unique_ptr<C2Param> &param : remoteHeapParams) {
+        if (param) {
+            heapParams->push_back(std::move(param));
+        }
+    }
+    return status;
 }
 
 c2_status_t Codec2ConfigurableClient::config(
@@ -813,7 +937,16 @@ c2_status_t Codec2ConfigurableClient::config(
 
 c2_status_t Codec2ConfigurableClient::querySupportedParams(
         std::vector<std::shared_ptr<C2ParamDescriptor>>* const params) const {
-    return mImpl->querySupportedParams(params);
+    if (mCache->getDescriptors(params)) {
+        return C2_OK;
+    }
+    std::vector<std::shared_ptr<C2ParamDescriptor>> descriptors;
+    c2_status_t status = mImpl->querySupportedParams(&descriptors);
+    if (status == C2_OK) {
+        mCache->setDescriptors(descriptors);
+    }
+    params->insert(params->end(), descriptors.begin(), descriptors.end());
+    return status;
 }
 
 c2_status_t Codec2ConfigurableClient::querySupportedValues(
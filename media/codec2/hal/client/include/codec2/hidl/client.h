@@ -148,6 +148,7 @@ struct Codec2ConfigurableClient {
 
     explicit Codec2ConfigurableClient(const sp<HidlBase> &hidlBase);
     explicit Codec2ConfigurableClient(const std::shared_ptr<AidlBase> &aidlBase);
+    ~Codec2ConfigurableClient();
 
     const C2String& getName() const;
 
@@ -172,8 +173,10 @@ struct Codec2ConfigurableClient {
 private:
     struct HidlImpl;
     struct AidlImpl;
+    struct ParamCache;
 
     const std::unique_ptr<ImplBase> mImpl;
+    const std::unique_ptr<ParamCache> mCache;
 };
 
 struct Codec2Client : public Codec2ConfigurableClient {
@@ -502,6 +502,19 @@ public:
     }
 };
 
+// Returns true if parameter updates should be queued with the next input
+// buffer rather than sent to the component right away. The component then
+// applies them with that frame, and no transaction is needed per update.
+bool ShouldQueueParameters(
+        const std::unique_ptr<Config> &config,
+        const std::shared_ptr<Codec2Client::Component> &comp) {
+    // Parameter synchronization is not defined when using input surface. For now, route
+    // these directly to the component.
+    return config->mInputSurface == nullptr
+            && (property_get_bool("debug.stagefright.ccodec_delayed_params", false)
+                    || comp->getName().find("c2.android.") == 0);
+}
+
 void RevertOutputFormatIfNeeded(
         const sp<AMessage> &oldFormat, sp<AMessage> &currentFormat) {
     // We used to not report changes to these keys to the client.
@@ -2255,12 +2268,7 @@ void CCodec::signalSetParameters(const sp<AMessage> &msg) {
     std::vector<std::unique_ptr<C2Param>> configUpdate;
     (void)config->getConfigUpdateFromSdkParams(
             comp, params, Config::IS_PARAM, C2_MAY_BLOCK, &configUpdate);
-    // Prefer to pass parameters to the buffer channel, so they can be synchronized with the frames.
-    // Parameter synchronization is not defined when using input surface. For now, route
-    // these directly to the component.
-    if (config->mInputSurface == nullptr
-            && (property_get_bool("debug.stagefright.ccodec_delayed_params", false)
-                    || comp->getName().find("c2.android.") == 0)) {
+    if (ShouldQueueParameters(config, comp)) {
         mChannel->setParameters(configUpdate);
     } else {
         sp<AMessage> outputFormat = config->mOutputFormat;
@@ -2289,6 +2297,10 @@ void CCodec::signalRequestIDRFrame() {
     std::vector<std::unique_ptr<C2Param>> params;
     params.push_back(
             std::make_unique<C2StreamRequestSyncFrameTuning::output>(0u, true));
+    if (ShouldQueueParameters(config, comp)
+            && mChannel->setParameters(params) == OK) {
+        return;
+    }
     config->setParameters(comp, params, C2_MAY_BLOCK);
 }
 
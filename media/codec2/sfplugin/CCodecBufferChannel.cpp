@@ -388,13 +388,32 @@ status_t CCodecBufferChannel::setParameters(std::vector<std::unique_ptr<C2Param>
         ALOGD("[%s] setParameters is only supported in the running state.", mName);
         return -ENOSYS;
     }
-    mParamsToBeSet.insert(mParamsToBeSet.end(),
-                          std::make_move_iterator(params.begin()),
-                          std::make_move_iterator(params.end()));
-    params.clear();
+    MergePendingParams(&mParamsToBeSet, params);
     return OK;
 }
 
+// static
+void CCodecBufferChannel::MergePendingParams(
+        std::vector<std::unique_ptr<C2Param>> *pending,
+        std::vector<std::unique_ptr<C2Param>> &params) {
+    for (std::unique_ptr<C2Param> &param : params) {
+        if (!param) {
+            continue;
+        }
+        auto it = std::find_if(
+                pending->begin(), pending->end(),
+                [&param](const std::unique_ptr<C2Param> &p) {
+                    return p->index() == param->index();
+                });
+        if (it != pending->end()) {
+            *it = std::move(param);
+        } else {
+            pending->push_back(std::move(param));
+        }
+    }
+    params.clear();
+}
+
 status_t CCodecBufferChannel::attachBuffer(
         const std::shared_ptr<C2Buffer> &c2Buffer,
         const sp<MediaCodecBuffer> &buffer) {
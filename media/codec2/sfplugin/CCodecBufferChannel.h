@@ -124,6 +124,15 @@ public:
      */
     status_t setParameters(std::vector<std::unique_ptr<C2Param>> &params);
 
+    /**
+     * Move |params| to the params |pending| for the next input. Only the
+     * latest value of each param is kept, at the position of its first
+     * pending value.
+     */
+    static void MergePendingParams(
+            std::vector<std::unique_ptr<C2Param>> *pending,
+            std::vector<std::unique_ptr<C2Param>> &params);
+
     /**
      * Start queueing buffers to the component. This object should never queue
      * buffers before this call has completed.
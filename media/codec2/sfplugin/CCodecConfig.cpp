@@ -18,6 +18,7 @@
 #define LOG_TAG "CCodecConfig"
 
 #include <initializer_list>
+#include <mutex>
 
 #include <cutils/properties.h>
 #include <log/log.h>
@@ -91,7 +92,8 @@ struct ConfigMapper {
     typedef CCodecConfig::Domain Domain;
 
     ConfigMapper(std::string mediaKey, C2String c2struct, C2String c2field)
-        : mDomain(Domain::ALL), mMediaKey(mediaKey), mStruct(c2struct), mField(c2field) { }
+        : mDomain(Domain::ALL), mMediaKey(mediaKey), mStruct(c2struct), mField(c2field),
+          mPath(c2field.size() ? c2struct + '.' + c2field : c2struct) { }
 
     /// Limits this parameter to the given domain
     ConfigMapper &limitTo(uint32_t domain) {
@@ -175,8 +177,8 @@ struct ConfigMapper {
     }
 
     Domain domain() const { return mDomain; }
-    std::string mediaKey() const { return mMediaKey; }
-    std::string path() const { return mField.size() ? mStruct + '.' + mField : mStruct; }
+    const std::string &mediaKey() const { return mMediaKey; }
+    const std::string &path() const { return mPath; }
     Mapper mapper() const { return mMapper; }
     Mapper reverse() const { return mReverse; }
 
@@ -185,6 +187,7 @@ private:
     std::string mMediaKey;  ///< SDK key
     C2String mStruct;       ///< Codec 2.0 struct name
     C2String mField;        ///< Codec 2.0 field name
+    std::string mPath;      ///< Codec 2.0 field path (struct.field)
     Mapper mMapper;         ///< optional SDK => Codec 2.0 value mapper
     Mapper mReverse;        ///< optional Codec 2.0 => SDK value mapper
 };
@@ -233,6 +236,10 @@ AString QueryMediaType(
 
 /**
  * Set of standard parameters used by CCodec that are exposed to MediaCodec.
+ *
+ * The set only depends on the coding media type (and bit depth) of the component, so it is
+ * built once per process and shared by all CCodecConfig instances. It must not be modified
+ * once it has been indexed.
  */
 struct StandardParams {
     typedef CCodecConfig::Domain Domain;
@@ -247,6 +254,7 @@ struct StandardParams {
     const std::vector<ConfigMapper> &getConfigMappersForSdkKey(std::string key) const {
         auto it = mConfigMappers.find(key);
         if (it == mConfigMappers.end()) {
+            std::lock_guard<std::mutex> lock(mComplainedLock);
             if (mComplained.count(key) == 0) {
                 ALOGD("no c2 equivalents for %s", key.c_str());
                 mComplained.insert(key);
@@ -285,12 +293,6 @@ struct StandardParams {
         }
     }
 
-    // Updates or adds a mapper for a "sdkkey"
-    void updateConfigMappersForKey(const SdkKey& key,
-            const std::vector<ConfigMapper>& vec_cm) {
-        mConfigMappers.insert_or_assign(key, vec_cm);
-    }
-
     /**
      * Returns all paths for a specific domain.
      *
@@ -315,16 +317,30 @@ struct StandardParams {
     }
 
     /**
-     * Returns SDK <=> Codec 2.0 mappings.
-     *
-     * TODO: replace these with better methods as this exposes the inner structure.
+     * Numbers all SDK <=> Codec 2.0 mappings, ordered by SDK key and then by authority. Must be
+     * called once all mappings have been added.
      */
-    const std::map<SdkKey, std::vector<ConfigMapper>> getKeys() const {
-        return mConfigMappers;
+    void buildIndex() {
+        mMappers.clear();
+        for (const auto &[key, mappers] : mConfigMappers) {
+            for (const ConfigMapper &cm : mappers) {
+                mMappers.push_back(&cm);
+            }
+        }
+    }
+
+    /**
+     * Returns all SDK <=> Codec 2.0 mappings in index order. Mapping tables of the same coding
+     * media type share the same numbering regardless of bit depth.
+     */
+    const std::vector<const ConfigMapper *> &getConfigMappers() const {
+        return mMappers;
     }
 
 private:
     std::map<SdkKey, std::vector<ConfigMapper>> mConfigMappers;
+    std::vector<const ConfigMapper *> mMappers;
+    mutable std::mutex mComplainedLock;
     mutable std::set<std::string> mComplained;
 };
 
@@ -335,14 +351,47 @@ CCodecConfig::CCodecConfig()
     : mInputFormat(new AMessage),
       mOutputFormat(new AMessage),
       mUsingSurface(false),
+      mReflectAll(true),
       mTunneled(false),
       mPushBlankBuffersOnStop(false) { }
 
+// static
+std::shared_ptr<const StandardParams> CCodecConfig::GetStandardParams(
+        const std::string &codingMediaType, int32_t bitDepth) {
+    static std::mutex sLock;
+    static std::map<std::pair<std::string, int32_t>, std::shared_ptr<const StandardParams>>
+        sStandardParams;
+
+    std::lock_guard<std::mutex> lock(sLock);
+    std::shared_ptr<const StandardParams> &params =
+        sStandardParams[std::make_pair(codingMediaType, bitDepth)];
+    if (!params) {
+        params = CreateStandardParams(codingMediaType, bitDepth);
+    }
+    return params;
+}
+
 void CCodecConfig::initializeStandardParams() {
+    mStandardParams = GetStandardParams(mCodingMediaType, 8 /* bitDepth */);
+
+    // mark the standard params that apply to this component
+    const std::vector<const ConfigMapper *> &mappers = mStandardParams->getConfigMappers();
+    mSupportedStandardParams.assign(mappers.size(), false);
+    for (size_t i = 0; i < mappers.size(); ++i) {
+        const ConfigMapper &cm = *mappers[i];
+        mSupportedStandardParams[i] =
+            (cm.domain() & mDomain) == mDomain // component domain + kind (these must match)
+            && mParamUpdater->getTypeForKey(cm.path()) != C2FieldDescriptor::type_t(~0);
+    }
+}
+
+// static
+std::shared_ptr<const StandardParams> CCodecConfig::CreateStandardParams(
+        const std::string &codingMediaType, int32_t bitDepth) {
     typedef Domain D;
-    mStandardParams = std::make_shared<StandardParams>();
+    std::shared_ptr<StandardParams> standardParams = std::make_shared<StandardParams>();
     std::function<void(const ConfigMapper &)> add =
-        [params = mStandardParams](const ConfigMapper &cm) {
+        [params = standardParams](const ConfigMapper &cm) {
             params->add(cm);
     };
     std::function<void(const ConfigMapper &)> deprecated = add;
@@ -733,7 +782,7 @@ void CCodecConfig::initializeStandardParams() {
         }));
 
     std::shared_ptr<C2Mapper::ProfileLevelMapper> mapper =
-        C2Mapper::GetProfileLevelMapper(mCodingMediaType);
+        C2Mapper::GetBitDepthProfileLevelMapper(codingMediaType, bitDepth);
 
     add(ConfigMapper(KEY_PROFILE, C2_PARAMKEY_PROFILE_LEVEL, "profile")
         .limitTo(D::CODED)
@@ -981,6 +1030,9 @@ void CCodecConfig::initializeStandardParams() {
 
     add(ConfigMapper(C2_PARAMKEY_INPUT_TIME_STRETCH, C2_PARAMKEY_INPUT_TIME_STRETCH, "value"));
 
+    add(ConfigMapper("android._thread-count", C2_PARAMKEY_THREAD_COUNT, "value")
+        .limitTo(D::DECODER & D::CONFIG));
+
     add(ConfigMapper(KEY_LOW_LATENCY, C2_PARAMKEY_LOW_LATENCY_MODE, "value")
         .limitTo(D::DECODER & (D::CONFIG | D::PARAM))
         .withMapper([](C2Value v) -> C2Value {
@@ -1034,6 +1086,9 @@ void CCodecConfig::initializeStandardParams() {
     KEY_AUDIO_SESSION_ID // we use "audio-hw-sync"
     KEY_OUTPUT_REORDER_DEPTH
     */
+
+    standardParams->buildIndex();
+    return standardParams;
 }
 
 status_t CCodecConfig::initialize(
@@ -1113,6 +1168,7 @@ status_t CCodecConfig::initialize(
     mParamUpdater->supportWholeParam(
             C2_PARAMKEY_TEMPORAL_LAYERING, C2StreamTemporalLayeringTuning::CORE_INDEX);
     mParamUpdater->addParamDesc(mReflector, mParamDescs);
+    mReflectAll = true;
 
     // TEMP: add some standard fields even if not reflected
     if (kind.value == C2Component::KIND_ENCODER) {
@@ -1265,6 +1321,7 @@ bool CCodecConfig::updateConfiguration(
             }
             auto insertion = mCurrentConfig.emplace(p->index(), nullptr);
             if (insertion.second || *insertion.first->second != *p) {
+                mDirtyIndices.insert(p->index());
                 if (mSupportedIndices.count(p->index()) || mLocalParams.count(p->index())) {
                     // only track changes in supported (reflected or local) indices
                     changed = true;
@@ -1291,25 +1348,27 @@ bool CCodecConfig::updateConfiguration(
     return false;
 }
 
-bool CCodecConfig::updateFormats(Domain domain) {
-    // get addresses of params in the current config
-    std::vector<C2Param*> paramPointers;
-    for (const auto &it : mCurrentConfig) {
-        paramPointers.push_back(it.second.get());
-    }
+namespace {
 
-    ReflectedParamUpdater::Dict reflected = mParamUpdater->getParams(paramPointers);
-    std::string config = reflected.debugString();
-    std::set<std::string> configLines;
+/// Logs the lines of |current| that are not in |previous|.
+void logConfigDiff(
+        const ReflectedParamUpdater::Dict &previous,
+        const ReflectedParamUpdater::Dict &current) {
+    std::string previousConfig = previous.debugString();
+    std::set<std::string> previousLines;
+    for (size_t start = 0; start != std::string::npos; ) {
+        size_t end = previousConfig.find('\n', start);
+        size_t count = (end == std::string::npos) ? std::string::npos : end - start + 1;
+        previousLines.insert(previousConfig.substr(start, count));
+        start = (end == std::string::npos) ? std::string::npos : end + 1;
+    }
+    std::string config = current.debugString();
     std::string diff;
     for (size_t start = 0; start != std::string::npos; ) {
         size_t end = config.find('\n', start);
-        size_t count = (end == std::string::npos)
-                ? std::string::npos
-                : end - start + 1;
+        size_t count = (end == std::string::npos) ? std::string::npos : end - start + 1;
         std::string line = config.substr(start, count);
-        configLines.insert(line);
-        if (mLastConfig.count(line) == 0) {
+        if (previousLines.count(line) == 0) {
             diff.append(line);
         }
         start = (end == std::string::npos) ? std::string::npos : end + 1;
@@ -1317,29 +1376,87 @@ bool CCodecConfig::updateFormats(Domain domain) {
     if (!diff.empty()) {
         ALOGD("c2 config diff is %s", diff.c_str());
     }
-    mLastConfig.swap(configLines);
+}
+
+}  // namespace
+
+void CCodecConfig::updateReflectedConfig() {
+    // rendering the config diff is expensive, so only do it if anyone is listening
+    const bool logDiff =
+        __android_log_is_loggable(ANDROID_LOG_VERBOSE, LOG_TAG, ANDROID_LOG_DEBUG);
+
+    if (mReflectAll) {
+        std::vector<C2Param*> paramPointers;
+        for (const auto &it : mCurrentConfig) {
+            paramPointers.push_back(it.second.get());
+        }
+        ReflectedParamUpdater::Dict reflected = mParamUpdater->getParams(paramPointers);
+        if (logDiff) {
+            logConfigDiff(mReflectedConfig, reflected);
+        }
+        mReflectedConfig.swap(reflected);
+        mReflectedKeys.clear();
+        mDirtyIndices.clear();
+        mReflectAll = false;
+        return;
+    }
+    if (mDirtyIndices.empty()) {
+        return;
+    }
+
+    std::vector<C2Param*> paramPointers;
+    ReflectedParamUpdater::Dict previous;
+    for (const C2Param::Index &index : mDirtyIndices) {
+        auto it = mCurrentConfig.find(index);
+        if (it != mCurrentConfig.end()) {
+            paramPointers.push_back(it->second.get());
+        }
+        // drop the previously reflected fields of the param, as not all fields may be
+        // reflected for every value (e.g. truncated strings).
+        auto keys = mReflectedKeys.find(index);
+        if (keys == mReflectedKeys.end()) {
+            keys = mReflectedKeys.emplace(index, std::vector<std::string>()).first;
+            mParamUpdater->getKeysForParamIndex(index, &keys->second);
+        }
+        for (const std::string &key : keys->second) {
+            auto field = mReflectedConfig.find(key);
+            if (field != mReflectedConfig.end()) {
+                if (logDiff) {
+                    previous.emplace(key, field->second);
+                }
+                mReflectedConfig.erase(field);
+            }
+        }
+    }
+    mDirtyIndices.clear();
+
+    ReflectedParamUpdater::Dict reflected = mParamUpdater->getParams(paramPointers);
+    if (logDiff) {
+        logConfigDiff(previous, reflected);
+    }
+    for (auto &kv : reflected) {
+        mReflectedConfig[kv.first] = std::move(kv.second);
+    }
+}
+
+bool CCodecConfig::updateFormats(Domain domain) {
+    updateReflectedConfig();
 
     bool changed = false;
     if (domain & mInputDomain) {
-        sp<AMessage> oldFormat = mInputFormat;
-        mInputFormat = mInputFormat->dup(); // trigger format changed
-        mInputFormat->extend(getFormatForDomain(reflected, mInputDomain));
-        if (mInputFormat->countEntries() != oldFormat->countEntries()
-                || mInputFormat->changesFrom(oldFormat)->countEntries() > 0) {
+        sp<AMessage> update = getFormatForDomain(mReflectedConfig, mInputDomain);
+        if (update->changesFrom(mInputFormat)->countEntries() > 0) {
+            mInputFormat = mInputFormat->dup(); // trigger format changed
+            mInputFormat->extend(update);
             changed = true;
-        } else {
-            mInputFormat = oldFormat; // no change
         }
     }
     if (domain & mOutputDomain) {
-        sp<AMessage> oldFormat = mOutputFormat;
-        mOutputFormat = mOutputFormat->dup(); // trigger output format changed
-        mOutputFormat->extend(getFormatForDomain(reflected, mOutputDomain));
-        if (mOutputFormat->countEntries() != oldFormat->countEntries()
-                || mOutputFormat->changesFrom(oldFormat)->countEntries() > 0) {
+        sp<AMessage> update = getFormatForDomain(mReflectedConfig, mOutputDomain);
+        if (update->changesFrom(mOutputFormat)->countEntries() > 0) {
+            mOutputFormat = mOutputFormat->dup(); // trigger output format changed
+            mOutputFormat->extend(update);
             changed = true;
-        } else {
-            mOutputFormat = oldFormat; // no change
         }
     }
     ALOGV_IF(changed, "format(s) changed");
@@ -1350,33 +1467,36 @@ sp<AMessage> CCodecConfig::getFormatForDomain(
         const ReflectedParamUpdater::Dict &reflected,
         Domain portDomain) const {
     sp<AMessage> msg = new AMessage;
-    for (const auto &[key, mappers] : mStandardParams->getKeys()) {
-        for (const ConfigMapper &cm : mappers) {
-            if ((cm.domain() & portDomain) == 0 // input-output-coded-raw
-                || (cm.domain() & mDomain) != mDomain // component domain + kind (these must match)
-                || (cm.domain() & IS_READ) == 0) {
-                continue;
-            }
-            auto it = reflected.find(cm.path());
-            if (it == reflected.end()) {
-                continue;
-            }
-            C2Value c2Value;
-            sp<ABuffer> bufValue;
-            AString strValue;
-            AMessage::ItemData item;
-            if (it->second.find(&c2Value)) {
-                item = cm.mapToMessage(c2Value);
-            } else if (it->second.find(&bufValue)) {
-                item.set(bufValue);
-            } else if (it->second.find(&strValue)) {
-                item.set(strValue);
-            } else {
-                ALOGD("unexpected untyped query value for key: %s", cm.path().c_str());
-                continue;
-            }
-            msg->setItem(key.c_str(), item);
+    const std::vector<const ConfigMapper *> &mappers = mStandardParams->getConfigMappers();
+    for (size_t i = 0; i < mappers.size(); ++i) {
+        // skip params of other components domains or kinds, or not reflected by the component
+        if (!mSupportedStandardParams[i]) {
+            continue;
+        }
+        const ConfigMapper &cm = *mappers[i];
+        if ((cm.domain() & portDomain) == 0 // input-output-coded-raw
+            || (cm.domain() & IS_READ) == 0) {
+            continue;
+        }
+        auto it = reflected.find(cm.path());
+        if (it == reflected.end()) {
+            continue;
+        }
+        C2Value c2Value;
+        sp<ABuffer> bufValue;
+        AString strValue;
+        AMessage::ItemData item;
+        if (it->second.find(&c2Value)) {
+            item = cm.mapToMessage(c2Value);
+        } else if (it->second.find(&bufValue)) {
+            item.set(bufValue);
+        } else if (it->second.find(&strValue)) {
+            item.set(strValue);
+        } else {
+            ALOGD("unexpected untyped query value for key: %s", cm.path().c_str());
+            continue;
         }
+        msg->setItem(cm.mediaKey().c_str(), item);
     }
 
     bool input = (portDomain & Domain::IS_INPUT);
@@ -1937,50 +2057,9 @@ status_t CCodecConfig::getConfigUpdateFromSdkParams(
         int32_t bitDepth = (is10bAv1EncodeRequested) ? 10 : 8;
         // we always initilze with an 8b mapper. Update this only if needed.
         if (bitDepth != 8) {
-            std::shared_ptr<C2Mapper::ProfileLevelMapper> mapper =
-                C2Mapper::GetBitDepthProfileLevelMapper(mCodingMediaType, bitDepth);
-            mStandardParams->updateConfigMappersForKey(StandardParams::SdkKey(KEY_PROFILE),
-                {
-                    ConfigMapper(KEY_PROFILE, C2_PARAMKEY_PROFILE_LEVEL, "profile")
-                    .limitTo(Domain::CODED)
-                    .withMappers([mapper](C2Value v) -> C2Value {
-                        C2Config::profile_t c2 = PROFILE_UNUSED;
-                        int32_t sdk;
-                        if (mapper && v.get(&sdk) && mapper->mapProfile(sdk, &c2)) {
-                            return c2;
-                        }
-                        return PROFILE_UNUSED;
-                        }, [mapper](C2Value v) -> C2Value {
-                        C2Config::profile_t c2;
-                        int32_t sdk;
-                        using C2ValueType =
-                            typename _c2_reduce_enum_to_underlying_type<decltype(c2)>::type;
-                        if (mapper && v.get((C2ValueType*)&c2) && mapper->mapProfile(c2, &sdk)) {
-                            return sdk;
-                        }
-                        return C2Value();
-                })});
-            mStandardParams->updateConfigMappersForKey(StandardParams::SdkKey(KEY_LEVEL),
-                {
-                    ConfigMapper(KEY_LEVEL, C2_PARAMKEY_PROFILE_LEVEL, "level")
-                    .limitTo(Domain::CODED)
-                    .withMappers([mapper](C2Value v) -> C2Value {
-                        C2Config::level_t c2 = LEVEL_UNUSED;
-                        int32_t sdk;
-                        if (mapper && v.get(&sdk) && mapper->mapLevel(sdk, &c2)) {
-                            return c2;
-                        }
-                        return LEVEL_UNUSED;
-                        }, [mapper](C2Value v) -> C2Value {
-                        C2Config::level_t c2;
-                        int32_t sdk;
-                        using C2ValueType =
-                            typename _c2_reduce_enum_to_underlying_type<decltype(c2)>::type;
-                        if (mapper && v.get((C2ValueType*)&c2) && mapper->mapLevel(c2, &sdk)) {
-                            return sdk;
-                        }
-                        return C2Value();
-                })});
+            // the bit depth specific table numbers its mappers the same way, so the
+            // supported standard params remain valid.
+            mStandardParams = GetStandardParams(mCodingMediaType, bitDepth);
         }
     }
 
@@ -2047,6 +2126,7 @@ status_t CCodecConfig::setParameters(
                         mParamUpdater->getParamName(param->index()).c_str());
 
                 mCurrentConfig[param->index()] = std::move(copy);
+                mDirtyIndices.insert(param->index());
             } else {
                 ALOGD("failed to set parameter value for %s => %s",
                         mParamUpdater->getParamName(param->index()).c_str(), asString(err));
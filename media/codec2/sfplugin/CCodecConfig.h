@@ -110,8 +110,11 @@ struct CCodecConfig {
     Domain mOutputDomain; // output port domain
     std::string mCodingMediaType;  // media type of the coded stream
 
-    // standard MediaCodec to Codec 2.0 params mapping
-    std::shared_ptr<StandardParams> mStandardParams;
+    // standard MediaCodec to Codec 2.0 params mapping, shared by all components of the same
+    // coding media type. May be replaced by a bit depth specific mapping on configure.
+    mutable std::shared_ptr<const StandardParams> mStandardParams;
+    // standard params (by index in mStandardParams) that apply to this component
+    std::vector<bool> mSupportedStandardParams;
 
     std::set<C2Param::Index> mSupportedIndices; ///< indices supported by the component
     std::set<C2Param::Index> mSubscribedIndices; ///< indices to subscribe to
@@ -142,7 +145,15 @@ struct CCodecConfig {
     /// Vendor field name -> desc map.
     std::map<std::string, std::shared_ptr<C2ParamDescriptor>> mVendorParams;
 
-    std::set<std::string> mLastConfig;
+    /// Reflected fields of mCurrentConfig as last passed to the formats.
+    ReflectedParamUpdater::Dict mReflectedConfig;
+    /// Indices in mCurrentConfig that changed since mReflectedConfig was updated.
+    std::set<C2Param::Index> mDirtyIndices;
+    /// Whether mReflectedConfig must be rebuilt from all of mCurrentConfig, e.g. because
+    /// fields were added to mParamUpdater.
+    bool mReflectAll;
+    /// Cached reflected field names of each param index.
+    std::map<C2Param::Index, std::vector<std::string>> mReflectedKeys;
 
     /// Tunneled codecs
     bool mTunneled;
@@ -196,6 +207,7 @@ struct CCodecConfig {
 
         mLocalParams.emplace(index, validator);
         mParamUpdater->addStandardParam<T>(name, attrib);
+        mReflectAll = true;
         return true;
     }
 
@@ -218,6 +230,7 @@ struct CCodecConfig {
                 }
             }
             mCurrentConfig[T::PARAM_TYPE] = std::move(default_);
+            mDirtyIndices.insert(T::PARAM_TYPE);
             return true;
         }
         return false;
@@ -377,6 +390,18 @@ private:
     /// initializes the standard MediaCodec to Codec 2.0 params mapping
     void initializeStandardParams();
 
+    /// Returns the process-wide standard params mapping for a coding media type and bit depth.
+    static std::shared_ptr<const StandardParams> GetStandardParams(
+            const std::string &codingMediaType, int32_t bitDepth);
+
+    /// Builds the standard params mapping for a coding media type and bit depth.
+    static std::shared_ptr<const StandardParams> CreateStandardParams(
+            const std::string &codingMediaType, int32_t bitDepth);
+
+    /// Brings mReflectedConfig up to date with mCurrentConfig, reflecting only the params
+    /// that changed since the last call.
+    void updateReflectedConfig();
+
     /// Gets SDK format from codec 2.0 reflected configuration
     /// \param domain input/output bitmask
     sp<AMessage> getFormatForDomain(
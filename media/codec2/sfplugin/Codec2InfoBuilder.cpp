@@ -18,7 +18,15 @@
 #define LOG_TAG "Codec2InfoBuilder"
 #include <log/log.h>
 
+#include <stdio.h>
 #include <strings.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <optional>
+#include <thread>
 
 #include <C2Component.h>
 #include <C2Config.h>
@@ -40,7 +48,9 @@
 #include <android/hardware/media/omx/1.0/IOmxNode.h>
 #include <android/hardware/media/omx/1.0/types.h>
 
+#include <android-base/file.h>
 #include <android-base/properties.h>
+#include <binder/Parcel.h>
 #include <codec2/hidl/client.h>
 #include <cutils/native_handle.h>
 #include <media/omx/1.0/WOmxNode.h>
@@ -60,6 +70,10 @@ typedef std::map<uint32_t, int32_t> PixelFormatMap;
 
 namespace /* unnamed */ {
 
+constexpr unsigned kMaxQueryThreads = 8;
+constexpr int32_t kQueryCacheVersion = 1;
+constexpr char kApexInfoListPath[] = "/apex/apex-info-list.xml";
+
 bool hasPrefix(const std::string& s, const char* prefix) {
     size_t prefixLen = strlen(prefix);
     return s.compare(0, prefixLen, prefix) == 0;
@@ -91,18 +105,32 @@ std::optional<int32_t> findFrameworkColorFormat(
     return std::nullopt;
 }
 
-// returns true if component advertised supported profile level(s)
-bool addSupportedProfileLevels(
-        std::shared_ptr<Codec2Client::Interface> intf,
-        MediaCodecInfo::CapabilitiesWriter *caps,
-        const Traits& trait, const std::string &mediaType) {
-    std::shared_ptr<C2Mapper::ProfileLevelMapper> mapper =
-        C2Mapper::GetProfileLevelMapper(trait.mediaType);
-    // if we don't know the media type, pass through all values unmapped
+// Results of the queries issued to the interface of a component. They do not
+// depend on the XML files, so they are gathered while those are parsed, and are
+// persisted so that they need not be gathered again on the next boot.
+struct ComponentQueryResults {
+    // whether the interface of the component could be created
+    bool valid = false;
+    std::string serviceName;
+    // whether the supported profiles were enumerated
+    bool profilesQueried = false;
+    // supported profiles, with the levels supported for each profile
+    std::vector<std::pair<uint32_t, std::vector<uint32_t>>> profileLevels;
+    bool supportsHdr = false;
+    bool supportsHdr10Plus = false;
+    // supported HAL pixel formats on the raw port
+    std::vector<uint32_t> pixelFormats;
+};
 
-    // TODO: we cannot find levels that are local 'maxima' without knowing the coding
-    // e.g. H.263 level 45 and level 30 could be two values for highest level as
-    // they don't include one another. For now we use the last supported value.
+struct ComponentQueries {
+    // one entry per name or alias of each component, in the order of the traits
+    std::vector<ComponentQueryResults> components;
+    std::map<std::string, PixelFormatMap> pixelFormatMaps;
+};
+
+void queryProfileLevels(
+        const std::shared_ptr<Codec2Client::Interface> &intf,
+        const Traits& trait, ComponentQueryResults *results) {
     bool encoder = trait.kind == C2Component::KIND_ENCODER;
     C2StreamProfileLevelInfo pl(encoder /* output */, 0u);
     std::vector<C2FieldSupportedValuesQuery> profileQuery = {
@@ -112,20 +140,14 @@ bool addSupportedProfileLevels(
     c2_status_t err = intf->querySupportedValues(profileQuery, C2_DONT_BLOCK);
     ALOGV("query supported profiles -> %s | %s", asString(err), asString(profileQuery[0].status));
     if (err != C2_OK || profileQuery[0].status != C2_OK) {
-        return false;
+        return;
     }
 
     // we only handle enumerated values
     if (profileQuery[0].values.type != C2FieldSupportedValues::VALUES) {
-        return false;
+        return;
     }
-
-    // determine if codec supports HDR; imply 10-bit support
-    bool supportsHdr = false;
-    // determine if codec supports HDR10Plus; imply 10-bit support
-    bool supportsHdr10Plus = false;
-    // determine if codec supports 10-bit format
-    bool supports10Bit = false;
+    results->profilesQueried = true;
 
     std::vector<std::shared_ptr<C2ParamDescriptor>> paramDescs;
     c2_status_t err1 = intf->querySupportedParams(&paramDescs);
@@ -140,10 +162,10 @@ bool addSupportedProfileLevels(
             case C2StreamHdrDynamicMetadataInfo::CORE_INDEX:
                 [[fallthrough]];
             case C2StreamHdr10PlusInfo::CORE_INDEX:  // will be deprecated
-                supportsHdr10Plus = true;
+                results->supportsHdr10Plus = true;
                 break;
             case C2StreamHdrStaticInfo::CORE_INDEX:
-                supportsHdr = true;
+                results->supportsHdr = true;
                 break;
             default:
                 break;
@@ -151,6 +173,344 @@ bool addSupportedProfileLevels(
         }
     }
 
+    for (C2Value::Primitive profile : profileQuery[0].values.values) {
+        pl.profile = (C2Config::profile_t)profile.ref<uint32_t>();
+        std::vector<std::unique_ptr<C2SettingResult>> failures;
+        err = intf->config({&pl}, C2_DONT_BLOCK, &failures);
+        ALOGV("set profile to %u -> %s", pl.profile, asString(err));
+        std::vector<C2FieldSupportedValuesQuery> levelQuery = {
+            C2FieldSupportedValuesQuery::Current(C2ParamField(&pl, &pl.level))
+        };
+        err = intf->querySupportedValues(levelQuery, C2_DONT_BLOCK);
+        ALOGV("query supported levels -> %s | %s", asString(err), asString(levelQuery[0].status));
+        if (err != C2_OK || levelQuery[0].status != C2_OK
+                || levelQuery[0].values.type != C2FieldSupportedValues::VALUES
+                || levelQuery[0].values.values.size() == 0) {
+            continue;
+        }
+        std::vector<uint32_t> levels;
+        for (C2Value::Primitive v : levelQuery[0].values.values) {
+            levels.push_back(v.ref<uint32_t>());
+        }
+        results->profileLevels.emplace_back(pl.profile, std::move(levels));
+    }
+}
+
+void queryPixelFormats(
+        const std::shared_ptr<Codec2Client::Interface> &intf,
+        const Traits& trait, ComponentQueryResults *results) {
+    // TODO: get this from intf() as well, but how do we map them to
+    // MediaCodec color formats?
+    if (trait.domain != C2Component::DOMAIN_VIDEO && trait.domain != C2Component::DOMAIN_IMAGE) {
+        return;
+    }
+    bool encoder = trait.kind == C2Component::KIND_ENCODER;
+    std::vector<C2FieldSupportedValuesQuery> query;
+    if (encoder) {
+        C2StreamPixelFormatInfo::input pixelFormat;
+        query.push_back(C2FieldSupportedValuesQuery::Possible(
+                C2ParamField::Make(pixelFormat, pixelFormat.value)));
+    } else {
+        C2StreamPixelFormatInfo::output pixelFormat;
+        query.push_back(C2FieldSupportedValuesQuery::Possible(
+                C2ParamField::Make(pixelFormat, pixelFormat.value)));
+    }
+    if (intf->querySupportedValues(query, C2_DONT_BLOCK) == C2_OK) {
+        if (query[0].status == C2_OK) {
+            const C2FieldSupportedValues &fsv = query[0].values;
+            if (fsv.type == C2FieldSupportedValues::VALUES) {
+                for (C2Value::Primitive value : fsv.values) {
+                    results->pixelFormats.push_back(value.u32);
+                }
+            }
+        }
+    }
+}
+
+PixelFormatMap queryPixelFormatMap(const std::shared_ptr<Codec2Client> &client) {
+    PixelFormatMap pixelFormatMap;
+    pixelFormatMap[HAL_PIXEL_FORMAT_YCBCR_420_888] = COLOR_FormatYUV420Flexible;
+    pixelFormatMap[HAL_PIXEL_FORMAT_YCBCR_P010]    = COLOR_FormatYUVP010;
+    pixelFormatMap[HAL_PIXEL_FORMAT_RGBA_1010102]  = COLOR_Format32bitABGR2101010;
+    pixelFormatMap[HAL_PIXEL_FORMAT_RGBA_FP16]     = COLOR_Format64bitABGRFloat;
+
+    std::shared_ptr<C2StoreFlexiblePixelFormatDescriptorsInfo> pixelFormatInfo;
+    std::vector<std::unique_ptr<C2Param>> heapParams;
+    if (client->query(
+                {},
+                {C2StoreFlexiblePixelFormatDescriptorsInfo::PARAM_TYPE},
+                C2_MAY_BLOCK,
+                &heapParams) == C2_OK
+            && heapParams.size() == 1u) {
+        pixelFormatInfo.reset(C2StoreFlexiblePixelFormatDescriptorsInfo::From(
+                heapParams[0].release()));
+    }
+    if (pixelFormatInfo && *pixelFormatInfo) {
+        for (size_t i = 0; i < pixelFormatInfo->flexCount(); ++i) {
+            C2FlexiblePixelFormatDescriptorStruct &desc =
+                pixelFormatInfo->m.values[i];
+            std::optional<int32_t> colorFormat = findFrameworkColorFormat(desc);
+            if (colorFormat) {
+                pixelFormatMap[desc.pixelFormat] = *colorFormat;
+            }
+        }
+    }
+    return pixelFormatMap;
+}
+
+// Queries the interfaces of all names and aliases of the components, using at
+// most |maxThreads| threads. Results are stored by position, so they do not
+// depend on the order in which the queries complete.
+class ComponentQuerier {
+public:
+    ComponentQuerier(const std::vector<Traits> &traits, size_t maxThreads,
+                     ComponentQueries *queries)
+        : mQueries(queries) {
+        for (const Traits &trait : traits) {
+            mJobs.emplace_back(&trait, trait.name);
+            for (const std::string &alias : trait.aliases) {
+                mJobs.emplace_back(&trait, alias);
+            }
+        }
+        mQueries->components.assign(mJobs.size(), ComponentQueryResults());
+        mClients.resize(mJobs.size());
+        size_t numThreads = std::min(maxThreads, mJobs.size());
+        for (size_t i = 0; i < numThreads; ++i) {
+            mThreads.emplace_back([this] { run(); });
+        }
+    }
+
+    ~ComponentQuerier() { join(); }
+
+    // Waits for the queries to complete. Afterwards the pixel format
+    // descriptors of each Codec2 service are queried.
+    void join() {
+        if (mThreads.empty()) {
+            return;
+        }
+        for (std::thread &thread : mThreads) {
+            thread.join();
+        }
+        mThreads.clear();
+        for (size_t i = 0; i < mJobs.size(); ++i) {
+            const std::shared_ptr<Codec2Client> &client = mClients[i];
+            if (client && mQueries->pixelFormatMaps.count(client->getServiceName()) == 0) {
+                mQueries->pixelFormatMaps.emplace(
+                        client->getServiceName(), queryPixelFormatMap(client));
+            }
+        }
+        mClients.clear();
+    }
+
+private:
+    void run() {
+        for (size_t i = mNext++; i < mJobs.size(); i = mNext++) {
+            const Traits &trait = *mJobs[i].first;
+            const std::string &nameOrAlias = mJobs[i].second;
+            ComponentQueryResults &results = mQueries->components[i];
+            std::shared_ptr<Codec2Client::Interface> intf =
+                Codec2Client::CreateInterfaceByName(nameOrAlias.c_str(), &mClients[i]);
+            if (!intf) {
+                continue;
+            }
+            results.valid = true;
+            results.serviceName = mClients[i]->getServiceName();
+            queryProfileLevels(intf, trait, &results);
+            queryPixelFormats(intf, trait, &results);
+        }
+    }
+
+    ComponentQueries *mQueries;
+    std::vector<std::pair<const Traits *, std::string>> mJobs;
+    std::vector<std::shared_ptr<Codec2Client>> mClients;
+    std::atomic<size_t> mNext{0};
+    std::vector<std::thread> mThreads;
+};
+
+// Returns a hash of everything the query results depend on: the builds of the
+// system and vendor partitions, the active APEXes and the component traits.
+uint64_t hashQueryInputs(const std::vector<Traits> &traits) {
+    // FNV-1a, which unlike std::hash is stable across releases.
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto add = [&hash](const std::string &s) {
+        for (char c : s) {
+            hash = (hash ^ (uint8_t)c) * 0x100000001b3ull;
+        }
+        hash = (hash ^ 0xff) * 0x100000001b3ull;
+    };
+    add(base::GetProperty("ro.build.fingerprint", ""));
+    add(base::GetProperty("ro.vendor.build.fingerprint", ""));
+    std::string apexInfo;
+    if (base::ReadFileToString(kApexInfoListPath, &apexInfo)) {
+        add(apexInfo);
+    }
+    for (const Traits &trait : traits) {
+        add(trait.name);
+        add(trait.owner);
+        add(trait.mediaType);
+        add(std::to_string(trait.domain) + "/" + std::to_string(trait.kind) + "/" +
+                std::to_string(trait.rank));
+        for (const std::string &alias : trait.aliases) {
+            add(alias);
+        }
+    }
+    return hash;
+}
+
+bool readQueryCache(const std::string &path, uint64_t hash, ComponentQueries *queries) {
+    std::string data;
+    if (!base::ReadFileToString(path, &data)) {
+        return false;
+    }
+    Parcel parcel;
+    parcel.setData(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+    if (parcel.readInt32() != kQueryCacheVersion || parcel.readUint64() != hash) {
+        ALOGD("codec query cache %s is stale", path.c_str());
+        return false;
+    }
+    auto readString = [&parcel](std::string *s) {
+        const char *str = parcel.readCString();
+        if (str) {
+            *s = str;
+        }
+        return str != nullptr;
+    };
+    // Every counted item takes at least 4 bytes, which bounds the counts of a
+    // corrupt file.
+    auto readCount = [&parcel](uint32_t *count) {
+        *count = parcel.readUint32();
+        return *count <= parcel.dataAvail() / 4;
+    };
+    uint32_t count;
+    ComponentQueries cached;
+    if (!readCount(&count)) {
+        return false;
+    }
+    cached.components.resize(count);
+    for (ComponentQueryResults &results : cached.components) {
+        results.valid = parcel.readBool();
+        if (!results.valid) {
+            continue;
+        }
+        if (!readString(&results.serviceName)) {
+            return false;
+        }
+        results.profilesQueried = parcel.readBool();
+        results.supportsHdr = parcel.readBool();
+        results.supportsHdr10Plus = parcel.readBool();
+        if (!readCount(&count)) {
+            return false;
+        }
+        results.profileLevels.resize(count);
+        for (auto &[profile, levels] : results.profileLevels) {
+            profile = parcel.readUint32();
+            if (!readCount(&count)) {
+                return false;
+            }
+            levels.resize(count);
+            for (uint32_t &level : levels) {
+                level = parcel.readUint32();
+            }
+        }
+        if (!readCount(&count)) {
+            return false;
+        }
+        results.pixelFormats.resize(count);
+        for (uint32_t &pixelFormat : results.pixelFormats) {
+            pixelFormat = parcel.readUint32();
+        }
+    }
+    for (uint32_t numServices = parcel.readUint32(); numServices > 0; --numServices) {
+        std::string serviceName;
+        if (!readString(&serviceName)) {
+            return false;
+        }
+        PixelFormatMap &pixelFormatMap = cached.pixelFormatMaps[serviceName];
+        for (uint32_t numFormats = parcel.readUint32(); numFormats > 0; --numFormats) {
+            uint32_t pixelFormat = parcel.readUint32();
+            pixelFormatMap[pixelFormat] = parcel.readInt32();
+        }
+    }
+    // Reads past the end of a truncated file return zeroes rather than failing,
+    // so the file ends with a marker.
+    if (parcel.readUint64() != hash || parcel.dataAvail() != 0) {
+        ALOGD("codec query cache %s is corrupt", path.c_str());
+        return false;
+    }
+    *queries = std::move(cached);
+    return true;
+}
+
+void writeQueryCache(const std::string &path, uint64_t hash, const ComponentQueries &queries) {
+    Parcel parcel;
+    parcel.writeInt32(kQueryCacheVersion);
+    parcel.writeUint64(hash);
+    parcel.writeUint32(queries.components.size());
+    for (const ComponentQueryResults &results : queries.components) {
+        parcel.writeBool(results.valid);
+        if (!results.valid) {
+            continue;
+        }
+        parcel.writeCString(results.serviceName.c_str());
+        parcel.writeBool(results.profilesQueried);
+        parcel.writeBool(results.supportsHdr);
+        parcel.writeBool(results.supportsHdr10Plus);
+        parcel.writeUint32(results.profileLevels.size());
+        for (const auto &[profile, levels] : results.profileLevels) {
+            parcel.writeUint32(profile);
+            parcel.writeUint32(levels.size());
+            for (uint32_t level : levels) {
+                parcel.writeUint32(level);
+            }
+        }
+        parcel.writeUint32(results.pixelFormats.size());
+        for (uint32_t pixelFormat : results.pixelFormats) {
+            parcel.writeUint32(pixelFormat);
+        }
+    }
+    parcel.writeUint32(queries.pixelFormatMaps.size());
+    for (const auto &[serviceName, pixelFormatMap] : queries.pixelFormatMaps) {
+        parcel.writeCString(serviceName.c_str());
+        parcel.writeUint32(pixelFormatMap.size());
+        for (const auto &[pixelFormat, colorFormat] : pixelFormatMap) {
+            parcel.writeUint32(pixelFormat);
+            parcel.writeInt32(colorFormat);
+        }
+    }
+    parcel.writeUint64(hash);
+
+    // Write to a temporary file first so that readers never see a partial cache.
+    std::string tmpPath = path + ".tmp";
+    std::string data(reinterpret_cast<const char *>(parcel.data()), parcel.dataSize());
+    if (!base::WriteStringToFile(data, tmpPath) || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ALOGD("could not write codec query cache %s", path.c_str());
+        unlink(tmpPath.c_str());
+    }
+}
+
+// returns true if component advertised supported profile level(s)
+bool addSupportedProfileLevels(
+        const ComponentQueryResults &results,
+        MediaCodecInfo::CapabilitiesWriter *caps,
+        const Traits& trait, const std::string &mediaType) {
+    std::shared_ptr<C2Mapper::ProfileLevelMapper> mapper =
+        C2Mapper::GetProfileLevelMapper(trait.mediaType);
+    // if we don't know the media type, pass through all values unmapped
+
+    // TODO: we cannot find levels that are local 'maxima' without knowing the coding
+    // e.g. H.263 level 45 and level 30 could be two values for highest level as
+    // they don't include one another. For now we use the last supported value.
+    if (!results.profilesQueried) {
+        return false;
+    }
+
+    // determine if codec supports HDR; imply 10-bit support
+    bool supportsHdr = results.supportsHdr;
+    // determine if codec supports HDR10Plus; imply 10-bit support
+    bool supportsHdr10Plus = results.supportsHdr10Plus;
+    // determine if codec supports 10-bit format
+    bool supports10Bit = false;
+
     // VP9 does not support HDR metadata in the bitstream and static metadata
     // can always be carried by the framework. (The framework does not propagate
     // dynamic metadata as that needs to be frame accurate.)
@@ -169,24 +529,10 @@ bool addSupportedProfileLevels(
 
     bool added = false;
 
-    for (C2Value::Primitive profile : profileQuery[0].values.values) {
-        pl.profile = (C2Config::profile_t)profile.ref<uint32_t>();
-        std::vector<std::unique_ptr<C2SettingResult>> failures;
-        err = intf->config({&pl}, C2_DONT_BLOCK, &failures);
-        ALOGV("set profile to %u -> %s", pl.profile, asString(err));
-        std::vector<C2FieldSupportedValuesQuery> levelQuery = {
-            C2FieldSupportedValuesQuery::Current(C2ParamField(&pl, &pl.level))
-        };
-        err = intf->querySupportedValues(levelQuery, C2_DONT_BLOCK);
-        ALOGV("query supported levels -> %s | %s", asString(err), asString(levelQuery[0].status));
-        if (err != C2_OK || levelQuery[0].status != C2_OK
-                || levelQuery[0].values.type != C2FieldSupportedValues::VALUES
-                || levelQuery[0].values.values.size() == 0) {
-            continue;
-        }
-
-        C2Value::Primitive level = levelQuery[0].values.values.back();
-        pl.level = (C2Config::level_t)level.ref<uint32_t>();
+    for (const auto &[profile, levels] : results.profileLevels) {
+        C2StreamProfileLevelInfo pl(trait.kind == C2Component::KIND_ENCODER /* output */, 0u);
+        pl.profile = (C2Config::profile_t)profile;
+        pl.level = (C2Config::level_t)levels.back();
         ALOGV("supporting level: %u", pl.level);
         int32_t sdkProfile, sdkLevel;
         if (mapper && mapper->mapProfile(pl.profile, &sdkProfile)
@@ -223,8 +569,8 @@ bool addSupportedProfileLevels(
         // have to be here
         if (mediaType == MIMETYPE_VIDEO_H263) {
             C2Config::level_t nextLevel = C2Config::LEVEL_UNUSED;
-            for (C2Value::Primitive v : levelQuery[0].values.values) {
-                C2Config::level_t level = (C2Config::level_t)v.ref<uint32_t>();
+            for (uint32_t v : levels) {
+                C2Config::level_t level = (C2Config::level_t)v;
                 if (level < C2Config::LEVEL_H263_45 && level > nextLevel) {
                     nextLevel = level;
                 }
@@ -243,43 +589,23 @@ bool addSupportedProfileLevels(
 }
 
 void addSupportedColorFormats(
-        std::shared_ptr<Codec2Client::Interface> intf,
+        const ComponentQueryResults &results,
         MediaCodecInfo::CapabilitiesWriter *caps,
         const Traits& trait, const std::string &mediaType,
         const PixelFormatMap &pixelFormatMap) {
-    // TODO: get this from intf() as well, but how do we map them to
-    // MediaCodec color formats?
-    bool encoder = trait.kind == C2Component::KIND_ENCODER;
     if (mediaType.find("video") != std::string::npos
             || mediaType.find("image") != std::string::npos) {
 
-        std::vector<C2FieldSupportedValuesQuery> query;
-        if (encoder) {
-            C2StreamPixelFormatInfo::input pixelFormat;
-            query.push_back(C2FieldSupportedValuesQuery::Possible(
-                    C2ParamField::Make(pixelFormat, pixelFormat.value)));
-        } else {
-            C2StreamPixelFormatInfo::output pixelFormat;
-            query.push_back(C2FieldSupportedValuesQuery::Possible(
-                    C2ParamField::Make(pixelFormat, pixelFormat.value)));
-        }
         std::list<int32_t> supportedColorFormats;
-        if (intf->querySupportedValues(query, C2_DONT_BLOCK) == C2_OK) {
-            if (query[0].status == C2_OK) {
-                const C2FieldSupportedValues &fsv = query[0].values;
-                if (fsv.type == C2FieldSupportedValues::VALUES) {
-                    for (C2Value::Primitive value : fsv.values) {
-                        auto it = pixelFormatMap.find(value.u32);
-                        if (it != pixelFormatMap.end()) {
-                            auto it2 = std::find(
-                                    supportedColorFormats.begin(),
-                                    supportedColorFormats.end(),
-                                    it->second);
-                            if (it2 == supportedColorFormats.end()) {
-                                supportedColorFormats.push_back(it->second);
-                            }
-                        }
-                    }
+        for (uint32_t pixelFormat : results.pixelFormats) {
+            auto it = pixelFormatMap.find(pixelFormat);
+            if (it != pixelFormatMap.end()) {
+                auto it2 = std::find(
+                        supportedColorFormats.begin(),
+                        supportedColorFormats.end(),
+                        it->second);
+                if (it2 == supportedColorFormats.end()) {
+                    supportedColorFormats.push_back(it->second);
                 }
             }
         }
@@ -391,55 +717,19 @@ Switch isDomainEnabled(
     return isSettingEnabled("domain-" + domain, settings);
 }
 
-} // unnamed namespace
-
-status_t Codec2InfoBuilder::buildMediaCodecList(MediaCodecListWriter* writer) {
-    // TODO: Remove run-time configurations once all codecs are working
-    // properly. (Assume "full" behavior eventually.)
-    //
-    // debug.stagefright.ccodec supports 5 values.
-    //   0 - No Codec 2.0 components are available.
-    //   1 - Audio decoders and encoders with prefix "c2.android." are available
-    //       and ranked first.
-    //       All other components with prefix "c2.android." are available with
-    //       their normal ranks.
-    //       Components with prefix "c2.vda." are available with their normal
-    //       ranks.
-    //       All other components with suffix ".avc.decoder" or ".avc.encoder"
-    //       are available but ranked last.
-    //   2 - Components with prefix "c2.android." are available and ranked
-    //       first.
-    //       Components with prefix "c2.vda." are available with their normal
-    //       ranks.
-    //       All other components with suffix ".avc.decoder" or ".avc.encoder"
-    //       are available but ranked last.
-    //   3 - Components with prefix "c2.android." are available and ranked
-    //       first.
-    //       All other components are available with their normal ranks.
-    //   4 - All components are available with their normal ranks.
-    //
-    // The default value (boot time) is 1.
-    //
-    // Note: Currently, OMX components have default rank 0x100, while all
-    // Codec2.0 software components have default rank 0x200.
-    int option = ::android::base::GetIntProperty("debug.stagefright.ccodec", 4);
-
-    // Obtain Codec2Client
-    std::vector<Traits> traits = Codec2Client::ListComponents();
-
+void parseXmlFiles(MediaCodecsXmlParser *parser) {
     // parse APEX XML first, followed by vendor XML.
     // Note: APEX XML names do not depend on ro.media.xml_variant.* properties.
-    MediaCodecsXmlParser parser;
-    parser.parseXmlFilesInSearchDirs(
+    parser->parseXmlFilesInSearchDirs(
             { "media_codecs.xml", "media_codecs_performance.xml" },
             { "/apex/com.android.media.swcodec/etc" });
 
     // TODO: remove these c2-specific files once product moved to default file names
-    parser.parseXmlFilesInSearchDirs(
+    parser->parseXmlFilesInSearchDirs(
             { "media_codecs_c2.xml", "media_codecs_performance_c2.xml" });
 
     // parse default XML files
-    parser.parseXmlFilesInSearchDirs();
+    parser->parseXmlFilesInSearchDirs();
 
     // The mainline modules for media may optionally include some codec shaping information.
     // Based on vendor partition SDK, and the brand/product/device information
@@ -491,7 +781,68 @@ status_t Codec2InfoBuilder::buildMediaCodecList(MediaCodecListWriter* writer) {
             base
         };
 
-        parser.parseXmlFilesInSearchDirs( { "media_codecs_shaping.xml" }, modulePathnames);
+        parser->parseXmlFilesInSearchDirs( { "media_codecs_shaping.xml" }, modulePathnames);
+    }
+}
+
+} // unnamed namespace
+
+status_t Codec2InfoBuilder::buildMediaCodecList(MediaCodecListWriter* writer) {
+    // TODO: Remove run-time configurations once all codecs are working
+    // properly. (Assume "full" behavior eventually.)
+    //
+    // debug.stagefright.ccodec supports 5 values.
+    //   0 - No Codec 2.0 components are available.
+    //   1 - Audio decoders and encoders with prefix "c2.android." are available
+    //       and ranked first.
+    //       All other components with prefix "c2.android." are available with
+    //       their normal ranks.
+    //       Components with prefix "c2.vda." are available with their normal
+    //       ranks.
+    //       All other components with suffix ".avc.decoder" or ".avc.encoder"
+    //       are available but ranked last.
+    //   2 - Components with prefix "c2.android." are available and ranked
+    //       first.
+    //       Components with prefix "c2.vda." are available with their normal
+    //       ranks.
+    //       All other components with suffix ".avc.decoder" or ".avc.encoder"
+    //       are available but ranked last.
+    //   3 - Components with prefix "c2.android." are available and ranked
+    //       first.
+    //       All other components are available with their normal ranks.
+    //   4 - All components are available with their normal ranks.
+    //
+    // The default value (boot time) is 1.
+    //
+    // Note: Currently, OMX components have default rank 0x100, while all
+    // Codec2.0 software components have default rank 0x200.
+    int option = ::android::base::GetIntProperty("debug.stagefright.ccodec", 4);
+
+    // Obtain Codec2Client
+    std::vector<Traits> traits = Codec2Client::ListComponents();
+
+    // Query the component interfaces on a pool of threads while the XML files
+    // are parsed, unless the results persisted by an earlier build are valid.
+    ComponentQueries queries;
+    uint64_t hash = hashQueryInputs(traits);
+    bool cached = mOptions.useCache && readQueryCache(mOptions.cachePath, hash, &queries);
+    std::optional<ComponentQuerier> querier;
+    if (!cached) {
+        size_t maxThreads = mOptions.maxQueryThreads;
+        if (maxThreads == 0) {
+            maxThreads = std::clamp(std::thread::hardware_concurrency(), 1u, kMaxQueryThreads);
+        }
+        querier.emplace(traits, maxThreads, &queries);
+    }
+
+    MediaCodecsXmlParser parser;
+    parseXmlFiles(&parser);
+
+    if (querier) {
+        querier->join();
+        if (mOptions.useCache) {
+            writeQueryCache(mOptions.cachePath, hash, queries);
+        }
     }
 
     if (parser.getParsingStatus() != OK) {
@@ -508,7 +859,7 @@ status_t Codec2InfoBuilder::buildMediaCodecList(MediaCodecListWriter* writer) {
         }
     }
 
-    std::map<std::string, PixelFormatMap> nameToPixelFormatMap;
+    size_t queryIndex = 0;
     for (const Traits& trait : traits) {
         C2Component::rank_t rank = trait.rank;
 
@@ -522,10 +873,8 @@ status_t Codec2InfoBuilder::buildMediaCodecList(MediaCodecListWriter* writer) {
         nameAndAliases.insert(nameAndAliases.begin(), trait.name);
         for (const std::string &nameOrAlias : nameAndAliases) {
             bool isAlias = trait.name != nameOrAlias;
-            std::shared_ptr<Codec2Client> client;
-            std::shared_ptr<Codec2Client::Interface> intf =
-                Codec2Client::CreateInterfaceByName(nameOrAlias.c_str(), &client);
-            if (!intf) {
+            const ComponentQueryResults &results = queries.components[queryIndex++];
+            if (!results.valid) {
                 ALOGD("could not create interface for %s'%s'",
                         isAlias ? "alias " : "",
                         nameOrAlias.c_str());
@@ -709,7 +1058,7 @@ status_t Codec2InfoBuilder::buildMediaCodecList(MediaCodecListWriter* writer) {
                     }
                 }
 
-                if (!addSupportedProfileLevels(intf, caps.get(), trait, mediaType)) {
+                if (!addSupportedProfileLevels(results, caps.get(), trait, mediaType)) {
                     // TODO(b/193279646) This will get fixed in C2InterfaceHelper
                     // Some components may not advertise supported values if they use a const
                     // param for profile/level (they support only one profile). For now cover
@@ -719,39 +1068,13 @@ status_t Codec2InfoBuilder::buildMediaCodecList(MediaCodecListWriter* writer) {
                     }
                 }
 
-                auto it = nameToPixelFormatMap.find(client->getServiceName());
-                if (it == nameToPixelFormatMap.end()) {
-                    it = nameToPixelFormatMap.try_emplace(client->getServiceName()).first;
-                    PixelFormatMap &pixelFormatMap = it->second;
-                    pixelFormatMap[HAL_PIXEL_FORMAT_YCBCR_420_888] = COLOR_FormatYUV420Flexible;
-                    pixelFormatMap[HAL_PIXEL_FORMAT_YCBCR_P010]    = COLOR_FormatYUVP010;
-                    pixelFormatMap[HAL_PIXEL_FORMAT_RGBA_1010102]  = COLOR_Format32bitABGR2101010;
-                    pixelFormatMap[HAL_PIXEL_FORMAT_RGBA_FP16]     = COLOR_Format64bitABGRFloat;
-
-                    std::shared_ptr<C2StoreFlexiblePixelFormatDescriptorsInfo> pixelFormatInfo;
-                    std::vector<std::unique_ptr<C2Param>> heapParams;
-                    if (client->query(
-                                {},
-                                {C2StoreFlexiblePixelFormatDescriptorsInfo::PARAM_TYPE},
-                                C2_MAY_BLOCK,
-                                &heapParams) == C2_OK
-                            && heapParams.size() == 1u) {
-                        pixelFormatInfo.reset(C2StoreFlexiblePixelFormatDescriptorsInfo::From(
-                                heapParams[0].release()));
-                    }
-                    if (pixelFormatInfo && *pixelFormatInfo) {
-                        for (size_t i = 0; i < pixelFormatInfo->flexCount(); ++i) {
-                            C2FlexiblePixelFormatDescriptorStruct &desc =
-                                pixelFormatInfo->m.values[i];
-                            std::optional<int32_t> colorFormat = findFrameworkColorFormat(desc);
-                            if (colorFormat) {
-                                pixelFormatMap[desc.pixelFormat] = *colorFormat;
-                            }
-                        }
-                    }
+                auto it = queries.pixelFormatMaps.find(results.serviceName);
+                if (it == queries.pixelFormatMaps.end()) {
+                    ALOGD("no pixel formats for service '%s'", results.serviceName.c_str());
+                    continue;
                 }
                 addSupportedColorFormats(
-                        intf, caps.get(), trait, mediaType, it->second);
+                        results, caps.get(), trait, mediaType, it->second);
             }
         }
     }
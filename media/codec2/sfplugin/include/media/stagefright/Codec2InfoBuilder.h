@@ -17,6 +17,8 @@
 #ifndef CODEC2_INFO_BUILDER_H_
 #define CODEC2_INFO_BUILDER_H_
 
+#include <string>
+
 #include <media/stagefright/MediaCodecList.h>
 #include <utils/Errors.h>
 
@@ -24,9 +26,24 @@ namespace android {
 
 class Codec2InfoBuilder : public MediaCodecListBuilderBase {
 public:
+    struct Options {
+        // Maximum number of component interfaces queried in parallel. 0 picks
+        // a default based on the number of CPUs.
+        size_t maxQueryThreads = 0;
+        // Whether the query results may be read from and written to |cachePath|.
+        // They are reused as long as the builds, the active APEXes and the
+        // listed components do not change.
+        bool useCache = true;
+        std::string cachePath = "/data/misc/media/codec2_info_cache";
+    };
+
     Codec2InfoBuilder() = default;
+    explicit Codec2InfoBuilder(const Options &options) : mOptions(options) {}
     ~Codec2InfoBuilder() override = default;
     status_t buildMediaCodecList(MediaCodecListWriter* writer) override;
+
+private:
+    Options mOptions;
 };
 
 }  // namespace android
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CCodecBufferChannel.h"
+
+#include <gtest/gtest.h>
+
+#include <C2Config.h>
+
+namespace android {
+
+namespace {
+
+std::unique_ptr<C2Param> bitrate(uint32_t value) {
+    return std::make_unique<C2StreamBitrateInfo::output>(0u, value);
+}
+
+std::unique_ptr<C2Param> syncFrameRequest() {
+    return std::make_unique<C2StreamRequestSyncFrameTuning::output>(0u, true);
+}
+
+std::unique_ptr<C2Param> hdr10PlusInfo(uint8_t value, size_t size) {
+    std::unique_ptr<C2StreamHdr10PlusInfo::output> info =
+        C2StreamHdr10PlusInfo::output::AllocUnique(size);
+    memset(info->m.value, value, size);
+    return info;
+}
+
+// Adds the params to |pending| as setParameters() would.
+void setParameters(std::vector<std::unique_ptr<C2Param>> *pending,
+                   std::vector<std::unique_ptr<C2Param>> params) {
+    CCodecBufferChannel::MergePendingParams(pending, params);
+    EXPECT_TRUE(params.empty());
+}
+
+std::vector<std::unique_ptr<C2Param>> makeParams(std::unique_ptr<C2Param> param) {
+    std::vector<std::unique_ptr<C2Param>> params;
+    params.push_back(std::move(param));
+    return params;
+}
+
+uint32_t bitrateOf(const std::unique_ptr<C2Param> &param) {
+    C2StreamBitrateInfo::output *info = C2StreamBitrateInfo::output::From(param.get());
+    return info ? info->value : 0;
+}
+
+}  // namespace
+
+// Each param keeps the position of its first pending value, and ends at the
+// value it was set to last.
+TEST(CCodecBufferChannelTest, PendingParamsAreCoalesced) {
+    std::vector<std::unique_ptr<C2Param>> pending;
+    for (uint32_t value : {100000u, 200000u, 300000u}) {
+        setParameters(&pending, makeParams(bitrate(value)));
+        setParameters(&pending, makeParams(syncFrameRequest()));
+    }
+    ASSERT_EQ(2u, pending.size());
+    EXPECT_EQ(300000u, bitrateOf(pending[0]));
+    EXPECT_EQ(C2Param::Index(C2StreamRequestSyncFrameTuning::output::PARAM_TYPE),
+              pending[1]->index());
+}
+
+// A sync frame request, as sent by requestIDRFrame(), stays behind the params
+// set before it, and ahead of the params set after it.
+TEST(CCodecBufferChannelTest, SyncFrameRequestKeepsItsOrder) {
+    std::vector<std::unique_ptr<C2Param>> pending;
+    setParameters(&pending, makeParams(hdr10PlusInfo(1, 4)));
+    setParameters(&pending, makeParams(syncFrameRequest()));
+    setParameters(&pending, makeParams(bitrate(100000)));
+    setParameters(&pending, makeParams(syncFrameRequest()));
+
+    ASSERT_EQ(3u, pending.size());
+    EXPECT_EQ(C2Param::Index(C2StreamHdr10PlusInfo::output::PARAM_TYPE), pending[0]->index());
+    EXPECT_EQ(C2Param::Index(C2StreamRequestSyncFrameTuning::output::PARAM_TYPE),
+              pending[1]->index());
+    EXPECT_EQ(100000u, bitrateOf(pending[2]));
+}
+
+// A heap param is replaced by its latest value, whatever its size, and keeps
+// its position among the other params.
+TEST(CCodecBufferChannelTest, HeapParamsAreCoalesced) {
+    std::vector<std::unique_ptr<C2Param>> pending;
+    std::vector<std::unique_ptr<C2Param>> params;
+    params.push_back(bitrate(100000));
+    params.push_back(hdr10PlusInfo(1, 4));
+    params.push_back(syncFrameRequest());
+    setParameters(&pending, std::move(params));
+
+    params.clear();
+    params.push_back(hdr10PlusInfo(2, 16));
+    params.push_back(nullptr);
+    params.push_back(bitrate(200000));
+    setParameters(&pending, std::move(params));
+
+    ASSERT_EQ(3u, pending.size());
+    EXPECT_EQ(200000u, bitrateOf(pending[0]));
+    EXPECT_TRUE(*hdr10PlusInfo(2, 16) == *pending[1]);
+    EXPECT_EQ(C2Param::Index(C2StreamRequestSyncFrameTuning::output::PARAM_TYPE),
+              pending[2]->index());
+}
+
+// The same param on another stream is a different param.
+TEST(CCodecBufferChannelTest, StreamsAreNotCoalesced) {
+    std::vector<std::unique_ptr<C2Param>> pending;
+    setParameters(&pending, makeParams(bitrate(100000)));
+    setParameters(&pending, makeParams(
+            std::make_unique<C2StreamBitrateInfo::output>(1u, 200000)));
+    ASSERT_EQ(2u, pending.size());
+    EXPECT_EQ(100000u, bitrateOf(pending[0]));
+    EXPECT_EQ(200000u, bitrateOf(pending[1]));
+}
+
+}  // namespace android
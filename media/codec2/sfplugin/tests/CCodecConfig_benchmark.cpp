@@ -0,0 +1,205 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the CCodecConfig work done for each codec instance and for each config update
+// coming back from the component, against a fake AVC decoder interface.
+
+#include "CCodecConfig.h"
+
+#include <benchmark/benchmark.h>
+
+#include <codec2/hidl/1.0/Configurable.h>
+#include <codec2/hidl/client.h>
+#include <util/C2InterfaceHelper.h>
+
+#include <media/stagefright/MediaCodecConstants.h>
+
+namespace android {
+
+namespace {
+
+using D = CCodecConfig::Domain;
+
+struct Cache : public hardware::media::c2::V1_0::utils::ParameterCache {
+    c2_status_t validate(const std::vector<std::shared_ptr<C2ParamDescriptor>>&) override {
+        return C2_OK;
+    }
+};
+
+class Configurable : public hardware::media::c2::V1_0::utils::ConfigurableC2Intf {
+public:
+    explicit Configurable(const std::shared_ptr<C2ReflectorHelper> &reflector)
+        : ConfigurableC2Intf("name", 0u),
+          mImpl(reflector) {
+    }
+
+    c2_status_t query(
+            const std::vector<C2Param::Index> &indices,
+            c2_blocking_t mayBlock,
+            std::vector<std::unique_ptr<C2Param>>* const params) const override {
+        return mImpl.query({}, indices, mayBlock, params);
+    }
+
+    c2_status_t config(
+            const std::vector<C2Param*> &params,
+            c2_blocking_t mayBlock,
+            std::vector<std::unique_ptr<C2SettingResult>>* const failures) override {
+        return mImpl.config(params, mayBlock, failures);
+    }
+
+    c2_status_t querySupportedParams(
+            std::vector<std::shared_ptr<C2ParamDescriptor>>* const params) const override {
+        return mImpl.querySupportedParams(params);
+    }
+
+    c2_status_t querySupportedValues(
+            std::vector<C2FieldSupportedValuesQuery>& fields,
+            c2_blocking_t mayBlock) const override {
+        return mImpl.querySupportedValues(fields, mayBlock);
+    }
+
+private:
+    class Impl : public C2InterfaceHelper {
+    public:
+        explicit Impl(const std::shared_ptr<C2ReflectorHelper> &reflector)
+            : C2InterfaceHelper{reflector} {
+
+            setDerivedInstance(this);
+
+            addParameter(
+                    DefineParam(mDomain, C2_PARAMKEY_COMPONENT_DOMAIN)
+                    .withConstValue(new C2ComponentDomainSetting(C2Component::DOMAIN_VIDEO))
+                    .build());
+
+            addParameter(
+                    DefineParam(mKind, C2_PARAMKEY_COMPONENT_KIND)
+                    .withConstValue(new C2ComponentKindSetting(C2Component::KIND_DECODER))
+                    .build());
+
+            addParameter(
+                    DefineParam(mInputStreamCount, C2_PARAMKEY_INPUT_STREAM_COUNT)
+                    .withConstValue(new C2PortStreamCountTuning::input(1))
+                    .build());
+
+            addParameter(
+                    DefineParam(mOutputStreamCount, C2_PARAMKEY_OUTPUT_STREAM_COUNT)
+                    .withConstValue(new C2PortStreamCountTuning::output(1))
+                    .build());
+
+            addParameter(
+                    DefineParam(mInputMediaType, C2_PARAMKEY_INPUT_MEDIA_TYPE)
+                    .withConstValue(AllocSharedString<C2PortMediaTypeSetting::input>(
+                            MIMETYPE_VIDEO_AVC))
+                    .build());
+
+            addParameter(
+                    DefineParam(mOutputMediaType, C2_PARAMKEY_OUTPUT_MEDIA_TYPE)
+                    .withConstValue(AllocSharedString<C2PortMediaTypeSetting::output>(
+                            MIMETYPE_VIDEO_RAW))
+                    .build());
+
+            addParameter(
+                    DefineParam(mPixelAspectRatio, C2_PARAMKEY_PIXEL_ASPECT_RATIO)
+                    .withDefault(new C2StreamPixelAspectRatioInfo::output(0u, 1, 1))
+                    .withFields({
+                        C2F(mPixelAspectRatio, width).any(),
+                        C2F(mPixelAspectRatio, height).any(),
+                    })
+                    .withSetter(Setter<C2StreamPixelAspectRatioInfo::output>)
+                    .build());
+        }
+
+    private:
+        std::shared_ptr<C2ComponentDomainSetting> mDomain;
+        std::shared_ptr<C2ComponentKindSetting> mKind;
+        std::shared_ptr<C2PortStreamCountTuning::input> mInputStreamCount;
+        std::shared_ptr<C2PortStreamCountTuning::output> mOutputStreamCount;
+        std::shared_ptr<C2PortMediaTypeSetting::input> mInputMediaType;
+        std::shared_ptr<C2PortMediaTypeSetting::output> mOutputMediaType;
+        std::shared_ptr<C2StreamPixelAspectRatioInfo::output> mPixelAspectRatio;
+
+        template<typename T>
+        static std::shared_ptr<T> AllocSharedString(const std::string &str) {
+            std::shared_ptr<T> ret = T::AllocShared(str.length() + 1);
+            strcpy(ret->m.value, str.c_str());
+            return ret;
+        }
+
+        template<typename T>
+        static C2R Setter(bool, C2P<T> &) {
+            return C2R::Ok();
+        }
+    };
+
+    Impl mImpl;
+};
+
+struct FakeDecoder {
+    FakeDecoder() : reflector{std::make_shared<C2ReflectorHelper>()} {
+        sp<hardware::media::c2::V1_0::utils::CachedConfigurable> cachedConfigurable =
+            new hardware::media::c2::V1_0::utils::CachedConfigurable(
+                    std::make_unique<Configurable>(reflector));
+        cachedConfigurable->init(std::make_shared<Cache>());
+        configurable = std::make_shared<Codec2Client::Configurable>(cachedConfigurable);
+    }
+
+    std::shared_ptr<C2ReflectorHelper> reflector;
+    std::shared_ptr<Codec2Client::Configurable> configurable;
+};
+
+}  // namespace
+
+// The format update following a single param change coming back from the component, as
+// happens for per-frame metadata, with a full or an incremental reflection of the config.
+static void BM_UpdateConfiguration(benchmark::State &state) {
+    const bool reflectAll = state.range(0);
+    FakeDecoder decoder;
+    CCodecConfig config;
+    if (config.initialize(decoder.reflector, decoder.configurable) != OK) {
+        state.SkipWithError("initialize failed");
+        return;
+    }
+    config.updateFormats(D::ALL);
+
+    int32_t i = 0;
+    for (auto _ : state) {
+        std::vector<std::unique_ptr<C2Param>> configUpdate;
+        C2StreamPixelAspectRatioInfo::output par(0u, 1 + (++i & 1), 1);
+        configUpdate.push_back(C2Param::Copy(par));
+        config.mReflectAll = reflectAll;
+        benchmark::DoNotOptimize(config.updateConfiguration(configUpdate, D::ALL));
+    }
+}
+
+BENCHMARK(BM_UpdateConfiguration)->ArgName("reflectAll")->Arg(0)->Arg(1);
+
+// Initializing the configuration of a new codec, as done for each codec instance.
+static void BM_Initialize(benchmark::State &state) {
+    FakeDecoder decoder;
+    for (auto _ : state) {
+        CCodecConfig config;
+        if (config.initialize(decoder.reflector, decoder.configurable) != OK) {
+            state.SkipWithError("initialize failed");
+            break;
+        }
+    }
+}
+
+BENCHMARK(BM_Initialize)->Unit(benchmark::kMicrosecond);
+
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -589,6 +589,126 @@ TEST_F(CCodecConfigTest, DataspaceUpdate) {
             << "mOutputFormat = " << mConfig.mOutputFormat->debugString().c_str();
 }
 
+TEST_F(CCodecConfigTest, IncrementalUpdateMatchesFullUpdate) {
+    init(C2Component::DOMAIN_VIDEO, C2Component::KIND_DECODER, MIMETYPE_VIDEO_AVC);
+
+    ASSERT_EQ(OK, mConfig.initialize(mReflector, mConfigurable));
+    mConfig.updateFormats(D::ALL);
+
+    for (int32_t i = 1; i <= 4; ++i) {
+        std::vector<std::unique_ptr<C2Param>> configUpdate;
+        C2StreamPixelAspectRatioInfo::output par(0u, 10 + i, 11);
+        configUpdate.push_back(C2Param::Copy(par));
+        ASSERT_TRUE(mConfig.updateConfiguration(configUpdate, D::ALL));
+
+        sp<AMessage> inputFormat = mConfig.mInputFormat;
+        sp<AMessage> outputFormat = mConfig.mOutputFormat;
+
+        // nothing changed since the last update
+        EXPECT_FALSE(mConfig.updateFormats(D::ALL));
+
+        // reflecting the whole configuration should yield the same formats
+        mConfig.mReflectAll = true;
+        EXPECT_FALSE(mConfig.updateFormats(D::ALL))
+                << "mOutputFormat = " << mConfig.mOutputFormat->debugString().c_str();
+        EXPECT_EQ(inputFormat, mConfig.mInputFormat);
+        EXPECT_EQ(outputFormat, mConfig.mOutputFormat);
+
+        int32_t parWidth{0};
+        ASSERT_TRUE(mConfig.mOutputFormat->findInt32(KEY_PIXEL_ASPECT_RATIO_WIDTH, &parWidth))
+                << "mOutputFormat = " << mConfig.mOutputFormat->debugString().c_str();
+        EXPECT_EQ(10 + i, parWidth);
+    }
+}
+
+TEST_F(CCodecConfigTest, UpdateReflectsOnlyChangedParams) {
+    init(C2Component::DOMAIN_VIDEO, C2Component::KIND_DECODER, MIMETYPE_VIDEO_AVC);
+
+    ASSERT_EQ(OK, mConfig.initialize(mReflector, mConfigurable));
+    mConfig.updateFormats(D::ALL);
+    EXPECT_FALSE(mConfig.mReflectAll);
+    EXPECT_TRUE(mConfig.mDirtyIndices.empty());
+    EXPECT_TRUE(mConfig.mReflectedKeys.empty());
+
+    std::vector<std::unique_ptr<C2Param>> configUpdate;
+    C2StreamPixelAspectRatioInfo::output par(0u, 3, 2);
+    configUpdate.push_back(C2Param::Copy(par));
+    ASSERT_TRUE(mConfig.updateConfiguration(configUpdate, D::ALL));
+
+    // only the changed param was reflected again
+    EXPECT_TRUE(mConfig.mDirtyIndices.empty());
+    ASSERT_EQ(1u, mConfig.mReflectedKeys.size());
+    EXPECT_EQ(C2Param::Index(par.index()), mConfig.mReflectedKeys.begin()->first);
+
+    // an update to the same value does not change the formats
+    sp<AMessage> outputFormat = mConfig.mOutputFormat;
+    configUpdate.clear();
+    configUpdate.push_back(C2Param::Copy(par));
+    EXPECT_FALSE(mConfig.updateConfiguration(configUpdate, D::ALL));
+    EXPECT_TRUE(mConfig.mDirtyIndices.empty());
+    EXPECT_EQ(outputFormat, mConfig.mOutputFormat);
+
+    // an update to another value replaces the previously reflected fields
+    C2StreamPixelAspectRatioInfo::output otherPar(0u, 4, 3);
+    configUpdate.clear();
+    configUpdate.push_back(C2Param::Copy(otherPar));
+    ASSERT_TRUE(mConfig.updateConfiguration(configUpdate, D::ALL));
+    EXPECT_NE(outputFormat, mConfig.mOutputFormat);
+    int32_t parWidth{0};
+    int32_t parHeight{0};
+    ASSERT_TRUE(mConfig.mOutputFormat->findInt32(KEY_PIXEL_ASPECT_RATIO_WIDTH, &parWidth))
+            << "mOutputFormat = " << mConfig.mOutputFormat->debugString().c_str();
+    ASSERT_TRUE(mConfig.mOutputFormat->findInt32(KEY_PIXEL_ASPECT_RATIO_HEIGHT, &parHeight))
+            << "mOutputFormat = " << mConfig.mOutputFormat->debugString().c_str();
+    EXPECT_EQ(4, parWidth);
+    EXPECT_EQ(3, parHeight);
+}
+
+TEST_F(CCodecConfigTest, StandardParamsShared) {
+    init(C2Component::DOMAIN_VIDEO, C2Component::KIND_DECODER, MIMETYPE_VIDEO_AVC);
+
+    ASSERT_EQ(OK, mConfig.initialize(mReflector, mConfigurable));
+    CCodecConfig config;
+    ASSERT_EQ(OK, config.initialize(mReflector, mConfigurable));
+
+    EXPECT_EQ(mConfig.mStandardParams, config.mStandardParams);
+    EXPECT_EQ(mConfig.mSupportedStandardParams, config.mSupportedStandardParams);
+    EXPECT_EQ(0u, mConfig.mInputFormat->changesFrom(config.mInputFormat)->countEntries())
+            << "mInputFormat = " << mConfig.mInputFormat->debugString().c_str();
+    EXPECT_EQ(0u, mConfig.mOutputFormat->changesFrom(config.mOutputFormat)->countEntries())
+            << "mOutputFormat = " << mConfig.mOutputFormat->debugString().c_str();
+
+    // the standard params of an encoder are shared too, but apply differently
+    init(C2Component::DOMAIN_VIDEO, C2Component::KIND_ENCODER, MIMETYPE_VIDEO_AVC);
+    CCodecConfig encoderConfig;
+    ASSERT_EQ(OK, encoderConfig.initialize(mReflector, mConfigurable));
+    EXPECT_EQ(mConfig.mStandardParams, encoderConfig.mStandardParams);
+    EXPECT_NE(mConfig.mSupportedStandardParams, encoderConfig.mSupportedStandardParams);
+}
+
+TEST_F(CCodecConfigTest, Av1TenBitStandardParamsShared) {
+    init(C2Component::DOMAIN_VIDEO, C2Component::KIND_ENCODER, MIMETYPE_VIDEO_AV1);
+
+    ASSERT_EQ(OK, mConfig.initialize(mReflector, mConfigurable));
+    CCodecConfig config;
+    ASSERT_EQ(OK, config.initialize(mReflector, mConfigurable));
+    const std::shared_ptr<const StandardParams> eightBitParams = mConfig.mStandardParams;
+    ASSERT_EQ(eightBitParams, config.mStandardParams);
+
+    sp<AMessage> format{new AMessage};
+    format->setString(KEY_MIME, MIMETYPE_VIDEO_AV1);
+    format->setInt32(KEY_PROFILE, AV1ProfileMain10);
+    std::vector<std::unique_ptr<C2Param>> configUpdate;
+    ASSERT_EQ(OK, mConfig.getConfigUpdateFromSdkParams(
+            mConfigurable, format, D::ALL, C2_MAY_BLOCK, &configUpdate));
+    ASSERT_EQ(OK, config.getConfigUpdateFromSdkParams(
+            mConfigurable, format, D::ALL, C2_MAY_BLOCK, &configUpdate));
+
+    // a 10-bit request switches both codecs to the same shared 10-bit table
+    EXPECT_NE(eightBitParams, mConfig.mStandardParams);
+    EXPECT_EQ(mConfig.mStandardParams, config.mStandardParams);
+}
+
 typedef std::tuple<std::string, C2Config::profile_t, int32_t> HdrProfilesParams;
 
 class HdrProfilesTest
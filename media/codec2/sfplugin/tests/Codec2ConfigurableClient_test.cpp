@@ -0,0 +1,251 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mutex>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <codec2/hidl/1.0/Configurable.h>
+#include <codec2/hidl/client.h>
+#include <util/C2InterfaceHelper.h>
+
+#include <media/stagefright/MediaCodecConstants.h>
+
+namespace android {
+
+namespace {
+
+struct Cache : public hardware::media::c2::V1_0::utils::ParameterCache {
+    c2_status_t validate(const std::vector<std::shared_ptr<C2ParamDescriptor>>&) override {
+        return C2_OK;
+    }
+};
+
+// Records the params queried from the component.
+class Configurable : public hardware::media::c2::V1_0::utils::ConfigurableC2Intf {
+public:
+    explicit Configurable(const std::shared_ptr<C2ReflectorHelper> &reflector)
+        : ConfigurableC2Intf("name", 0u),
+          mImpl(reflector) {
+    }
+
+    c2_status_t query(
+            const std::vector<C2Param::Index> &indices,
+            c2_blocking_t mayBlock,
+            std::vector<std::unique_ptr<C2Param>>* const params) const override {
+        {
+            std::scoped_lock lock{mMutex};
+            mQueried.insert(mQueried.end(), indices.begin(), indices.end());
+            ++mNumQueries;
+        }
+        return mImpl.query({}, indices, mayBlock, params);
+    }
+
+    c2_status_t config(
+            const std::vector<C2Param*> &params,
+            c2_blocking_t mayBlock,
+            std::vector<std::unique_ptr<C2SettingResult>>* const failures) override {
+        return mImpl.config(params, mayBlock, failures);
+    }
+
+    c2_status_t querySupportedParams(
+            std::vector<std::shared_ptr<C2ParamDescriptor>>* const params) const override {
+        return mImpl.querySupportedParams(params);
+    }
+
+    c2_status_t querySupportedValues(
+            std::vector<C2FieldSupportedValuesQuery>& fields,
+            c2_blocking_t mayBlock) const override {
+        return mImpl.querySupportedValues(fields, mayBlock);
+    }
+
+    // Returns the params queried from the component since the last call, and
+    // the number of query calls.
+    std::vector<C2Param::Index> takeQueried(int *numQueries = nullptr) {
+        std::scoped_lock lock{mMutex};
+        if (numQueries) {
+            *numQueries = mNumQueries;
+        }
+        mNumQueries = 0;
+        std::vector<C2Param::Index> queried;
+        queried.swap(mQueried);
+        return queried;
+    }
+
+private:
+    class Impl : public C2InterfaceHelper {
+    public:
+        explicit Impl(const std::shared_ptr<C2ReflectorHelper> &reflector)
+            : C2InterfaceHelper{reflector} {
+
+            setDerivedInstance(this);
+
+            addParameter(
+                    DefineParam(mDomain, C2_PARAMKEY_COMPONENT_DOMAIN)
+                    .withConstValue(new C2ComponentDomainSetting(C2Component::DOMAIN_VIDEO))
+                    .build());
+
+            addParameter(
+                    DefineParam(mInputMediaType, C2_PARAMKEY_INPUT_MEDIA_TYPE)
+                    .withConstValue(AllocSharedString<C2PortMediaTypeSetting::input>(
+                            MIMETYPE_VIDEO_AVC))
+                    .build());
+
+            addParameter(
+                    DefineParam(mPixelAspectRatio, C2_PARAMKEY_PIXEL_ASPECT_RATIO)
+                    .withDefault(new C2StreamPixelAspectRatioInfo::output(0u, 1, 1))
+                    .withFields({
+                        C2F(mPixelAspectRatio, width).any(),
+                        C2F(mPixelAspectRatio, height).any(),
+                    })
+                    .withSetter(Setter<C2StreamPixelAspectRatioInfo::output>)
+                    .build());
+
+            mHdr10PlusInfo = C2StreamHdr10PlusInfo::output::AllocShared(0);
+            addParameter(
+                    DefineParam(mHdr10PlusInfo, C2_PARAMKEY_OUTPUT_HDR10_PLUS_INFO)
+                    .withDefault(mHdr10PlusInfo)
+                    .withFields({
+                        C2F(mHdr10PlusInfo, m.value).any(),
+                    })
+                    .withSetter(Setter<C2StreamHdr10PlusInfo::output>)
+                    .build());
+        }
+
+    private:
+        std::shared_ptr<C2ComponentDomainSetting> mDomain;
+        std::shared_ptr<C2PortMediaTypeSetting::input> mInputMediaType;
+        std::shared_ptr<C2StreamPixelAspectRatioInfo::output> mPixelAspectRatio;
+        std::shared_ptr<C2StreamHdr10PlusInfo::output> mHdr10PlusInfo;
+
+        template<typename T>
+        static std::shared_ptr<T> AllocSharedString(const std::string &str) {
+            std::shared_ptr<T> ret = T::AllocShared(str.length() + 1);
+            strcpy(ret->m.value, str.c_str());
+            return ret;
+        }
+
+        template<typename T>
+        static C2R Setter(bool, C2P<T> &) {
+            return C2R::Ok();
+        }
+    };
+
+    Impl mImpl;
+    mutable std::mutex mMutex;
+    mutable std::vector<C2Param::Index> mQueried;
+    mutable int mNumQueries = 0;
+};
+
+}  // namespace
+
+class Codec2ConfigurableClientTest : public ::testing::Test {
+public:
+    void SetUp() override {
+        std::unique_ptr<Configurable> configurable =
+            std::make_unique<Configurable>(std::make_shared<C2ReflectorHelper>());
+        mConfigurable = configurable.get();
+        sp<hardware::media::c2::V1_0::utils::CachedConfigurable> cachedConfigurable =
+            new hardware::media::c2::V1_0::utils::CachedConfigurable(std::move(configurable));
+        cachedConfigurable->init(std::make_shared<Cache>());
+        mClient = std::make_shared<Codec2Client::Configurable>(cachedConfigurable);
+
+        // The const params are known from their descriptors.
+        std::vector<std::shared_ptr<C2ParamDescriptor>> descriptors;
+        ASSERT_EQ(C2_OK, mClient->querySupportedParams(&descriptors));
+        ASSERT_FALSE(descriptors.empty());
+    }
+
+protected:
+    Configurable *mConfigurable;
+    std::shared_ptr<Codec2Client::Configurable> mClient;
+};
+
+// The descriptors are only fetched from the component once: later calls return
+// the same objects.
+TEST_F(Codec2ConfigurableClientTest, DescriptorsAreCached) {
+    std::vector<std::shared_ptr<C2ParamDescriptor>> first;
+    ASSERT_EQ(C2_OK, mClient->querySupportedParams(&first));
+    std::vector<std::shared_ptr<C2ParamDescriptor>> second;
+    ASSERT_EQ(C2_OK, mClient->querySupportedParams(&second));
+    EXPECT_EQ(first, second);
+}
+
+// A const param is queried from the component the first time only.
+TEST_F(Codec2ConfigurableClientTest, ConstParamsAreServedFromCache) {
+    C2ComponentDomainSetting domain;
+    ASSERT_EQ(C2_OK, mClient->query({&domain}, {}, C2_MAY_BLOCK, nullptr));
+    EXPECT_EQ(C2Component::DOMAIN_VIDEO, domain.value);
+    EXPECT_EQ(std::vector<C2Param::Index>{domain.index()}, mConfigurable->takeQueried());
+
+    C2ComponentDomainSetting cachedDomain;
+    ASSERT_EQ(C2_OK, mClient->query({&cachedDomain}, {}, C2_MAY_BLOCK, nullptr));
+    EXPECT_EQ(C2Component::DOMAIN_VIDEO, cachedDomain.value);
+    int numQueries;
+    EXPECT_TRUE(mConfigurable->takeQueried(&numQueries).empty());
+    EXPECT_EQ(0, numQueries);
+}
+
+// A param that is not const is queried from the component every time, and
+// reflects the latest config.
+TEST_F(Codec2ConfigurableClientTest, MutableParamsAreAlwaysQueried) {
+    for (int32_t width : {1, 4, 16}) {
+        C2StreamPixelAspectRatioInfo::output par(0u, width, 3);
+        std::vector<std::unique_ptr<C2SettingResult>> failures;
+        ASSERT_EQ(C2_OK, mClient->config({&par}, C2_MAY_BLOCK, &failures));
+
+        C2StreamPixelAspectRatioInfo::output queried(0u);
+        ASSERT_EQ(C2_OK, mClient->query({&queried}, {}, C2_MAY_BLOCK, nullptr));
+        EXPECT_EQ(width, queried.width);
+        EXPECT_EQ(3, queried.height);
+        EXPECT_EQ(std::vector<C2Param::Index>{queried.index()}, mConfigurable->takeQueried());
+    }
+}
+
+// Heap params are returned in the order they were requested in, whether they
+// are served from the cache or by the component, and only the params that
+// are not const are queried from the component.
+TEST_F(Codec2ConfigurableClientTest, HeapParamsKeepRequestedOrder) {
+    const C2Param::Index mediaType = C2PortMediaTypeSetting::input::PARAM_TYPE;
+    const C2Param::Index hdr10Plus = C2StreamHdr10PlusInfo::output::PARAM_TYPE;
+    const C2Param::Index par = C2StreamPixelAspectRatioInfo::output::PARAM_TYPE;
+    const C2Param::Index domain = C2ComponentDomainSetting::PARAM_TYPE;
+    const std::vector<C2Param::Index> indices{hdr10Plus, mediaType, par, domain};
+
+    for (int i = 0; i < 2; ++i) {
+        std::vector<std::unique_ptr<C2Param>> heapParams;
+        ASSERT_EQ(C2_OK, mClient->query({}, indices, C2_MAY_BLOCK, &heapParams));
+        ASSERT_EQ(indices.size(), heapParams.size());
+        for (size_t j = 0; j < indices.size(); ++j) {
+            ASSERT_NE(nullptr, heapParams[j]);
+            EXPECT_EQ(indices[j], heapParams[j]->index()) << "param #" << j;
+        }
+        C2PortMediaTypeSetting::input *mediaTypeParam =
+            C2PortMediaTypeSetting::input::From(heapParams[1].get());
+        ASSERT_NE(nullptr, mediaTypeParam);
+        EXPECT_STREQ(MIMETYPE_VIDEO_AVC, mediaTypeParam->m.value);
+
+        std::vector<C2Param::Index> queried = mConfigurable->takeQueried();
+        if (i == 0) {
+            EXPECT_EQ(indices, queried);
+        } else {
+            EXPECT_EQ((std::vector<C2Param::Index>{hdr10Plus, par}), queried);
+        }
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks changing the bitrate of the AVC encoder, with or without a sync
+// frame request, as a real-time encoder may do for every frame.
+
+#include <benchmark/benchmark.h>
+#include <binder/ProcessState.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaCodecConstants.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+using namespace android;
+
+// range(0) is whether each update also requests a sync frame.
+static void BM_SetParameters(benchmark::State &state) {
+    const bool requestSyncFrame = state.range(0);
+    sp<ALooper> looper = new ALooper;
+    looper->start();
+    sp<MediaCodec> codec = MediaCodec::CreateByComponentName(looper, "c2.android.avc.encoder");
+    if (codec == nullptr) {
+        looper->stop();
+        state.SkipWithError("c2.android.avc.encoder is not available");
+        return;
+    }
+    sp<AMessage> cfg = new AMessage;
+    cfg->setInt32("width", 320);
+    cfg->setInt32("height", 240);
+    cfg->setString("mime", MIMETYPE_VIDEO_AVC);
+    cfg->setInt32("color-format", COLOR_FormatYUV420Flexible);
+    cfg->setInt32("bitrate", 500000);
+    cfg->setInt32("frame-rate", 30);
+    cfg->setInt32("i-frame-interval", 1);
+    if (codec->configure(cfg, nullptr, nullptr, MediaCodec::CONFIGURE_FLAG_ENCODE) != OK
+            || codec->start() != OK) {
+        state.SkipWithError("could not start the encoder");
+    } else {
+        int i = 0;
+        for (auto _ : state) {
+            sp<AMessage> params = new AMessage;
+            params->setInt32(PARAMETER_KEY_VIDEO_BITRATE, 400000 + (++i % 2) * 100000);
+            if (requestSyncFrame) {
+                params->setInt32(PARAMETER_KEY_REQUEST_SYNC_FRAME, 0);
+            }
+            if (codec->setParameters(params) != OK) {
+                state.SkipWithError("setParameters failed");
+                break;
+            }
+        }
+    }
+    codec->release();
+    looper->stop();
+}
+
+BENCHMARK(BM_SetParameters)->ArgName("requestSyncFrame")->Arg(0)->Arg(1)->UseRealTime();
+
+int main(int argc, char **argv) {
+    ProcessState::self()->startThreadPool();
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
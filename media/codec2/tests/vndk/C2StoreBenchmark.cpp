@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks listing the components of a new platform component store, as done when the
+// codec service starts and builds the codec list.
+
+#include <benchmark/benchmark.h>
+
+#include <C2Component.h>
+#include <C2PlatformSupport.h>
+
+namespace android {
+
+static void BM_ListComponents(benchmark::State &state) {
+    for (auto _ : state) {
+        // the platform store is only kept while it is referenced, so each iteration gets a
+        // new one
+        std::shared_ptr<C2ComponentStore> store = GetCodec2PlatformComponentStore();
+        benchmark::DoNotOptimize(store->listComponents());
+    }
+}
+
+BENCHMARK(BM_ListComponents)->Unit(benchmark::kMicrosecond);
+
+}  // namespace android
+
+BENCHMARK_MAIN();
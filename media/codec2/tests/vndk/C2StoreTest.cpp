@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "C2StoreTest"
+
+#include <dlfcn.h>
+
+#include <set>
+
+#include <gtest/gtest.h>
+
+#include <C2Component.h>
+#include <C2ComponentFactory.h>
+#include <C2PlatformComponents.h>
+#include <C2PlatformSupport.h>
+#include <util/C2InterfaceUtils.h>
+
+namespace android {
+
+// Listing the platform components must not load any of the component libraries.
+TEST(C2StoreTest, ListComponentsDoesNotLoadLibraries) {
+    constexpr char kLibPath[] = "libcodec2_soft_avcdec.so";
+    void *handle = dlopen(kLibPath, RTLD_NOW | RTLD_NOLOAD);
+    if (handle != nullptr) {
+        dlclose(handle);
+        GTEST_SKIP() << kLibPath << " is already loaded";
+    }
+
+    std::shared_ptr<C2ComponentStore> store = GetCodec2PlatformComponentStore();
+    ASSERT_NE(nullptr, store);
+    std::vector<std::shared_ptr<const C2Component::Traits>> traits = store->listComponents();
+
+    std::set<C2String> names;
+    for (const std::shared_ptr<const C2Component::Traits> &t : traits) {
+        ASSERT_NE(nullptr, t);
+        EXPECT_TRUE(names.insert(t->name).second) << "duplicate component " << t->name;
+        EXPECT_FALSE(t->mediaType.empty()) << t->name;
+    }
+    EXPECT_EQ(1u, names.count("c2.android.avc.decoder"));
+
+    handle = dlopen(kLibPath, RTLD_NOW | RTLD_NOLOAD);
+    EXPECT_EQ(nullptr, handle) << kLibPath << " was loaded by listComponents";
+    if (handle != nullptr) {
+        dlclose(handle);
+    }
+}
+
+// The traits the platform store lists without loading the component libraries must be the
+// ones the components report once loaded.
+TEST(C2StoreTest, ListedTraitsMatchComponents) {
+    std::shared_ptr<C2ComponentStore> store = GetCodec2PlatformComponentStore();
+    ASSERT_NE(nullptr, store);
+    const std::vector<std::shared_ptr<const C2Component::Traits>> listed =
+        store->listComponents();
+    ASSERT_FALSE(listed.empty());
+
+    for (const std::shared_ptr<const C2Component::Traits> &traits : listed) {
+        std::shared_ptr<C2ComponentInterface> intf;
+        ASSERT_EQ(C2_OK, store->createInterface(traits->name, &intf)) << traits->name;
+        ASSERT_NE(nullptr, intf) << traits->name;
+
+        C2Component::Traits reported;
+        ASSERT_TRUE(C2InterfaceUtils::FillTraitsFromInterface(&reported, intf))
+                << traits->name;
+        EXPECT_EQ(traits->name, reported.name);
+        EXPECT_EQ(traits->domain, reported.domain) << traits->name;
+        EXPECT_EQ(traits->kind, reported.kind) << traits->name;
+        EXPECT_EQ(traits->mediaType, reported.mediaType) << traits->name;
+        EXPECT_EQ(traits->aliases, reported.aliases) << traits->name;
+    }
+
+    // loading the components did not correct any of the listed traits
+    const std::vector<std::shared_ptr<const C2Component::Traits>> loaded =
+        store->listComponents();
+    ASSERT_EQ(listed.size(), loaded.size());
+    for (size_t i = 0; i < listed.size(); ++i) {
+        EXPECT_EQ(listed[i], loaded[i]) << listed[i]->name;
+    }
+}
+
+// Every library in the table of platform components must load on its own, outside of the
+// store, and report the traits the table lists for it.
+TEST(C2StoreTest, TableMatchesComponentLibraries) {
+    std::set<C2String> libPaths;
+    std::set<C2String> names;
+    for (const C2PlatformComponent &component : kC2PlatformComponents) {
+        const std::string name = component.name;
+        EXPECT_TRUE(libPaths.insert(component.libPath).second)
+                << "duplicate library " << component.libPath;
+        EXPECT_TRUE(names.insert(name).second) << "duplicate component " << name;
+
+        void *handle = dlopen(component.libPath, RTLD_NOW | RTLD_NODELETE);
+        ASSERT_NE(nullptr, handle) << component.libPath << ": " << dlerror();
+        auto createFactory = (C2ComponentFactory::CreateCodec2FactoryFunc)dlsym(
+                handle, "CreateCodec2Factory");
+        auto destroyFactory = (C2ComponentFactory::DestroyCodec2FactoryFunc)dlsym(
+                handle, "DestroyCodec2Factory");
+        ASSERT_NE(nullptr, createFactory) << component.libPath;
+        ASSERT_NE(nullptr, destroyFactory) << component.libPath;
+        C2ComponentFactory *factory = createFactory();
+        ASSERT_NE(nullptr, factory) << component.libPath;
+
+        C2Component::Traits reported;
+        bool filled = false;
+        {
+            std::shared_ptr<C2ComponentInterface> intf;
+            c2_status_t err = factory->createInterface(
+                    0, &intf, [](C2ComponentInterface *p) { delete p; });
+            EXPECT_EQ(C2_OK, err) << component.libPath;
+            if (err == C2_OK && intf) {
+                filled = C2InterfaceUtils::FillTraitsFromInterface(&reported, intf);
+            }
+        }
+        destroyFactory(factory);
+        dlclose(handle);
+        ASSERT_TRUE(filled) << component.libPath;
+
+        EXPECT_EQ(name, reported.name) << component.libPath;
+        EXPECT_EQ(component.kind, reported.kind) << name;
+        EXPECT_EQ(component.domain, reported.domain) << name;
+        EXPECT_EQ(component.mediaType, reported.mediaType) << name;
+        EXPECT_TRUE(reported.aliases.empty()) << name << " has aliases";
+    }
+}
+
+}  // namespace android
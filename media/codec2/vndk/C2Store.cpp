@@ -26,6 +26,7 @@
 #include <C2BqBufferPriv.h>
 #include <C2Component.h>
 #include <C2Config.h>
+#include <C2PlatformComponents.h>
 #include <C2PlatformStorePluginLoader.h>
 #include <C2PlatformSupport.h>
 #include <codec2/common/HalSelection.h>
@@ -35,9 +36,11 @@
 #include <dlfcn.h>
 #include <unistd.h> // getpagesize
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <thread>
 
 #ifdef __ANDROID_APEX__
 #include <android-base/properties.h>
@@ -656,6 +659,22 @@ c2_status_t CreateCodec2BlockPool(
     return sBlockPoolCache->createBlockPool(allocatorId, {component}, pool);
 }
 
+namespace {
+
+/**
+ * Returns the rank of a platform component in a given domain.
+ */
+C2Component::rank_t GetDefaultRank(C2Component::domain_t domain) {
+    switch (domain) {
+    case C2Component::DOMAIN_AUDIO:
+        return 8;
+    default:
+        return 512;
+    }
+}
+
+}  // namespace
+
 class C2PlatformComponentStore : public C2ComponentStore {
 public:
     virtual std::vector<std::shared_ptr<const C2Component::Traits>> listComponents() override;
@@ -692,9 +711,6 @@ private:
 
     /**
      * An object encapsulating a loaded component module.
-     *
-     * \todo provide a way to add traits to known components here to avoid loading the .so-s
-     * for listComponents
      */
     struct ComponentModule : public C2ComponentFactory,
             public std::enable_shared_from_this<ComponentModule> {
@@ -794,7 +810,8 @@ private:
          * \retval C2_CORRUPTED the component module could not be loaded
          * \retval C2_REFUSED   permission denied to load the component module
          */
-        c2_status_t fetchModule(std::shared_ptr<ComponentModule> *module) {
+        c2_status_t fetchModule(std::shared_ptr<ComponentModule> *module,
+                                bool *traitsChanged = nullptr) {
             c2_status_t res = C2_OK;
             std::lock_guard<std::mutex> lock(mMutex);
             std::shared_ptr<ComponentModule> localModule = mModule.lock();
@@ -809,17 +826,36 @@ private:
                 res = localModule->init(mLibPath);
                 if (res == C2_OK) {
                     mModule = localModule;
+                    if (mTraits && !verifyTraits(localModule->getTraits())) {
+                        mTraits = localModule->getTraits();
+                        if (traitsChanged) {
+                            *traitsChanged = true;
+                        }
+                    }
                 }
             }
             *module = localModule;
             return res;
         }
 
+        /**
+         * \returns the traits of the component in this module as known without loading it, or
+         * nullptr if the module must be loaded to discover them. Once the module has been
+         * loaded, these are the traits it reported.
+         */
+        std::shared_ptr<const C2Component::Traits> getKnownTraits() {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mTraits;
+        }
+
         /**
          * Creates a component loader for a specific library path (or name).
+         *
+         * \param traits[in] the traits of the component in the library if known.
          */
-        ComponentLoader(std::string libPath)
-            : mLibPath(libPath) {}
+        ComponentLoader(std::string libPath,
+                        std::shared_ptr<const C2Component::Traits> traits = nullptr)
+            : mLibPath(libPath), mTraits(traits) {}
 
         // For testing only
         ComponentLoader(std::tuple<C2String,
@@ -830,9 +866,37 @@ private:
               mDestroyFactory(std::get<2>(func)) {}
 
     private:
+        /**
+         * Checks the traits reported by the loaded module against the ones listed for the
+         * library.
+         *
+         * \return false if the loaded module reports different traits, in which case the
+         *         component store has been listing the wrong ones.
+         */
+        bool verifyTraits(const std::shared_ptr<const C2Component::Traits> &loaded) const {
+            if (!loaded) {
+                return true;
+            }
+            if (loaded->name != mTraits->name
+                    || loaded->domain != mTraits->domain
+                    || loaded->kind != mTraits->kind
+                    || loaded->mediaType != mTraits->mediaType
+                    || loaded->aliases != mTraits->aliases) {
+                ALOGE("%s: listed as %s (%u/%u %s) but contains %s (%u/%u %s)",
+                        mLibPath.c_str(),
+                        mTraits->name.c_str(), (uint32_t)mTraits->domain, (uint32_t)mTraits->kind,
+                        mTraits->mediaType.c_str(),
+                        loaded->name.c_str(), (uint32_t)loaded->domain, (uint32_t)loaded->kind,
+                        loaded->mediaType.c_str());
+                return false;
+            }
+            return true;
+        }
+
         std::mutex mMutex; ///< mutex guarding the module
         std::weak_ptr<ComponentModule> mModule; ///< weak reference to the loaded module
         std::string mLibPath; ///< library path
+        std::shared_ptr<const C2Component::Traits> mTraits; ///< known traits, if any
 
         // For testing only
         C2ComponentFactory::CreateCodec2FactoryFunc mCreateFactory = nullptr;
@@ -940,11 +1004,24 @@ private:
     c2_status_t findComponent(C2String name, std::shared_ptr<ComponentModule> *module);
 
     /**
-     * Loads each component module and discover its contents.
+     * Discovers the contents of each component module, loading the modules whose traits are
+     * not known.
      */
     void visitComponents();
 
-    std::mutex mMutex; ///< mutex guarding the component lists during construction
+    /**
+     * Loads the libraries of the component modules in the background so that later loading of
+     * a module does not need to link its library.
+     */
+    void prelinkComponents();
+
+    /**
+     * Forgets the component lists, so that they are built again from the traits known by the
+     * component modules.
+     */
+    void invalidateComponents();
+
+    std::mutex mMutex; ///< mutex guarding the component lists
     bool mVisited; ///< component modules visited
     std::map<C2String, ComponentLoader> mComponents; ///< path -> component module
     std::map<C2String, C2String> mComponentNameToPath; ///< name -> path
@@ -1007,13 +1084,7 @@ c2_status_t C2PlatformComponentStore::ComponentModule::init(
         }
 
         // TODO: get this properly from the store during emplace
-        switch (traits->domain) {
-        case C2Component::DOMAIN_AUDIO:
-            traits->rank = 8;
-            break;
-        default:
-            traits->rank = 512;
-        }
+        traits->rank = GetDefaultRank(traits->domain);
     }
     mTraits = traits;
 
@@ -1075,45 +1146,24 @@ C2PlatformComponentStore::C2PlatformComponentStore()
       mReflector(std::make_shared<C2ReflectorHelper>()),
       mInterface(mReflector) {
 
-    auto emplace = [this](const char *libPath) {
-        mComponents.emplace(libPath, libPath);
-    };
-
-    // TODO: move this also into a .so so it can be updated
-    emplace("libcodec2_soft_aacdec.so");
-    emplace("libcodec2_soft_aacenc.so");
-    emplace("libcodec2_soft_amrnbdec.so");
-    emplace("libcodec2_soft_amrnbenc.so");
-    emplace("libcodec2_soft_amrwbdec.so");
-    emplace("libcodec2_soft_amrwbenc.so");
-    //emplace("libcodec2_soft_av1dec_aom.so"); // deprecated for the gav1 implementation
-    emplace("libcodec2_soft_av1dec_gav1.so");
-    emplace("libcodec2_soft_av1dec_dav1d.so");
-    emplace("libcodec2_soft_av1enc.so");
-    emplace("libcodec2_soft_avcdec.so");
-    emplace("libcodec2_soft_avcenc.so");
-    emplace("libcodec2_soft_flacdec.so");
-    emplace("libcodec2_soft_flacenc.so");
-    emplace("libcodec2_soft_g711alawdec.so");
-    emplace("libcodec2_soft_g711mlawdec.so");
-    emplace("libcodec2_soft_gsmdec.so");
-    emplace("libcodec2_soft_h263dec.so");
-    emplace("libcodec2_soft_h263enc.so");
-    emplace("libcodec2_soft_hevcdec.so");
-    emplace("libcodec2_soft_hevcenc.so");
-    emplace("libcodec2_soft_mp3dec.so");
-    emplace("libcodec2_soft_mpeg2dec.so");
-    emplace("libcodec2_soft_mpeg4dec.so");
-    emplace("libcodec2_soft_mpeg4enc.so");
-    emplace("libcodec2_soft_opusdec.so");
-    emplace("libcodec2_soft_opusenc.so");
-    emplace("libcodec2_soft_rawdec.so");
-    emplace("libcodec2_soft_vorbisdec.so");
-    emplace("libcodec2_soft_vp8dec.so");
-    emplace("libcodec2_soft_vp8enc.so");
-    emplace("libcodec2_soft_vp9dec.so");
-    emplace("libcodec2_soft_vp9enc.so");
+    // List the platform components without loading their libraries. If a library reports
+    // other traits than kC2PlatformComponents, the store lists the reported traits once the
+    // library has been loaded.
+    for (const C2PlatformComponent &component : kC2PlatformComponents) {
+        std::shared_ptr<C2Component::Traits> traits = std::make_shared<C2Component::Traits>();
+        traits->name = component.name;
+        traits->domain = component.domain;
+        traits->kind = component.kind;
+        traits->rank = GetDefaultRank(component.domain);
+        traits->mediaType = component.mediaType;
+        mComponents.emplace(std::piecewise_construct,
+                            std::forward_as_tuple(component.libPath),
+                            std::forward_as_tuple(component.libPath, traits));
+    }
 
+    if (property_get_bool("debug.c2.store.prelink", false)) {
+        prelinkComponents();
+    }
 }
 
 // For testing only
@@ -1159,24 +1209,59 @@ void C2PlatformComponentStore::visitComponents() {
     for (auto &pathAndLoader : mComponents) {
         const C2String &path = pathAndLoader.first;
         ComponentLoader &loader = pathAndLoader.second;
-        std::shared_ptr<ComponentModule> module;
-        if (loader.fetchModule(&module) == C2_OK) {
-            std::shared_ptr<const C2Component::Traits> traits = module->getTraits();
-            if (traits) {
-                mComponentList.push_back(traits);
-                mComponentNameToPath.emplace(traits->name, path);
-                for (const C2String &alias : traits->aliases) {
-                    mComponentNameToPath.emplace(alias, path);
-                }
+        std::shared_ptr<const C2Component::Traits> traits = loader.getKnownTraits();
+        if (!traits) {
+            // the module needs to be loaded to know what it contains
+            std::shared_ptr<ComponentModule> module;
+            if (loader.fetchModule(&module) == C2_OK) {
+                traits = module->getTraits();
+            }
+        }
+        if (traits) {
+            mComponentList.push_back(traits);
+            mComponentNameToPath.emplace(traits->name, path);
+            for (const C2String &alias : traits->aliases) {
+                mComponentNameToPath.emplace(alias, path);
             }
         }
     }
     mVisited = true;
 }
 
+void C2PlatformComponentStore::prelinkComponents() {
+    std::vector<C2String> libPaths;
+    for (const auto &pathAndLoader : mComponents) {
+        libPaths.push_back(pathAndLoader.first);
+    }
+    // Libraries are loaded with RTLD_NODELETE, so they stay linked after this. Loading only
+    // needs the library paths, so the threads do not hold on to the store.
+    const size_t numThreads = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    for (size_t i = 0; i < numThreads; ++i) {
+        std::vector<C2String> paths;
+        for (size_t j = i; j < libPaths.size(); j += numThreads) {
+            paths.push_back(libPaths[j]);
+        }
+        std::thread([paths = std::move(paths)] {
+            for (const C2String &path : paths) {
+                if (dlopen(path.c_str(), RTLD_NOW | RTLD_NODELETE) == nullptr) {
+                    ALOGD("could not prelink %s: %s", path.c_str(), dlerror());
+                }
+            }
+        }).detach();
+    }
+}
+
+void C2PlatformComponentStore::invalidateComponents() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mComponentList.clear();
+    mComponentNameToPath.clear();
+    mVisited = false;
+}
+
 std::vector<std::shared_ptr<const C2Component::Traits>> C2PlatformComponentStore::listComponents() {
     // This method SHALL return within 500ms.
     visitComponents();
+    std::lock_guard<std::mutex> lock(mMutex);
     return mComponentList;
 }
 
@@ -1185,11 +1270,29 @@ c2_status_t C2PlatformComponentStore::findComponent(
     (*module).reset();
     visitComponents();
 
-    auto pos = mComponentNameToPath.find(name);
-    if (pos != mComponentNameToPath.end()) {
-        return mComponents.at(pos->second).fetchModule(module);
+    ComponentLoader *loader = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto pos = mComponentNameToPath.find(name);
+        if (pos == mComponentNameToPath.end()) {
+            return C2_NOT_FOUND;
+        }
+        loader = &mComponents.at(pos->second);
     }
-    return C2_NOT_FOUND;
+    bool traitsChanged = false;
+    c2_status_t res = loader->fetchModule(module, &traitsChanged);
+    if (traitsChanged) {
+        // the module was listed with the wrong traits; list the ones it reported instead
+        invalidateComponents();
+        std::shared_ptr<const C2Component::Traits> traits = loader->getKnownTraits();
+        if (res == C2_OK && traits->name != name
+                && std::find(traits->aliases.begin(), traits->aliases.end(), name)
+                        == traits->aliases.end()) {
+            (*module).reset();
+            return C2_NOT_FOUND;
+        }
+    }
+    return res;
 }
 
 c2_status_t C2PlatformComponentStore::createComponent(
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_STAGEFRIGHT_C2_PLATFORM_COMPONENTS_H_
+#define ANDROID_STAGEFRIGHT_C2_PLATFORM_COMPONENTS_H_
+
+#include <C2Component.h>
+#include <media/stagefright/foundation/MediaDefs.h>
+
+namespace android {
+
+/**
+ * A software component of the platform store, and the traits its library reports, so that
+ * the store can list it without loading the library. None of the platform components have
+ * aliases.
+ *
+ * codec2_vndk_test loads every library listed in kC2PlatformComponents and checks that it
+ * reports these traits.
+ */
+struct C2PlatformComponent {
+    const char *libPath;
+    const char *name;
+    C2Component::kind_t kind;
+    C2Component::domain_t domain;
+    const char *mediaType;
+};
+
+// TODO: move this also into a .so so it can be updated
+static const C2PlatformComponent kC2PlatformComponents[] = {
+#define DEC C2Component::KIND_DECODER
+#define ENC C2Component::KIND_ENCODER
+#define AUDIO C2Component::DOMAIN_AUDIO
+#define VIDEO C2Component::DOMAIN_VIDEO
+    { "libcodec2_soft_aacdec.so", "c2.android.aac.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_AAC },
+    { "libcodec2_soft_aacenc.so", "c2.android.aac.encoder", ENC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_AAC },
+    { "libcodec2_soft_amrnbdec.so", "c2.android.amrnb.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_AMR_NB },
+    { "libcodec2_soft_amrnbenc.so", "c2.android.amrnb.encoder", ENC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_AMR_NB },
+    { "libcodec2_soft_amrwbdec.so", "c2.android.amrwb.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_AMR_WB },
+    { "libcodec2_soft_amrwbenc.so", "c2.android.amrwb.encoder", ENC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_AMR_WB },
+    // deprecated for the gav1 implementation
+    //{ "libcodec2_soft_av1dec_aom.so", "c2.android.av1-aom.decoder", DEC, VIDEO,
+    //        MEDIA_MIMETYPE_VIDEO_AV1 },
+    { "libcodec2_soft_av1dec_gav1.so", "c2.android.av1.decoder", DEC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_AV1 },
+    { "libcodec2_soft_av1dec_dav1d.so", "c2.android.av1-dav1d.decoder", DEC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_AV1 },
+    { "libcodec2_soft_av1enc.so", "c2.android.av1.encoder", ENC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_AV1 },
+    { "libcodec2_soft_avcdec.so", "c2.android.avc.decoder", DEC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_AVC },
+    { "libcodec2_soft_avcenc.so", "c2.android.avc.encoder", ENC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_AVC },
+    { "libcodec2_soft_flacdec.so", "c2.android.flac.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_FLAC },
+    { "libcodec2_soft_flacenc.so", "c2.android.flac.encoder", ENC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_FLAC },
+    { "libcodec2_soft_g711alawdec.so", "c2.android.g711.alaw.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_G711_ALAW },
+    { "libcodec2_soft_g711mlawdec.so", "c2.android.g711.mlaw.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_G711_MLAW },
+    { "libcodec2_soft_gsmdec.so", "c2.android.gsm.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_MSGSM },
+    { "libcodec2_soft_h263dec.so", "c2.android.h263.decoder", DEC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_H263 },
+    { "libcodec2_soft_h263enc.so", "c2.android.h263.encoder", ENC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_H263 },
+    { "libcodec2_soft_hevcdec.so", "c2.android.hevc.decoder", DEC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_HEVC },
+    { "libcodec2_soft_hevcenc.so", "c2.android.hevc.encoder", ENC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_HEVC },
+    { "libcodec2_soft_mp3dec.so", "c2.android.mp3.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_MPEG },
+    { "libcodec2_soft_mpeg2dec.so", "c2.android.mpeg2.decoder", DEC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_MPEG2 },
+    { "libcodec2_soft_mpeg4dec.so", "c2.android.mpeg4.decoder", DEC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_MPEG4 },
+    { "libcodec2_soft_mpeg4enc.so", "c2.android.mpeg4.encoder", ENC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_MPEG4 },
+    { "libcodec2_soft_opusdec.so", "c2.android.opus.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_OPUS },
+    { "libcodec2_soft_opusenc.so", "c2.android.opus.encoder", ENC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_OPUS },
+    { "libcodec2_soft_rawdec.so", "c2.android.raw.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_RAW },
+    { "libcodec2_soft_vorbisdec.so", "c2.android.vorbis.decoder", DEC, AUDIO,
+            MEDIA_MIMETYPE_AUDIO_VORBIS },
+    { "libcodec2_soft_vp8dec.so", "c2.android.vp8.decoder", DEC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_VP8 },
+    { "libcodec2_soft_vp8enc.so", "c2.android.vp8.encoder", ENC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_VP8 },
+    { "libcodec2_soft_vp9dec.so", "c2.android.vp9.decoder", DEC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_VP9 },
+    { "libcodec2_soft_vp9enc.so", "c2.android.vp9.encoder", ENC, VIDEO,
+            MEDIA_MIMETYPE_VIDEO_VP9 },
+#undef DEC
+#undef ENC
+#undef AUDIO
+#undef VIDEO
+};
+
+}  // namespace android
+
+#endif  // ANDROID_STAGEFRIGHT_C2_PLATFORM_COMPONENTS_H_
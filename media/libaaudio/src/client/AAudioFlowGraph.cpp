@@ -20,6 +20,9 @@
 
 #include "AAudioFlowGraph.h"
 
+#include <math.h>
+#include <string.h>
+
 #include <flowgraph/Limiter.h>
 #include <flowgraph/ManyToMultiConverter.h>
 #include <flowgraph/MonoBlend.h>
@@ -134,10 +137,51 @@ aaudio_result_t AAudioFlowGraph::configure(audio_format_t sourceFormat,
     }
     lastOutput->connect(&mSink->input);
 
+    // The limiter does not change samples within the unit range, which is checked
+    // before each direct copy.
+    mPassThroughPossible = sourceFormat == sinkFormat
+            && sourceChannelCount == sinkChannelCount
+            && mMonoBlend == nullptr;
+    mSamplesPerFrame = sinkChannelCount;
+    mBytesPerFrame = audio_bytes_per_frame(sinkChannelCount, sinkFormat);
+
     return AAUDIO_OK;
 }
 
+bool AAudioFlowGraph::isPassThrough() const {
+    if (!mPassThroughPossible) {
+        return false;
+    }
+    for (const auto& ramp : mVolumeRamps) {
+        if (!ramp->isUnity()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool isWithinUnitRange(const float *data, int32_t numSamples) {
+    for (int32_t i = 0; i < numSamples; i++) {
+        if (!(fabsf(data[i]) <= 1.0f)) { // also false for NaN
+            return false;
+        }
+    }
+    return true;
+}
+
 void AAudioFlowGraph::process(const void *source, void *destination, int32_t numFrames) {
+    // The graph runs at least once before any direct copy. Until then the volume
+    // ramps jump to a new target instead of ramping to it.
+    const int32_t numSamples = numFrames * mSamplesPerFrame;
+    if (numSamples > 0 && mSink->getLastCallCount() >= 0 && isPassThrough()
+            && (mLimiter == nullptr
+                || isWithinUnitRange(static_cast<const float *>(source), numSamples))) {
+        memcpy(destination, source, (size_t) numFrames * mBytesPerFrame);
+        if (mLimiter != nullptr) {
+            mLimiter->setLastValidOutput(static_cast<const float *>(source)[numSamples - 1]);
+        }
+        return;
+    }
     mSource->setData(source, numFrames);
     mSink->read(destination, numFrames);
 }
@@ -54,8 +54,18 @@ public:
                               float audioBalance,
                               bool isExclusive);
 
+    /**
+     * Convert the frames from source to destination. When no conversion is needed
+     * and the volume ramps are at unity, the frames are copied directly.
+     */
     void process(const void *source, void *destination, int32_t numFrames);
 
+    /**
+     * @return true if process() can copy the frames without conversion, as long as
+     *         float data stays within the range of the limiter
+     */
+    bool isPassThrough() const;
+
     /**
      * @param volume between 0.0 and 1.0
      */
@@ -85,6 +95,12 @@ private:
     float mTargetVolume = 1.0f;
     android::audio_utils::Balance mBalance;
     std::unique_ptr<FLOWGRAPH_OUTER_NAMESPACE::flowgraph::FlowGraphSink> mSink;
+
+    // Set when the source and sink formats match and only the volume ramps or
+    // the limiter could modify the data.
+    bool mPassThroughPossible = false;
+    int32_t mSamplesPerFrame = 0;
+    int32_t mBytesPerFrame = 0;
 };
 
 
@@ -22,6 +22,8 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+
 #include <binder/IServiceManager.h>
 
 #include <aaudio/AAudio.h>
@@ -823,7 +825,10 @@ aaudio_result_t AudioStreamInternal::processData(void *buffer, int32_t numFrames
             if (!mAudioEndpoint->isFreeRunning()) {
                 // If there is software on the other end of the FIFO then it may get delayed.
                 // So wake up just a little after we expect it to be ready.
-                wakeTimeNanos += mWakeupDelayNanos;
+                // Once the clock model has measured the timing jitter, use that
+                // instead, between a quarter of the configured delay and all of it.
+                wakeTimeNanos += std::clamp<int64_t>(mClockModel.getWakeupMarginNanos(),
+                                                    mWakeupDelayNanos / 4, mWakeupDelayNanos);
             }
 
             currentTimeNanos = AudioClock::getNanoseconds();
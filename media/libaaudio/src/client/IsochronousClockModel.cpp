@@ -22,6 +22,7 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <algorithm>
+#include <cmath>
 
 #include "utility/AudioClock.h"
 #include "utility/AAudioUtilities.h"
@@ -35,6 +36,12 @@ using namespace android::audio_utils;
 #define ICM_LOG_DRIFT   0
 #endif // ICM_LOG_DRIFT
 
+// Set to 1 to log the timestamps in CSV format, which can be imported into
+// spreadsheets or replayed with test_clock_model_replay.
+#ifndef ICM_LOG_CSV
+#define ICM_LOG_CSV     0
+#endif // ICM_LOG_CSV
+
 // To enable the timestamp histogram, enter this before opening the stream:
 //    adb root
 //    adb shell setprop aaudio.log_mask 1
@@ -63,6 +70,7 @@ void IsochronousClockModel::start(int64_t nanoTime) {
     mState = STATE_STARTING;
     mConsecutiveVeryLateCount = 0;
     mDspStallCount = 0;
+    mFilterCount = 0;
     if (mHistogramMicros) {
         mHistogramMicros->clear();
     }
@@ -92,9 +100,10 @@ bool IsochronousClockModel::isRunning() const {
 
 void IsochronousClockModel::processTimestamp(int64_t framePosition, int64_t nanoTime) {
     mTimestampCount++;
-// Log position and time in CSV format so we can import it easily into spreadsheets.
-    //ALOGD("%s() CSV, %d, %lld, %lld", __func__,
-          //mTimestampCount, (long long)framePosition, (long long)nanoTime);
+#if ICM_LOG_CSV
+    ALOGD("%s() CSV, %d, %lld, %lld", __func__,
+          mTimestampCount, (long long)framePosition, (long long)nanoTime);
+#endif
     int64_t framesDelta = framePosition - mMarkerFramePosition;
     int64_t nanosDelta = nanoTime - mMarkerNanoTime;
     if (nanosDelta < 1000) {
@@ -129,6 +138,7 @@ void IsochronousClockModel::processTimestamp(int64_t framePosition, int64_t nano
         } else {
 //            ALOGD("processTimestamp() - advance to STATE_RUNNING");
             mState = STATE_RUNNING;
+            resetFilter(framePosition, nanoTime);
         }
         break;
     case STATE_RUNNING:
@@ -162,6 +172,7 @@ void IsochronousClockModel::processTimestamp(int64_t framePosition, int64_t nano
                 // Assume the timestamp is valid and let subsequent EARLY timestamps
                 // move the window quickly to the correct place.
                 setPositionAndTime(framePosition, nanoTime); // JUMP!
+                resetFilter(framePosition, nanoTime);
                 mDspStallCount++;
                 // Throttle the warnings but do not silence them.
                 // They indicate a bug that needs to be fixed!
@@ -198,6 +209,7 @@ void IsochronousClockModel::processTimestamp(int64_t framePosition, int64_t nano
             mMaxMeasuredLatenessNanos = (int32_t) latenessNanos;
         }
 
+        updateFilter(framePosition, nanoTime);
         break;
     default:
         break;
@@ -231,6 +243,88 @@ void IsochronousClockModel::driftForward(int64_t latenessNanos,
 #endif
 }
 
+double IsochronousClockModel::getResidualNanos(int64_t framePosition, int64_t nanoTime) const {
+    const double expectedNanos = (double) (framePosition - mFilterOriginPosition)
+            * AAUDIO_NANOS_PER_SECOND / mSampleRate;
+    return (double) (nanoTime - mFilterOriginNanos) - expectedNanos;
+}
+
+void IsochronousClockModel::resetFilter(int64_t framePosition, int64_t nanoTime) {
+    // The drift of the hardware clock survives a stall, the phase does not.
+    const double burstNanos = (double) mBurstPeriodNanos;
+    mFilterOriginPosition = framePosition;
+    mFilterOriginNanos = nanoTime;
+    mFilterLastNanos = nanoTime;
+    mFilterCount = 0;
+    mFilterPhase = 0.0;
+    mFilterCovariance[0][0] = burstNanos * burstNanos;
+    mFilterCovariance[0][1] = 0.0;
+    mFilterCovariance[1][0] = 0.0;
+    mFilterCovariance[1][1] = kFilterInitialDriftVariance;
+    // Timestamps are sampled at a random point within a burst.
+    mInnovationVariance = burstNanos * burstNanos / 12.0;
+}
+
+// Track the phase and drift of the timestamps with a Kalman filter. The
+// measurement noise is taken from the running variance of the innovations,
+// so the confidence bounds widen when the timestamps get jittery and tighten
+// again when they settle down.
+void IsochronousClockModel::updateFilter(int64_t framePosition, int64_t nanoTime) {
+    const double dt = (double) (nanoTime - mFilterLastNanos) / AAUDIO_NANOS_PER_SECOND;
+    if (dt <= 0.0) {
+        return;
+    }
+    mFilterLastNanos = nanoTime;
+    double (&p)[2][2] = mFilterCovariance;
+
+    // Predict.
+    mFilterPhase += mFilterDrift * dt;
+    p[0][0] += dt * (p[0][1] + p[1][0]) + dt * dt * p[1][1] + kFilterPhaseNoise * dt;
+    p[0][1] += dt * p[1][1];
+    p[1][0] = p[0][1];
+    p[1][1] += kFilterDriftNoise * dt;
+
+    // Correct with the measured phase.
+    const double innovation = getResidualNanos(framePosition, nanoTime) - mFilterPhase;
+    mInnovationVariance += kFilterInnovationWeight
+            * (innovation * innovation - mInnovationVariance);
+    // The innovations include the uncertainty of the prediction, so this overestimates
+    // the measurement noise a little, which keeps the filter from chasing early outliers.
+    const double s = p[0][0] + std::max(mInnovationVariance, 1.0);
+    const double k0 = p[0][0] / s;
+    const double k1 = p[1][0] / s;
+    mFilterPhase += k0 * innovation;
+    mFilterDrift += k1 * innovation;
+    p[1][1] -= k1 * p[0][1];
+    p[0][0] *= 1.0 - k0;
+    p[0][1] *= 1.0 - k0;
+    p[1][0] = p[0][1];
+
+    mFilterCount++;
+    if (isFilterConverged()) {
+        // The late edge of the window is the upper confidence bound of the timestamps,
+        // measured from the marker. It never goes past the latest timestamp seen.
+        const double markerPhase = getResidualNanos(mMarkerFramePosition, mMarkerNanoTime);
+        const double lateEdge = mFilterPhase - markerPhase
+                + kFilterSigmaForMargin * std::sqrt(mInnovationVariance);
+        mFilteredLateOffsetNanos = std::clamp((int64_t) lateEdge,
+                (int64_t) 0, mMaxMeasuredLatenessNanos);
+    }
+}
+
+int64_t IsochronousClockModel::getWakeupMarginNanos() const {
+    if (!isRunning() || !isFilterConverged()) {
+        return INT64_MAX;
+    }
+    // Sampling at a random point within a burst spreads the timestamps over
+    // one burst period. That spread is not jitter.
+    const double burstNanos = (double) mBurstPeriodNanos;
+    const double jitterVariance =
+            std::max(mInnovationVariance - burstNanos * burstNanos / 12.0, 0.0);
+    return std::max((int64_t) (kFilterSigmaForMargin * std::sqrt(jitterVariance)),
+            (int64_t) kMinWakeupMarginNanos);
+}
+
 void IsochronousClockModel::setSampleRate(int32_t sampleRate) {
     mSampleRate = sampleRate;
     update();
@@ -294,6 +388,9 @@ int64_t IsochronousClockModel::convertTimeToPosition(int64_t nanoTime) const {
 }
 
 int32_t IsochronousClockModel::getLateTimeOffsetNanos() const {
+    if (isFilterConverged()) {
+        return mFilteredLateOffsetNanos + kExtraLatenessNanos;
+    }
     return mMaxMeasuredLatenessNanos + kExtraLatenessNanos;
 }
 
@@ -311,6 +408,10 @@ void IsochronousClockModel::dump() const {
     ALOGD("mSampleRate          = %6d", mSampleRate);
     ALOGD("mFramesPerBurst      = %6d", mFramesPerBurst);
     ALOGD("mMaxMeasuredLatenessNanos = %6" PRId64, mMaxMeasuredLatenessNanos);
+    ALOGD("mFilteredLateOffsetNanos  = %6" PRId64, mFilteredLateOffsetNanos);
+    ALOGD("mFilterDrift         = %6.1f nanos/sec", mFilterDrift);
+    ALOGD("jitter sigma         = %6.1f micros",
+          std::sqrt(mInnovationVariance) / AAUDIO_NANOS_PER_MICROSECOND);
     ALOGD("mState               = %6d", mState);
 }
 
@@ -123,6 +123,22 @@ public:
      */
     int64_t convertDeltaTimeToPosition(int64_t nanosDelta) const;
 
+    /**
+     * Margin to add to a wake up time to cover the timestamp jitter, based on the
+     * spread of the timestamps around the filtered clock, and never below a small floor.
+     *
+     * @return margin in nanoseconds, or INT64_MAX until the filter has converged
+     */
+    int64_t getWakeupMarginNanos() const;
+
+    /**
+     * @return estimated drift of the hardware clock relative to the nominal rate,
+     *         in nanoseconds per second
+     */
+    double getDriftNanosPerSecond() const {
+        return mFilterDrift;
+    }
+
     void dump() const;
 
     void dumpHistogram() const;
@@ -135,6 +151,14 @@ private:
     int32_t getLateTimeOffsetNanos() const;
     void update();
 
+    // Offset of a timestamp from the nominal clock started at the filter origin.
+    double getResidualNanos(int64_t framePosition, int64_t nanoTime) const;
+    void resetFilter(int64_t framePosition, int64_t nanoTime);
+    void updateFilter(int64_t framePosition, int64_t nanoTime);
+    bool isFilterConverged() const {
+        return mFilterCount >= kFilterWarmupCount;
+    }
+
     enum clock_model_state_t {
         STATE_STOPPED,
         STATE_STARTING,
@@ -158,6 +182,21 @@ private:
     static constexpr int32_t   kShifterForDrift = 6; // divide by 2^N
     static constexpr int32_t   kVeryLateCountsNeededToTriggerJump = 2;
 
+    // Timestamps needed before the filter is trusted for margins.
+    static constexpr int32_t   kFilterWarmupCount = 64;
+    // Width of the confidence bound, in standard deviations.
+    static constexpr double    kFilterSigmaForMargin = 4.0;
+    // Process noise of the phase and the drift, per second of elapsed time.
+    static constexpr double    kFilterPhaseNoise = 1000.0 * 1000.0;  // (1 usec)^2
+    static constexpr double    kFilterDriftNoise = 10.0 * 10.0;      // (10 nanos/sec)^2
+    // Initial drift uncertainty, a 50 ppm clock error.
+    static constexpr double    kFilterInitialDriftVariance = 50000.0 * 50000.0;
+    // Weight of a new innovation in the running innovation variance.
+    static constexpr double    kFilterInnovationWeight = 1.0 / 128;
+    // Smallest wake up margin. The timestamps do not show the scheduling jitter
+    // of the wake up itself, so steady timestamps still need some margin.
+    static constexpr int32_t   kMinWakeupMarginNanos = 50 * AAUDIO_NANOS_PER_MICROSECOND;
+
     static constexpr int32_t   kHistogramBinWidthMicros = 50;
     static constexpr int32_t   kHistogramBinCount       = 128;
 
@@ -178,6 +217,18 @@ private:
 
     clock_model_state_t mState{STATE_STOPPED};   // State machine handles startup sequence.
 
+    // Kalman filter of the timestamps with the phase (nanos) and drift (nanos per
+    // second) of the hardware clock, relative to the nominal rate from the origin.
+    int64_t             mFilterOriginPosition{0};
+    int64_t             mFilterOriginNanos{0};
+    int64_t             mFilterLastNanos{0};
+    int32_t             mFilterCount{0};
+    double              mFilterPhase{0.0};
+    double              mFilterDrift{0.0};
+    double              mFilterCovariance[2][2]{};
+    double              mInnovationVariance{0.0};
+    int64_t             mFilteredLateOffsetNanos{0};  // Late edge of the window.
+
     int32_t             mTimestampCount = 0;  // For logging.
     int32_t             mDspStallCount = 0;  // For logging.
 
@@ -35,6 +35,16 @@ public:
         return "Limiter";
     }
 
+    /**
+     * Keep the limiter in step with samples that were passed on without it,
+     * which it would not have changed.
+     *
+     * @param output last sample passed on
+     */
+    void setLastValidOutput(float output) {
+        mLastValidOutput = output;
+    }
+
 private:
     // These numbers are based on a polynomial spline for a quadratic solution Ax^2 + Bx + C
     // The range is up to 3 dB, (10^(3/20)), to match AudioTrack for float data.
@@ -61,6 +61,13 @@ public:
         return mTarget.load();
     }
 
+    /**
+     * @return true if the output will be the same as the input until the target changes
+     */
+    bool isUnity() const {
+        return mRemaining == 0 && mLevelTo == 1.0f && getTarget() == 1.0f;
+    }
+
     /**
      * Force the nextSegment to start from this level.
      *
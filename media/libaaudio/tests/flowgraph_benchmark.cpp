@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the CPU time to write one burst through the AAudio client flowgraph
+// when the app format matches the device format. With a unity volume the frames
+// are copied directly, otherwise they go through the conversion and volume ramps.
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <client/AAudioFlowGraph.h>
+
+namespace {
+
+constexpr int32_t kFramesPerBurst = 96;
+constexpr int32_t kChannelCount = 2;
+
+}  // namespace
+
+static void BM_WriteBurst(benchmark::State& state) {
+    const audio_format_t format = state.range(0) ? AUDIO_FORMAT_PCM_FLOAT
+                                                 : AUDIO_FORMAT_PCM_16_BIT;
+    const bool direct = state.range(1);
+    const size_t numBytes = kFramesPerBurst * audio_bytes_per_frame(kChannelCount, format);
+    std::vector<uint8_t> source(numBytes);
+    std::vector<uint8_t> destination(numBytes);
+    if (format == AUDIO_FORMAT_PCM_FLOAT) {
+        float *samples = reinterpret_cast<float *>(source.data());
+        for (int32_t i = 0; i < kFramesPerBurst * kChannelCount; i++) {
+            samples[i] = (i % 64) / 64.0f - 0.5f;
+        }
+    }
+
+    AAudioFlowGraph flowGraph;
+    if (flowGraph.configure(format, kChannelCount, format, kChannelCount,
+                            false /* useMonoBlend */, 0.0f /* audioBalance */,
+                            true /* isExclusive */) != AAUDIO_OK) {
+        state.SkipWithError("failed to configure the flowgraph");
+        return;
+    }
+    // Any volume below unity needs the volume ramps.
+    flowGraph.setTargetVolume(direct ? 1.0f : 0.99f);
+    flowGraph.process(source.data(), destination.data(), kFramesPerBurst);
+    if (flowGraph.isPassThrough() != direct) {
+        state.SkipWithError("unexpected flowgraph mode");
+        return;
+    }
+
+    for (auto _ : state) {
+        flowGraph.process(source.data(), destination.data(), kFramesPerBurst);
+        benchmark::DoNotOptimize(destination.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFramesPerBurst);
+}
+
+BENCHMARK(BM_WriteBurst)
+        ->ArgNames({"float", "direct"})
+        ->Args({0, 0})
+        ->Args({0, 1})
+        ->Args({1, 0})
+        ->Args({1, 1});
+
+BENCHMARK_MAIN();
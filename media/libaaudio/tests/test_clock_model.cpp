@@ -208,3 +208,78 @@ TEST_F(ClockModelTestFixture, clock_fast_drift) {
 TEST_F(ClockModelTestFixture, clock_jump_forward_500) {
     checkDriftingClock(SAMPLE_RATE, NUM_LOOPS_DRIFT, 0.500);
 }
+
+class ClockModelFilterTestFixture: public ClockModelTestFixture {
+public:
+    /** Feed timestamps that are sampled at a random point within a burst,
+     * plus a random amount of extra jitter.
+     * @param hardwareFramesPerSecond  sample rate that may be slightly off
+     * @param jitterNanos  maximum extra delay of each timestamp
+     * @param numLoops number of timestamps
+     */
+    void feedJitteryClock(double hardwareFramesPerSecond,
+                          int64_t jitterNanos,
+                          int numLoops) {
+        const int64_t startTimeNanos = 500000000; // arbitrary
+
+        srand48(654321); // arbitrary seed for repeatable test results
+        model.start(startTimeNanos);
+
+        double elapsedTimeSeconds = 0.0;
+        for (int i = 0; i < numLoops; i++) {
+            elapsedTimeSeconds += 4.0 * drand48() * NANOS_PER_BURST / NANOS_PER_SECOND;
+            const int64_t currentTimeNanos = startTimeNanos
+                    + (int64_t)(elapsedTimeSeconds * NANOS_PER_SECOND);
+            const int64_t numBursts = (int64_t)(hardwareFramesPerSecond * elapsedTimeSeconds)
+                    / HW_FRAMES_PER_BURST;
+            const int64_t hardwarePosition = HW_FRAMES_PER_BURST * (numBursts + 1);
+            const int64_t sampledTimeNanos = currentTimeNanos
+                    + (int64_t)(drand48() * jitterNanos);
+            model.processTimestamp(hardwarePosition, sampledTimeNanos);
+        }
+    }
+};
+
+#define NUM_LOOPS_FILTER   20000
+
+// There is no margin until the model has seen enough timestamps.
+TEST_F(ClockModelFilterTestFixture, clock_margin_unknown) {
+    model.start(100000000);
+    EXPECT_EQ(INT64_MAX, model.getWakeupMarginNanos());
+    feedJitteryClock(SAMPLE_RATE, 0, 16);
+    EXPECT_EQ(INT64_MAX, model.getWakeupMarginNanos());
+}
+
+// Steady timestamps need much less margin than the jittery ones.
+TEST_F(ClockModelFilterTestFixture, clock_margin_follows_jitter) {
+    feedJitteryClock(SAMPLE_RATE, 0, NUM_LOOPS_FILTER);
+    const int64_t steadyMargin = model.getWakeupMarginNanos();
+    EXPECT_GT(steadyMargin, 0);
+    EXPECT_LT(steadyMargin, (int64_t) NANOS_PER_BURST);
+
+    feedJitteryClock(SAMPLE_RATE, 2 * NANOS_PER_BURST, NUM_LOOPS_FILTER);
+    const int64_t jitteryMargin = model.getWakeupMarginNanos();
+    EXPECT_GT(jitteryMargin, (int64_t) NANOS_PER_BURST);
+    EXPECT_LT(jitteryMargin, (int64_t) (4 * NANOS_PER_BURST));
+    EXPECT_GT(jitteryMargin, steadyMargin);
+}
+
+// The drift estimate should match the error of the hardware clock.
+// A slow clock makes the timestamps later than expected.
+TEST_F(ClockModelFilterTestFixture, clock_filter_slow_drift) {
+    feedJitteryClock(0.99998 * SAMPLE_RATE, 0, NUM_LOOPS_FILTER);
+    EXPECT_NEAR(20000.0, model.getDriftNanosPerSecond(), 2000.0);
+}
+
+TEST_F(ClockModelFilterTestFixture, clock_filter_fast_drift) {
+    feedJitteryClock(1.00002 * SAMPLE_RATE, 0, NUM_LOOPS_FILTER);
+    EXPECT_NEAR(-20000.0, model.getDriftNanosPerSecond(), 2000.0);
+}
+
+// The late edge of the window never moves past the latest timestamp seen.
+TEST_F(ClockModelFilterTestFixture, clock_filter_late_edge) {
+    feedJitteryClock(SAMPLE_RATE, NANOS_PER_BURST, NUM_LOOPS_FILTER);
+    const int64_t nowNanos = 500000000 + 10 * NANOS_PER_SECOND;
+    const int64_t position = model.convertTimeToPosition(nowNanos);
+    EXPECT_LE(model.convertLatestTimeToPosition(nowNanos), position);
+}
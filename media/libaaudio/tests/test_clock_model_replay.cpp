@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replay a timestamp trace through the IsochronousClockModel and count the glitches
+// that a stream with a given buffer size would see.
+//
+// The trace has one "position,nanos" pair per line. Lines in the format of the
+// ICM_LOG_CSV log, "... CSV, index, position, nanos", are also accepted, so a trace
+// can be cut straight from logcat. Without a file, a synthetic trace is generated.
+//
+// Usage: test_clock_model_replay [-r rate] [-b burst] [-j jitterMicros] [-d driftPPM]
+//                                [-n count] [trace.csv]
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <client/IsochronousClockModel.h>
+
+using namespace aaudio;
+
+struct Timestamp {
+    int64_t position;
+    int64_t nanos;
+};
+
+static constexpr int32_t kBufferSizesInBursts[] = {1, 2, 3, 4, 6, 8};
+
+static bool readTrace(const char *fileName, std::vector<Timestamp> *trace) {
+    FILE *file = fopen(fileName, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "ERROR - cannot open %s\n", fileName);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        long long index, position, nanos;
+        const char *csv = strstr(line, "CSV,");
+        if (csv != nullptr) {
+            if (sscanf(csv, "CSV, %lld, %lld, %lld", &index, &position, &nanos) == 3) {
+                trace->push_back({position, nanos});
+            }
+        } else if (sscanf(line, "%lld , %lld", &position, &nanos) == 2) {
+            trace->push_back({position, nanos});
+        }
+    }
+    fclose(file);
+    return !trace->empty();
+}
+
+// Timestamps from a DSP that advances one burst at a time and is polled at
+// random intervals, with an extra random delay on each timestamp.
+static void makeTrace(int32_t sampleRate, int32_t framesPerBurst, int64_t jitterNanos,
+                      double driftPPM, int32_t count, std::vector<Timestamp> *trace) {
+    const double hardwareRate = sampleRate * (1.0 + driftPPM * 1e-6);
+    const double burstSeconds = (double) framesPerBurst / sampleRate;
+    const int64_t startNanos = 1000000000;
+    double elapsedSeconds = 0.0;
+    srand48(98765);
+    for (int32_t i = 0; i < count; i++) {
+        elapsedSeconds += 4.0 * drand48() * burstSeconds;
+        const int64_t numBursts = (int64_t) (hardwareRate * elapsedSeconds) / framesPerBurst;
+        trace->push_back({(numBursts + 1) * framesPerBurst,
+                          startNanos + (int64_t) (elapsedSeconds * 1e9)
+                                  + (int64_t) (drand48() * jitterNanos)});
+    }
+}
+
+static void usage() {
+    printf("test_clock_model_replay [-r rate] [-b burst] [-j jitterMicros] [-d driftPPM]"
+           " [-n count] [trace.csv]\n");
+}
+
+int main(int argc, char **argv) {
+    int32_t sampleRate = 48000;
+    int32_t framesPerBurst = 96;
+    int64_t jitterNanos = 0;
+    double driftPPM = 0.0;
+    int32_t count = 100000;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:b:j:d:n:h")) != -1) {
+        switch (opt) {
+            case 'r': sampleRate = atoi(optarg); break;
+            case 'b': framesPerBurst = atoi(optarg); break;
+            case 'j': jitterNanos = atoll(optarg) * 1000; break;
+            case 'd': driftPPM = atof(optarg); break;
+            case 'n': count = atoi(optarg); break;
+            default: usage(); return EXIT_FAILURE;
+        }
+    }
+    if (sampleRate <= 0 || framesPerBurst <= 0 || count <= 0) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Timestamp> trace;
+    if (optind < argc) {
+        if (!readTrace(argv[optind], &trace)) {
+            return EXIT_FAILURE;
+        }
+    } else {
+        makeTrace(sampleRate, framesPerBurst, jitterNanos, driftPPM, count, &trace);
+    }
+
+    IsochronousClockModel model;
+    model.setSampleRate(sampleRate);
+    model.setFramesPerBurst(framesPerBurst);
+    model.start(trace.front().nanos - 1000000);
+
+    constexpr size_t kNumSizes = sizeof(kBufferSizesInBursts) / sizeof(kBufferSizesInBursts[0]);
+    int32_t underruns[kNumSizes] = {};
+    int32_t earlyReads = 0;
+    int32_t checks = 0;
+    double marginSumNanos = 0.0;
+    double lateOffsetSumNanos = 0.0;
+    int64_t maxMarginNanos = 0;
+    for (const Timestamp &timestamp : trace) {
+        // Check what the model predicted before it learns about this timestamp.
+        if (model.isRunning()) {
+            checks++;
+            // Playback: the DSP has read further than the writer thinks.
+            const int64_t aheadFrames = timestamp.position
+                    - model.convertTimeToPosition(timestamp.nanos);
+            for (size_t i = 0; i < kNumSizes; i++) {
+                if (aheadFrames > (int64_t) kBufferSizesInBursts[i] * framesPerBurst) {
+                    underruns[i]++;
+                }
+            }
+            // Capture: the reader expects data the DSP has not written yet.
+            if (model.convertLatestTimeToPosition(timestamp.nanos) > timestamp.position) {
+                earlyReads++;
+            }
+            const int64_t marginNanos = model.getWakeupMarginNanos();
+            if (marginNanos != INT64_MAX) {
+                marginSumNanos += marginNanos;
+                maxMarginNanos = std::max(maxMarginNanos, marginNanos);
+            }
+            lateOffsetSumNanos += model.convertPositionToLatestTime(timestamp.position)
+                    - model.convertPositionToTime(timestamp.position);
+        }
+        model.processTimestamp(timestamp.position, timestamp.nanos);
+    }
+
+    printf("timestamps     = %zu, checked = %d\n", trace.size(), checks);
+    printf("sample rate    = %d, frames per burst = %d\n", sampleRate, framesPerBurst);
+    printf("drift          = %.1f nanos/sec\n", model.getDriftNanosPerSecond());
+    if (checks > 0) {
+        printf("wakeup margin  = %.1f micros mean, %.1f micros max\n",
+               marginSumNanos / checks / 1000.0, maxMarginNanos / 1000.0);
+        printf("late offset    = %.1f micros mean\n", lateOffsetSumNanos / checks / 1000.0);
+    }
+    for (size_t i = 0; i < kNumSizes; i++) {
+        printf("playback, buffer = %d bursts, underruns = %d\n",
+               kBufferSizesInBursts[i], underruns[i]);
+    }
+    printf("capture, early reads = %d\n", earlyReads);
+    model.dump();
+    return EXIT_SUCCESS;
+}
@@ -22,9 +22,11 @@
  */
 
 #include <iostream>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "client/AAudioFlowGraph.h"
 #include "flowgraph/ClipToRange.h"
 #include "flowgraph/Limiter.h"
 #include "flowgraph/MonoBlend.h"
@@ -394,3 +396,76 @@ TEST(test_flowgraph, module_limiter_nan) {
         EXPECT_NEAR(expected[i], output[i], tolerance);
     }
 }
+
+TEST(test_flowgraph, aaudio_flowgraph_pass_through) {
+    constexpr int kChannelCount = 2;
+    constexpr int kNumFrames = 4;
+    static const int16_t input[kNumFrames * kChannelCount] = {
+        -32768, 32767, 1, -1, 1000, -1000, 0, 12345};
+    int16_t output[kNumFrames * kChannelCount] = {};
+    AAudioFlowGraph flowGraph;
+    ASSERT_EQ(AAUDIO_OK, flowGraph.configure(AUDIO_FORMAT_PCM_16_BIT, kChannelCount,
+                                             AUDIO_FORMAT_PCM_16_BIT, kChannelCount,
+                                             false /* useMonoBlend */, 0.0f /* audioBalance */,
+                                             true /* isExclusive */));
+
+    // At unity volume the frames are copied as they are.
+    flowGraph.setTargetVolume(1.0f);
+    EXPECT_TRUE(flowGraph.isPassThrough());
+    flowGraph.process(input, output, kNumFrames);
+    for (int i = 0; i < kNumFrames * kChannelCount; i++) {
+        EXPECT_EQ(input[i], output[i]);
+    }
+
+    flowGraph.process(input, output, kNumFrames);
+    for (int i = 0; i < kNumFrames * kChannelCount; i++) {
+        EXPECT_EQ(input[i], output[i]);
+    }
+
+    // Any other volume needs the volume ramps, which ramp down from unity
+    // rather than jump to the new volume.
+    constexpr int kRampFrames = 8;
+    constexpr int16_t kLevel = 16384;
+    std::vector<int16_t> steady(2 * kRampFrames * kChannelCount, kLevel);
+    std::vector<int16_t> ramped(steady.size());
+    flowGraph.setRampLengthInFrames(kRampFrames);
+    flowGraph.setTargetVolume(0.5f);
+    EXPECT_FALSE(flowGraph.isPassThrough());
+    flowGraph.process(steady.data(), ramped.data(), 2 * kRampFrames);
+    EXPECT_FALSE(flowGraph.isPassThrough());
+    EXPECT_GT(ramped[0], kLevel * 3 / 4);
+    for (int i = 1; i < 2 * kRampFrames; i++) {
+        EXPECT_LE(ramped[i * kChannelCount], ramped[(i - 1) * kChannelCount]) << "frame " << i;
+    }
+    EXPECT_NEAR(kLevel / 2, ramped[ramped.size() - 1], 1);
+}
+
+TEST(test_flowgraph, aaudio_flowgraph_pass_through_limiter) {
+    static const float input[] = {0.5f, -1.0f, 1.0f, 0.0f};
+    static const float loud[] = {0.5f, -1.0f, 10.0f, NAN};
+    float output[std::size(input)] = {};
+    AAudioFlowGraph flowGraph;
+    ASSERT_EQ(AAUDIO_OK, flowGraph.configure(AUDIO_FORMAT_PCM_FLOAT, 1,
+                                             AUDIO_FORMAT_PCM_FLOAT, 1,
+                                             false /* useMonoBlend */, 0.0f /* audioBalance */,
+                                             false /* isExclusive */));
+    EXPECT_TRUE(flowGraph.isPassThrough());
+    flowGraph.process(input, output, std::size(input));
+    for (size_t i = 0; i < std::size(input); i++) {
+        EXPECT_EQ(input[i], output[i]);
+    }
+
+    // Samples outside of the unit range still go through the limiter.
+    flowGraph.process(loud, output, std::size(loud));
+    EXPECT_EQ(loud[0], output[0]);
+    EXPECT_GT(loud[2], output[2]);
+    EXPECT_FALSE(isnan(output[3]));
+
+    // A NaN right after a direct copy repeats the last sample copied.
+    static const float quiet[] = {0.25f, -0.5f};
+    static const float gap[] = {NAN, 0.0f};
+    flowGraph.process(quiet, output, std::size(quiet));
+    EXPECT_EQ(quiet[1], output[1]);
+    flowGraph.process(gap, output, std::size(gap));
+    EXPECT_EQ(quiet[1], output[0]);
+}
@@ -29,6 +29,7 @@
 #include <media/AudioSystem.h>
 #include <media/IAudioFlinger.h>
 #include <media/PolicyAidlConversion.h>
+#include <media/ReadMostly.h>
 #include <media/TypeConverter.h>
 #include <math.h>
 
@@ -100,6 +101,9 @@ void AudioSystem::setAudioFlingerBinder(const sp<IBinder>& audioFlinger) {
 
 static sp<IAudioFlinger> gLocalAudioFlinger; // set if we are local.
 
+// gAudioFlinger as seen by the queries, which read it without gLock. Updated with gLock held.
+static ReadMostly<sp<IAudioFlinger>> gPublishedAudioFlinger;
+
 status_t AudioSystem::setLocalAudioFlinger(const sp<IAudioFlinger>& af) {
     Mutex::Autolock _l(gLock);
     if (gAudioFlinger != nullptr) return INVALID_OPERATION;
@@ -109,7 +113,11 @@ status_t AudioSystem::setLocalAudioFlinger(const sp<IAudioFlinger>& af) {
 
 // establish binder interface to AudioFlinger service
 const sp<IAudioFlinger> AudioSystem::getAudioFlingerImpl(bool canStartThreadPool = true) {
-    sp<IAudioFlinger> af;
+    sp<IAudioFlinger> af = gPublishedAudioFlinger.read(
+            [](const sp<IAudioFlinger>& published) { return published; });
+    if (af != nullptr) {
+        return af;
+    }
     sp<AudioFlingerClient> afc;
     bool reportNoError = false;
     {
@@ -146,6 +154,7 @@ const sp<IAudioFlinger> AudioSystem::getAudioFlingerImpl(bool canStartThreadPool
         }
         afc = gAudioFlingerClient;
         af = gAudioFlinger;
+        gPublishedAudioFlinger.update([&af](sp<IAudioFlinger>& published) { published = af; });
         // Make sure callbacks can be received by gAudioFlingerClient
         if(canStartThreadPool) {
             ProcessState::self()->startThreadPool();
@@ -170,7 +179,8 @@ const sp<AudioSystem::AudioFlingerClient> AudioSystem::getAudioFlingerClient() {
     // calling get_audio_flinger() will initialize gAudioFlingerClient if needed
     const sp<IAudioFlinger>& af = AudioSystem::get_audio_flinger();
     if (af == 0) return 0;
-    Mutex::Autolock _l(gLock);
+    // gAudioFlingerClient is set before gAudioFlinger is first published and never changes
+    // afterwards, so it can be read without gLock.
     return gAudioFlingerClient;
 }
 
@@ -559,6 +569,7 @@ void AudioSystem::AudioFlingerClient::binderDied(const wp<IBinder>& who __unused
     {
         Mutex::Autolock _l(AudioSystem::gLock);
         AudioSystem::gAudioFlinger.clear();
+        gPublishedAudioFlinger.update([](sp<IAudioFlinger>& published) { published.clear(); });
     }
 
     // clear output handles and stream to output map caches
@@ -593,13 +604,11 @@ Status AudioSystem::AudioFlingerClient::ioConfigChanged(
             case AUDIO_OUTPUT_REGISTERED:
             case AUDIO_INPUT_OPENED:
             case AUDIO_INPUT_REGISTERED: {
-                sp<AudioIoDescriptor> oldDesc = getIoDescriptor_l(ioDesc->getIoHandle());
-                if (oldDesc == 0) {
-                    mIoDescriptors.add(ioDesc->getIoHandle(), ioDesc);
-                } else {
+                sp<AudioIoDescriptor> oldDesc = mIoDescriptors.get(ioDesc->getIoHandle());
+                if (oldDesc != 0) {
                     deviceId = oldDesc->getDeviceId();
-                    mIoDescriptors.replaceValueFor(ioDesc->getIoHandle(), ioDesc);
                 }
+                mIoDescriptors.put(ioDesc);
 
                 if (ioDesc->getDeviceId() != AUDIO_PORT_HANDLE_NONE) {
                     deviceId = ioDesc->getDeviceId();
@@ -620,7 +629,7 @@ Status AudioSystem::AudioFlingerClient::ioConfigChanged(
                 break;
             case AUDIO_OUTPUT_CLOSED:
             case AUDIO_INPUT_CLOSED: {
-                if (getIoDescriptor_l(ioDesc->getIoHandle()) == 0) {
+                if (mIoDescriptors.get(ioDesc->getIoHandle()) == 0) {
                     ALOGW("ioConfigChanged() closing unknown %s %d",
                           event == AUDIO_OUTPUT_CLOSED ? "output" : "input", ioDesc->getIoHandle());
                     break;
@@ -628,14 +637,14 @@ Status AudioSystem::AudioFlingerClient::ioConfigChanged(
                 ALOGV("ioConfigChanged() %s %d closed",
                       event == AUDIO_OUTPUT_CLOSED ? "output" : "input", ioDesc->getIoHandle());
 
-                mIoDescriptors.removeItem(ioDesc->getIoHandle());
+                mIoDescriptors.remove(ioDesc->getIoHandle());
                 mAudioDeviceCallbacks.erase(ioDesc->getIoHandle());
             }
                 break;
 
             case AUDIO_OUTPUT_CONFIG_CHANGED:
             case AUDIO_INPUT_CONFIG_CHANGED: {
-                sp<AudioIoDescriptor> oldDesc = getIoDescriptor_l(ioDesc->getIoHandle());
+                sp<AudioIoDescriptor> oldDesc = mIoDescriptors.get(ioDesc->getIoHandle());
                 if (oldDesc == 0) {
                     ALOGW("ioConfigChanged() modifying unknown %s! %d",
                           event == AUDIO_OUTPUT_CONFIG_CHANGED ? "output" : "input",
@@ -644,7 +653,7 @@ Status AudioSystem::AudioFlingerClient::ioConfigChanged(
                 }
 
                 deviceId = oldDesc->getDeviceId();
-                mIoDescriptors.replaceValueFor(ioDesc->getIoHandle(), ioDesc);
+                mIoDescriptors.put(ioDesc);
 
                 if (deviceId != ioDesc->getDeviceId()) {
                     deviceId = ioDesc->getDeviceId();
@@ -660,7 +669,7 @@ Status AudioSystem::AudioFlingerClient::ioConfigChanged(
             }
                 break;
             case AUDIO_CLIENT_STARTED: {
-                sp<AudioIoDescriptor> oldDesc = getIoDescriptor_l(ioDesc->getIoHandle());
+                sp<AudioIoDescriptor> oldDesc = mIoDescriptors.get(ioDesc->getIoHandle());
                 if (oldDesc == 0) {
                     ALOGW("ioConfigChanged() start client on unknown io! %d",
                             ioDesc->getIoHandle());
@@ -668,7 +677,15 @@ Status AudioSystem::AudioFlingerClient::ioConfigChanged(
                 }
                 ALOGV("ioConfigChanged() AUDIO_CLIENT_STARTED  io %d port %d num callbacks %zu",
                       ioDesc->getIoHandle(), ioDesc->getPortId(), mAudioDeviceCallbacks.size());
-                oldDesc->setPatch(ioDesc->getPatch());
+                // Queries may be reading the cached descriptor: replace it with a copy
+                // routed to the new patch.
+                oldDesc = sp<AudioIoDescriptor>::make(
+                        oldDesc->getIoHandle(), ioDesc->getPatch(), oldDesc->getIsInput(),
+                        oldDesc->getSamplingRate(), oldDesc->getFormat(),
+                        oldDesc->getChannelMask(), oldDesc->getFrameCount(),
+                        oldDesc->getFrameCountHAL(), oldDesc->getLatency(),
+                        oldDesc->getPortId());
+                mIoDescriptors.put(oldDesc);
                 auto it = mAudioDeviceCallbacks.find(ioDesc->getIoHandle());
                 if (it != mAudioDeviceCallbacks.end()) {
                     auto cbks = it->second;
@@ -755,19 +772,8 @@ status_t AudioSystem::AudioFlingerClient::getInputBufferSize(
     return NO_ERROR;
 }
 
-sp<AudioIoDescriptor>
-AudioSystem::AudioFlingerClient::getIoDescriptor_l(audio_io_handle_t ioHandle) {
-    sp<AudioIoDescriptor> desc;
-    ssize_t index = mIoDescriptors.indexOfKey(ioHandle);
-    if (index >= 0) {
-        desc = mIoDescriptors.valueAt(index);
-    }
-    return desc;
-}
-
 sp<AudioIoDescriptor> AudioSystem::AudioFlingerClient::getIoDescriptor(audio_io_handle_t ioHandle) {
-    Mutex::Autolock _l(mLock);
-    return getIoDescriptor_l(ioHandle);
+    return mIoDescriptors.get(ioHandle);
 }
 
 status_t AudioSystem::AudioFlingerClient::addAudioDeviceCallback(
@@ -1520,6 +1526,7 @@ void AudioSystem::clearAudioConfigCache() {
             gAudioFlingerClient->clearIoCache();
         }
         gAudioFlinger.clear();
+        gPublishedAudioFlinger.update([](sp<IAudioFlinger>& published) { published.clear(); });
     }
     clearAudioPolicyService();
 }
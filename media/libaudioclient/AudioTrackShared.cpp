@@ -79,7 +79,7 @@ Proxy::Proxy(audio_track_cblk_t* cblk, void *buffers, size_t frameCount, size_t
         bool isOut, bool clientInServer)
     : mCblk(cblk), mBuffers(buffers), mFrameCount(frameCount), mFrameSize(frameSize),
       mFrameCountP2(roundup(frameCount)), mIsOut(isOut), mClientInServer(clientInServer),
-      mIsShutdown(false), mUnreleased(0)
+      mIsShutdown(false), mUnreleased(0), mFutexSyscalls(0)
 {
 }
 
@@ -316,9 +316,7 @@ status_t ClientProxy::obtainBuffer(Buffer* buffer, const struct timespec *reques
                 clock_gettime(CLOCK_MONOTONIC, &before);
                 beforeIsValid = true;
             }
-            errno = 0;
-            (void) syscall(__NR_futex, &cblk->mFutex,
-                    mClientInServer ? FUTEX_WAIT_PRIVATE : FUTEX_WAIT, old & ~CBLK_FUTEX_WAKE, ts);
+            waitForServer(ts);
             status_t error = errno; // clock_gettime can affect errno
             // update total elapsed time spent waiting
             if (measure) {
@@ -402,6 +400,27 @@ void ClientProxy::releaseBuffer(Buffer* buffer)
     }
 }
 
+void ClientProxy::waitForServer(const struct timespec *ts)
+{
+    audio_track_cblk_t* cblk = mCblk;
+    // The server only issues a futex wake when it sees a waiter, so count this thread before
+    // checking for a wake posted since it was consumed. Any later wake changes the futex value
+    // and either prevents the wait or finds the waiter.
+    const int32_t waiting =
+            android_atomic_add(CBLK_FUTEX_WAITER, &cblk->mFutex) + CBLK_FUTEX_WAITER;
+    if (waiting & CBLK_FUTEX_WAKE) {
+        errno = EWOULDBLOCK;
+    } else {
+        mFutexSyscalls++;
+        errno = 0;
+        (void) syscall(__NR_futex, &cblk->mFutex,
+                mClientInServer ? FUTEX_WAIT_PRIVATE : FUTEX_WAIT, waiting, ts);
+    }
+    const int error = errno;
+    android_atomic_add(-CBLK_FUTEX_WAITER, &cblk->mFutex);
+    errno = error;
+}
+
 void ClientProxy::binderDied()
 {
     audio_track_cblk_t* cblk = mCblk;
@@ -576,9 +595,7 @@ status_t AudioTrackClientProxy::waitStreamEndDone(const struct timespec *request
                 clock_gettime(CLOCK_MONOTONIC, &before);
                 beforeIsValid = true;
             }
-            errno = 0;
-            (void) syscall(__NR_futex, &cblk->mFutex,
-                    mClientInServer ? FUTEX_WAIT_PRIVATE : FUTEX_WAIT, old & ~CBLK_FUTEX_WAKE, ts);
+            waitForServer(ts);
             status_t error = errno; // clock_gettime can affect errno
             {
                 struct timespec after;
@@ -726,6 +743,29 @@ ServerProxy::ServerProxy(audio_track_cblk_t* cblk, void *buffers, size_t frameCo
     cblk->mStartThresholdInFrames = frameCount;
 }
 
+void ServerProxy::wakeClient()
+{
+    audio_track_cblk_t* cblk = mCblk;
+    int32_t old = android_atomic_or(CBLK_FUTEX_WAKE, &cblk->mFutex);
+    // The bits besides CBLK_FUTEX_WAKE count the waiters.
+    if (!(old & CBLK_FUTEX_WAKE) && (old & ~CBLK_FUTEX_WAKE) != 0) {
+        mFutexSyscalls++;
+        (void) syscall(__NR_futex, &cblk->mFutex,
+                mClientInServer ? FUTEX_WAKE_PRIVATE : FUTEX_WAKE, INT_MAX);
+    }
+}
+
+void ServerProxy::signalClientFlag(int32_t flag)
+{
+    audio_track_cblk_t* cblk = mCblk;
+    android_atomic_or(flag, &cblk->mFlags);
+    // Posting a wake changes the futex value, so that a client thread about to wait sees the
+    // flag, and keeps the count of the waiters, which remove themselves when they return.
+    android_atomic_or(CBLK_FUTEX_WAKE, &cblk->mFutex);
+    (void) syscall(__NR_futex, &cblk->mFutex,
+            mClientInServer ? FUTEX_WAKE_PRIVATE : FUTEX_WAKE, INT_MAX);
+}
+
 __attribute__((no_sanitize("integer")))
 void ServerProxy::flushBufferIfNeeded()
 {
@@ -767,11 +807,7 @@ void ServerProxy::flushBufferIfNeeded()
         android_atomic_release_store(newFront, &cblk->u.mStreaming.mFront);
         // There is no danger from a false positive, so err on the side of caution
         if (true /*front != newFront*/) {
-            int32_t old = android_atomic_or(CBLK_FUTEX_WAKE, &cblk->mFutex);
-            if (!(old & CBLK_FUTEX_WAKE)) {
-                (void) syscall(__NR_futex, &cblk->mFutex,
-                        mClientInServer ? FUTEX_WAKE_PRIVATE : FUTEX_WAKE, INT_MAX);
-            }
+            wakeClient();
         }
         mFlushed += (newFront - front) & mask;
     }
@@ -937,11 +973,7 @@ void ServerProxy::releaseBuffer(Buffer* buffer)
     // FIXME AudioRecord wakeup needs to be optimized; it currently wakes up client every time
     if (!mIsOut || (mAvailToClient + stepCount >= minimum)) {
         ALOGV("mAvailToClient=%zu stepCount=%zu minimum=%zu", mAvailToClient, stepCount, minimum);
-        int32_t old = android_atomic_or(CBLK_FUTEX_WAKE, &cblk->mFutex);
-        if (!(old & CBLK_FUTEX_WAKE)) {
-            (void) syscall(__NR_futex, &cblk->mFutex,
-                    mClientInServer ? FUTEX_WAKE_PRIVATE : FUTEX_WAKE, INT_MAX);
-        }
+        wakeClient();
     }
 
     buffer->mFrameCount = 0;
@@ -1002,8 +1034,11 @@ bool  AudioTrackServerProxy::setStreamEndDone() {
     bool old =
             (android_atomic_or(CBLK_STREAM_END_DONE, &cblk->mFlags) & CBLK_STREAM_END_DONE) != 0;
     if (!old) {
+        // Post a wake so that a client thread about to wait in waitStreamEndDone() does not
+        // miss it, and wake all the waiters: the one woken could be blocked in obtainBuffer().
+        android_atomic_or(CBLK_FUTEX_WAKE, &cblk->mFutex);
         (void) syscall(__NR_futex, &cblk->mFutex, mClientInServer ? FUTEX_WAKE_PRIVATE : FUTEX_WAKE,
-                1);
+                INT_MAX);
     }
     return old;
 }
@@ -1022,6 +1022,8 @@ ToneGenerator::ToneGenerator(audio_stream_type_t streamType, float volume, bool
     mpNewToneDesc = NULL;
     // Generate tone by chunks of 20 ms to keep cadencing precision
     mProcessSize = (mSamplingRate * 20) / 1000;
+    // onMoreData() generates up to twice mProcessSize frames at a time
+    mAccumulator.resize(mProcessSize * 2);
 
     char value[PROPERTY_VALUE_MAX];
     if (property_get("gsm.operator.iso-country", value, "") == 0) {
@@ -1365,7 +1367,7 @@ size_t ToneGenerator::onMoreData(const AudioTrack::Buffer& buffer) {
     // 0 at loop end
     size_t bytesWritten = lNumSmp * sizeof(int16_t);
 
-    // Clear output buffer: WaveGenerator accumulates into lpOut buffer
+    // Clear output buffer: silent blocks are not generated
     memset(lpOut, 0, buffer.size());
 
     while (lNumSmp) {
@@ -1373,6 +1375,10 @@ size_t ToneGenerator::onMoreData(const AudioTrack::Buffer& buffer) {
         unsigned int lGenSmp;
         unsigned int lWaveCmd = WaveGenerator::WAVEGEN_CONT;
         bool lSignal = false;
+        bool lGenerated = false;
+
+        // Clear the accumulator: the wave generators of all segments in this block add into it
+        memset(mAccumulator.data(), 0, lReqSmp * sizeof(int32_t));
 
         mLock.lock();
 
@@ -1429,14 +1435,8 @@ size_t ToneGenerator::onMoreData(const AudioTrack::Buffer& buffer) {
             // If segment,  ON -> OFF transition : ramp volume down
             if (mpToneDesc->segments[mCurSegment].waveFreq[0] != 0) {
                 lWaveCmd = WaveGenerator::WAVEGEN_STOP;
-                unsigned int lFreqIdx = 0;
-                uint16_t lFrequency = mpToneDesc->segments[mCurSegment].waveFreq[lFreqIdx];
-
-                while (lFrequency != 0) {
-                    WaveGenerator *lpWaveGen = mWaveGens.valueFor(lFrequency);
-                    lpWaveGen->getSamples(lpOut, lGenSmp, lWaveCmd);
-                    lFrequency = mpToneDesc->segments[mCurSegment].waveFreq[++lFreqIdx];
-                }
+                getSegmentSamples(mAccumulator.data(), lGenSmp, lWaveCmd);
+                lGenerated = true;
                 ALOGV("ON->OFF, lGenSmp: %d, lReqSmp: %d", lGenSmp, lReqSmp);
             }
 
@@ -1519,15 +1519,13 @@ size_t ToneGenerator::onMoreData(const AudioTrack::Buffer& buffer) {
         }
 
         if (lGenSmp) {
-            // If samples must be generated, call all active wave generators and acumulate waves in lpOut
-            unsigned int lFreqIdx = 0;
-            uint16_t lFrequency = mpToneDesc->segments[mCurSegment].waveFreq[lFreqIdx];
-
-            while (lFrequency != 0) {
-                WaveGenerator *lpWaveGen = mWaveGens.valueFor(lFrequency);
-                lpWaveGen->getSamples(lpOut, lGenSmp, lWaveCmd);
-                lFrequency = mpToneDesc->segments[mCurSegment].waveFreq[++lFreqIdx];
-            }
+            // If samples must be generated, call all active wave generators and acumulate waves
+            getSegmentSamples(mAccumulator.data(), lGenSmp, lWaveCmd);
+            lGenerated = true;
+        }
+
+        if (lGenerated) {
+            clampToneSamples(lpOut, mAccumulator.data(), lReqSmp);
         }
 
         lNumSmp -= lReqSmp;
@@ -1686,6 +1684,38 @@ unsigned int ToneGenerator::numWaves(unsigned int segmentIdx) {
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//    Method:        ToneGenerator::getSegmentSamples()
+//
+//    Description:    Generates count samples of all the sine waves of the current
+//        segment in one pass and accumulates the result in outBuffer.
+//
+//    Input:
+//        outBuffer:      Output buffer where to accumulate samples.
+//        count:          number of samples to produce.
+//        command:        special action requested (see enum gen_command).
+//
+//    Output:
+//        none
+//
+////////////////////////////////////////////////////////////////////////////////
+void ToneGenerator::getSegmentSamples(int32_t *outBuffer, unsigned int count,
+        unsigned int command) {
+    static_assert(TONEGEN_MAX_WAVES <= kToneMaxWaves);
+    ToneWave *lpWaves[TONEGEN_MAX_WAVES];
+    unsigned int lNumWaves = 0;
+    uint16_t lFrequency = mpToneDesc->segments[mCurSegment].waveFreq[0];
+
+    while (lFrequency != 0 && lNumWaves < TONEGEN_MAX_WAVES) {
+        lpWaves[lNumWaves] = mWaveGens.valueFor(lFrequency)->getWave(command);
+        lFrequency = mpToneDesc->segments[mCurSegment].waveFreq[++lNumWaves];
+    }
+    synthesizeToneWaves(lpWaves, lNumWaves, outBuffer, count,
+            command == WaveGenerator::WAVEGEN_STOP);
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //    Method:        ToneGenerator::clearWaveGens()
@@ -1766,21 +1796,22 @@ ToneGenerator::WaveGenerator::WaveGenerator(uint32_t samplingRate,
     F_div_Fs = frequency / (double)samplingRate;
     d0 = - (float)GEN_AMP * sin(2 * M_PI * F_div_Fs);
     mS2_0 = (int16_t)d0;
-    mS1 = 0;
-    mS2 = mS2_0;
+    mWave.s1 = 0;
+    mWave.s2 = mS2_0;
 
-    mAmplitude_Q15 = (int16_t)(32767. * 32767. * volume / GEN_AMP);
+    int16_t amplitude_Q15 = (int16_t)(32767. * 32767. * volume / GEN_AMP);
     // take some margin for amplitude fluctuation
-    if (mAmplitude_Q15 > 32500)
-        mAmplitude_Q15 = 32500;
+    if (amplitude_Q15 > 32500)
+        amplitude_Q15 = 32500;
+    mWave.amplitudeQ15 = amplitude_Q15;
 
     d0 = 32768.0 * cos(2 * M_PI * F_div_Fs);  // Q14*2*cos()
     if (d0 > 32767)
         d0 = 32767;
-    mA1_Q14 = (int16_t) d0;
+    mWave.a1Q14 = (int16_t) d0;
 
     ALOGV("WaveGenerator init, mA1_Q14: %d, mS2_0: %d, mAmplitude_Q15: %d",
-            mA1_Q14, mS2_0, mAmplitude_Q15);
+            mWave.a1Q14, mS2_0, mWave.amplitudeQ15);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1801,70 +1832,25 @@ ToneGenerator::WaveGenerator::~WaveGenerator() {
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//    Method:        WaveGenerator::getSamples()
+//    Method:        WaveGenerator::getWave()
 //
-//    Description:    Generates count samples of a sine wave and accumulates
-//        result in outBuffer.
+//    Description:    Returns the oscillator state to pass to synthesizeToneWaves()
+//        for the next block of samples.
 //
 //    Input:
-//        outBuffer:      Output buffer where to accumulate samples.
-//        count:          number of samples to produce.
 //        command:        special action requested (see enum gen_command).
+//            WAVEGEN_START restarts the wave from phase 0.
 //
 //    Output:
-//        none
+//        returned value:    oscillator state, updated by synthesizeToneWaves()
 //
 ////////////////////////////////////////////////////////////////////////////////
-void ToneGenerator::WaveGenerator::getSamples(int16_t *outBuffer,
-        unsigned int count, unsigned int command) {
-    long lS1, lS2;
-    long lA1, lAmplitude;
-    long Sample;  // current sample
-
-    // init local
+ToneWave *ToneGenerator::WaveGenerator::getWave(unsigned int command) {
     if (command == WAVEGEN_START) {
-        lS1 = (long)0;
-        lS2 = (long)mS2_0;
-    } else {
-        lS1 = mS1;
-        lS2 = mS2;
-    }
-    lA1 = (long)mA1_Q14;
-    lAmplitude = (long)mAmplitude_Q15;
-
-    if (command == WAVEGEN_STOP) {
-        lAmplitude <<= 16;
-        if (count == 0) {
-            return;
-        }
-        long dec = lAmplitude/count;
-        // loop generation
-        while (count) {
-            count--;
-            Sample = ((lA1 * lS1) >> S_Q14) - lS2;
-            // shift delay
-            lS2 = lS1;
-            lS1 = Sample;
-            Sample = ((lAmplitude>>16) * Sample) >> S_Q15;
-            *(outBuffer++) += (int16_t)Sample;  // put result in buffer
-            lAmplitude -= dec;
-        }
-    } else {
-        // loop generation
-        while (count) {
-            count--;
-            Sample = ((lA1 * lS1) >> S_Q14) - lS2;
-            // shift delay
-            lS2 = lS1;
-            lS1 = Sample;
-            Sample = (lAmplitude * Sample) >> S_Q15;
-            *(outBuffer++) += (int16_t)Sample;  // put result in buffer
-        }
+        mWave.s1 = 0;
+        mWave.s2 = mS2_0;
     }
-
-    // save status
-    mS1 = lS1;
-    mS2 = lS2;
+    return &mWave;
 }
 
 }  // end namespace android
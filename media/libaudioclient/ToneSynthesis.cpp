@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ToneSynthesis"
+
+#include <algorithm>
+
+#include <audio_utils/primitives.h>
+#include <utils/Log.h>
+
+#include "media/ToneSynthesis.h"
+
+namespace android {
+
+namespace {
+
+constexpr int kShiftQ14 = 14;
+constexpr int kShiftQ15 = 15;
+// The ramp keeps 16 fractional bits on the Q15 amplitude so that it decreases
+// smoothly over long blocks. This fits in 32 bits for amplitudes up to 32767.
+constexpr int kShiftRamp = 16;
+
+}  // namespace
+
+// The oscillators are copied into fixed size lanes so that each step of the
+// inner loops is one vector operation on all the waves of the segment.
+// The products fit in 32 bits: the resonator output stays within 16 bits and
+// both the coefficient and the amplitude are below 1.0 in their Q format.
+void synthesizeToneWaves(ToneWave *const waves[], size_t numWaves,
+                         int32_t *outBuffer, size_t count, bool rampDown) {
+    ALOGW_IF(numWaves > kToneMaxWaves, "%s: %zu waves, only %zu generated",
+             __func__, numWaves, kToneMaxWaves);
+    numWaves = std::min(numWaves, kToneMaxWaves);
+    if (numWaves == 0 || count == 0) {
+        return;
+    }
+
+    int32_t a1[kToneMaxWaves] = {};
+    int32_t s1[kToneMaxWaves] = {};
+    int32_t s2[kToneMaxWaves] = {};
+    int32_t amplitude[kToneMaxWaves] = {};
+    int32_t decrement[kToneMaxWaves] = {};
+    for (size_t i = 0; i < numWaves; i++) {
+        a1[i] = waves[i]->a1Q14;
+        s1[i] = waves[i]->s1;
+        s2[i] = waves[i]->s2;
+        amplitude[i] = waves[i]->amplitudeQ15;
+    }
+
+    if (rampDown) {
+        for (size_t i = 0; i < kToneMaxWaves; i++) {
+            amplitude[i] <<= kShiftRamp;
+            decrement[i] = static_cast<int32_t>(amplitude[i] / static_cast<int64_t>(count));
+        }
+        for (size_t n = 0; n < count; n++) {
+            int32_t sum = 0;
+            for (size_t i = 0; i < kToneMaxWaves; i++) {
+                const int32_t sample = ((a1[i] * s1[i]) >> kShiftQ14) - s2[i];
+                s2[i] = s1[i];
+                s1[i] = sample;
+                sum += ((amplitude[i] >> kShiftRamp) * sample) >> kShiftQ15;
+                amplitude[i] -= decrement[i];
+            }
+            outBuffer[n] += sum;
+        }
+    } else {
+        for (size_t n = 0; n < count; n++) {
+            int32_t sum = 0;
+            for (size_t i = 0; i < kToneMaxWaves; i++) {
+                const int32_t sample = ((a1[i] * s1[i]) >> kShiftQ14) - s2[i];
+                s2[i] = s1[i];
+                s1[i] = sample;
+                sum += (amplitude[i] * sample) >> kShiftQ15;
+            }
+            outBuffer[n] += sum;
+        }
+    }
+
+    for (size_t i = 0; i < numWaves; i++) {
+        waves[i]->s1 = s1[i];
+        waves[i]->s2 = s2[i];
+    }
+}
+
+void clampToneSamples(int16_t *dst, const int32_t *src, size_t count) {
+    for (size_t n = 0; n < count; n++) {
+        dst[n] = clamp16(src[n]);
+    }
+}
+
+}  // namespace android
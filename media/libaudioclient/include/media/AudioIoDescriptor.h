@@ -17,9 +17,11 @@
 #ifndef ANDROID_AUDIO_IO_DESCRIPTOR_H
 #define ANDROID_AUDIO_IO_DESCRIPTOR_H
 
+#include <map>
 #include <sstream>
 #include <string>
 
+#include <media/ReadMostly.h>
 #include <system/audio.h>
 #include <utils/RefBase.h>
 
@@ -105,6 +107,45 @@ public:
     const audio_port_handle_t  mPortId = AUDIO_PORT_HANDLE_NONE;
 };
 
+// Descriptors of the inputs and outputs known to the client process, indexed by io handle.
+// They are queried each time a track or record is configured or its latency is read, and
+// only change on the ioConfigChanged() callbacks from AudioFlinger. Queries never wait
+// for the client lock or for an update, see ReadMostly. The cached descriptors are shared
+// with the readers and must not be modified.
+class AudioIoDescriptorCache {
+public:
+    using DescriptorMap = std::map<audio_io_handle_t, sp<AudioIoDescriptor>>;
+
+    // Never waits for an update in progress.
+    sp<AudioIoDescriptor> get(audio_io_handle_t ioHandle) const {
+        return mDescriptors.read(
+                [ioHandle](const DescriptorMap& descriptors) -> sp<AudioIoDescriptor> {
+                    auto it = descriptors.find(ioHandle);
+                    return it != descriptors.end() ? it->second : nullptr;
+                });
+    }
+
+    // Updates are not synchronized with each other and must be serialized by the caller.
+    void put(const sp<AudioIoDescriptor>& desc) {
+        mDescriptors.update([&desc](DescriptorMap& descriptors) {
+            descriptors[desc->getIoHandle()] = desc;
+        });
+    }
+
+    void remove(audio_io_handle_t ioHandle) {
+        mDescriptors.update([ioHandle](DescriptorMap& descriptors) {
+            descriptors.erase(ioHandle);
+        });
+    }
+
+    void clear() {
+        mDescriptors.update([](DescriptorMap& descriptors) { descriptors.clear(); });
+    }
+
+private:
+    ReadMostly<DescriptorMap> mDescriptors;
+};
+
 
 };  // namespace android
 
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_READ_MOSTLY_H
+#define ANDROID_READ_MOSTLY_H
+
+#include <atomic>
+#include <sched.h>
+
+namespace android {
+
+/**
+ * A value that is read far more often than it is written, kept in two copies
+ * (the "left-right" scheme). Readers never block: they announce themselves on the
+ * copy currently published and read it in place. A writer updates the other copy,
+ * publishes it, waits for the readers still on the old copy to leave, and then
+ * applies the same update to the old copy.
+ *
+ * Reads cost two atomic increments on a counter shared by all readers, and never wait
+ * for a writer. Updates are not synchronized with each other and must be serialized
+ * by the caller; an update waits for the reads in progress, which must be short and
+ * must not update the value themselves.
+ */
+template <typename T>
+class ReadMostly {
+public:
+    ReadMostly() = default;
+    explicit ReadMostly(const T& value) : mValues{value, value} {}
+
+    ReadMostly(const ReadMostly&) = delete;
+    ReadMostly& operator=(const ReadMostly&) = delete;
+
+    // Returns reader(value). reader() may run again if an update was published meanwhile.
+    template <typename Reader>
+    auto read(Reader&& reader) const {
+        for (;;) {
+            const int index = mIndex.load();
+            mReaders[index]++;
+            // An update that published the other copy before our increment may already
+            // have stopped waiting for readers of this one.
+            if (mIndex.load() == index) {
+                auto result = reader(mValues[index]);
+                mReaders[index]--;
+                return result;
+            }
+            mReaders[index]--;
+        }
+    }
+
+    // Applies writer() to both copies of the value, one after the other.
+    template <typename Writer>
+    void update(Writer&& writer) {
+        const int index = mIndex.load(std::memory_order_relaxed);
+        writer(mValues[index ^ 1]);
+        mIndex.store(index ^ 1);
+        while (mReaders[index].load() != 0) {
+            sched_yield();
+        }
+        writer(mValues[index]);
+    }
+
+private:
+    std::atomic<int> mIndex{0};
+    mutable std::atomic<int> mReaders[2] = {0, 0};
+    T mValues[2];
+};
+
+}  // namespace android
+
+#endif  // ANDROID_READ_MOSTLY_H
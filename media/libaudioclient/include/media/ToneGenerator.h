@@ -18,9 +18,11 @@
 #define ANDROID_TONEGENERATOR_H_
 
 #include <string>
+#include <vector>
 
 #include <media/AudioSystem.h>
 #include <media/AudioTrack.h>
+#include <media/ToneSynthesis.h>
 #include <utils/Compat.h>
 #include <utils/KeyedVector.h>
 #include <utils/RefBase.h>
@@ -316,6 +318,7 @@ private:
     float mVolume;  // Volume applied to audio track
     audio_stream_type_t mStreamType; // Audio stream used for output
     unsigned int mProcessSize;  // Size of audio blocks generated at a time by audioCallback() (in PCM frames).
+    std::vector<int32_t> mAccumulator;  // Sum of the waves of a block, before conversion to 16 bits
     struct timespec mStartTime; // tone start time: needed to guaranty actual tone duration
 
     size_t onMoreData(const AudioTrack::Buffer& buffer) override;
@@ -323,6 +326,7 @@ private:
     static void audioCallback(int event, void* user, void *info);
     bool prepareWave();
     unsigned int numWaves(unsigned int segmentIdx);
+    void getSegmentSamples(int32_t *outBuffer, unsigned int count, unsigned int command);
     void clearWaveGens();
     tone_type getToneForRegion(tone_type toneType);
 
@@ -339,19 +343,13 @@ private:
                 float volume);
         ~WaveGenerator();
 
-        void getSamples(int16_t *outBuffer, unsigned int count,
-                unsigned int command);
+        ToneWave *getWave(unsigned int command);
 
     private:
         static const int16_t GEN_AMP = 32000;  // amplitude of generator
-        static const int16_t S_Q14 = 14;  // shift for Q14
-        static const int16_t S_Q15 = 15;  // shift for Q15
 
-        int16_t mA1_Q14;  // Q14 coefficient
-        // delay line of full amplitude generator
-        long mS1, mS2;  // delay line S2 oldest
+        ToneWave mWave;  // coefficient, delay line and amplitude
         int16_t mS2_0;  // saved value for reinitialisation
-        int16_t mAmplitude_Q15;  // Q15 amplitude
     };
 
     KeyedVector<uint16_t, WaveGenerator *> mWaveGens;  // list of active wave generators.
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_TONESYNTHESIS_H_
+#define ANDROID_TONESYNTHESIS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+
+// State of one sine wave oscillator of a tone. The wave is generated by the
+// resonator s[n] = a1 * s[n-1] - s[n-2], with a1 = 2 * cos(2 * pi * f / fs) in Q14,
+// and scaled by a Q15 amplitude.
+struct ToneWave {
+    int32_t a1Q14;         // Q14 resonator coefficient
+    int32_t s1;            // delay line of the full amplitude resonator,
+    int32_t s2;            //     s2 is the oldest sample
+    int32_t amplitudeQ15;  // Q15 output amplitude
+};
+
+// Number of oscillators synthesized together. Segments with fewer waves leave
+// the extra lanes silent.
+constexpr size_t kToneMaxWaves = 4;
+
+// Adds count samples of the sum of the numWaves waves to outBuffer and advances
+// the state of the waves. With rampDown, the amplitude of each wave decreases
+// linearly from its nominal value to 0 over the count samples.
+// The waves are summed in 32 bits, use clampToneSamples() to convert the result.
+void synthesizeToneWaves(ToneWave *const waves[], size_t numWaves,
+                         int32_t *outBuffer, size_t count, bool rampDown);
+
+// Converts count accumulated samples to 16 bits, saturating the peaks of waves
+// that add up beyond full scale.
+void clampToneSamples(int16_t *dst, const int32_t *src, size_t count);
+
+}  // namespace android
+
+#endif  // ANDROID_TONESYNTHESIS_H_
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks io descriptor queries from several threads, as AudioTrack and AudioRecord
+// do when they are configured, while another thread keeps updating the cache like the
+// ioConfigChanged() callbacks. The read-mostly cache used by AudioSystem is compared
+// with the locked map it replaced. The whole AudioSystem query path, which also gets the
+// AudioFlinger and client singletons, is measured against the output of a real track and
+// needs audioserver.
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+#include <media/AudioIoDescriptor.h>
+#include <media/AudioSystem.h>
+#include <media/AudioTrack.h>
+
+using namespace android;
+
+namespace {
+
+constexpr int kNumIos = 8;
+constexpr audio_io_handle_t kFirstIo = 13;
+
+sp<AudioIoDescriptor> makeDescriptor(audio_io_handle_t ioHandle, size_t frameCount) {
+    return sp<AudioIoDescriptor>::make(ioHandle, audio_patch{}, false /* isInput */, 48000,
+                                       AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+                                       frameCount, frameCount /* frameCountHal */);
+}
+
+// The cache before it was read-mostly: every query and update takes the client lock.
+class LockedIoDescriptorCache {
+public:
+    sp<AudioIoDescriptor> get(audio_io_handle_t ioHandle) {
+        std::lock_guard _l(mLock);
+        auto it = mDescriptors.find(ioHandle);
+        return it != mDescriptors.end() ? it->second : nullptr;
+    }
+
+    void put(const sp<AudioIoDescriptor>& desc) {
+        std::lock_guard _l(mLock);
+        mDescriptors[desc->getIoHandle()] = desc;
+    }
+
+private:
+    std::mutex mLock;
+    std::map<audio_io_handle_t, sp<AudioIoDescriptor>> mDescriptors;
+};
+
+// Replaces the descriptors one after the other until stopped.
+template <typename Cache>
+class CallbackThread {
+public:
+    explicit CallbackThread(Cache* cache) : mCache(cache) {
+        for (int i = 0; i < kNumIos; i++) {
+            mCache->put(makeDescriptor(kFirstIo + i, 960));
+        }
+        mThread = std::thread([this] {
+            for (size_t n = 0; !mStop; n++) {
+                mCache->put(makeDescriptor(kFirstIo + n % kNumIos, 960 + n % 2));
+                mUpdates++;
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    ~CallbackThread() {
+        mStop = true;
+        mThread.join();
+    }
+
+    int64_t updates() const { return mUpdates; }
+
+private:
+    Cache* const mCache;
+    std::atomic<bool> mStop{false};
+    std::atomic<int64_t> mUpdates{0};
+    std::thread mThread;
+};
+
+template <typename Cache>
+struct BenchmarkState {
+    Cache cache;
+    CallbackThread<Cache> callbacks{&cache};
+};
+
+template <typename Cache>
+void queryIoDescriptors(benchmark::State& state) {
+    static BenchmarkState<Cache>* gState;
+    if (state.thread_index() == 0) {
+        gState = new BenchmarkState<Cache>;
+    }
+
+    size_t n = state.thread_index();
+    for (auto _ : state) {
+        sp<AudioIoDescriptor> desc = gState->cache.get(kFirstIo + n++ % kNumIos);
+        benchmark::DoNotOptimize(desc->getFrameCount());
+    }
+
+    if (state.thread_index() == 0) {
+        state.counters["updates"] = benchmark::Counter(
+                gState->callbacks.updates(), benchmark::Counter::kIsRate);
+        delete gState;
+        gState = nullptr;
+    }
+}
+
+// The output of a track kept open for all the AudioSystem benchmarks, or
+// AUDIO_IO_HANDLE_NONE.
+audio_io_handle_t getTrackOutput() {
+    static const sp<AudioTrack> track = sp<AudioTrack>::make(
+            AUDIO_STREAM_MUSIC, 48000 /* sampleRate */, AUDIO_FORMAT_PCM_16_BIT,
+            AUDIO_CHANNEL_OUT_STEREO);
+    return track->initCheck() == NO_ERROR ? track->getOutput() : AUDIO_IO_HANDLE_NONE;
+}
+
+}  // namespace
+
+static void BM_LockedQuery(benchmark::State& state) {
+    queryIoDescriptors<LockedIoDescriptorCache>(state);
+}
+
+static void BM_ReadMostlyQuery(benchmark::State& state) {
+    queryIoDescriptors<AudioIoDescriptorCache>(state);
+}
+
+// What AudioTrack and AudioRecord query about their io handle when they are configured.
+static void BM_AudioSystemQuery(benchmark::State& state) {
+    const audio_io_handle_t output = getTrackOutput();
+    if (output == AUDIO_IO_HANDLE_NONE) {
+        state.SkipWithError("cannot create an AudioTrack");
+    }
+    for (auto _ : state) {
+        uint32_t samplingRate;
+        size_t frameCount;
+        uint32_t latency;
+        AudioSystem::getSamplingRate(output, &samplingRate);
+        AudioSystem::getFrameCount(output, &frameCount);
+        AudioSystem::getLatency(output, &latency);
+        benchmark::DoNotOptimize(samplingRate + frameCount + latency);
+    }
+}
+
+BENCHMARK(BM_LockedQuery)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_ReadMostlyQuery)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_AudioSystemQuery)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
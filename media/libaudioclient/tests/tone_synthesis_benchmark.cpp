@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the synthesis of a tone as ToneGenerator plays it, in the audio callback, for
+// 1 to 3 waves. The waves synthesized together are compared with the one wave at a time
+// generator they replaced.
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "tone_synthesis_utils.h"
+
+using namespace android;
+
+namespace {
+
+const std::vector<std::vector<uint16_t>> kFrequencies = {
+    {425}, {1336, 941}, {950, 1400, 1800},
+};
+
+void runToneSynthesis(benchmark::State& state, bool reference) {
+    constexpr uint32_t kSampleRate = 48000;
+    const std::vector<uint16_t>& frequencies = kFrequencies[state.range(0) - 1];
+    std::vector<int32_t> output;
+    for (auto _ : state) {
+        generateTone(frequencies, kSampleRate, 0.2f, reference, &output);
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * output.size());
+    state.SetLabel(std::to_string(frequencies.size()) + " waves");
+}
+
+}  // namespace
+
+static void BM_ToneSynthesis(benchmark::State& state) {
+    runToneSynthesis(state, false /* reference */);
+}
+
+static void BM_ToneSynthesisOneWaveAtATime(benchmark::State& state) {
+    runToneSynthesis(state, true /* reference */);
+}
+
+BENCHMARK(BM_ToneSynthesis)->DenseRange(1, 3);
+BENCHMARK(BM_ToneSynthesisOneWaveAtATime)->DenseRange(1, 3);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ToneSynthesisTests"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <media/ToneSynthesis.h>
+#include <utils/Log.h>
+
+#include "tone_synthesis_utils.h"
+
+using namespace android;
+
+class ToneSynthesisGoldenTest
+    : public ::testing::TestWithParam<std::tuple<uint32_t, std::vector<uint16_t>>> {};
+
+// With the gain ToneGenerator applies, the waves never add up beyond full scale
+// and the output must be identical to the one wave at a time generator.
+TEST_P(ToneSynthesisGoldenTest, MatchesGoldenOutput) {
+    const uint32_t sampleRate = std::get<0>(GetParam());
+    const std::vector<uint16_t>& frequencies = std::get<1>(GetParam());
+    const float volume = 0.9f / (frequencies.size() + 1);
+
+    std::vector<int32_t> golden;
+    std::vector<int32_t> output;
+    generateTone(frequencies, sampleRate, volume, true /* reference */, &golden);
+    generateTone(frequencies, sampleRate, volume, false /* reference */, &output);
+    ASSERT_EQ(golden.size(), output.size());
+    for (size_t i = 0; i < golden.size(); i++) {
+        ASSERT_EQ(golden[i], output[i]) << "sample " << i;
+    }
+
+    // The ramp down ends close to silence.
+    const size_t blockSize = sampleRate / 50;
+    int32_t peak = 0;
+    for (size_t i = output.size() - blockSize / 20; i < output.size(); i++) {
+        peak = std::max(peak, std::abs(output[i]));
+    }
+    EXPECT_LT(peak, 32768 / 20);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        ToneSynthesis, ToneSynthesisGoldenTest,
+        ::testing::Combine(::testing::Values(8000, 44100, 48000),
+                           ::testing::Values(std::vector<uint16_t>{425},
+                                             std::vector<uint16_t>{1336, 941},
+                                             std::vector<uint16_t>{950, 1400, 1800})));
+
+// Waves that add up beyond full scale saturate instead of wrapping around.
+TEST(ToneSynthesisTest, SaturatesLoudTones) {
+    constexpr uint32_t kSampleRate = 48000;
+    constexpr size_t kCount = kSampleRate / 50;
+    ToneWave waves[] = {makeWave(kSampleRate, 1000, 0.9f), makeWave(kSampleRate, 1000, 0.9f),
+                        makeWave(kSampleRate, 1000, 0.9f)};
+    ToneWave *wavePointers[] = {&waves[0], &waves[1], &waves[2]};
+    std::vector<int32_t> accumulator(kCount, 0);
+    synthesizeToneWaves(wavePointers, 3, accumulator.data(), kCount, false /* rampDown */);
+
+    std::vector<int16_t> output(kCount);
+    clampToneSamples(output.data(), accumulator.data(), kCount);
+    bool saturated = false;
+    for (size_t i = 0; i < kCount; i++) {
+        // The sign always follows the sum of the waves.
+        ASSERT_EQ(accumulator[i] > 0, output[i] > 0) << "sample " << i;
+        if (accumulator[i] > INT16_MAX) {
+            ASSERT_EQ(INT16_MAX, output[i]);
+            saturated = true;
+        } else if (accumulator[i] < INT16_MIN) {
+            ASSERT_EQ(INT16_MIN, output[i]);
+            saturated = true;
+        } else {
+            ASSERT_EQ(accumulator[i], output[i]);
+        }
+    }
+    EXPECT_TRUE(saturated);
+}
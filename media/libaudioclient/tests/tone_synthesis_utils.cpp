@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "tone_synthesis_utils.h"
+
+namespace android {
+
+ToneWave makeWave(uint32_t sampleRate, uint16_t frequency, float volume) {
+    constexpr int16_t kGenAmp = 32000;
+    const double fDivFs = frequency / (double)sampleRate;
+    ToneWave wave;
+    wave.s1 = 0;
+    wave.s2 = (int16_t)(-(float)kGenAmp * sin(2 * M_PI * fDivFs));
+    int16_t amplitude = (int16_t)(32767. * 32767. * volume / kGenAmp);
+    wave.amplitudeQ15 = std::min<int16_t>(amplitude, 32500);
+    wave.a1Q14 = (int16_t)std::min(32768.0 * cos(2 * M_PI * fDivFs), 32767.0);
+    return wave;
+}
+
+namespace {
+
+// The one wave at a time generator ToneGenerator used before the waves were
+// synthesized together. It produces the golden output.
+void referenceSamples(ToneWave *wave, int32_t *outBuffer, size_t count, bool rampDown) {
+    long lS1 = wave->s1;
+    long lS2 = wave->s2;
+    long lA1 = wave->a1Q14;
+    long lAmplitude = wave->amplitudeQ15;
+    long Sample;
+
+    if (rampDown) {
+        lAmplitude <<= 16;
+        if (count == 0) {
+            return;
+        }
+        long dec = lAmplitude / (long)count;
+        while (count) {
+            count--;
+            Sample = ((lA1 * lS1) >> 14) - lS2;
+            lS2 = lS1;
+            lS1 = Sample;
+            Sample = ((lAmplitude >> 16) * Sample) >> 15;
+            *(outBuffer++) += (int16_t)Sample;
+            lAmplitude -= dec;
+        }
+    } else {
+        while (count) {
+            count--;
+            Sample = ((lA1 * lS1) >> 14) - lS2;
+            lS2 = lS1;
+            lS1 = Sample;
+            Sample = (lAmplitude * Sample) >> 15;
+            *(outBuffer++) += (int16_t)Sample;
+        }
+    }
+    wave->s1 = lS1;
+    wave->s2 = lS2;
+}
+
+}  // namespace
+
+void generateTone(const std::vector<uint16_t>& frequencies, uint32_t sampleRate, float volume,
+                  bool reference, std::vector<int32_t> *output) {
+    const size_t blockSize = sampleRate / 50;  // 20 ms
+    constexpr size_t kNumBlocks = 10;
+    std::vector<ToneWave> waves;
+    for (uint16_t frequency : frequencies) {
+        waves.push_back(makeWave(sampleRate, frequency, volume));
+    }
+    std::vector<ToneWave *> wavePointers;
+    for (ToneWave& wave : waves) {
+        wavePointers.push_back(&wave);
+    }
+
+    output->assign(blockSize * (kNumBlocks + 1), 0);
+    for (size_t block = 0; block <= kNumBlocks; block++) {
+        int32_t *out = output->data() + block * blockSize;
+        const bool rampDown = block == kNumBlocks;
+        if (reference) {
+            for (ToneWave& wave : waves) {
+                referenceSamples(&wave, out, blockSize, rampDown);
+            }
+        } else {
+            synthesizeToneWaves(wavePointers.data(), wavePointers.size(), out, blockSize,
+                                rampDown);
+        }
+    }
+}
+
+}  // namespace android
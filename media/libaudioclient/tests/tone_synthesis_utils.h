@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_TONE_SYNTHESIS_UTILS_H
+#define ANDROID_TONE_SYNTHESIS_UTILS_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <media/ToneSynthesis.h>
+
+namespace android {
+
+// Returns a wave with the same parameters as ToneGenerator::WaveGenerator.
+ToneWave makeWave(uint32_t sampleRate, uint16_t frequency, float volume);
+
+// Generates a tone as ToneGenerator does: a few 20 ms blocks, then a ramp down. With
+// reference set, the waves are generated one at a time, as ToneGenerator did before they
+// were synthesized together.
+void generateTone(const std::vector<uint16_t>& frequencies, uint32_t sampleRate, float volume,
+                  bool reference, std::vector<int32_t> *output);
+
+}  // namespace android
+
+#endif  // ANDROID_TONE_SYNTHESIS_UTILS_H
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the AudioTrack shared memory protocol between two processes, without AudioFlinger.
+// The benchmark process writes bursts through an AudioTrackClientProxy, blocking when the
+// buffer is full. A child process reads them through an AudioTrackServerProxy as fast as it
+// can, or with a pause after each burst like a mixer thread. Each iteration writes one burst;
+// the futex syscalls of both sides and the context switches of the writer are reported per
+// burst.
+
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+
+#include <benchmark/benchmark.h>
+#include <private/media/AudioTrackShared.h>
+
+using namespace android;
+
+namespace {
+
+constexpr size_t kBurstFrames = 192;  // 4 ms at 48 kHz
+constexpr size_t kFrameSize = 4;      // stereo 16 bit
+constexpr uint32_t kSampleRate = 48000;
+constexpr struct timespec kTimeout = {1 /* tv_sec */, 0 /* tv_nsec */};
+
+// Start of the shared memory, the buffer comes next.
+struct SharedState {
+    audio_track_cblk_t cblk;
+    std::atomic<bool> stop{false};
+    std::atomic<int64_t> serverFutexSyscalls{0};
+};
+
+void runServer(SharedState* shared, size_t frameCount, useconds_t pauseUs) {
+    sp<AudioTrackServerProxy> proxy = new AudioTrackServerProxy(
+            &shared->cblk, shared + 1, frameCount, kFrameSize, false /* clientInServer */,
+            kSampleRate);
+    while (!shared->stop) {
+        Proxy::Buffer buffer;
+        buffer.mFrameCount = kBurstFrames;
+        if (proxy->obtainBuffer(&buffer) == NO_ERROR) {
+            proxy->releaseBuffer(&buffer);
+        }
+        if (pauseUs > 0) {
+            usleep(pauseUs);
+        } else {
+            sched_yield();
+        }
+    }
+    shared->serverFutexSyscalls = proxy->getFutexSyscallCount();
+}
+
+}  // namespace
+
+static void BM_WriteBurst(benchmark::State& state) {
+    const size_t frameCount = state.range(0) * kBurstFrames;
+    const useconds_t pauseUs = state.range(1);
+    const size_t size = sizeof(SharedState) + frameCount * kFrameSize;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                        -1 /* fd */, 0 /* offset */);
+    if (memory == MAP_FAILED) {
+        state.SkipWithError("mmap failed");
+        return;
+    }
+    SharedState* shared = new (memory) SharedState();
+    sp<AudioTrackClientProxy> proxy =
+            new AudioTrackClientProxy(&shared->cblk, shared + 1, frameCount, kFrameSize);
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        runServer(shared, frameCount, pauseUs);
+        _exit(0);
+    }
+    if (pid < 0) {
+        state.SkipWithError("fork failed");
+        munmap(memory, size);
+        return;
+    }
+
+    struct rusage before;
+    getrusage(RUSAGE_SELF, &before);
+    for (auto _ : state) {
+        size_t remaining = kBurstFrames;
+        while (remaining > 0) {
+            Proxy::Buffer buffer;
+            buffer.mFrameCount = remaining;
+            if (proxy->obtainBuffer(&buffer, &kTimeout) != NO_ERROR) {
+                break;
+            }
+            memset(buffer.mRaw, 0, buffer.mFrameCount * kFrameSize);
+            remaining -= buffer.mFrameCount;
+            proxy->releaseBuffer(&buffer);
+        }
+        if (remaining > 0) {
+            state.SkipWithError("obtainBuffer failed");
+            break;
+        }
+    }
+    struct rusage after;
+    getrusage(RUSAGE_SELF, &after);
+
+    shared->stop = true;
+    waitpid(pid, nullptr /* wstatus */, 0 /* options */);
+    state.counters["clientFutex"] = benchmark::Counter(
+            proxy->getFutexSyscallCount(), benchmark::Counter::kAvgIterations);
+    state.counters["serverFutex"] = benchmark::Counter(
+            shared->serverFutexSyscalls, benchmark::Counter::kAvgIterations);
+    state.counters["clientSwitches"] = benchmark::Counter(
+            after.ru_nvcsw - before.ru_nvcsw, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * kBurstFrames);
+
+    proxy.clear();
+    shared->~SharedState();
+    munmap(memory, size);
+}
+
+BENCHMARK(BM_WriteBurst)
+        ->ArgNames({"bursts", "pauseUs"})
+        ->Args({2, 0})
+        ->Args({2, 100})
+        ->Args({8, 0})
+        ->Args({8, 100})
+        ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the client and server proxies of AudioTrack and AudioRecord against each other on
+// several threads, over shared memory as between AudioFlinger and its clients. A wakeup lost
+// by the server leaves a client thread blocked until its timeout, so each blocking call is
+// timed. The count of client threads waiting on the futex must go back to 0.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "TrackProxyTests"
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <private/media/AudioTrackShared.h>
+
+using namespace android;
+
+namespace {
+
+constexpr size_t kBurstFrames = 96;
+constexpr size_t kFrameCount = 2 * kBurstFrames;
+constexpr size_t kFrameSize = sizeof(int32_t);  // each frame holds its index in the stream
+constexpr uint32_t kSampleRate = 48000;
+constexpr int32_t kNumFrames = 100000;
+constexpr size_t kNumTracks = 4;
+constexpr struct timespec kTimeout = {2 /* tv_sec */, 0 /* tv_nsec */};
+// The server never pauses for more than kMaxServerPauseUs, so a client that waits this long
+// has missed its wakeup and only returned on kTimeout.
+constexpr useconds_t kMaxServerPauseUs = 200;
+constexpr auto kMaxWait = std::chrono::milliseconds(500);
+
+using Clock = std::chrono::steady_clock;
+
+// A control block followed by its buffer, in memory that could be shared with another process.
+class SharedTrack {
+public:
+    SharedTrack() {
+        mMemory = mmap(nullptr, kSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                       -1 /* fd */, 0 /* offset */);
+        if (mMemory != MAP_FAILED) {
+            mCblk = new (mMemory) audio_track_cblk_t();
+        }
+    }
+
+    ~SharedTrack() {
+        if (mCblk != nullptr) {
+            mCblk->~audio_track_cblk_t();
+            munmap(mMemory, kSize);
+        }
+    }
+
+    audio_track_cblk_t* cblk() const { return mCblk; }
+    void* buffers() const { return mCblk + 1; }
+
+    // The client threads counted as waiting on the futex.
+    int32_t waiters() const {
+        return (android_atomic_acquire_load(&mCblk->mFutex) & ~CBLK_FUTEX_WAKE)
+                / CBLK_FUTEX_WAITER;
+    }
+
+private:
+    static constexpr size_t kSize = sizeof(audio_track_cblk_t) + kFrameCount * kFrameSize;
+
+    void* mMemory = MAP_FAILED;
+    audio_track_cblk_t* mCblk = nullptr;
+};
+
+// Longest blocking call of the client threads, and errors of all the threads.
+struct Results {
+    std::atomic<int64_t> maxWaitNs{0};
+    std::atomic<int> numErrors{0};
+
+    template <typename Call>
+    status_t timed(Call&& call) {
+        const Clock::time_point begin = Clock::now();
+        const status_t status = call();
+        const int64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - begin).count();
+        int64_t maxWaitNs = this->maxWaitNs;
+        while (waitNs > maxWaitNs && !this->maxWaitNs.compare_exchange_weak(maxWaitNs, waitNs)) {}
+        return status;
+    }
+
+    void expectNoLostWakeup() const {
+        EXPECT_EQ(0, numErrors.load());
+        EXPECT_LT(maxWaitNs.load(), std::chrono::nanoseconds(kMaxWait).count());
+    }
+};
+
+// The server side runs like a mixer or record thread: it takes what is there, then yields
+// or sleeps for a while.
+void serverPause(std::minstd_rand& rng) {
+    if (rng() % 2 == 0) {
+        sched_yield();
+    } else {
+        usleep(rng() % kMaxServerPauseUs);
+    }
+}
+
+// Writes kNumFrames through the client proxy, blocking while the buffer is full.
+void writeFrames(ClientProxy* proxy, Results* results) {
+    for (int32_t next = 0; next < kNumFrames;) {
+        Proxy::Buffer buffer;
+        buffer.mFrameCount = std::min<size_t>(kBurstFrames, kNumFrames - next);
+        if (results->timed([&] { return proxy->obtainBuffer(&buffer, &kTimeout); })
+                != NO_ERROR) {
+            results->numErrors++;
+            return;
+        }
+        int32_t* frames = static_cast<int32_t*>(buffer.mRaw);
+        for (size_t i = 0; i < buffer.mFrameCount; i++) {
+            frames[i] = next++;
+        }
+        proxy->releaseBuffer(&buffer);
+    }
+}
+
+// Reads kNumFrames through the client proxy, blocking while the buffer is empty.
+void readFrames(ClientProxy* proxy, Results* results) {
+    for (int32_t next = 0; next < kNumFrames;) {
+        Proxy::Buffer buffer;
+        buffer.mFrameCount = kBurstFrames;
+        if (results->timed([&] { return proxy->obtainBuffer(&buffer, &kTimeout); })
+                != NO_ERROR) {
+            results->numErrors++;
+            return;
+        }
+        const int32_t* frames = static_cast<const int32_t*>(buffer.mRaw);
+        for (size_t i = 0; i < buffer.mFrameCount; i++) {
+            if (frames[i] != next++) {
+                results->numErrors++;
+            }
+        }
+        proxy->releaseBuffer(&buffer);
+    }
+}
+
+// Drains kNumFrames through the server proxy of a track, without blocking.
+void drainFrames(ServerProxy* proxy, unsigned seed, Results* results) {
+    std::minstd_rand rng(seed);
+    for (int32_t next = 0; next < kNumFrames;) {
+        Proxy::Buffer buffer;
+        buffer.mFrameCount = kBurstFrames;
+        if (proxy->obtainBuffer(&buffer) == NO_ERROR) {
+            const int32_t* frames = static_cast<const int32_t*>(buffer.mRaw);
+            for (size_t i = 0; i < buffer.mFrameCount; i++) {
+                if (frames[i] != next++) {
+                    results->numErrors++;
+                }
+            }
+            proxy->releaseBuffer(&buffer);
+        }
+        serverPause(rng);
+    }
+}
+
+// Fills kNumFrames through the server proxy of a record, without blocking.
+void fillFrames(ServerProxy* proxy, unsigned seed) {
+    std::minstd_rand rng(seed);
+    for (int32_t next = 0; next < kNumFrames;) {
+        Proxy::Buffer buffer;
+        buffer.mFrameCount = std::min<size_t>(kBurstFrames, kNumFrames - next);
+        if (proxy->obtainBuffer(&buffer) == NO_ERROR) {
+            int32_t* frames = static_cast<int32_t*>(buffer.mRaw);
+            for (size_t i = 0; i < buffer.mFrameCount; i++) {
+                frames[i] = next++;
+            }
+            proxy->releaseBuffer(&buffer);
+        }
+        serverPause(rng);
+    }
+}
+
+}  // namespace
+
+// Several tracks are played at once, each with a writer blocking on a full buffer.
+TEST(TrackProxyTest, PlaybackWakesBlockedWriters) {
+    std::vector<std::unique_ptr<SharedTrack>> tracks;
+    std::vector<std::thread> threads;
+    Results results;
+    for (size_t t = 0; t < kNumTracks; t++) {
+        ASSERT_NE(nullptr, tracks.emplace_back(std::make_unique<SharedTrack>())->cblk());
+    }
+    for (size_t t = 0; t < kNumTracks; t++) {
+        const auto& track = tracks[t];
+        sp<AudioTrackServerProxy> server = new AudioTrackServerProxy(
+                track->cblk(), track->buffers(), kFrameCount, kFrameSize,
+                false /* clientInServer */, kSampleRate);
+        sp<AudioTrackClientProxy> client = new AudioTrackClientProxy(
+                track->cblk(), track->buffers(), kFrameCount, kFrameSize);
+        threads.emplace_back([client, &results] { writeFrames(client.get(), &results); });
+        threads.emplace_back([server, t, &results] { drainFrames(server.get(), t, &results); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    results.expectNoLostWakeup();
+    for (const auto& track : tracks) {
+        EXPECT_EQ(0, track->waiters());
+    }
+}
+
+// Several records are captured at once, each with a reader blocking on an empty buffer.
+TEST(TrackProxyTest, CaptureWakesBlockedReaders) {
+    std::vector<std::unique_ptr<SharedTrack>> tracks;
+    std::vector<std::thread> threads;
+    Results results;
+    for (size_t t = 0; t < kNumTracks; t++) {
+        ASSERT_NE(nullptr, tracks.emplace_back(std::make_unique<SharedTrack>())->cblk());
+    }
+    for (size_t t = 0; t < kNumTracks; t++) {
+        const auto& track = tracks[t];
+        sp<AudioRecordServerProxy> server = new AudioRecordServerProxy(
+                track->cblk(), track->buffers(), kFrameCount, kFrameSize,
+                false /* clientInServer */);
+        sp<AudioRecordClientProxy> client = new AudioRecordClientProxy(
+                track->cblk(), track->buffers(), kFrameCount, kFrameSize);
+        threads.emplace_back([client, &results] { readFrames(client.get(), &results); });
+        threads.emplace_back([server, t] { fillFrames(server.get(), t); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    results.expectNoLostWakeup();
+    for (const auto& track : tracks) {
+        EXPECT_EQ(0, track->waiters());
+    }
+}
+
+// Two client threads wait on the same track, as when an application drains an offloaded
+// track while its callback thread writes: one for room in the buffer, one for the stream end.
+TEST(TrackProxyTest, StreamEndWakesItsWaiter) {
+    constexpr int kNumStreamEnds = 200;
+    SharedTrack track;
+    ASSERT_NE(nullptr, track.cblk());
+    sp<AudioTrackServerProxy> server = new AudioTrackServerProxy(
+            track.cblk(), track.buffers(), kFrameCount, kFrameSize,
+            false /* clientInServer */, kSampleRate);
+    sp<AudioTrackClientProxy> client = new AudioTrackClientProxy(
+            track.cblk(), track.buffers(), kFrameCount, kFrameSize);
+    Results results;
+    std::atomic<int> numSignaled{0};
+    std::atomic<int> numReceived{0};
+
+    std::thread writer([&] { writeFrames(client.get(), &results); });
+    std::thread drainer([&] {
+        while (numReceived < kNumStreamEnds) {
+            if (results.timed([&] { return client->waitStreamEndDone(&kTimeout); })
+                    != NO_ERROR) {
+                results.numErrors++;
+                return;
+            }
+            numReceived++;
+        }
+    });
+    // The stream end flag is consumed by the drainer, so it is only set again once the
+    // previous one was received.
+    std::minstd_rand rng(kNumTracks);
+    for (int32_t next = 0; next < kNumFrames || numReceived < kNumStreamEnds;) {
+        Proxy::Buffer buffer;
+        buffer.mFrameCount = kBurstFrames;
+        if (next < kNumFrames && server->obtainBuffer(&buffer) == NO_ERROR) {
+            next += buffer.mFrameCount;
+            server->releaseBuffer(&buffer);
+        }
+        if (numSignaled < kNumStreamEnds && numSignaled == numReceived) {
+            numSignaled++;
+            server->setStreamEndDone();
+        }
+        if (results.numErrors > 0) {
+            break;
+        }
+        serverPause(rng);
+    }
+    writer.join();
+    drainer.join();
+
+    results.expectNoLostWakeup();
+    EXPECT_EQ(kNumStreamEnds, numReceived.load());
+    EXPECT_EQ(0, track.waiters());
+}
+
+// Invalidating a track wakes all its client threads at once, and their count stays right.
+TEST(TrackProxyTest, InvalidationWakesAllWaiters) {
+    constexpr size_t kNumWaiters = 4;
+    SharedTrack track;
+    ASSERT_NE(nullptr, track.cblk());
+    sp<AudioRecordServerProxy> server = new AudioRecordServerProxy(
+            track.cblk(), track.buffers(), kFrameCount, kFrameSize,
+            false /* clientInServer */);
+    std::vector<sp<AudioRecordClientProxy>> clients;
+    std::vector<std::thread> threads;
+    Results results;
+    std::atomic<int> numInvalidated{0};
+    for (size_t i = 0; i < kNumWaiters; i++) {
+        // The proxies of one control block do not share their state, so each thread has one.
+        clients.push_back(new AudioRecordClientProxy(
+                track.cblk(), track.buffers(), kFrameCount, kFrameSize));
+        threads.emplace_back([client = clients.back(), &results, &numInvalidated] {
+            Proxy::Buffer buffer;
+            buffer.mFrameCount = kBurstFrames;
+            if (results.timed([&] { return client->obtainBuffer(&buffer, &kTimeout); })
+                    == DEAD_OBJECT) {
+                numInvalidated++;
+            }
+        });
+    }
+    // Give the clients time to block, although some may only check the flag afterwards.
+    for (int i = 0; i < 100 && track.waiters() < (int32_t) kNumWaiters; i++) {
+        usleep(1000);
+    }
+    server->signalClientFlag(CBLK_INVALID);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    results.expectNoLostWakeup();
+    EXPECT_EQ((int) kNumWaiters, numInvalidated.load());
+    EXPECT_EQ(0, track.waiters());
+}
@@ -21,6 +21,7 @@
 #include <cstdint>
 
 #include <audio_utils/clock.h>
+#include <cutils/properties.h>
 #include <media/AidlConversion.h>
 #include <media/AidlConversionCore.h>
 #include <media/AidlConversionCppNdk.h>
@@ -30,6 +31,7 @@
 #include <mediautils/TimeCheck.h>
 #include <system/audio.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
 #include "DeviceHalAidl.h"
 #include "EffectHalAidl.h"
@@ -56,8 +58,19 @@ template<HalCommand::Tag cmd> HalCommand makeHalCommand() {
 template<HalCommand::Tag cmd, typename T> HalCommand makeHalCommand(T data) {
     return HalCommand::make<cmd>(data);
 }
+
+// How long the position and latency from the last reply can be reused while the stream
+// is not transferring data. The position comes with its own timestamp, so an older
+// reply is still consistent, only less recent.
+constexpr int32_t kDefaultCountersMaxAgeMs = 2;
 }  // namespace
 
+// static
+int64_t StreamHalAidl::getCountersMaxAgeNs() {
+    return property_get_int32("audio.hal.counters_max_age_ms", kDefaultCountersMaxAgeMs)
+            * NANOS_PER_MILLISECOND;
+}
+
 // static
 template<class T>
 std::shared_ptr<IStreamCommon> StreamHalAidl::getStreamCommon(const std::shared_ptr<T>& stream) {
@@ -76,13 +89,14 @@ StreamHalAidl::StreamHalAidl(
         std::string_view className, bool isInput, const audio_config& config,
         int32_t nominalLatency, StreamContextAidl&& context,
         const std::shared_ptr<IStreamCommon>& stream,
-        const std::shared_ptr<IHalAdapterVendorExtension>& vext)
+        const std::shared_ptr<IHalAdapterVendorExtension>& vext, int64_t countersMaxAgeNs)
         : ConversionHelperAidl(className),
           mIsInput(isInput),
           mConfig(configToBase(config)),
           mContext(std::move(context)),
           mStream(stream),
-          mVendorExt(vext) {
+          mVendorExt(vext),
+          mCountersMaxAgeNs(countersMaxAgeNs) {
     ALOGD("%p %s::%s", this, getClassName().c_str(), __func__);
     {
         std::lock_guard l(mLock);
@@ -284,7 +298,10 @@ status_t StreamHalAidl::getHardwarePosition(int64_t *frames, int64_t *timestamp)
     if (!mStream) return NO_INIT;
     StreamDescriptor::Reply reply;
     // TODO: switch to updateCountersIfNeeded once we sort out mWorkerTid initialization
-    RETURN_STATUS_IF_ERROR(sendCommand(makeHalCommand<HalCommand::Tag::getStatus>(), &reply, true));
+    if (!getRecentReply(&reply)) {
+        RETURN_STATUS_IF_ERROR(
+                sendCommand(makeHalCommand<HalCommand::Tag::getStatus>(), &reply, true));
+    }
     *frames = std::max<int64_t>(0, reply.hardware.frames);
     *timestamp = std::max<int64_t>(0, reply.hardware.timeNs);
     return OK;
@@ -485,6 +502,8 @@ status_t StreamHalAidl::sendCommand(
             reply->latencyMs = mLastReply.latencyMs;
         }
         mLastReply = *reply;
+        // A failed reply does not carry valid counters, and must not be reused for them.
+        mLastReplyTimeNs = reply->status == STATUS_OK ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
     }
     switch (reply->status) {
         case STATUS_OK: return OK;
@@ -498,12 +517,28 @@ status_t StreamHalAidl::sendCommand(
     }
 }
 
+bool StreamHalAidl::getRecentReply(
+        ::aidl::android::hardware::audio::core::StreamDescriptor::Reply* reply) {
+    std::lock_guard l(mLock);
+    if (mLastReplyTimeNs == 0 ||
+            systemTime(SYSTEM_TIME_MONOTONIC) - mLastReplyTimeNs > mCountersMaxAgeNs) {
+        return false;
+    }
+    if (reply != nullptr) {
+        *reply = mLastReply;
+    }
+    return true;
+}
+
 status_t StreamHalAidl::updateCountersIfNeeded(
         ::aidl::android::hardware::audio::core::StreamDescriptor::Reply* reply) {
+    // While the stream is transferring, every 'transfer' call refreshes the last reply.
+    // Otherwise the getters called in the same cycle share one 'getStatus' exchange.
     if (mWorkerTid.load(std::memory_order_acquire) == gettid()) {
         if (const auto state = getState(); state != StreamDescriptor::State::ACTIVE &&
                 state != StreamDescriptor::State::DRAINING &&
                 state != StreamDescriptor::State::TRANSFERRING) {
+            if (getRecentReply(reply)) return OK;
             return sendCommand(makeHalCommand<HalCommand::Tag::getStatus>(), reply);
         }
     }
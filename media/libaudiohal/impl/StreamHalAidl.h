@@ -201,7 +201,8 @@ class StreamHalAidl : public virtual StreamHalInterface, public ConversionHelper
             int32_t nominalLatency,
             StreamContextAidl&& context,
             const std::shared_ptr<::aidl::android::hardware::audio::core::IStreamCommon>& stream,
-            const std::shared_ptr<::aidl::android::media::audio::IHalAdapterVendorExtension>& vext);
+            const std::shared_ptr<::aidl::android::media::audio::IHalAdapterVendorExtension>& vext,
+            int64_t countersMaxAgeNs = getCountersMaxAgeNs());
 
     ~StreamHalAidl() override;
 
@@ -254,11 +255,17 @@ class StreamHalAidl : public virtual StreamHalInterface, public ConversionHelper
             bool safeFromNonWorkerThread = false);
     status_t updateCountersIfNeeded(
             ::aidl::android::hardware::audio::core::StreamDescriptor::Reply* reply = nullptr);
+    // Reads the 'audio.hal.counters_max_age_ms' property.
+    static int64_t getCountersMaxAgeNs();
+    // Copies the last reply if it was OK and received within the last 'mCountersMaxAgeNs'.
+    bool getRecentReply(::aidl::android::hardware::audio::core::StreamDescriptor::Reply* reply);
 
     const std::shared_ptr<::aidl::android::hardware::audio::core::IStreamCommon> mStream;
     const std::shared_ptr<::aidl::android::media::audio::IHalAdapterVendorExtension> mVendorExt;
+    const int64_t mCountersMaxAgeNs;
     std::mutex mLock;
     ::aidl::android::hardware::audio::core::StreamDescriptor::Reply mLastReply GUARDED_BY(mLock);
+    int64_t mLastReplyTimeNs GUARDED_BY(mLock) = 0;
     // mStreamPowerLog is used for audio signal power logging.
     StreamPowerLog mStreamPowerLog;
     std::atomic<pid_t> mWorkerTid = -1;
@@ -14,8 +14,11 @@
  * limitations under the License.
  */
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #define LOG_TAG "CoreAudioHalAidlTest"
@@ -27,7 +30,9 @@
 #include <aidl/android/hardware/audio/core/BnStreamCommon.h>
 #include <aidl/android/media/audio/BnHalAdapterVendorExtension.h>
 #include <aidl/android/media/audio/common/Int.h>
+#include <audio_utils/clock.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
 namespace {
 
@@ -605,3 +610,221 @@ TEST_F(StreamHalAidlVendorParametersTest, SetInvalidVendorParameters) {
     EXPECT_EQ(0UL, mStreamCommon->getAsyncParameters().size());
     EXPECT_EQ(0UL, mStreamCommon->getSyncParameters().size());
 }
+
+namespace {
+
+using ::aidl::android::hardware::audio::core::StreamDescriptor;
+
+constexpr int32_t kLoopbackLatencyMs = 20;
+constexpr size_t kLoopbackFrameSizeBytes = 4;
+constexpr size_t kLoopbackBufferSizeFrames = 960;
+
+// Serves the stream FMQs like a HAL module worker and counts the command/reply exchanges.
+// Written data is consumed right away.
+class StreamWorkerLoopback {
+  public:
+    StreamWorkerLoopback()
+        : mCommandMQ(1, true /*configureEventFlagWord*/),
+          mReplyMQ(1, true /*configureEventFlagWord*/),
+          mDataMQ(kLoopbackFrameSizeBytes * kLoopbackBufferSizeFrames) {}
+    ~StreamWorkerLoopback() { stop(); }
+
+    StreamDescriptor getDescriptor() {
+        StreamDescriptor descriptor;
+        descriptor.command = mCommandMQ.dupeDesc();
+        descriptor.reply = mReplyMQ.dupeDesc();
+        descriptor.frameSizeBytes = kLoopbackFrameSizeBytes;
+        descriptor.bufferSizeFrames = kLoopbackBufferSizeFrames;
+        descriptor.audio.set<StreamDescriptor::AudioBuffer::Tag::fmq>(mDataMQ.dupeDesc());
+        return descriptor;
+    }
+    void start() {
+        mThread = std::thread([this] { loop(); });
+    }
+    void stop() {
+        mStop = true;
+        if (mThread.joinable()) mThread.join();
+    }
+    int getRoundTrips() const { return mRoundTrips; }
+    // The next command fails, with a reply that carries no counters.
+    void failNextCommand() { mFailNextCommand = true; }
+
+  private:
+    void loop() {
+        std::vector<int8_t> data(mDataMQ.getQuantumCount());
+        while (!mStop) {
+            StreamDescriptor::Command command;
+            if (!mCommandMQ.readBlocking(&command, 1, 10 * NANOS_PER_MILLISECOND)) continue;
+            ++mRoundTrips;
+            StreamDescriptor::Reply reply;
+            if (mFailNextCommand.exchange(false)) {
+                reply.status = STATUS_INVALID_OPERATION;
+                reply.state = mState;
+                mReplyMQ.writeBlocking(&reply, 1);
+                continue;
+            }
+            reply.status = STATUS_OK;
+            switch (command.getTag()) {
+                case StreamDescriptor::Command::Tag::start:
+                    mState = StreamDescriptor::State::IDLE;
+                    break;
+                case StreamDescriptor::Command::Tag::burst: {
+                    const size_t bytes = mDataMQ.availableToRead();
+                    if (bytes != 0 && mDataMQ.read(data.data(), bytes)) {
+                        mFrames += bytes / kLoopbackFrameSizeBytes;
+                    }
+                    reply.fmqByteCount = bytes;
+                    mState = StreamDescriptor::State::ACTIVE;
+                    break;
+                }
+                case StreamDescriptor::Command::Tag::pause:
+                    mState = StreamDescriptor::State::PAUSED;
+                    break;
+                case StreamDescriptor::Command::Tag::standby:
+                    mState = StreamDescriptor::State::STANDBY;
+                    break;
+                default:
+                    break;
+            }
+            reply.observable.frames = mFrames;
+            reply.observable.timeNs = systemTime(SYSTEM_TIME_MONOTONIC);
+            reply.hardware = reply.observable;
+            reply.latencyMs = kLoopbackLatencyMs;
+            reply.state = mState;
+            mReplyMQ.writeBlocking(&reply, 1);
+        }
+    }
+
+    StreamContextAidl::CommandMQ mCommandMQ;
+    StreamContextAidl::ReplyMQ mReplyMQ;
+    StreamContextAidl::DataMQ mDataMQ;
+    std::thread mThread;
+    std::atomic<bool> mStop = false;
+    std::atomic<int> mRoundTrips = 0;
+    std::atomic<bool> mFailNextCommand = false;
+    StreamDescriptor::State mState = StreamDescriptor::State::STANDBY;
+    int64_t mFrames = 0;
+};
+
+}  // namespace
+
+// Exposes the protected stream operations that the output and input streams build on.
+class StreamHalAidlLoopback : public StreamHalAidl {
+  public:
+    StreamHalAidlLoopback(StreamDescriptor& descriptor,
+                          const std::shared_ptr<StreamCommonMock>& streamCommon,
+                          int64_t countersMaxAgeNs)
+        : StreamHalAidl("loopback", false /*isInput*/, makeConfig(), kLoopbackLatencyMs,
+                        StreamContextAidl(descriptor, false /*isAsynchronous*/), streamCommon,
+                        nullptr /*vext*/, countersMaxAgeNs) {}
+
+    using StreamHalAidl::getHardwarePosition;
+    using StreamHalAidl::getLatency;
+    using StreamHalAidl::getObservablePosition;
+    using StreamHalAidl::pause;
+    using StreamHalAidl::transfer;
+
+  private:
+    static audio_config makeConfig() {
+        audio_config config = AUDIO_CONFIG_INITIALIZER;
+        config.sample_rate = 48000;
+        config.channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+        config.format = AUDIO_FORMAT_PCM_16_BIT;
+        return config;
+    }
+};
+
+class StreamHalAidlCountersTest : public testing::Test {
+  public:
+    void TearDown() override {
+        mWorker.stop();
+        mStream.clear();
+        mStreamCommon.reset();
+    }
+
+  protected:
+    // Creates the stream with the given window for reusing a reply, and starts the worker.
+    void createStream(int64_t countersMaxAgeNs) {
+        mStreamCommon = ndk::SharedRefBase::make<StreamCommonMock>();
+        StreamDescriptor descriptor = mWorker.getDescriptor();
+        mStream = sp<StreamHalAidlLoopback>::make(descriptor, mStreamCommon, countersMaxAgeNs);
+        mWorker.start();
+    }
+
+
+    // The calls a playback thread makes to the stream in one mixer cycle,
+    // returns the number of FMQ round trips they took.
+    int mixerCycle(bool transfer) {
+        const int roundTrips = mWorker.getRoundTrips();
+        if (transfer) {
+            size_t transferred = 0;
+            EXPECT_EQ(OK, mStream->transfer(mBuffer, sizeof(mBuffer), &transferred));
+        }
+        uint32_t latency = 0;
+        int64_t frames = 0, timestamp = 0;
+        EXPECT_EQ(OK, mStream->getLatency(&latency));
+        EXPECT_EQ(static_cast<uint32_t>(kLoopbackLatencyMs), latency);
+        EXPECT_EQ(OK, mStream->getObservablePosition(&frames, &timestamp));  // render position
+        EXPECT_EQ(OK, mStream->getObservablePosition(&frames, &timestamp));  // presentation
+        return mWorker.getRoundTrips() - roundTrips;
+    }
+
+    StreamWorkerLoopback mWorker;
+    std::shared_ptr<StreamCommonMock> mStreamCommon;
+    sp<StreamHalAidlLoopback> mStream;
+    int8_t mBuffer[kLoopbackFrameSizeBytes * 240] = {};
+};
+
+TEST_F(StreamHalAidlCountersTest, ActiveStreamUsesTransferReply) {
+    createStream(100 * NANOS_PER_MILLISECOND);
+    mixerCycle(true /*transfer*/);  // Takes the stream out of standby.
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(1, mixerCycle(true /*transfer*/));
+    }
+}
+
+// Without reuse, every getter exchanges a 'getStatus' command.
+TEST_F(StreamHalAidlCountersTest, PausedStreamWithoutReuse) {
+    createStream(0);
+    mixerCycle(true /*transfer*/);
+    ASSERT_EQ(OK, mStream->pause());
+    EXPECT_EQ(3, mixerCycle(false /*transfer*/));
+}
+
+// With reuse, the getters share the reply until it gets too old.
+TEST_F(StreamHalAidlCountersTest, PausedStreamSharesStatusReply) {
+    createStream(100 * NANOS_PER_MILLISECOND);
+    mixerCycle(true /*transfer*/);
+    ASSERT_EQ(OK, mStream->pause());
+    EXPECT_EQ(0, mixerCycle(false /*transfer*/));
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_EQ(1, mixerCycle(false /*transfer*/));
+}
+
+// A failed reply carries no counters, so the position is queried again rather than
+// taken from it, and does not go back to 0.
+TEST_F(StreamHalAidlCountersTest, FailedReplyIsNotReused) {
+    createStream(100 * NANOS_PER_MILLISECOND);
+    mixerCycle(true /*transfer*/);
+    ASSERT_EQ(OK, mStream->pause());
+    int64_t frames = 0, timestamp = 0;
+    ASSERT_EQ(OK, mStream->getObservablePosition(&frames, &timestamp));
+    const int64_t pausedFrames = frames;
+    ASSERT_GT(pausedFrames, 0);
+
+    mWorker.failNextCommand();
+    EXPECT_NE(OK, mStream->pause());
+
+    int roundTrips = mWorker.getRoundTrips();
+    EXPECT_EQ(OK, mStream->getObservablePosition(&frames, &timestamp));
+    EXPECT_EQ(pausedFrames, frames);
+    EXPECT_EQ(1, mWorker.getRoundTrips() - roundTrips);
+
+    mWorker.failNextCommand();
+    EXPECT_NE(OK, mStream->pause());
+
+    roundTrips = mWorker.getRoundTrips();
+    EXPECT_EQ(OK, mStream->getHardwarePosition(&frames, &timestamp));
+    EXPECT_EQ(pausedFrames, frames);
+    EXPECT_EQ(1, mWorker.getRoundTrips() - roundTrips);
+}
@@ -19,6 +19,8 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
 #include <utils/Log.h>
 #include <cutils/properties.h>
 
@@ -30,6 +32,7 @@
 #include <media/IMediaHTTPService.h>
 #include <media/stagefright/MediaCodecConstants.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MediaCodecList.h>
 #include <media/stagefright/MediaDefs.h>
@@ -42,16 +45,31 @@
 
 namespace android {
 
+// Default size in bytes of the extracted frames kept for repeated requests of the same frame.
+// Frames larger than the cache are not kept.
+static const int32_t kDefaultFrameCacheBytes = 8 * 1024 * 1024;
+
+// The warm decoder and the frame cache are released after this long without a frame request.
+static const int64_t kFrameSessionIdleTimeoutUs = 1000000LL;
+
 StagefrightMetadataRetriever::StagefrightMetadataRetriever()
     : mParsedMetaData(false),
       mAlbumArt(NULL),
-      mLastDecodedIndex(-1) {
+      mLastDecodedIndex(-1),
+      mFrameDecoderColorFormat(0),
+      mFrameCacheBytes(0),
+      mFrameSessionGeneration(0) {
     ALOGV("StagefrightMetadataRetriever()");
 }
 
 StagefrightMetadataRetriever::~StagefrightMetadataRetriever() {
     ALOGV("~StagefrightMetadataRetriever()");
     clearMetadata();
+    if (mFrameSessionLooper != NULL) {
+        mFrameSessionLooper->stop();
+        mFrameSessionLooper->unregisterHandler(mReflector->id());
+    }
+    clearFrameSession();
     if (mSource != NULL) {
         mSource->close();
     }
@@ -64,6 +82,7 @@ status_t StagefrightMetadataRetriever::setDataSource(
     ALOGV("setDataSource(%s)", uri);
 
     clearMetadata();
+    clearFrameSession();
     mSource = PlayerServiceDataSourceFactory::getInstance()->CreateFromURI(
             httpService, uri, headers);
 
@@ -93,6 +112,7 @@ status_t StagefrightMetadataRetriever::setDataSource(
     ALOGV("setDataSource(%d, %" PRId64 ", %" PRId64 ")", fd, offset, length);
 
     clearMetadata();
+    clearFrameSession();
     mSource = new PlayerServiceFileSource(fd, offset, length);
 
     status_t err;
@@ -118,6 +138,7 @@ status_t StagefrightMetadataRetriever::setDataSource(
     ALOGV("setDataSource(DataSource)");
 
     clearMetadata();
+    clearFrameSession();
     mSource = source;
     mExtractor = MediaExtractorFactory::Create(mSource, mime);
 
@@ -157,6 +178,7 @@ sp<IMemory> StagefrightMetadataRetriever::getImageInternal(
         int index, int colorFormat, bool metaOnly, bool thumbnail, FrameRect* rect) {
     mDecoder.clear();
     mLastDecodedIndex = -1;
+    clearFrameSession();
 
     if (mExtractor.get() == NULL) {
         ALOGE("no extractor.");
@@ -334,6 +356,32 @@ sp<IMemory> StagefrightMetadataRetriever::getFrameInternal(
     mDecoder.clear();
     mLastDecodedIndex = -1;
 
+    // Thumbnail requests for nearby timestamps (e.g. while scrolling a gallery) reuse the
+    // decoder of the previous request instead of instantiating and configuring a new codec.
+    const bool reuseDecoder = !metaOnly
+            && option != MediaSource::ReadOptions::SEEK_FRAME_INDEX
+            && property_get_bool("media.stagefright.thumbnail.reuse_decoder", true);
+    if (reuseDecoder) {
+        sp<IMemory> frame = getCachedFrame(timeUs, option, colorFormat);
+        if (frame != nullptr) {
+            ALOGV("getFrameInternal: returning cached frame at %" PRId64 " us", timeUs);
+            return frame;
+        }
+        sp<FrameDecoder> decoder = takeFrameDecoder(colorFormat);
+        if (decoder != NULL && decoder->seekTo(timeUs, option) == OK) {
+            frame = decoder->extractFrame();
+            if (frame != nullptr) {
+                keepFrameDecoder(decoder, colorFormat);
+                cacheFrame(timeUs, option, colorFormat, frame);
+                return frame;
+            }
+        }
+        // the track source is released with the decoder before a new decoder is
+        // instantiated on it
+    } else {
+        clearFrameSession();
+    }
+
     if (mExtractor.get() == NULL) {
         ALOGE("no extractor.");
         return NULL;
@@ -424,6 +472,9 @@ sp<IMemory> StagefrightMetadataRetriever::getFrameInternal(
                 if (option == MediaSource::ReadOptions::SEEK_FRAME_INDEX) {
                     mDecoder = decoder;
                     mLastDecodedIndex = timeUs;
+                } else if (reuseDecoder) {
+                    keepFrameDecoder(decoder, colorFormat);
+                    cacheFrame(timeUs, option, colorFormat, frame);
                 }
                 return frame;
             }
@@ -435,6 +486,113 @@ sp<IMemory> StagefrightMetadataRetriever::getFrameInternal(
     return NULL;
 }
 
+sp<IMemory> StagefrightMetadataRetriever::getCachedFrame(
+        int64_t timeUs, int option, int colorFormat) {
+    std::lock_guard<std::mutex> lock(mFrameSessionLock);
+    for (auto it = mFrameCache.begin(); it != mFrameCache.end(); ++it) {
+        if (it->timeUs == timeUs && it->option == option && it->colorFormat == colorFormat) {
+            mFrameCache.splice(mFrameCache.begin(), mFrameCache, it);
+            scheduleFrameSessionRelease_l();
+            return mFrameCache.front().frame;
+        }
+    }
+    return NULL;
+}
+
+void StagefrightMetadataRetriever::cacheFrame(
+        int64_t timeUs, int option, int colorFormat, const sp<IMemory> &frame) {
+    const size_t maxBytes = std::max(property_get_int32(
+            "media.stagefright.thumbnail.cache_bytes", kDefaultFrameCacheBytes), 0);
+    const size_t frameBytes = frame->size();
+    std::lock_guard<std::mutex> lock(mFrameSessionLock);
+    if (frameBytes > maxBytes) {
+        return;
+    }
+    mFrameCache.push_front({timeUs, option, colorFormat, frame});
+    mFrameCacheBytes += frameBytes;
+    while (mFrameCacheBytes > maxBytes) {
+        mFrameCacheBytes -= mFrameCache.back().frame->size();
+        mFrameCache.pop_back();
+    }
+    scheduleFrameSessionRelease_l();
+}
+
+sp<FrameDecoder> StagefrightMetadataRetriever::takeFrameDecoder(int colorFormat) {
+    sp<FrameDecoder> decoder;
+    int decoderColorFormat;
+    {
+        std::lock_guard<std::mutex> lock(mFrameSessionLock);
+        decoder = std::move(mFrameDecoder);
+        decoderColorFormat = mFrameDecoderColorFormat;
+    }
+    if (colorFormat != decoderColorFormat) {
+        return NULL;  // releases the decoder
+    }
+    return decoder;
+}
+
+void StagefrightMetadataRetriever::keepFrameDecoder(
+        const sp<FrameDecoder> &decoder, int colorFormat) {
+    sp<FrameDecoder> previous;
+    std::lock_guard<std::mutex> lock(mFrameSessionLock);
+    previous = mFrameDecoder;  // released after the lock
+    mFrameDecoder = decoder;
+    mFrameDecoderColorFormat = colorFormat;
+    scheduleFrameSessionRelease_l();
+}
+
+void StagefrightMetadataRetriever::scheduleFrameSessionRelease_l() {
+    if (mFrameSessionLooper == NULL) {
+        mFrameSessionLooper = new ALooper;
+        mFrameSessionLooper->setName("thumbnail_idle");
+        mFrameSessionLooper->start();
+        mReflector = new AHandlerReflector<StagefrightMetadataRetriever>(this);
+        mFrameSessionLooper->registerHandler(mReflector);
+    }
+    // a release posted for an earlier request is ignored
+    sp<AMessage> msg = new AMessage(kWhatReleaseFrameSession, mReflector);
+    msg->setInt32("generation", ++mFrameSessionGeneration);
+    msg->post(kFrameSessionIdleTimeoutUs);
+}
+
+void StagefrightMetadataRetriever::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatReleaseFrameSession:
+        {
+            int32_t generation;
+            CHECK(msg->findInt32("generation", &generation));
+            sp<FrameDecoder> decoder;
+            std::list<CachedFrame> frames;
+            {
+                std::lock_guard<std::mutex> lock(mFrameSessionLock);
+                if (generation != mFrameSessionGeneration) {
+                    break;
+                }
+                ALOGV("releasing idle frame session");
+                // the codec is released outside of the lock
+                decoder = std::move(mFrameDecoder);
+                frames.swap(mFrameCache);
+                mFrameCacheBytes = 0;
+            }
+            break;
+        }
+
+        default:
+            TRESPASS();
+    }
+}
+
+void StagefrightMetadataRetriever::clearFrameSession() {
+    sp<FrameDecoder> decoder;
+    std::list<CachedFrame> frames;
+    std::lock_guard<std::mutex> lock(mFrameSessionLock);
+    decoder = std::move(mFrameDecoder);
+    frames.swap(mFrameCache);
+    mFrameCacheBytes = 0;
+    // also cancels a pending release
+    ++mFrameSessionGeneration;
+}
+
 MediaAlbumArt *StagefrightMetadataRetriever::extractAlbumArt() {
     ALOGV("extractAlbumArt (extractor: %s)", mExtractor.get() != NULL ? "YES" : "NO");
 
@@ -21,10 +21,15 @@
 #include <android/IMediaExtractor.h>
 #include <media/MediaMetadataRetrieverInterface.h>
 
+#include <media/stagefright/foundation/AHandlerReflector.h>
 #include <utils/KeyedVector.h>
 
+#include <list>
+#include <mutex>
+
 namespace android {
 
+struct ALooper;
 class DataSource;
 struct FrameDecoder;
 struct FrameRect;
@@ -53,7 +58,14 @@ struct StagefrightMetadataRetriever : public MediaMetadataRetrieverBase {
     virtual MediaAlbumArt *extractAlbumArt();
     virtual const char *extractMetadata(int keyCode);
 
+    // for AHandlerReflector
+    void onMessageReceived(const sp<AMessage> &msg);
+
 private:
+    enum {
+        kWhatReleaseFrameSession = 'rlfs',
+    };
+
     sp<DataSource> mSource;
     sp<IMediaExtractor> mExtractor;
 
@@ -63,6 +75,36 @@ private:
 
     sp<FrameDecoder> mDecoder;
     int mLastDecodedIndex;
+
+    // Video decoder kept warm across getFrameAtTime() calls, and recently extracted frames,
+    // most recently used first. Both are released once no frame has been requested for a
+    // while, by a message posted to mFrameSessionLooper.
+    struct CachedFrame {
+        int64_t timeUs;
+        int option;
+        int colorFormat;
+        sp<IMemory> frame;
+    };
+    std::mutex mFrameSessionLock;
+    sp<FrameDecoder> mFrameDecoder;         // guarded by mFrameSessionLock
+    int mFrameDecoderColorFormat;           // guarded by mFrameSessionLock
+    std::list<CachedFrame> mFrameCache;     // guarded by mFrameSessionLock
+    size_t mFrameCacheBytes;                // guarded by mFrameSessionLock
+    int32_t mFrameSessionGeneration;        // guarded by mFrameSessionLock
+    sp<ALooper> mFrameSessionLooper;        // guarded by mFrameSessionLock
+    sp<AHandlerReflector<StagefrightMetadataRetriever>> mReflector;
+
+    sp<IMemory> getCachedFrame(int64_t timeUs, int option, int colorFormat);
+    void cacheFrame(int64_t timeUs, int option, int colorFormat, const sp<IMemory> &frame);
+    // Take the warm decoder out of the session, if it converts to colorFormat.
+    sp<FrameDecoder> takeFrameDecoder(int colorFormat);
+    // Keep the decoder warm for the next request.
+    void keepFrameDecoder(const sp<FrameDecoder> &decoder, int colorFormat);
+    // (Re)start the idle timeout of the frame session.
+    void scheduleFrameSessionRelease_l();
+    // Release the warm decoder and the frame cache.
+    void clearFrameSession();
+
     void parseMetaData();
     void parseColorAspects(const sp<MetaData>& meta);
     // Delete album art and clear metadata.
@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "StagefrightMetadataRetrieverTest"
+#include <utils/Log.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/properties.h>
+#include <binder/ProcessState.h>
+#include <gtest/gtest.h>
+#include <media/stagefright/MediaSource.h>
+#include <private/media/VideoFrame.h>
+#include <system/graphics.h>
+
+#include "StagefrightMetadataRetriever.h"
+
+using namespace android;
+
+// Video to extract frames from; can be overridden with --video=<path>.
+static std::string gVideoPath = "/data/local/tmp/MetadataRetrieverTest/video.mp4";
+
+constexpr char kReuseDecoderProperty[] = "media.stagefright.thumbnail.reuse_decoder";
+constexpr char kCacheBytesProperty[] = "media.stagefright.thumbnail.cache_bytes";
+constexpr int32_t kFrameCount = 10;
+// Spacing between requested frames, as when scrolling through a video timeline.
+constexpr int64_t kFrameSpacingUs = 100000LL;
+// Longer than the time after which an idle retriever releases its decoder and frame cache.
+constexpr std::chrono::milliseconds kIdleWait(1500);
+
+// The header and the pixels of a frame returned by the retriever.
+static std::vector<uint8_t> frameContents(const sp<IMemory> &frameMem) {
+    const VideoFrame *frame = static_cast<VideoFrame *>(frameMem->unsecurePointer());
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(frame);
+    return std::vector<uint8_t>(data, data + frame->getFlattenedSize());
+}
+
+class StagefrightMetadataRetrieverTest : public ::testing::TestWithParam<int> {
+  public:
+    void SetUp() override {
+        struct stat st;
+        if (stat(gVideoPath.c_str(), &st) != 0) {
+            GTEST_SKIP() << "missing input video " << gVideoPath;
+        }
+        mPreviousReuseDecoder = android::base::GetProperty(kReuseDecoderProperty, "");
+        mPreviousCacheBytes = android::base::GetProperty(kCacheBytesProperty, "");
+    }
+
+    void TearDown() override {
+        android::base::SetProperty(kReuseDecoderProperty, mPreviousReuseDecoder);
+        android::base::SetProperty(kCacheBytesProperty, mPreviousCacheBytes);
+    }
+
+    sp<StagefrightMetadataRetriever> createRetriever() {
+        int fd = open(gVideoPath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            ADD_FAILURE() << "failed to open " << gVideoPath;
+            return nullptr;
+        }
+        sp<StagefrightMetadataRetriever> retriever = new StagefrightMetadataRetriever();
+        struct stat st;
+        fstat(fd, &st);
+        status_t err = retriever->setDataSource(fd, 0, st.st_size);
+        close(fd);
+        if (err != OK) {
+            ADD_FAILURE() << "setDataSource failed with " << err;
+            return nullptr;
+        }
+        return retriever;
+    }
+
+    void setProperty(const char *name, const std::string &value) {
+        ASSERT_TRUE(android::base::SetProperty(name, value)) << "failed to set " << name;
+    }
+
+    // Extracts the frames of a thumbnail strip, one retriever for the whole strip.
+    std::vector<std::vector<uint8_t>> extractFrames(int option) {
+        std::vector<std::vector<uint8_t>> frames;
+        sp<StagefrightMetadataRetriever> retriever = createRetriever();
+        if (retriever == nullptr) {
+            return frames;
+        }
+        for (int32_t i = 0; i < kFrameCount; ++i) {
+            sp<IMemory> frameMem = retriever->getFrameAtTime(
+                    i * kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */);
+            if (frameMem == nullptr) {
+                ADD_FAILURE() << "no frame at " << i * kFrameSpacingUs << " us";
+                break;
+            }
+            frames.push_back(frameContents(frameMem));
+        }
+        return frames;
+    }
+
+  private:
+    std::string mPreviousReuseDecoder;
+    std::string mPreviousCacheBytes;
+};
+
+// A reused decoder, repositioned between requests, returns the same frames as a decoder
+// created for each request.
+TEST_P(StagefrightMetadataRetrieverTest, ReusedDecoderMatchesNewDecoder) {
+    const int option = GetParam();
+    setProperty(kReuseDecoderProperty, "0");
+    const std::vector<std::vector<uint8_t>> expected = extractFrames(option);
+    ASSERT_EQ(kFrameCount, (int32_t)expected.size());
+
+    setProperty(kReuseDecoderProperty, "1");
+    const std::vector<std::vector<uint8_t>> frames = extractFrames(option);
+    ASSERT_EQ(kFrameCount, (int32_t)frames.size());
+    for (int32_t i = 0; i < kFrameCount; ++i) {
+        EXPECT_EQ(expected[i], frames[i]) << "frame at " << i * kFrameSpacingUs << " us";
+    }
+}
+
+// Extracting a frame with the reused decoder does not overwrite a frame returned before.
+TEST_P(StagefrightMetadataRetrieverTest, ReturnedFramesAreNotOverwritten) {
+    const int option = GetParam();
+    setProperty(kReuseDecoderProperty, "1");
+    setProperty(kCacheBytesProperty, "0");
+    sp<StagefrightMetadataRetriever> retriever = createRetriever();
+    ASSERT_NE(nullptr, retriever);
+
+    sp<IMemory> first = retriever->getFrameAtTime(
+            0, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */);
+    ASSERT_NE(nullptr, first);
+    const std::vector<uint8_t> contents = frameContents(first);
+    for (int32_t i = 1; i < kFrameCount; ++i) {
+        sp<IMemory> frame = retriever->getFrameAtTime(
+                i * kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */);
+        ASSERT_NE(nullptr, frame);
+        EXPECT_NE(first->unsecurePointer(), frame->unsecurePointer());
+    }
+    EXPECT_EQ(contents, frameContents(first));
+}
+
+// A repeated request is served from the cache only while the frame fits in the cache size.
+TEST_P(StagefrightMetadataRetrieverTest, CacheIsBoundedByBytes) {
+    const int option = GetParam();
+    setProperty(kReuseDecoderProperty, "1");
+    sp<StagefrightMetadataRetriever> retriever = createRetriever();
+    ASSERT_NE(nullptr, retriever);
+
+    setProperty(kCacheBytesProperty, std::to_string(64 * 1024 * 1024));
+    sp<IMemory> frame = retriever->getFrameAtTime(
+            0, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */);
+    ASSERT_NE(nullptr, frame);
+    EXPECT_EQ(frame->unsecurePointer(), retriever->getFrameAtTime(
+            0, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */)->unsecurePointer());
+
+    // a cache smaller than a frame does not keep it
+    setProperty(kCacheBytesProperty, std::to_string(frame->size() - 1));
+    sp<IMemory> uncached = retriever->getFrameAtTime(
+            kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */);
+    ASSERT_NE(nullptr, uncached);
+    sp<IMemory> again = retriever->getFrameAtTime(
+            kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */);
+    ASSERT_NE(nullptr, again);
+    EXPECT_NE(uncached->unsecurePointer(), again->unsecurePointer());
+    EXPECT_EQ(frameContents(uncached), frameContents(again));
+
+    // a cache holding a single frame evicts the previous one
+    setProperty(kCacheBytesProperty, std::to_string(frame->size()));
+    sp<IMemory> second = retriever->getFrameAtTime(
+            2 * kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */);
+    ASSERT_NE(nullptr, second);
+    sp<IMemory> third = retriever->getFrameAtTime(
+            3 * kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */);
+    ASSERT_NE(nullptr, third);
+    EXPECT_EQ(third->unsecurePointer(), retriever->getFrameAtTime(
+            3 * kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */)
+            ->unsecurePointer());
+    EXPECT_NE(second->unsecurePointer(), retriever->getFrameAtTime(
+            2 * kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */)
+            ->unsecurePointer());
+}
+
+// An idle retriever releases its frame session: a repeated request after the idle timeout
+// is decoded again, and still returns the same frame.
+TEST_P(StagefrightMetadataRetrieverTest, IdleSessionIsReleased) {
+    const int option = GetParam();
+    setProperty(kReuseDecoderProperty, "1");
+    setProperty(kCacheBytesProperty, std::to_string(64 * 1024 * 1024));
+    sp<StagefrightMetadataRetriever> retriever = createRetriever();
+    ASSERT_NE(nullptr, retriever);
+
+    sp<IMemory> frame = retriever->getFrameAtTime(
+            kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */);
+    ASSERT_NE(nullptr, frame);
+    std::this_thread::sleep_for(kIdleWait);
+
+    sp<IMemory> again = retriever->getFrameAtTime(
+            kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */);
+    ASSERT_NE(nullptr, again);
+    EXPECT_NE(frame->unsecurePointer(), again->unsecurePointer());
+    EXPECT_EQ(frameContents(frame), frameContents(again));
+
+    // the retriever still works after the session is released, and is destroyed cleanly
+    // with a release pending
+    EXPECT_NE(nullptr, retriever->getFrameAtTime(
+            2 * kFrameSpacingUs, option, HAL_PIXEL_FORMAT_RGB_565, false /* metaOnly */));
+    retriever.clear();
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        StagefrightMetadataRetrieverTestAll, StagefrightMetadataRetrieverTest,
+        ::testing::Values(MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC,
+                          MediaSource::ReadOptions::SEEK_CLOSEST));
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--video=", 0) == 0) {
+            gVideoPath = arg.substr(strlen("--video="));
+        }
+    }
+    ProcessState::self()->startThreadPool();
+    int status = RUN_ALL_TESTS();
+    ALOGV("Test result = %d\n", status);
+    return status;
+}
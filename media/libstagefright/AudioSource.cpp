@@ -17,6 +17,8 @@
 #include <inttypes.h>
 #include <stdlib.h>
 
+#include <algorithm>
+
 //#define LOG_NDEBUG 0
 #define LOG_TAG "AudioSource"
 #include <utils/Log.h>
@@ -142,6 +144,10 @@ AudioSource::~AudioSource() {
     if (mStarted) {
         reset();
     }
+    while (!mFreeBuffers.empty()) {
+        (*mFreeBuffers.begin())->release();
+        mFreeBuffers.erase(mFreeBuffers.begin());
+    }
 }
 
 status_t AudioSource::initCheck() const {
@@ -182,7 +188,7 @@ void AudioSource::releaseQueuedFrames_l() {
     List<MediaBuffer *>::iterator it;
     while (!mBuffersReceived.empty()) {
         it = mBuffersReceived.begin();
-        (*it)->release();
+        recycleBuffer_l(*it);
         mBuffersReceived.erase(it);
     }
 }
@@ -232,36 +238,39 @@ sp<MetaData> AudioSource::getFormat() {
     return meta;
 }
 
+// static
 void AudioSource::rampVolume(
-        int32_t startFrame, int32_t rampDurationFrames,
-        uint8_t *data,   size_t bytes) {
-
+        int16_t *data, size_t frameCount, int32_t channelCount,
+        int64_t startFrame, int32_t rampDurationFrames) {
     const int32_t kShift = 14;
-    int32_t fixedMultiplier = (startFrame << kShift) / rampDurationFrames;
-    const int32_t nChannels = mRecord->channelCount();
-    int32_t stopFrame = startFrame + bytes / sizeof(int16_t);
-    int16_t *frame = (int16_t *) data;
-    if (stopFrame > rampDurationFrames) {
-        stopFrame = rampDurationFrames;
-    }
-
-    while (startFrame < stopFrame) {
-        if (nChannels == 1) {  // mono
-            frame[0] = (frame[0] * fixedMultiplier) >> kShift;
-            ++frame;
-            ++startFrame;
-        } else {               // stereo
-            frame[0] = (frame[0] * fixedMultiplier) >> kShift;
-            frame[1] = (frame[1] * fixedMultiplier) >> kShift;
-            frame += 2;
-            startFrame += 2;
+    if (startFrame < 0 || rampDurationFrames <= 0 || channelCount <= 0) {
+        return;
+    }
+    const int64_t stopFrame = std::min(startFrame + (int64_t)frameCount,
+            (int64_t)rampDurationFrames);
+    int64_t frame = startFrame;
+    while (frame < stopFrame) {
+        // The multiplier is updated every 4 frames. Within a block all samples share it,
+        // so the inner loop has no dependency between samples and can be vectorized.
+        const int32_t multiplier = (int32_t)((frame << kShift) / rampDurationFrames);
+        const int64_t blockFrames = std::min(4 - (frame & 3), stopFrame - frame);
+        const size_t sampleCount = blockFrames * channelCount;
+        for (size_t i = 0; i < sampleCount; ++i) {
+            data[i] = (data[i] * multiplier) >> kShift;
         }
+        data += sampleCount;
+        frame += blockFrames;
+    }
+}
 
-        // Update the multiplier every 4 frames
-        if ((startFrame & 3) == 0) {
-            fixedMultiplier = (startFrame << kShift) / rampDurationFrames;
-        }
+// static
+int16_t AudioSource::maxAmplitude(const int16_t *data, size_t sampleCount) {
+    // Accumulate in 32 bits so that -32768 does not overflow and the loop can be vectorized.
+    int32_t maxValue = 0;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        maxValue = std::max(maxValue, std::abs((int32_t)data[i]));
     }
+    return (int16_t)std::min(maxValue, (int32_t)INT16_MAX);
 }
 
 status_t AudioSource::read(
@@ -298,12 +307,11 @@ status_t AudioSource::read(
         int32_t autoRampDurationFrames =
                     ((int64_t)kAutoRampDurationUs * mSampleRate + 500000LL) / 1000000LL; //Need type casting
 
-        int32_t autoRampStartFrames =
-                    ((int64_t)kAutoRampStartUs * mSampleRate + 500000LL) / 1000000LL; //Need type casting
-
-        int32_t nFrames = mNumFramesReceived - autoRampStartFrames;
-        rampVolume(nFrames, autoRampDurationFrames,
-                (uint8_t *) buffer->data(), buffer->range_length());
+        // Position of this buffer in the ramp, from its own timestamp.
+        int64_t rampFrame =
+                ((elapsedTimeUs - kAutoRampStartUs) * mSampleRate + 500000LL) / 1000000LL;
+        rampVolume((int16_t *) buffer->data(), buffer->range_length() / mRecord->frameSize(),
+                mRecord->channelCount(), rampFrame, autoRampDurationFrames);
     }
 
     // Track the max recording signal amplitude.
@@ -341,7 +349,7 @@ void AudioSource::signalBufferReturned(MediaBufferBase *buffer) {
     Mutex::Autolock autoLock(mLock);
     --mNumClientOwnedBuffers;
     buffer->setObserver(0);
-    buffer->release();
+    recycleBuffer_l(static_cast<MediaBuffer *>(buffer));
     mFrameEncodingCompletionCondition.signal();
     return;
 }
@@ -429,9 +437,8 @@ size_t AudioSource::onMoreData(const AudioRecord::Buffer& audioBuffer) {
         } else {
             numLostBytes = 0;
         }
-        MediaBuffer *lostAudioBuffer = new MediaBuffer(bufferSize);
+        MediaBuffer *lostAudioBuffer = acquireBuffer_l(bufferSize);
         memset(lostAudioBuffer->data(), 0, bufferSize);
-        lostAudioBuffer->set_range(0, bufferSize);
         mNumFramesLost += bufferSize / mRecord->frameSize();
         queueInputBuffer_l(lostAudioBuffer, timeUs);
     }
@@ -441,14 +448,39 @@ size_t AudioSource::onMoreData(const AudioRecord::Buffer& audioBuffer) {
         return audioBuffer.size();
     }
 
-    MediaBuffer *buffer = new MediaBuffer(audioBuffer.size());
+    MediaBuffer *buffer = acquireBuffer_l(audioBuffer.size());
     memcpy((uint8_t *) buffer->data(),
             audioBuffer.data(), audioBuffer.size());
-    buffer->set_range(0, audioBuffer.size());
     queueInputBuffer_l(buffer, timeUs);
     return audioBuffer.size();
 }
 
+MediaBuffer *AudioSource::acquireBuffer_l(size_t size) {
+    for (List<MediaBuffer *>::iterator it = mFreeBuffers.begin();
+            it != mFreeBuffers.end(); ++it) {
+        MediaBuffer *buffer = *it;
+        if (buffer->size() >= size) {
+            mFreeBuffers.erase(it);
+            buffer->set_range(0, size);
+            return buffer;
+        }
+    }
+    // Callbacks usually deliver the same amount of data, so allocate at least
+    // kMaxBufferSize to let the buffer be reused for lost audio data as well.
+    MediaBuffer *buffer = new MediaBuffer(std::max(size, (size_t)kMaxBufferSize));
+    buffer->set_range(0, size);
+    return buffer;
+}
+
+void AudioSource::recycleBuffer_l(MediaBuffer *buffer) {
+    if (mFreeBuffers.size() >= kMaxFreeBuffers) {
+        buffer->release();
+        return;
+    }
+    buffer->reset();
+    mFreeBuffers.push_back(buffer);
+}
+
 void AudioSource::queueInputBuffer_l(MediaBuffer *buffer, int64_t timeUs) {
     const size_t bufferSize = buffer->range_length();
     const size_t frameSize = mRecord->frameSize();
@@ -468,14 +500,9 @@ void AudioSource::queueInputBuffer_l(MediaBuffer *buffer, int64_t timeUs) {
 }
 
 void AudioSource::trackMaxAmplitude(int16_t *data, int nSamples) {
-    for (int i = nSamples; i > 0; --i) {
-        int16_t value = *data++;
-        if (value < 0) {
-            value = -value;
-        }
-        if (mMaxAmplitude < value) {
-            mMaxAmplitude = value;
-        }
+    int16_t value = maxAmplitude(data, nSamples);
+    if (mMaxAmplitude < value) {
+        mMaxAmplitude = value;
     }
 }
 
@@ -48,6 +48,9 @@ namespace android {
 static const int64_t kBufferTimeOutUs = 10000LL; // 10 msec
 static const size_t kRetryCount = 100; // must be >0
 static const int64_t kDefaultSampleDurationUs = 33333LL; // 33ms
+// When a reused decoder is asked for a later frame within this distance, decode forward
+// instead of seeking back to the previous sync frame and flushing the decoder.
+static const int64_t kMaxForwardDecodeUs = 1000000LL; // 1 sec
 
 sp<IMemory> allocVideoFrame(const sp<MetaData>& trackMeta,
         int32_t width, int32_t height, int32_t tileWidth, int32_t tileHeight,
@@ -353,6 +356,29 @@ sp<IMemory> FrameDecoder::extractFrame(FrameRect *rect) {
     return mFrameMemory;
 }
 
+status_t FrameDecoder::seekTo(int64_t frameTimeUs, int option) {
+    if (!mDecoder) {
+        ALOGE("decoder is not initialized");
+        return NO_INIT;
+    }
+    bool decodeForward = false;
+    status_t err = onSeek(frameTimeUs, option, mHaveMoreInputs, &mReadOptions, &decodeForward);
+    if (err != OK) {
+        return err;
+    }
+    if (!decodeForward) {
+        err = mDecoder->flush();
+        if (err != OK) {
+            ALOGW("flush returned error %d (%s)", err, asString(err));
+            return err;
+        }
+        mHaveMoreInputs = true;
+        mFirstSample = true;
+    }
+    mFrameMemory.clear();
+    return OK;
+}
+
 status_t FrameDecoder::extractInternal() {
     status_t err = OK;
     bool done = false;
@@ -503,6 +529,7 @@ VideoFrameDecoder::VideoFrameDecoder(
       mIsHevc(false),
       mSeekMode(MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC),
       mTargetTimeUs(-1LL),
+      mLastOutputTimeUs(-1LL),
       mDefaultSampleDurationUs(0) {
 }
 
@@ -579,6 +606,46 @@ sp<AMessage> VideoFrameDecoder::onGetFormatAndSeekOptions(
     return videoFormat;
 }
 
+status_t VideoFrameDecoder::onSeek(
+        int64_t frameTimeUs, int seekMode, bool canDecodeForward,
+        MediaSource::ReadOptions *options, bool *decodeForward) {
+    MediaSource::ReadOptions::SeekMode mode =
+            static_cast<MediaSource::ReadOptions::SeekMode>(seekMode);
+    if (mode < MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC ||
+            mode > MediaSource::ReadOptions::SEEK_CLOSEST) {
+        // SEEK_FRAME_INDEX keeps its own decoder for sequential access.
+        return ERROR_UNSUPPORTED;
+    }
+    // The decoder was configured with a single buffer per port unless seeking closest,
+    // so it can only be reused for requests of the same kind.
+    bool wasSeekingClosest = (mSeekMode == MediaSource::ReadOptions::SEEK_CLOSEST)
+            || (mSeekMode == MediaSource::ReadOptions::SEEK_FRAME_INDEX);
+    bool isSeekingClosest = (mode == MediaSource::ReadOptions::SEEK_CLOSEST);
+    if (wasSeekingClosest != isSeekingClosest || frameTimeUs < 0) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    // Allocate a new frame on the next output so previously returned frames stay valid.
+    mFrame = NULL;
+    mSeekMode = mode;
+
+    if (isSeekingClosest && canDecodeForward && mLastOutputTimeUs >= 0
+            && frameTimeUs > mLastOutputTimeUs
+            && frameTimeUs - mLastOutputTimeUs <= kMaxForwardDecodeUs) {
+        ALOGV("decoding forward from %lld to %lld us",
+                (long long)mLastOutputTimeUs, (long long)frameTimeUs);
+        mTargetTimeUs = frameTimeUs;
+        *decodeForward = true;
+        return OK;
+    }
+
+    mTargetTimeUs = -1LL;
+    mSampleDurations.clear();
+    options->setSeekTo(frameTimeUs, mSeekMode);
+    *decodeForward = false;
+    return OK;
+}
+
 status_t VideoFrameDecoder::onInputReceived(
         const sp<MediaCodecBuffer> &codecBuffer,
         MetaDataBase &sampleMeta, bool firstSample, uint32_t *flags) {
@@ -625,6 +692,7 @@ status_t VideoFrameDecoder::onOutputReceived(
     }
 
     *done = true;
+    mLastOutputTimeUs = timeUs;
 
     if (outputFormat == NULL) {
         return ERROR_MALFORMED;
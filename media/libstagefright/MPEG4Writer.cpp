@@ -145,6 +145,9 @@ public:
     status_t stop(bool stopSource = true);
     status_t pause();
     bool reachedEOS();
+    // Fragmented files only: whether the state the moov box is written from has been
+    // captured. Called with the writer lock held.
+    bool initSegmentStateCaptured_l() const { return mInitSegmentStateCaptured; }
 
     int64_t getDurationUs() const;
     int64_t getEstimatedTrackSizeBytes() const;
@@ -343,6 +346,13 @@ private:
 
     List<MediaBuffer *> mChunkSamples;
 
+    // Fragmented files only: trun entries of mChunkSamples, and the decoding time
+    // of its first sample.
+    std::vector<FragmentSample> mFragmentSamples;
+    uint64_t mFragmentDecodeTicks;
+
+    uint32_t mSampleCount;
+    uint32_t mSyncSampleCount;
     bool mSamplesHaveSameSize;
     ListTableEntries<uint32_t, 1> *mStszTableEntries;
     ListTableEntries<off64_t, 1> *mCo64TableEntries;
@@ -387,6 +397,15 @@ private:
     bool mTrackingProgressStatus;
 
     bool mReachedEOS;
+
+    // Fragmented files only: the moov box is written by the writer thread while the track
+    // thread keeps adding samples. The track thread captures, under the writer lock, the
+    // part of its state that still changes after its codec specific data and first sample
+    // are known, and the moov box is only written once every track has done so.
+    bool mInitSegmentStateCaptured;
+    bool mInitSegmentHasSampleEntry;  // the stbl box has a sample description
+    void captureInitSegmentState();
+
     int64_t mStartTimestampUs;
     int64_t mStartTimeRealUs;
     int64_t mFirstSampleTimeRealUs;
@@ -551,6 +570,12 @@ void MPEG4Writer::initInternal(int fd, bool isFirstSession) {
     mWriteBoxToMemory = false;
     mFreeBoxOffset = 0;
     mStreamableFile = false;
+    mIsFragmented = false;
+    mFragmentDurationUs = 0;
+    mCmafChunkDurationUs = 0;
+    mInitSegmentWritten = false;
+    mFragmentSequenceNumber = 0;
+    mMehdDurationOffset = 0;
     mTimeScale = -1;
     mHasFileLevelMeta = false;
     mIsAvif = false;
@@ -631,7 +656,7 @@ status_t MPEG4Writer::Track::dump(
     snprintf(buffer, SIZE, "       reached EOS: %s\n",
             mReachedEOS? "true": "false");
     result.append(buffer);
-    snprintf(buffer, SIZE, "       frames encoded : %d\n", mStszTableEntries->count());
+    snprintf(buffer, SIZE, "       frames encoded : %d\n", mSampleCount);
     result.append(buffer);
     snprintf(buffer, SIZE, "       duration encoded : %" PRId64 " us\n", mTrackDurationUs);
     result.append(buffer);
@@ -962,6 +987,32 @@ status_t MPEG4Writer::start(MetaData *param) {
         (mMaxFileSizeLimitBytes != 0 &&
          mMaxFileSizeLimitBytes >= kMinStreamableFileSizeInBytes);
 
+    /*
+     * A fragmented file has its moov box, without any sample tables, written
+     * right before the first movie fragment. Samples are then written as
+     * movie fragments (moof + mdat) of at least mFragmentDurationUs, starting
+     * at a sync sample, so neither the sample tables nor a reserved free box
+     * are needed, and everything written before an interruption stays playable.
+     */
+    int64_t fragmentDurationUs;
+    if (param && param->findInt64(kKeyFragmentDurationUs, &fragmentDurationUs) &&
+            fragmentDurationUs > 0) {
+        if (mHasFileLevelMeta) {
+            ALOGW("Fragmented output is not supported for HEIF, ignored");
+        } else {
+            mIsFragmented = true;
+            mFragmentDurationUs = fragmentDurationUs;
+            int64_t chunkDurationUs;
+            if (param->findInt64(kKeyCmafChunkDurationUs, &chunkDurationUs) &&
+                    chunkDurationUs > 0 && chunkDurationUs < fragmentDurationUs) {
+                mCmafChunkDurationUs = chunkDurationUs;
+            }
+            mStreamableFile = false;
+            ALOGI("Fragmented output: fragment %" PRId64 " us, chunk %" PRId64 " us",
+                    mFragmentDurationUs, mCmafChunkDurationUs);
+        }
+    }
+
     /*
      * mWriteBoxToMemory is true if the amount of data in a file-level meta or
      * moov box is smaller than the reserved free space at the beginning of a
@@ -1029,7 +1080,7 @@ status_t MPEG4Writer::start(MetaData *param) {
 
     mFreeBoxOffset = mOffset;
 
-    if (mInMemoryCacheSize == 0) {
+    if (mInMemoryCacheSize == 0 && !mIsFragmented) {
         int32_t bitRate = -1;
         if (mHasFileLevelMeta) {
             mFileLevelMetaDataSize = estimateFileLevelMetaSize(param);
@@ -1067,7 +1118,10 @@ status_t MPEG4Writer::start(MetaData *param) {
 
     mOffset = mMdatOffset;
     seekOrPostError(mFd, mMdatOffset, SEEK_SET);
-    write("\x00\x00\x00\x01mdat????????", 16);
+    if (!mIsFragmented) {
+        // Each movie fragment has its own mdat box.
+        write("\x00\x00\x00\x01mdat????????", 16);
+    }
 
     /* Confirm whether the writing of the initial file atoms, ftyp and free,
      * are written to the file properly by posting kWhatNoIOErrorSoFar to the
@@ -1362,6 +1416,28 @@ status_t MPEG4Writer::reset(bool stopSource, bool waitForAnyPreviousCallToComple
         return mResetStatus;
     }
 
+    if (mIsFragmented) {
+        // All samples are already in movie fragments; only the overall
+        // duration in the mehd box is left to fill in.
+        if (!mInitSegmentWritten) {
+            writeInitSegment();
+        }
+        if (mMehdDurationOffset > 0) {
+            uint64_t duration = hton64((maxDurationUs * mTimeScale + 5E5) / 1E6);
+            seekOrPostError(mFd, mMehdDurationOffset, SEEK_SET);
+            writeOrPostError(mFd, &duration, 8);
+            seekOrPostError(mFd, mOffset, SEEK_SET);
+        }
+        mMdatEndOffset = mOffset;
+        CHECK(mBoxes.empty());
+        status_t errRelease = release();
+        if (err == OK) {
+            err = errRelease;
+        }
+        mResetStatus = err;
+        return mResetStatus;
+    }
+
     // Fix up the size of the 'mdat' chunk.
     seekOrPostError(mFd, mMdatOffset + 8, SEEK_SET);
     uint64_t size = mOffset - mMdatOffset;
@@ -1502,24 +1578,28 @@ void MPEG4Writer::writeMoovBox(int64_t durationUs) {
         writeUdtaBox();
     }
     writeMoovLevelMetaBox();
-    // Loop through all the tracks to get the global time offset if there is
-    // any ctts table appears in a video track.
-    int64_t minCttsOffsetTimeUs = kMaxCttsOffsetTimeUs;
-    for (List<Track *>::iterator it = mTracks.begin();
-        it != mTracks.end(); ++it) {
-        if (!(*it)->isHeif()) {
-            minCttsOffsetTimeUs =
-                std::min(minCttsOffsetTimeUs, (*it)->getMinCttsOffsetTimeUs());
+    // Movie fragments carry signed composition offsets, and the moov box is
+    // written before the track's ctts offsets are known.
+    if (!mIsFragmented) {
+        // Loop through all the tracks to get the global time offset if there is
+        // any ctts table appears in a video track.
+        int64_t minCttsOffsetTimeUs = kMaxCttsOffsetTimeUs;
+        for (List<Track *>::iterator it = mTracks.begin();
+            it != mTracks.end(); ++it) {
+            if (!(*it)->isHeif()) {
+                minCttsOffsetTimeUs =
+                    std::min(minCttsOffsetTimeUs, (*it)->getMinCttsOffsetTimeUs());
+            }
         }
-    }
-    ALOGI("Adjust the moov start time from %lld us -> %lld us", (long long)mStartTimestampUs,
-          (long long)(mStartTimestampUs + minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs));
-    // Adjust movie start time.
-    mStartTimestampUs += minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs;
+        ALOGI("Adjust the moov start time from %lld us -> %lld us", (long long)mStartTimestampUs,
+              (long long)(mStartTimestampUs + minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs));
+        // Adjust movie start time.
+        mStartTimestampUs += minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs;
 
-    // Add mStartTimeOffsetBFramesUs(-ve or zero) to the start offset of tracks.
-    mStartTimeOffsetBFramesUs = minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs;
-    ALOGV("mStartTimeOffsetBFramesUs :%" PRId32, mStartTimeOffsetBFramesUs);
+        // Add mStartTimeOffsetBFramesUs(-ve or zero) to the start offset of tracks.
+        mStartTimeOffsetBFramesUs = minCttsOffsetTimeUs - kMaxCttsOffsetTimeUs;
+        ALOGV("mStartTimeOffsetBFramesUs :%" PRId32, mStartTimeOffsetBFramesUs);
+    }
 
     for (List<Track *>::iterator it = mTracks.begin();
         it != mTracks.end(); ++it) {
@@ -1527,9 +1607,43 @@ void MPEG4Writer::writeMoovBox(int64_t durationUs) {
             (*it)->writeTrackHeader();
         }
     }
+    if (mIsFragmented) {
+        writeMvexBox();
+    }
     endBox();  // moov
 }
 
+void MPEG4Writer::writeMvexBox() {
+    beginBox("mvex");
+    beginBox("mehd");
+    writeInt32(0x01000000);  // version=1, flags=0
+    // fragment_duration is not known until the recording stops; see reset().
+    mMehdDurationOffset = mOffset;
+    writeInt64(0);
+    endBox();  // mehd
+    for (List<Track *>::iterator it = mTracks.begin();
+        it != mTracks.end(); ++it) {
+        if ((*it)->isHeif()) {
+            continue;
+        }
+        beginBox("trex");
+        writeInt32(0);  // version=0, flags=0
+        writeInt32((*it)->getTrackId().getId());
+        writeInt32(1);  // default_sample_description_index
+        writeInt32(0);  // default_sample_duration
+        writeInt32(0);  // default_sample_size
+        writeInt32(0);  // default_sample_flags
+        endBox();  // trex
+    }
+    endBox();  // mvex
+}
+
+void MPEG4Writer::writeInitSegment() {
+    writeMoovBox(0);
+    mInitSegmentWritten = true;
+    ALOGI("MOOV atom of the fragmented file was written");
+}
+
 void MPEG4Writer::writeFtypBox(MetaData *param) {
     beginBox("ftyp");
 
@@ -1586,6 +1700,10 @@ void MPEG4Writer::writeFtypBox(MetaData *param) {
             writeFourcc("dby1");
         }
     }
+    // Movie fragments with tfdt boxes.
+    if (mIsFragmented) {
+        writeFourcc("iso6");
+    }
 
     endBox();
 }
@@ -2212,6 +2330,9 @@ MPEG4Writer::Track::Track(
       mTrackId(aTrackId),
       mTrackDurationUs(0),
       mEstimatedTrackSizeBytes(0),
+      mFragmentDecodeTicks(0),
+      mSampleCount(0),
+      mSyncSampleCount(0),
       mSamplesHaveSameSize(true),
       mStszTableEntries(new ListTableEntries<uint32_t, 1>(1000)),
       mCo64TableEntries(new ListTableEntries<off64_t, 1>(1000)),
@@ -2228,6 +2349,8 @@ MPEG4Writer::Track::Track(
       mCodecSpecificDataSize(0),
       mGotAllCodecSpecificData(false),
       mReachedEOS(false),
+      mInitSegmentStateCaptured(false),
+      mInitSegmentHasSampleEntry(false),
       mStartTimestampUs(-1),
       mFirstSampleTimeRealUs(0),
       mFirstSampleStartOffsetUs(0),
@@ -2301,6 +2424,8 @@ void MPEG4Writer::Track::resetInternal() {
     mIsMalformed = false;
     mTrackDurationUs = 0;
     mEstimatedTrackSizeBytes = 0;
+    mSampleCount = 0;
+    mSyncSampleCount = 0;
     mSamplesHaveSameSize = false;
     if (mStszTableEntries != NULL) {
         delete mStszTableEntries;
@@ -2331,9 +2456,16 @@ void MPEG4Writer::Track::resetInternal() {
         mElstTableEntries = new ListTableEntries<uint32_t, 3>(3);
     }
     mReachedEOS = false;
+    mInitSegmentStateCaptured = false;
+    mInitSegmentHasSampleEntry = false;
 }
 
 int64_t MPEG4Writer::Track::trackMetaDataSize() {
+    if (mOwner->isFragmented()) {
+        // No sample tables, and the edit list is written by the writer thread.
+        // trun entries: duration, size, flags and composition offset.
+        return (int64_t)mSampleCount * 16;
+    }
     int64_t co64BoxSizeBytes = mCo64TableEntries->count() * 8;
     int64_t stszBoxSizeBytes = mStszTableEntries->count() * 4;
     int64_t trackMetaDataSize = mStscTableEntries->count() * 12 +  // stsc box size
@@ -2787,6 +2919,11 @@ void MPEG4Writer::writeChunkToFile(Chunk* chunk) {
     ALOGV("writeChunkToFile: %" PRId64 " from %s track",
         chunk->mTimeStampUs, chunk->mTrack->getTrackType());
 
+    if (mIsFragmented) {
+        writeFragmentToFile(chunk);
+        return;
+    }
+
     int32_t isFirstSample = true;
     while (!chunk->mSamples.empty()) {
         List<MediaBuffer *>::iterator it = chunk->mSamples.begin();
@@ -2816,6 +2953,98 @@ void MPEG4Writer::writeChunkToFile(Chunk* chunk) {
     chunk->mSamples.clear();
 }
 
+void MPEG4Writer::writeFragmentToFile(Chunk* chunk) {
+    if (!mInitSegmentWritten) {
+        writeInitSegment();
+    }
+
+    const std::vector<FragmentSample> &samples = chunk->mFragmentSamples;
+    CHECK_EQ(samples.size(), chunk->mSamples.size());
+    bool hasCompositionOffsets = false;
+    for (const FragmentSample &sample : samples) {
+        if (sample.mCompositionOffsetTicks != 0) {
+            hasCompositionOffsets = true;
+            break;
+        }
+    }
+
+    const off64_t moofOffset = mOffset;
+    beginBox("moof");
+    beginBox("mfhd");
+    writeInt32(0);  // version=0, flags=0
+    writeInt32(++mFragmentSequenceNumber);
+    endBox();  // mfhd
+    beginBox("traf");
+    beginBox("tfhd");
+    writeInt32(0x020000);  // version=0, flags=default-base-is-moof
+    writeInt32(chunk->mTrack->getTrackId().getId());
+    endBox();  // tfhd
+    beginBox("tfdt");
+    writeInt32(0x01000000);  // version=1, flags=0
+    writeInt64(chunk->mBaseDecodeTicks);  // baseMediaDecodeTime
+    endBox();  // tfdt
+    beginBox("trun");
+    // version=1 for signed composition offsets; flags=data-offset, sample-duration,
+    // sample-size, sample-flags and, if needed, sample-composition-time-offset.
+    writeInt32(0x01000701 | (hasCompositionOffsets ? 0x800 : 0));
+    writeInt32(samples.size());
+    const off64_t dataOffsetOffset = mOffset;
+    writeInt32(0);  // data_offset, set below
+    // Offset of each sample's sample_size field, in case its written size differs.
+    std::vector<off64_t> sampleSizeOffsets;
+    sampleSizeOffsets.reserve(samples.size());
+    for (const FragmentSample &sample : samples) {
+        writeInt32(sample.mDurationTicks);
+        sampleSizeOffsets.push_back(mOffset);
+        writeInt32(sample.mSize);
+        // sample_depends_on=2 for sync samples; else sample_depends_on=1 and
+        // sample_is_non_sync_sample=1.
+        writeInt32(sample.mIsSync ? 0x02000000 : 0x01010000);
+        if (hasCompositionOffsets) {
+            writeInt32(sample.mCompositionOffsetTicks);
+        }
+    }
+    endBox();  // trun
+    endBox();  // traf
+    endBox();  // moof
+
+    // Sample data starts right after the 8 byte mdat header.
+    const off64_t mdatOffset = mOffset;
+    uint32_t dataOffset = htonl(mdatOffset - moofOffset + 8);
+    seekOrPostError(mFd, dataOffsetOffset, SEEK_SET);
+    writeOrPostError(mFd, &dataOffset, 4);
+    seekOrPostError(mFd, mOffset, SEEK_SET);
+
+    beginBox("mdat");
+    const bool usePrefix = chunk->mTrack->usePrefix();
+    std::vector<std::pair<off64_t, uint32_t>> sizeFixups;
+    for (size_t i = 0; !chunk->mSamples.empty(); ++i) {
+        List<MediaBuffer *>::iterator it = chunk->mSamples.begin();
+        size_t bytesWritten;
+        addSample_l(*it, usePrefix, 0 /* tiffHdrOffset */, &bytesWritten);
+        if (bytesWritten != samples[i].mSize) {
+            sizeFixups.emplace_back(sampleSizeOffsets[i], bytesWritten);
+        }
+        (*it)->release();
+        (*it) = NULL;
+        chunk->mSamples.erase(it);
+    }
+    endBox();  // mdat
+
+    // NAL length prefixes may not add up to the size estimated by the track thread.
+    for (const auto &fixup : sizeFixups) {
+        uint32_t size = htonl(fixup.second);
+        seekOrPostError(mFd, fixup.first, SEEK_SET);
+        writeOrPostError(mFd, &size, 4);
+    }
+    if (!sizeFixups.empty()) {
+        seekOrPostError(mFd, mOffset, SEEK_SET);
+    }
+    ALOGV("fragment %u: %zu samples of %s track, moof at %" PRId64 ", mdat at %" PRId64,
+            mFragmentSequenceNumber, samples.size(), chunk->mTrack->getTrackType(),
+            (int64_t)moofOffset, (int64_t)mdatOffset);
+}
+
 void MPEG4Writer::writeAllChunks() {
     ALOGV("writeAllChunks");
     size_t outstandingChunks = 0;
@@ -2852,6 +3081,17 @@ bool MPEG4Writer::findChunkToWrite(Chunk *chunk) {
         return false;
     }
 
+    if (mIsFragmented && !mInitSegmentWritten && !mDone) {
+        // The moov box goes before the first fragment, so wait for every track
+        // to have its codec specific data and start time, or to have reached EOS.
+        for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+             it != mChunkInfos.end(); ++it) {
+            if (!it->mTrack->initSegmentStateCaptured_l()) {
+                return false;
+            }
+        }
+    }
+
     if (mIsFirstChunk) {
         mIsFirstChunk = false;
     }
@@ -3016,6 +3256,7 @@ status_t MPEG4Writer::Track::start(MetaData *params) {
     mMdatSizeBytes = 0;
     mMaxChunkDurationUs = 0;
     mLastDecodingTimeUs = -1;
+    mFragmentDecodeTicks = 0;
 
     pthread_create(&mThread, &attr, ThreadWrapper, this);
     pthread_attr_destroy(&attr);
@@ -3488,7 +3729,9 @@ status_t MPEG4Writer::Track::threadEntry() {
     int32_t count = 0;
     const int64_t interleaveDurationUs = mOwner->interleaveDuration();
     const bool hasMultipleTracks = (mOwner->numTracks() > 1);
+    const bool isFragmented = mOwner->isFragmented();
     int64_t chunkTimestampUs = 0;
+    int64_t fragmentTimestampUs = 0;  // Time stamp of the first sample of the current fragment
     int32_t nChunks = 0;
     int32_t nActualFrames = 0;        // frames containing non-CSD data (non-0 length)
     int32_t nZeroLengthFrames = 0;
@@ -3660,6 +3903,15 @@ status_t MPEG4Writer::Track::threadEntry() {
         if (!buffer->meta_data().findInt64(kKeySampleFileOffset, &sampleFileOffset)) {
             sampleFileOffset = -1;
         }
+        if (isFragmented && sampleFileOffset != -1) {
+            // Sample data has to follow its moof box.
+            ALOGE("Sample file offsets are not supported for fragmented files");
+            buffer->release();
+            buffer = nullptr;
+            mSource->stop();
+            mIsMalformed = true;
+            break;
+        }
         int64_t lastSample = -1;
         if (!buffer->meta_data().findInt64(kKeyLastSampleIndexInChunk, &lastSample)) {
             lastSample = -1;
@@ -3759,7 +4011,7 @@ status_t MPEG4Writer::Track::threadEntry() {
         }
 ////////////////////////////////////////////////////////////////////////////////
         if (!mIsHeif) {
-            if (mStszTableEntries->count() == 0) {
+            if (mSampleCount == 0) {
                 mFirstSampleTimeRealUs = systemTime() / 1000;
                 if (timestampUs < 0 && mFirstSampleStartOffsetUs == 0) {
                     mFirstSampleStartOffsetUs = -timestampUs;
@@ -3853,7 +4105,9 @@ status_t MPEG4Writer::Track::threadEntry() {
                     break;
                 }
 
-                if (mStszTableEntries->count() == 0) {
+                if (isFragmented) {
+                    // Written to the trun box of the fragment instead.
+                } else if (mSampleCount == 0) {
                     // Force the first ctts table entry to have one single entry
                     // so that we can do adjustment for the initial track start
                     // time offset easily in writeCttsBox().
@@ -3871,7 +4125,7 @@ status_t MPEG4Writer::Track::threadEntry() {
                 }
 
                 // Update ctts time offset range
-                if (mStszTableEntries->count() == 0) {
+                if (mSampleCount == 0) {
                     mMinCttsOffsetTicks = currCttsOffsetTimeTicks;
                     mMaxCttsOffsetTicks = currCttsOffsetTimeTicks;
                 } else {
@@ -3937,9 +4191,14 @@ status_t MPEG4Writer::Track::threadEntry() {
                     timestampUs += deltaUs;
                 }
             }
-            mStszTableEntries->add(htonl(sampleSize));
+            // Fragmented files keep no sample tables; the samples of each
+            // fragment are described by its trun box.
+            if (!isFragmented) {
+                mStszTableEntries->add(htonl(sampleSize));
+            }
+            ++mSampleCount;
 
-            if (mStszTableEntries->count() > 2) {
+            if (mSampleCount > 2 && !isFragmented) {
 
                 // Force the first sample to have its own stts entry so that
                 // we can adjust its value later to maintain the A/V sync.
@@ -3951,7 +4210,7 @@ status_t MPEG4Writer::Track::threadEntry() {
                 }
             }
             if (mSamplesHaveSameSize) {
-                if (mStszTableEntries->count() >= 2 && previousSampleSize != sampleSize) {
+                if (mSampleCount >= 2 && previousSampleSize != sampleSize) {
                     mSamplesHaveSameSize = false;
                 }
                 previousSampleSize = sampleSize;
@@ -3963,7 +4222,10 @@ status_t MPEG4Writer::Track::threadEntry() {
             lastTimestampUs = timestampUs;
 
             if (isSync != 0) {
-                addOneStssTableEntry(mStszTableEntries->count());
+                ++mSyncSampleCount;
+                if (!isFragmented) {
+                    addOneStssTableEntry(mSampleCount);
+                }
             }
 
             if (mTrackingProgressStatus) {
@@ -3973,7 +4235,7 @@ status_t MPEG4Writer::Track::threadEntry() {
                 trackProgressStatus(timestampUs);
             }
         }
-        if (!hasMultipleTracks) {
+        if (!hasMultipleTracks && !isFragmented) {
             size_t bytesWritten;
             off64_t offset = mOwner->addSample_l(
                     copy, usePrefix, tiffHdrOffset, &bytesWritten);
@@ -3990,6 +4252,41 @@ status_t MPEG4Writer::Track::threadEntry() {
             continue;
         }
 
+        if (isFragmented) {
+            // A new fragment starts at the first sync sample after the fragment
+            // duration, and a new chunk (moof + mdat) within it after the chunk
+            // duration. The duration of a sample is only known once the next one
+            // is received.
+            const bool isFragmentSync = isSync || !mIsVideo;
+            if (mChunkSamples.empty()) {
+                fragmentTimestampUs = timestampUs;
+                chunkTimestampUs = timestampUs;
+            } else {
+                mFragmentSamples.back().mDurationTicks = currDurationTicks;
+                const bool newFragment = isFragmentSync &&
+                        timestampUs - fragmentTimestampUs >= mOwner->fragmentDurationUs();
+                const bool newChunk = mOwner->cmafChunkDurationUs() > 0 &&
+                        timestampUs - chunkTimestampUs >= mOwner->cmafChunkDurationUs();
+                if (newFragment || newChunk) {
+                    bufferChunk(chunkTimestampUs);
+                    ++nChunks;
+                    chunkTimestampUs = timestampUs;
+                    if (newFragment) {
+                        fragmentTimestampUs = timestampUs;
+                    }
+                }
+            }
+            int32_t compositionOffsetTicks = 0;
+            if (mIsVideo) {
+                compositionOffsetTicks = currCttsOffsetTimeTicks -
+                        (kMaxCttsOffsetTimeUs * mTimeScale + 500000LL) / 1000000LL;
+            }
+            mChunkSamples.push_back(copy);
+            mFragmentSamples.push_back(FragmentSample{
+                    (uint32_t)sampleSize, 0, compositionOffsetTicks, isFragmentSync});
+            continue;
+        }
+
         mChunkSamples.push_back(copy);
         if (mIsHeif) {
             bufferChunk(0 /*timestampUs*/);
@@ -4028,16 +4325,36 @@ status_t MPEG4Writer::Track::threadEntry() {
     mOwner->trackProgressStatus(mTrackId.getId(), -1, err);
 
     // Add final entries only for non-empty tracks.
-    if (mStszTableEntries->count() > 0) {
+    if (mSampleCount > 0) {
         if (mIsHeif) {
             if (!mChunkSamples.empty()) {
                 bufferChunk(0);
                 ++nChunks;
             }
+        } else if (isFragmented) {
+            // Last fragment. As for stts below, repeat the previous sample's
+            // duration when the EOS buffer does not tell the last one.
+            if (!mFragmentSamples.empty()) {
+                if (lastSampleDurationUs >= 0) {
+                    mFragmentSamples.back().mDurationTicks = lastSampleDurationTicks;
+                } else if (mSampleCount == 1) {
+                    lastDurationUs = 0;  // A single sample's duration
+                    mFragmentSamples.back().mDurationTicks = 0;
+                } else {
+                    mFragmentSamples.back().mDurationTicks = lastDurationTicks;
+                }
+                bufferChunk(chunkTimestampUs);
+                ++nChunks;
+            }
+            if (lastSampleDurationUs >= 0) {
+                mTrackDurationUs += lastSampleDurationUs;
+            } else {
+                mTrackDurationUs += lastDurationUs;
+            }
         } else {
             // Last chunk
             if (!hasMultipleTracks) {
-                addOneStscTableEntry(1, mStszTableEntries->count());
+                addOneStscTableEntry(1, mSampleCount);
             } else if (!mChunkSamples.empty()) {
                 addOneStscTableEntry(++nChunks, mChunkSamples.size());
                 bufferChunk(timestampUs);
@@ -4046,7 +4363,7 @@ status_t MPEG4Writer::Track::threadEntry() {
             // We don't really know how long the last frame lasts, since
             // there is no frame time after it, just repeat the previous
             // frame's duration.
-            if (mStszTableEntries->count() == 1) {
+            if (mSampleCount == 1) {
                 if (lastSampleDurationUs >= 0) {
                     addOneSttsTableEntry(sampleCount, lastSampleDurationTicks);
                 } else {
@@ -4076,12 +4393,15 @@ status_t MPEG4Writer::Track::threadEntry() {
             }
         }
     }
+    if (mOwner->isFragmented() && !mInitSegmentStateCaptured) {
+        captureInitSegmentState();
+    }
     mReachedEOS = true;
 
     sendTrackSummary(hasMultipleTracks);
 
     ALOGI("Received total/0-length (%d/%d) buffers and encoded %d frames. - %s",
-            count, nZeroLengthFrames, mStszTableEntries->count(), trackName);
+            count, nZeroLengthFrames, mSampleCount, trackName);
     if (mIsAudio) {
         ALOGI("Audio track drift time: %" PRId64 " us", mOwner->getDriftTimeUs());
     }
@@ -4102,26 +4422,26 @@ bool MPEG4Writer::Track::isTrackMalFormed() {
         mOwner->mStartMeta->findInt32(kKeyEmptyTrackMalFormed, &emptyTrackMalformed) &&
         emptyTrackMalformed) {
         // MediaRecorder(sets kKeyEmptyTrackMalFormed by default) report empty tracks as malformed.
-        if (!mIsHeif && mStszTableEntries->count() == 0) {  // no samples written
+        if (!mIsHeif && mSampleCount == 0) {  // no samples written
             ALOGE("The number of recorded samples is 0");
             mIsMalformed = true;
             return true;
         }
-        if (mIsVideo && mStssTableEntries->count() == 0) {  // no sync frames for video
+        if (mIsVideo && mSyncSampleCount == 0) {  // no sync frames for video
             ALOGE("There are no sync frames for video track");
             mIsMalformed = true;
             return true;
         }
     } else {
         // Through MediaMuxer, empty tracks can be added. No sync frames for video.
-        if (mIsVideo && mStszTableEntries->count() > 0 && mStssTableEntries->count() == 0) {
+        if (mIsVideo && mSampleCount > 0 && mSyncSampleCount == 0) {
             ALOGE("There are no sync frames for video track");
             mIsMalformed = true;
             return true;
         }
     }
     // Don't check for CodecSpecificData when track is empty.
-    if (mStszTableEntries->count() > 0 && OK != checkCodecSpecificData()) {
+    if (mSampleCount > 0 && OK != checkCodecSpecificData()) {
         // No codec specific data.
         mIsMalformed = true;
         return true;
@@ -4149,7 +4469,7 @@ void MPEG4Writer::Track::sendTrackSummary(bool hasMultipleTracks) {
 
     mOwner->notify(MEDIA_RECORDER_TRACK_EVENT_INFO,
                     trackNum | MEDIA_RECORDER_TRACK_INFO_ENCODED_FRAMES,
-                    mStszTableEntries->count());
+                    mSampleCount);
 
     {
         // The system delay time excluding the requested initial delay that
@@ -4251,10 +4571,30 @@ void MPEG4Writer::Track::bufferChunk(int64_t timestampUs) {
     ALOGV("bufferChunk");
 
     Chunk chunk(this, timestampUs, mChunkSamples);
+    if (mOwner->isFragmented()) {
+        if (!mInitSegmentStateCaptured) {
+            captureInitSegmentState();
+        }
+        chunk.mBaseDecodeTicks = mFragmentDecodeTicks;
+        for (const FragmentSample &sample : mFragmentSamples) {
+            mFragmentDecodeTicks += sample.mDurationTicks;
+        }
+        chunk.mFragmentSamples = std::move(mFragmentSamples);
+        mFragmentSamples.clear();
+    }
     mOwner->bufferChunk(chunk);
     mChunkSamples.clear();
 }
 
+void MPEG4Writer::Track::captureInitSegmentState() {
+    // Evaluated here, as the writer thread must not read the sample counts.
+    const bool hasSampleEntry = mSampleCount > 0 && !isTrackMalFormed();
+    Mutex::Autolock autolock(mOwner->mLock);
+    mInitSegmentHasSampleEntry = hasSampleEntry;
+    mInitSegmentStateCaptured = true;
+    mOwner->mChunkReadyCondition.signal();
+}
+
 int64_t MPEG4Writer::Track::getDurationUs() const {
     return mTrackDurationUs + getStartTimeOffsetTimeUs() + mOwner->getStartTimeOffsetBFramesUs();
 }
@@ -4377,7 +4717,9 @@ int64_t MPEG4Writer::Track::getMinCttsOffsetTimeUs() {
 void MPEG4Writer::Track::writeStblBox() {
     mOwner->beginBox("stbl");
     // Add subboxes for only non-empty and well-formed tracks.
-    if (mStszTableEntries->count() > 0 && !isTrackMalFormed()) {
+    const bool hasSampleEntry = mOwner->isFragmented()
+            ? mInitSegmentHasSampleEntry : mSampleCount > 0 && !isTrackMalFormed();
+    if (hasSampleEntry) {
         mOwner->beginBox("stsd");
         mOwner->writeInt32(0);               // version=0, flags=0
         mOwner->writeInt32(1);               // entry count
@@ -4390,7 +4732,9 @@ void MPEG4Writer::Track::writeStblBox() {
         }
         mOwner->endBox();  // stsd
         writeSttsBox();
-        if (mIsVideo) {
+        // Sync samples of fragmented files are flagged in the trun boxes, and an
+        // empty stss box would mean none is.
+        if (mIsVideo && !mOwner->isFragmented()) {
             writeCttsBox();
             writeStssBox();
         }
@@ -4763,7 +5107,8 @@ void MPEG4Writer::Track::writeTkhdBox(uint32_t now) {
     mOwner->writeInt32(now);           // modification time
     mOwner->writeInt32(mTrackId.getId()); // track id starts with 1
     mOwner->writeInt32(0);             // reserved
-    int64_t trakDurationUs = getDurationUs();
+    // The duration of a fragmented file is only in its mehd box.
+    int64_t trakDurationUs = mOwner->isFragmented() ? 0 : getDurationUs();
     int32_t mvhdTimeScale = mOwner->getTimeScale();
     int32_t tkhdDuration =
         (trakDurationUs * mvhdTimeScale + 5E5) / 1E6;
@@ -4852,8 +5197,12 @@ void MPEG4Writer::Track::writeEdtsBox() {
     ALOGV("movieStartOffsetBFramesUs:%" PRId32, movieStartOffsetBFramesUs);
 
     // This media/track's real duration (sum of duration of all samples in this track).
-    uint32_t tkhdDurationTicks = (mTrackDurationUs * mvhdTimeScale + 5E5) / 1E6;
-    ALOGV("mTrackDurationUs:%" PRId64 "us", mTrackDurationUs);
+    // Still changing when the moov box of a fragmented file is written, and not needed then.
+    uint32_t tkhdDurationTicks = 0;
+    if (!mOwner->isFragmented()) {
+        tkhdDurationTicks = (mTrackDurationUs * mvhdTimeScale + 5E5) / 1E6;
+        ALOGV("mTrackDurationUs:%" PRId64 "us", mTrackDurationUs);
+    }
 
     int64_t movieStartTimeUs = mOwner->getStartTimestampUs();
     ALOGV("movieStartTimeUs:%" PRId64, movieStartTimeUs);
@@ -4861,7 +5210,20 @@ void MPEG4Writer::Track::writeEdtsBox() {
     int64_t trackStartTimeUs = movieStartTimeUs + trackStartOffsetUs;
     ALOGV("trackStartTimeUs:%" PRId64, trackStartTimeUs);
 
-    if (movieStartOffsetBFramesUs == 0) {
+    if (mOwner->isFragmented()) {
+        // The moov box is written before the track duration is known; a
+        // segment_duration of 0 extends the edit to the end of the media.
+        // Composition offsets in trun boxes are signed, so no B frames offset either.
+        if (trackStartOffsetUs > 0) {
+            uint32_t segDuration = (trackStartOffsetUs * mvhdTimeScale + 5E5) / 1E6;
+            ALOGV("Empty edit list entry for fragmented track");
+            addOneElstTableEntry(segDuration, -1, 1, 0);
+            addOneElstTableEntry(0, 0, 1, 0);
+        } else if (mFirstSampleStartOffsetUs > 0) {
+            int32_t mediaTime = (mFirstSampleStartOffsetUs * mTimeScale + 5E5) / 1E6;
+            addOneElstTableEntry(0, mediaTime, 1, 0);
+        }
+    } else if (movieStartOffsetBFramesUs == 0) {
         // No B frames in any tracks.
         if (trackStartOffsetUs > 0) {
             // Track with positive start offset.
@@ -4966,7 +5328,7 @@ void MPEG4Writer::Track::writeEdtsBox() {
 }
 
 void MPEG4Writer::Track::writeMdhdBox(uint32_t now) {
-    int64_t trakDurationUs = getDurationUs();
+    int64_t trakDurationUs = mOwner->isFragmented() ? 0 : getDurationUs();
     int64_t mdhdDuration = (trakDurationUs * mTimeScale + 5E5) / 1E6;
     mOwner->beginBox("mdhd");
 
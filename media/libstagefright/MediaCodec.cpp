@@ -1202,6 +1202,9 @@ MediaCodec::MediaCodec(
       mHaveInputSurface(false),
       mHavePendingInputBuffers(false),
       mCpuBoostRequested(false),
+      mSyncFastPathAllowed(property_get_bool("debug.stagefright.sync_fast_path", true)),
+      mSyncFastPathEnabled(false),
+      mBufferArraysStatus(INVALID_OPERATION),
       mIsSurfaceToDisplay(false),
       mAreRenderMetricsEnabled(areRenderMetricsEnabled()),
       mVideoRenderQualityTracker(
@@ -3164,6 +3167,13 @@ status_t MediaCodec::queueInputBuffer(
     msg->setInt32("flags", flags);
     msg->setPointer("errorDetailMsg", errorDetailMsg);
 
+    {
+        Mutex::Autolock al(mSyncFastPathLock);
+        if (mSyncFastPathEnabled) {
+            return onQueueInputBuffer(msg);
+        }
+    }
+
     sp<AMessage> response;
     return PostAndAwaitResponse(msg, &response);
 }
@@ -3278,6 +3288,21 @@ status_t MediaCodec::queueEncryptedBuffer(
 }
 
 status_t MediaCodec::dequeueInputBuffer(size_t *index, int64_t timeoutUs) {
+    {
+        Mutex::Autolock al(mSyncFastPathLock);
+        if (mSyncFastPathEnabled) {
+            ssize_t fastIndex = dequeuePortBuffer(kPortIndexInput);
+            if (fastIndex >= 0) {
+                *index = fastIndex;
+                return OK;
+            }
+            if (timeoutUs == 0LL) {
+                return -EAGAIN;
+            }
+            // waiting for a buffer is left to the looper
+        }
+    }
+
     sp<AMessage> msg = new AMessage(kWhatDequeueInputBuffer, this);
     msg->setInt64("timeoutUs", timeoutUs);
 
@@ -3299,6 +3324,33 @@ status_t MediaCodec::dequeueOutputBuffer(
         int64_t *presentationTimeUs,
         uint32_t *flags,
         int64_t timeoutUs) {
+    {
+        Mutex::Autolock al(mSyncFastPathLock);
+        if (mSyncFastPathEnabled) {
+            BufferInfo *info = peekNextPortBuffer(kPortIndexOutput);
+            if (info == nullptr) {
+                if (timeoutUs == 0LL) {
+                    return -EAGAIN;
+                }
+            } else {
+                sp<MediaCodecBuffer> buffer = info->mData;
+                int32_t bufferFlags;
+                CHECK(buffer->meta()->findInt32("flags", &bufferFlags));
+                // Format changes and decode-only buffers are handled by the looper.
+                if (buffer->format() == mOutputFormat
+                        && (bufferFlags & BUFFER_FLAG_DECODE_ONLY) == 0) {
+                    *index = dequeuePortBuffer(kPortIndexOutput);
+                    *offset = buffer->offset();
+                    *size = buffer->size();
+                    CHECK(buffer->meta()->findInt64("timeUs", presentationTimeUs));
+                    *flags = bufferFlags;
+                    statsBufferReceived(*presentationTimeUs, buffer);
+                    return OK;
+                }
+            }
+        }
+    }
+
     sp<AMessage> msg = new AMessage(kWhatDequeueOutputBuffer, this);
     msg->setInt64("timeoutUs", timeoutUs);
 
@@ -3340,6 +3392,13 @@ status_t MediaCodec::releaseOutputBuffer(size_t index) {
     sp<AMessage> msg = new AMessage(kWhatReleaseOutputBuffer, this);
     msg->setSize("index", index);
 
+    {
+        Mutex::Autolock al(mSyncFastPathLock);
+        if (mSyncFastPathEnabled) {
+            return onReleaseOutputBuffer(msg);
+        }
+    }
+
     sp<AMessage> response;
     return PostAndAwaitResponse(msg, &response);
 }
@@ -3465,6 +3524,10 @@ status_t MediaCodec::getOutputBuffers(Vector<sp<MediaCodecBuffer> > *buffers) co
     return PostAndAwaitResponse(msg, &response);
 }
 
+status_t MediaCodec::getBufferArraysStatus() const {
+    return mBufferArraysStatus;
+}
+
 status_t MediaCodec::getOutputBuffer(size_t index, sp<MediaCodecBuffer> *buffer) {
     sp<AMessage> format;
     return getBufferAndFormat(kPortIndexOutput, index, buffer, &format);
@@ -3781,7 +3844,51 @@ inline void MediaCodec::initClientConfigParcel(ClientConfigParcel& clientConfig)
     clientConfig.id = mCodecId;
 }
 
+bool MediaCodec::canUseSyncFastPath() {
+    // Anything beyond plain buffer cycling in the executing state, such as
+    // pending dequeues, errors, secure or block model buffers, goes through
+    // the looper.
+    return mState == STARTED
+            && (mFlags & (kFlagIsAsync
+                    | kFlagStickyError
+                    | kFlagOutputFormatChanged
+                    | kFlagOutputBuffersChanged
+                    | kFlagDequeueInputPending
+                    | kFlagDequeueOutputPending
+                    | kFlagIsSecure
+                    | kFlagUseBlockModel)) == 0
+            && !mHaveInputSurface
+            && !mTunneled
+            && !hasCryptoOrDescrambler()
+            && mCSD.empty()
+            && mLeftover.empty();
+}
+
+void MediaCodec::updateBufferArraysStatus() {
+    status_t status = OK;
+    if (!isExecuting() || (mFlags & kFlagIsAsync)) {
+        status = INVALID_OPERATION;
+    } else if (mFlags & kFlagStickyError) {
+        status = getStickyError();
+    }
+    mBufferArraysStatus = status;
+}
+
 void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
+    {
+        Mutex::Autolock al(mSyncFastPathLock);
+        mSyncFastPathEnabled = false;
+    }
+
+    handleMessage(msg);
+    updateBufferArraysStatus();
+
+    bool enable = canUseSyncFastPath();
+    Mutex::Autolock al(mSyncFastPathLock);
+    mSyncFastPathEnabled = enable && mSyncFastPathAllowed;
+}
+
+void MediaCodec::handleMessage(const sp<AMessage> &msg) {
     switch (msg->what()) {
         case kWhatCodecNotify:
         {
@@ -5831,6 +5938,7 @@ void MediaCodec::setState(State newState) {
     }
 
     mState = newState;
+    updateBufferArraysStatus();
 
     if (mBatteryChecker != nullptr) {
         mBatteryChecker->setExecuting(isExecuting());
@@ -37,6 +37,14 @@
 #include <dirent.h>
 #include <dlfcn.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace android {
 
 // static
@@ -128,6 +136,210 @@ std::shared_ptr<std::list<sp<ExtractorPlugin>>> MediaExtractorFactory::gPlugins;
 bool MediaExtractorFactory::gPluginsRegistered = false;
 bool MediaExtractorFactory::gIgnoreVersion = false;
 
+namespace {
+
+// Size of the start of the content read once and shared by all the sniffers. Most of them
+// only look at the first few KB, which would otherwise take one read of the source each,
+// i.e. one binder transaction when sniffing in the extractor service.
+constexpr size_t kSniffWindowSize = 64 * 1024;
+
+// The sniffers run on up to this many threads, including the calling one. The other threads
+// are started once and shared by all the callers.
+constexpr unsigned kMaxSniffThreads = 4;
+
+// Sniffers report their confidence between 0 and 1. Once one is certain of the format,
+// the sniffers after it cannot be chosen and are not run.
+constexpr float kMaxSniffConfidence = 1.0f;
+
+// Serves the sniffers from the window when they read within it. The window is read on the
+// first such read. Other reads, including those that cross the end of the window, go to the
+// source one at a time since sources are not required to support concurrent reads.
+//
+// There is no window for caching or HTTP based sources, whose reads may block until the data
+// is downloaded, nor for sources of unknown size, which may be live streams: reading ahead
+// could delay the sniffers by much more than it saves.
+class SniffDataSource : public DataSource {
+public:
+    explicit SniffDataSource(const sp<DataSource> &source)
+        : mSource(source), mFlags(source->flags()) {
+        mSizeStatus = mSource->getSize(&mSize);
+        if (mSizeStatus == OK
+                && (mFlags & (kIsCachingDataSource | kIsHTTPBasedSource)) == 0) {
+            mWindowSize = std::clamp<off64_t>(mSize, 0, kSniffWindowSize);
+        }
+    }
+
+    status_t initCheck() const override { return mSource->initCheck(); }
+
+    ssize_t readAt(off64_t offset, void *data, size_t size) override {
+        if (isInWindow(offset, size, mWindowSize)) {
+            std::call_once(mWindowRead, [this] {
+                std::lock_guard _l(mLock);
+                mWindow.resize(mWindowSize);
+                ssize_t n = mSource->readAt(0, mWindow.data(), mWindowSize);
+                mWindow.resize(n > 0 ? n : 0);
+            });
+            if (isInWindow(offset, size, mWindow.size())) {
+                memcpy(data, mWindow.data() + offset, size);
+                return size;
+            }
+        }
+        std::lock_guard _l(mLock);
+        return mSource->readAt(offset, data, size);
+    }
+
+    status_t getSize(off64_t *size) override {
+        *size = mSize;
+        return mSizeStatus;
+    }
+
+    uint32_t flags() override { return mFlags; }
+
+    String8 toString() override {
+        std::lock_guard _l(mLock);
+        return String8::format("SniffDataSource(%s)", mSource->toString().c_str());
+    }
+
+    String8 getUri() override {
+        std::lock_guard _l(mLock);
+        return mSource->getUri();
+    }
+
+private:
+    static bool isInWindow(off64_t offset, size_t size, size_t windowSize) {
+        return offset >= 0 && size <= windowSize
+                && static_cast<uint64_t>(offset) <= windowSize - size;
+    }
+
+    const sp<DataSource> mSource;
+    const uint32_t mFlags;
+    off64_t mSize = 0;
+    status_t mSizeStatus;
+    size_t mWindowSize = 0;
+    std::once_flag mWindowRead;
+    std::vector<uint8_t> mWindow;  // set once by mWindowRead
+    std::mutex mLock;  // serializes the accesses to mSource after construction
+};
+
+struct SniffResult {
+    void *creator = nullptr;
+    float confidence = 0.0f;
+    void *meta = nullptr;
+    FreeMetaFunc freeMeta = nullptr;
+};
+
+SniffResult sniffPlugin(const sp<ExtractorPlugin> &plugin, CDataSource *source) {
+    ALOGV("sniffing %s", plugin->def.extractor_name);
+    SniffResult result;
+    if (plugin->def.def_version == EXTRACTORDEF_VERSION_NDK_V1) {
+        result.creator = (void*) plugin->def.u.v2.sniff(
+                source, &result.confidence, &result.meta, &result.freeMeta);
+    } else if (plugin->def.def_version == EXTRACTORDEF_VERSION_NDK_V2) {
+        result.creator = (void*) plugin->def.u.v3.sniff(
+                source, &result.confidence, &result.meta, &result.freeMeta);
+    }
+    return result;
+}
+
+// The plugins of one sniff() call, taken in order by the threads running them. stop is
+// lowered to just after the first plugin that is certain of the format, so that all the
+// plugins before it still run.
+struct SniffJob {
+    SniffJob(const std::list<sp<ExtractorPlugin>> &plugins, const sp<DataSource> &source)
+        : pluginList(plugins.begin(), plugins.end()),
+          results(pluginList.size()),
+          sniffSource(new SniffDataSource(source)),
+          sniffCSource(sniffSource->wrap()),
+          stop(pluginList.size()) {}
+
+    const std::vector<sp<ExtractorPlugin>> pluginList;
+    std::vector<SniffResult> results;
+    const sp<SniffDataSource> sniffSource;
+    CDataSource *const sniffCSource;
+
+    std::mutex lock;
+    std::condition_variable cond;
+    size_t next = 0;     // guarded by lock
+    size_t stop;         // guarded by lock
+    size_t running = 0;  // guarded by lock, sniffers in progress
+
+    // Runs the plugins left until there are none.
+    void run() {
+        std::unique_lock l(lock);
+        while (next < stop) {
+            const size_t i = next++;
+            running++;
+            l.unlock();
+            SniffResult result = sniffPlugin(pluginList[i], sniffCSource);
+            l.lock();
+            results[i] = result;
+            if (result.creator != nullptr && result.confidence >= kMaxSniffConfidence) {
+                stop = std::min(stop, i + 1);
+            }
+            if (--running == 0) {
+                cond.notify_all();
+            }
+        }
+    }
+
+    // Runs the plugins left, then waits for those started by other threads. After that,
+    // the other threads cannot start any plugin, and results can be read without lock.
+    void runAndWait() {
+        run();
+        std::unique_lock l(lock);
+        cond.wait(l, [this] { return running == 0; });
+    }
+};
+
+// Threads helping the callers of sniff(). They are started on the first call and never
+// exit. A job that was posted but not picked up before its caller ran all its plugins finds
+// nothing left to do, so callers never wait for each other.
+class SniffThreadPool {
+public:
+    static SniffThreadPool &get() {
+        static SniffThreadPool *pool = new SniffThreadPool(std::min(
+                kMaxSniffThreads, std::max(std::thread::hardware_concurrency(), 1u)) - 1);
+        return *pool;
+    }
+
+    size_t size() const { return mNumThreads; }
+
+    void post(const std::shared_ptr<SniffJob> &job) {
+        {
+            std::lock_guard _l(mLock);
+            mJobs.push_back(job);
+        }
+        mCond.notify_one();
+    }
+
+private:
+    explicit SniffThreadPool(size_t numThreads) : mNumThreads(numThreads) {
+        for (size_t i = 0; i < numThreads; i++) {
+            std::thread([this] { threadLoop(); }).detach();
+        }
+    }
+
+    void threadLoop() {
+        for (;;) {
+            std::shared_ptr<SniffJob> job;
+            {
+                std::unique_lock l(mLock);
+                mCond.wait(l, [this] { return !mJobs.empty(); });
+                job = std::move(mJobs.front());
+                mJobs.pop_front();
+            }
+            job->run();
+        }
+    }
+
+    const size_t mNumThreads;
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::deque<std::shared_ptr<SniffJob>> mJobs;  // guarded by mLock
+};
+
+}  // namespace
+
 // static
 void *MediaExtractorFactory::sniff(
         const sp<DataSource> &source, float *confidence, void **meta,
@@ -144,37 +356,41 @@ void *MediaExtractorFactory::sniff(
         plugins = gPlugins;
     }
 
+    // The sniffers already run concurrently when several clients create extractors, so
+    // they can share the source as long as its reads are serialized.
+    const std::shared_ptr<SniffJob> job = std::make_shared<SniffJob>(*plugins, source);
+    SniffThreadPool &pool = SniffThreadPool::get();
+    const size_t numHelpers = job->pluginList.empty()
+            ? 0 : std::min(pool.size(), job->pluginList.size() - 1);
+    for (size_t i = 0; i < numHelpers; i++) {
+        pool.post(job);
+    }
+    job->runAndWait();
+    const std::vector<sp<ExtractorPlugin>> &pluginList = job->pluginList;
+    std::vector<SniffResult> &results = job->results;
+    const size_t stopIndex = job->stop;
+
+    // Same choice as sniffing one plugin after the other: the first plugin with the highest
+    // confidence wins.
     void *bestCreator = NULL;
-    for (auto it = plugins->begin(); it != plugins->end(); ++it) {
-        ALOGV("sniffing %s", (*it)->def.extractor_name);
-        float newConfidence;
-        void *newMeta = nullptr;
-        FreeMetaFunc newFreeMeta = nullptr;
-
-        void *curCreator = NULL;
-        if ((*it)->def.def_version == EXTRACTORDEF_VERSION_NDK_V1) {
-            curCreator = (void*) (*it)->def.u.v2.sniff(
-                    source->wrap(), &newConfidence, &newMeta, &newFreeMeta);
-        } else if ((*it)->def.def_version == EXTRACTORDEF_VERSION_NDK_V2) {
-            curCreator = (void*) (*it)->def.u.v3.sniff(
-                    source->wrap(), &newConfidence, &newMeta, &newFreeMeta);
+    for (size_t i = 0; i < results.size(); i++) {
+        SniffResult &result = results[i];
+        if (result.creator == nullptr) {
+            continue;
         }
-
-        if (curCreator) {
-            if (newConfidence > *confidence) {
-                *confidence = newConfidence;
-                if (*meta != nullptr && *freeMeta != nullptr) {
-                    (*freeMeta)(*meta);
-                }
-                *meta = newMeta;
-                *freeMeta = newFreeMeta;
-                plugin = *it;
-                bestCreator = curCreator;
-                *creatorVersion = (*it)->def.def_version;
-            } else {
-                if (newMeta != nullptr && newFreeMeta != nullptr) {
-                    newFreeMeta(newMeta);
-                }
+        if (i < stopIndex && result.confidence > *confidence) {
+            *confidence = result.confidence;
+            if (*meta != nullptr && *freeMeta != nullptr) {
+                (*freeMeta)(*meta);
+            }
+            *meta = result.meta;
+            *freeMeta = result.freeMeta;
+            plugin = pluginList[i];
+            bestCreator = result.creator;
+            *creatorVersion = pluginList[i]->def.def_version;
+        } else {
+            if (result.meta != nullptr && result.freeMeta != nullptr) {
+                result.freeMeta(result.meta);
             }
         }
     }
@@ -331,6 +547,19 @@ void MediaExtractorFactory::LoadExtractors() {
     gPluginsRegistered = true;
 }
 
+// static
+void MediaExtractorFactory::SetExtractorsForTest(const std::vector<ExtractorDef> &defs) {
+    std::shared_ptr<std::list<sp<ExtractorPlugin>>> newList(new std::list<sp<ExtractorPlugin>>());
+    for (const ExtractorDef &def : defs) {
+        String8 path(def.extractor_name);
+        RegisterExtractor(new ExtractorPlugin(def, nullptr, path), *newList);
+    }
+
+    Mutex::Autolock autoLock(gPluginMutex);
+    gPlugins = newList;
+    gPluginsRegistered = true;
+}
+
 // static
 std::vector<std::string> MediaExtractorFactory::getSupportedTypes() {
     if (getuid() == AID_MEDIA_EX) {
@@ -49,6 +49,12 @@ struct FrameDecoder : public RefBase {
 
     sp<IMemory> extractFrame(FrameRect *rect = NULL);
 
+    // Repositions an initialized decoder so that the next extractFrame() returns the frame
+    // at frameTimeUs for the given seek option, reusing the codec instead of creating a new one.
+    // Frames returned before are left untouched. Returns ERROR_UNSUPPORTED if the decoder
+    // cannot be reused for this request, in which case a new decoder should be created.
+    status_t seekTo(int64_t frameTimeUs, int option);
+
     static sp<IMemory> getMetadataOnly(
             const sp<MetaData> &trackMeta, int colorFormat,
             bool thumbnail = false, uint32_t bitDepth = 0);
@@ -64,6 +70,18 @@ protected:
 
     virtual status_t onExtractRect(FrameRect *rect) = 0;
 
+    // Called by seekTo(). canDecodeForward tells whether the decoder still has inputs to
+    // decode from its current position. Sets *decodeForward if the requested frame should
+    // be reached by decoding forward instead of seeking the source and flushing the decoder.
+    virtual status_t onSeek(
+            int64_t frameTimeUs __unused,
+            int seekMode __unused,
+            bool canDecodeForward __unused,
+            MediaSource::ReadOptions *options __unused,
+            bool *decodeForward __unused) {
+        return ERROR_UNSUPPORTED;
+    }
+
     virtual status_t onInputReceived(
             const sp<MediaCodecBuffer> &codecBuffer,
             MetaDataBase &sampleMeta,
@@ -121,6 +139,13 @@ protected:
         return (rect == NULL) ? OK : ERROR_UNSUPPORTED;
     }
 
+    virtual status_t onSeek(
+            int64_t frameTimeUs,
+            int seekMode,
+            bool canDecodeForward,
+            MediaSource::ReadOptions *options,
+            bool *decodeForward) override;
+
     virtual status_t onInputReceived(
             const sp<MediaCodecBuffer> &codecBuffer,
             MetaDataBase &sampleMeta,
@@ -140,6 +165,7 @@ private:
     bool mIsHevc;
     MediaSource::ReadOptions::SeekMode mSeekMode;
     int64_t mTargetTimeUs;
+    int64_t mLastOutputTimeUs;
     List<int64_t> mSampleDurations;
     int64_t mDefaultSampleDurationUs;
 
@@ -88,6 +88,15 @@ struct AudioSource : public MediaSource,
 
     status_t getPortId(audio_port_handle_t *portId) const;
 
+    // Applies the linear fade-in of the first rampDurationFrames frames of a recording to
+    // frameCount interleaved 16-bit frames, the first of which is frame startFrame of the ramp.
+    static void rampVolume(
+            int16_t *data, size_t frameCount, int32_t channelCount,
+            int64_t startFrame, int32_t rampDurationFrames);
+
+    // Returns the maximum absolute value of sampleCount 16-bit samples, saturated to INT16_MAX.
+    static int16_t maxAmplitude(const int16_t *data, size_t sampleCount);
+
 protected:
     virtual ~AudioSource();
 
@@ -95,6 +104,9 @@ private:
     enum {
         kMaxBufferSize = 2048,
 
+        // Maximum number of returned buffers kept for reuse by onMoreData().
+        kMaxFreeBuffers = 8,
+
         // After the initial mute, we raise the volume linearly
         // over kAutoRampDurationUs.
         kAutoRampDurationUs = 300000,
@@ -128,15 +140,13 @@ private:
     bool mNoMoreFramesToRead;
 
     List<MediaBuffer * > mBuffersReceived;
+    // Buffers returned by the encoder, recycled to avoid an allocation per callback.
+    List<MediaBuffer * > mFreeBuffers;
 
     void trackMaxAmplitude(int16_t *data, int nSamples);
 
-    // This is used to raise the volume from mute to the
-    // actual level linearly.
-    void rampVolume(
-        int32_t startFrame, int32_t rampDurationFrames,
-        uint8_t *data,   size_t bytes);
-
+    MediaBuffer *acquireBuffer_l(size_t size);
+    void recycleBuffer_l(MediaBuffer *buffer);
     void queueInputBuffer_l(MediaBuffer *buffer, int64_t timeUs);
     void releaseQueuedFrames_l();
     void waitOutstandingEncodingFrames_l();
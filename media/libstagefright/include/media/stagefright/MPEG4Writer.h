@@ -28,6 +28,7 @@
 #include <media/stagefright/foundation/ALooper.h>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 namespace android {
 
@@ -115,6 +116,12 @@ private:
     bool  mWriteBoxToMemory;
     off64_t mFreeBoxOffset;
     bool mStreamableFile;
+    bool mIsFragmented;  // Write movie fragments instead of a single moov box.
+    int64_t mFragmentDurationUs;
+    int64_t mCmafChunkDurationUs;
+    bool mInitSegmentWritten;  // moov box of a fragmented file has been written.
+    uint32_t mFragmentSequenceNumber;
+    off64_t mMehdDurationOffset;  // File offset of the fragment_duration field in mehd.
     off64_t mMoovExtraSize;
     uint32_t mInterleaveDurationUs;
     int32_t mTimeScale;
@@ -161,16 +168,28 @@ private:
     void writeCachedBoxToFile(const char *type);
     void printWriteDurations();
 
+    // Per sample information of a movie fragment, written to its 'trun' box.
+    struct FragmentSample {
+        uint32_t mSize;
+        uint32_t mDurationTicks;            // In media time scale
+        int32_t  mCompositionOffsetTicks;   // In media time scale
+        bool     mIsSync;
+    };
+
     struct Chunk {
         Track               *mTrack;        // Owner
         int64_t             mTimeStampUs;   // Timestamp of the 1st sample
         List<MediaBuffer *> mSamples;       // Sample data
 
+        // Fragmented files only: each chunk is written as a moof + mdat pair.
+        std::vector<FragmentSample> mFragmentSamples;
+        uint64_t            mBaseDecodeTicks;  // Decoding time of the 1st sample
+
         // Convenient constructor
-        Chunk(): mTrack(NULL), mTimeStampUs(0) {}
+        Chunk(): mTrack(NULL), mTimeStampUs(0), mBaseDecodeTicks(0) {}
 
         Chunk(Track *track, int64_t timeUs, List<MediaBuffer *> samples)
-            : mTrack(track), mTimeStampUs(timeUs), mSamples(samples) {
+            : mTrack(track), mTimeStampUs(timeUs), mSamples(samples), mBaseDecodeTicks(0) {
         }
 
     };
@@ -264,6 +283,12 @@ private:
     // Actually write the given chunk to the file.
     void writeChunkToFile(Chunk* chunk);
 
+    // Fragmented files: write the given chunk as a movie fragment (moof + mdat),
+    // preceded by the moov box for the first one.
+    void writeFragmentToFile(Chunk* chunk);
+    void writeInitSegment();
+    void writeMvexBox();
+
     // Adjust other track media clock (presumably wall clock)
     // based on audio track media clock with the drift time.
     int64_t mDriftTimeUs;
@@ -285,6 +310,13 @@ private:
     // transcoding.
     bool isBackgroundMode() const;
 
+    // Return whether movie fragments are written instead of a single moov box.
+    // Sample tables are then not kept in memory, and the samples written so far
+    // remain playable if the recording is interrupted.
+    bool isFragmented() const { return mIsFragmented; }
+    int64_t fragmentDurationUs() const { return mFragmentDurationUs; }
+    int64_t cmafChunkDurationUs() const { return mCmafChunkDurationUs; }
+
     void lock();
     void unlock();
 
@@ -18,6 +18,7 @@
 
 #define MEDIA_CODEC_H_
 
+#include <atomic>
 #include <list>
 #include <memory>
 #include <vector>
@@ -252,6 +253,11 @@ struct MediaCodec : public AHandler {
     status_t getInputBuffers(Vector<sp<MediaCodecBuffer> > *buffers) const;
     status_t getOutputBuffers(Vector<sp<MediaCodecBuffer> > *buffers) const;
 
+    // Returns what getInputBuffers() and getOutputBuffers() would return as of the
+    // last message handled, without a round trip to the looper: INVALID_OPERATION
+    // unless executing in synchronous mode, the sticky error once there is one, or OK.
+    status_t getBufferArraysStatus() const;
+
     status_t getOutputBuffer(size_t index, sp<MediaCodecBuffer> *buffer);
     status_t getOutputFormat(size_t index, sp<AMessage> *format);
     status_t getInputBuffer(size_t index, sp<MediaCodecBuffer> *buffer);
@@ -571,6 +577,18 @@ private:
     bool mHavePendingInputBuffers;
     bool mCpuBoostRequested;
 
+    // In synchronous mode, queueInputBuffer, dequeueInput/OutputBuffer and
+    // releaseOutputBuffer are served on the calling thread while the fast path
+    // is enabled. The looper disables it for the duration of every message, so
+    // those calls never run concurrently with a message handler.
+    Mutex mSyncFastPathLock;
+    bool mSyncFastPathAllowed;
+    bool mSyncFastPathEnabled;
+
+    // Updated on the looper when the state or the sticky error changes, and after
+    // every message.
+    std::atomic<status_t> mBufferArraysStatus;
+
     std::shared_ptr<BufferChannelBase> mBufferChannel;
     sp<CryptoAsync> mCryptoAsync;
     sp<ALooper> mCryptoLooper;
@@ -625,6 +643,10 @@ private:
         return mCrypto != NULL || mDescrambler != NULL;
     }
 
+    bool canUseSyncFastPath();
+    void updateBufferArraysStatus();
+    void handleMessage(const sp<AMessage> &msg);
+
     void postActivityNotificationIfPossible();
 
     void onInputBufferAvailable();
@@ -658,6 +680,7 @@ private:
     inline void setStickyError(status_t err) {
         mFlags |= kFlagStickyError;
         mStickyError = err;
+        updateBufferArraysStatus();
     }
 
     void onReleaseCrypto(const sp<AMessage>& msg);
@@ -40,6 +40,8 @@ public:
     static void LoadExtractors();
 
 private:
+    friend class ExtractorFactoryTestHelper;
+
     static Mutex gPluginMutex;
     static std::shared_ptr<std::list<sp<ExtractorPlugin>>> gPlugins;
     static bool gPluginsRegistered;
@@ -50,6 +52,8 @@ private:
             std::list<sp<ExtractorPlugin>> &pluginList);
     static void RegisterExtractor(
             const sp<ExtractorPlugin> &plugin, std::list<sp<ExtractorPlugin>> &pluginList);
+    // Replaces the loaded extractors with the given ones, in that order.
+    static void SetExtractorsForTest(const std::vector<ExtractorDef> &defs);
 
     static void *sniff(const sp<DataSource> &source,
             float *confidence, void **meta, FreeMetaFunc *freeMeta,
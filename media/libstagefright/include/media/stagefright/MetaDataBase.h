@@ -265,6 +265,13 @@ enum {
     // Treat empty track as malformed for MediaRecorder.
     kKeyEmptyTrackMalFormed = 'nemt', // bool (int32_t)
 
+    // Fragmented MP4 authoring: minimum duration of each movie fragment. Not set or 0
+    // writes a regular MP4 file with a single moov box.
+    kKeyFragmentDurationUs = 'frdu', // int64_t
+    // Duration of the CMAF chunks (moof + mdat) a fragment is split into, for low
+    // latency streaming. Not set or 0 writes each fragment as a single chunk.
+    kKeyCmafChunkDurationUs = 'cmch', // int64_t
+
     kKeyVps              = 'sVps', // int32_t, indicates that a buffer has vps.
     kKeySps              = 'sSps', // int32_t, indicates that a buffer has sps.
     kKeyPps              = 'sPps', // int32_t, indicates that a buffer has pps.
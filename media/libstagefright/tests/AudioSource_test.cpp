@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks the fade-in ramp and the max amplitude scan of AudioSource against the scalar
+// code they replaced, kept below as the golden reference.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AudioSource_test"
+#include <utils/Log.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/AudioSource.h>
+
+namespace android {
+
+namespace {
+
+constexpr int32_t kRampDurationFrames = 4800;  // 100 ms at 48 kHz
+
+// The ramp AudioSource used to apply, for mono, where frames and samples are the same.
+void oldRampVolumeMono(int32_t startFrame, int32_t rampDurationFrames,
+        uint8_t *data, size_t bytes) {
+    const int32_t kShift = 14;
+    int32_t fixedMultiplier = (startFrame << kShift) / rampDurationFrames;
+    int32_t stopFrame = startFrame + bytes / sizeof(int16_t);
+    int16_t *frame = (int16_t *) data;
+    if (stopFrame > rampDurationFrames) {
+        stopFrame = rampDurationFrames;
+    }
+
+    while (startFrame < stopFrame) {
+        frame[0] = (frame[0] * fixedMultiplier) >> kShift;
+        ++frame;
+        ++startFrame;
+
+        // Update the multiplier every 4 frames
+        if ((startFrame & 3) == 0) {
+            fixedMultiplier = (startFrame << kShift) / rampDurationFrames;
+        }
+    }
+}
+
+// The max amplitude tracking AudioSource used to do, which skipped -32768.
+void oldTrackMaxAmplitude(int16_t *maxAmplitude, const int16_t *data, int nSamples) {
+    for (int i = nSamples; i > 0; --i) {
+        int16_t value = *data++;
+        if (value < 0) {
+            value = -value;
+        }
+        if (*maxAmplitude < value) {
+            *maxAmplitude = value;
+        }
+    }
+}
+
+// Deterministic samples in [-32767, 32767].
+std::vector<int16_t> makeSamples(size_t count, uint32_t seed) {
+    std::vector<int16_t> samples(count);
+    for (int16_t &sample : samples) {
+        seed = seed * 1664525u + 1013904223u;
+        sample = (int16_t) ((int32_t) (seed >> 16) % 65535 - 32767);
+    }
+    return samples;
+}
+
+// Ramps frameCount frames, delivered in buffers of the given sizes in turn, from the start
+// of the ramp, with the new code.
+std::vector<int16_t> ramp(std::vector<int16_t> samples, int32_t channelCount,
+        const std::vector<size_t> &bufferFrames) {
+    const size_t frameCount = samples.size() / channelCount;
+    size_t frame = 0;
+    for (size_t i = 0; frame < frameCount; i++) {
+        size_t n = std::min(bufferFrames[i % bufferFrames.size()], frameCount - frame);
+        AudioSource::rampVolume(samples.data() + frame * channelCount, n, channelCount,
+                frame, kRampDurationFrames);
+        frame += n;
+    }
+    return samples;
+}
+
+// The same with the old code, applied to each channel on its own.
+std::vector<int16_t> oldRamp(std::vector<int16_t> samples, int32_t channelCount,
+        const std::vector<size_t> &bufferFrames) {
+    const size_t frameCount = samples.size() / channelCount;
+    for (int32_t c = 0; c < channelCount; c++) {
+        std::vector<int16_t> channel(frameCount);
+        for (size_t f = 0; f < frameCount; f++) {
+            channel[f] = samples[f * channelCount + c];
+        }
+        size_t frame = 0;
+        for (size_t i = 0; frame < frameCount; i++) {
+            size_t n = std::min(bufferFrames[i % bufferFrames.size()], frameCount - frame);
+            oldRampVolumeMono((int32_t) frame, kRampDurationFrames, (uint8_t *) &channel[frame],
+                    n * sizeof(int16_t));
+            frame += n;
+        }
+        for (size_t f = 0; f < frameCount; f++) {
+            samples[f * channelCount + c] = channel[f];
+        }
+    }
+    return samples;
+}
+
+// Buffer sizes in frames, aligned or not on the 4 frame blocks of the ramp.
+const std::vector<std::vector<size_t>> kBufferFrames = {
+    {(size_t) kRampDurationFrames * 2}, {1}, {3}, {4}, {5, 7}, {160}, {441}, {1, 960, 13},
+};
+
+}  // namespace
+
+// For mono, the ramp is the old one, whatever the buffer sizes. The ramp ends after
+// kRampDurationFrames frames, and leaves the rest as is.
+TEST(AudioSourceTest, MonoRampMatchesOldCode) {
+    const std::vector<int16_t> samples = makeSamples(kRampDurationFrames + 1000, 1);
+    for (const std::vector<size_t> &bufferFrames : kBufferFrames) {
+        std::vector<int16_t> expected = oldRamp(samples, 1, bufferFrames);
+        std::vector<int16_t> actual = ramp(samples, 1, bufferFrames);
+        ASSERT_EQ(expected, actual) << "first buffer size " << bufferFrames[0];
+        EXPECT_TRUE(std::equal(samples.begin() + kRampDurationFrames, samples.end(),
+                actual.begin() + kRampDurationFrames))
+                << "first buffer size " << bufferFrames[0];
+    }
+}
+
+// With more channels, every channel gets the old mono ramp, one gain per frame. The old
+// code got this wrong and is not the reference there.
+TEST(AudioSourceTest, MultichannelRampMatchesOldMonoRamp) {
+    for (int32_t channelCount : {2, 3, 6, 8}) {
+        const std::vector<int16_t> samples =
+                makeSamples((kRampDurationFrames + 100) * channelCount, channelCount);
+        for (const std::vector<size_t> &bufferFrames : kBufferFrames) {
+            ASSERT_EQ(oldRamp(samples, channelCount, bufferFrames),
+                    ramp(samples, channelCount, bufferFrames))
+                    << channelCount << " channels, first buffer size " << bufferFrames[0];
+        }
+    }
+}
+
+// The gain starts at 0, never decreases, including across buffers, and reaches unity at
+// the end of the ramp. Buffers aligned on the 4 frame blocks give the gains of a single
+// buffer.
+TEST(AudioSourceTest, RampGainsAcrossBuffers) {
+    constexpr int16_t kUnity = 1 << 14;
+    const std::vector<int16_t> ones(kRampDurationFrames + 8, kUnity);
+    const std::vector<int16_t> single = ramp(ones, 1, {ones.size()});
+    for (const std::vector<size_t> &bufferFrames : kBufferFrames) {
+        std::vector<int16_t> gains = ramp(ones, 1, bufferFrames);
+        EXPECT_EQ(0, gains[0]);
+        EXPECT_TRUE(std::is_sorted(gains.begin(), gains.end()))
+                << "first buffer size " << bufferFrames[0];
+        EXPECT_EQ(kUnity, gains[kRampDurationFrames]);
+        if (std::all_of(bufferFrames.begin(), bufferFrames.end(),
+                [](size_t n) { return n % 4 == 0; })) {
+            EXPECT_EQ(single, gains) << "first buffer size " << bufferFrames[0];
+        }
+    }
+}
+
+// A buffer that starts past the end of the ramp, or a ramp of no length, is left as is.
+TEST(AudioSourceTest, RampOutOfRange) {
+    const std::vector<int16_t> samples = makeSamples(64, 2);
+    std::vector<int16_t> data = samples;
+    AudioSource::rampVolume(data.data(), 32, 2, kRampDurationFrames, kRampDurationFrames);
+    AudioSource::rampVolume(data.data(), 32, 2, 0, 0);
+    AudioSource::rampVolume(data.data(), 32, 2, -1, kRampDurationFrames);
+    EXPECT_EQ(samples, data);
+}
+
+// The max amplitude across buffers, as getMaxAmplitude() reports it, is the old one for
+// every buffer length, including the tails left by the vectorized loop.
+TEST(AudioSourceTest, MaxAmplitudeMatchesOldCode) {
+    const std::vector<int16_t> samples = makeSamples(4096, 3);
+    for (size_t length = 0; length <= 67; length++) {
+        int16_t expected = 0;
+        int16_t actual = 0;
+        for (size_t offset = 0; offset + length <= samples.size(); offset += length + 1) {
+            oldTrackMaxAmplitude(&expected, &samples[offset], length);
+            actual = std::max(actual, AudioSource::maxAmplitude(&samples[offset], length));
+        }
+        EXPECT_EQ(expected, actual) << "length " << length;
+    }
+    for (int16_t sample : {0, 1, -1, 100, -100, INT16_MAX, -INT16_MAX}) {
+        int16_t expected = 0;
+        oldTrackMaxAmplitude(&expected, &sample, 1);
+        EXPECT_EQ(expected, AudioSource::maxAmplitude(&sample, 1)) << "sample " << sample;
+    }
+}
+
+// -32768, which the old code skipped, saturates to INT16_MAX.
+TEST(AudioSourceTest, MaxAmplitudeSaturates) {
+    std::vector<int16_t> samples(33, 5);
+    samples[32] = INT16_MIN;
+    EXPECT_EQ(INT16_MAX, AudioSource::maxAmplitude(samples.data(), samples.size()));
+    EXPECT_EQ(5, AudioSource::maxAmplitude(samples.data(), 32));
+}
+
+}  // namespace android
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the time to get an extractor for each file of the ExtractorFactoryTest corpus,
+// which is dominated by sniffing the content with all the extractor plugins. The reads that
+// reach the file are counted: in the extractor service each of them is a binder transaction.
+//
+// usage: ExtractorFactoryBenchmark [benchmark options] [path_to_res_folder]
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ExtractorFactoryBenchmark"
+#include <utils/Log.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <binder/ProcessState.h>
+#include <datasource/FileSource.h>
+#include <media/stagefright/MediaExtractorFactory.h>
+
+using namespace android;
+
+namespace {
+
+const char *kDefaultRes = "/data/local/tmp/extractor-1.5/";
+
+const char *kCorpus[] = {
+        "loudsoftaac.aac",
+        "testamr.amr",
+        "amrwb.wav",
+        "john_cage.ogg",
+        "monotestgsm.wav",
+        "segment000001.ts",
+        "sinesweepflac.flac",
+        "testopus.opus",
+        "midi_a.mid",
+        "sinesweepvorbis.mkv",
+        "sinesweepoggmp4.mp4",
+        "sinesweepmp3lame.mp3",
+        "swirl_144x136_vp9.webm",
+        "swirl_144x136_vp8.webm",
+        "swirl_132x130_mpeg4.mp4",
+};
+
+class CountingSource : public DataSource {
+public:
+    explicit CountingSource(const sp<DataSource> &source) : mSource(source) {}
+
+    status_t initCheck() const override { return mSource->initCheck(); }
+    ssize_t readAt(off64_t offset, void *data, size_t size) override {
+        mReads++;
+        return mSource->readAt(offset, data, size);
+    }
+    status_t getSize(off64_t *size) override { return mSource->getSize(size); }
+    uint32_t flags() override { return mSource->flags(); }
+    String8 toString() override { return mSource->toString(); }
+
+    int64_t reads() const { return mReads; }
+
+private:
+    const sp<DataSource> mSource;
+    std::atomic<int64_t> mReads{0};
+};
+
+void BM_CreateExtractor(benchmark::State &state, const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat buf;
+    if (fd < 0 || fstat(fd, &buf) != 0) {
+        if (fd >= 0) close(fd);
+        state.SkipWithError("unable to open the input file");
+        return;
+    }
+
+    int64_t reads = 0;
+    for (auto _ : state) {
+        sp<CountingSource> source = new CountingSource(new FileSource(dup(fd), 0, buf.st_size));
+        sp<IMediaExtractor> extractor = MediaExtractorFactory::CreateFromService(source);
+        if (extractor == nullptr) {
+            state.SkipWithError("no extractor found");
+            break;
+        }
+        reads += source->reads();
+        state.SetLabel(extractor->name().c_str());
+    }
+    state.counters["reads"] = benchmark::Counter(reads, benchmark::Counter::kAvgIterations);
+    close(fd);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    const std::string res = argc > 1 ? argv[1] : kDefaultRes;
+
+    ProcessState::self()->startThreadPool();
+    MediaExtractorFactory::LoadExtractors();
+    for (const char *file : kCorpus) {
+        benchmark::RegisterBenchmark(file, BM_CreateExtractor, res + file)
+                ->Unit(benchmark::kMicrosecond);
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks how MediaExtractorFactory picks an extractor, against stub plugins that report a
+// given confidence. The stub extractors record that they were picked, and fail to create.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ExtractorSniffTest"
+#include <utils/Log.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <media/DataSource.h>
+#include <media/MediaExtractorPluginApi.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaExtractorFactory.h>
+
+namespace android {
+
+class ExtractorFactoryTestHelper {
+public:
+    static void SetExtractors(const std::vector<ExtractorDef> &defs) {
+        MediaExtractorFactory::SetExtractorsForTest(defs);
+    }
+};
+
+namespace {
+
+constexpr size_t kNumStubs = 16;
+constexpr char kHeader[] = "stub";
+
+// What a stub plugin reports, and what it saw of the source.
+struct Stub {
+    float confidence;  // 0 for no match
+    std::atomic<int> numCalls;
+    std::atomic<bool> sawHeader;
+    std::atomic<status_t> sizeStatus;
+};
+
+Stub gStubs[kNumStubs];
+std::atomic<int> gNumMetas;
+std::atomic<int> gNumFreedMetas;
+// The stub picked, and the meta it was given, or -1.
+int gCreated;
+int gCreatedMeta;
+
+void FreeStubMeta(void *meta) {
+    delete static_cast<size_t *>(meta);
+    gNumFreedMetas++;
+}
+
+template <size_t N>
+CMediaExtractor *CreateStub(CDataSource *, void *meta) {
+    gCreated = N;
+    gCreatedMeta = meta != nullptr ? *static_cast<size_t *>(meta) : -1;
+    return nullptr;
+}
+
+template <size_t N>
+CreatorFunc SniffStub(CDataSource *source, float *confidence, void **meta,
+                      FreeMetaFunc *freeMeta) {
+    Stub &stub = gStubs[N];
+    stub.numCalls++;
+    char header[sizeof(kHeader)];
+    stub.sawHeader = source->readAt(source->handle, 0, header, sizeof(header))
+                    == (ssize_t) sizeof(header)
+            && memcmp(header, kHeader, sizeof(header)) == 0;
+    off64_t size;
+    stub.sizeStatus = source->getSize(source->handle, &size);
+    if (stub.confidence <= 0.0f) {
+        return nullptr;
+    }
+    *confidence = stub.confidence;
+    *meta = new size_t(N);
+    *freeMeta = FreeStubMeta;
+    gNumMetas++;
+    return CreateStub<N>;
+}
+
+template <size_t... N>
+std::array<SnifferFunc, sizeof...(N)> makeSniffers(std::index_sequence<N...>) {
+    return {SniffStub<N>...};
+}
+
+const std::array<SnifferFunc, kNumStubs> kSniffers =
+        makeSniffers(std::make_index_sequence<kNumStubs>());
+
+const char *kNoTypes[] = {nullptr};
+
+ExtractorDef stubDef(size_t n) {
+    static char names[kNumStubs][16];
+    snprintf(names[n], sizeof(names[n]), "stub %zu", n);
+    return {
+        EXTRACTORDEF_VERSION,
+        {{(uint8_t) (n + 1)}},
+        1,
+        names[n],
+        {
+            .v3 = {kSniffers[n], kNoTypes}
+        },
+    };
+}
+
+class StubDataSource : public DataSource {
+public:
+    explicit StubDataSource(bool sizeKnown, uint32_t flags = 0)
+        : mSizeKnown(sizeKnown), mFlags(flags), mData(1024, 0) {
+        memcpy(mData.data(), kHeader, sizeof(kHeader));
+    }
+
+    status_t initCheck() const override { return OK; }
+
+    ssize_t readAt(off64_t offset, void *data, size_t size) override {
+        mNumReads++;
+        mMaxReadSize = std::max(mMaxReadSize.load(), size);
+        if (offset < 0 || (size_t) offset >= mData.size()) {
+            return 0;
+        }
+        size = std::min(size, mData.size() - (size_t) offset);
+        memcpy(data, mData.data() + offset, size);
+        return size;
+    }
+
+    status_t getSize(off64_t *size) override {
+        if (!mSizeKnown) {
+            return ERROR_UNSUPPORTED;
+        }
+        *size = mData.size();
+        return OK;
+    }
+
+    uint32_t flags() override { return mFlags; }
+
+    int getNumReads() const { return mNumReads; }
+    size_t getMaxReadSize() const { return mMaxReadSize; }
+
+private:
+    const bool mSizeKnown;
+    const uint32_t mFlags;
+    std::vector<uint8_t> mData;
+    std::atomic<int> mNumReads{0};
+    std::atomic<size_t> mMaxReadSize{0};  // reads are serialized by the factory
+};
+
+}  // namespace
+
+class ExtractorSniffTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        for (Stub &stub : gStubs) {
+            stub.confidence = 0.0f;
+            stub.numCalls = 0;
+            stub.sawHeader = false;
+            stub.sizeStatus = OK;
+        }
+        gNumMetas = 0;
+        gNumFreedMetas = 0;
+        gCreated = -1;
+        gCreatedMeta = -1;
+    }
+
+    // Registers the stubs with the given confidences, in that order.
+    void setConfidences(const std::vector<float> &confidences) {
+        std::vector<ExtractorDef> defs;
+        for (size_t i = 0; i < confidences.size(); i++) {
+            gStubs[i].confidence = confidences[i];
+            defs.push_back(stubDef(i));
+        }
+        ExtractorFactoryTestHelper::SetExtractors(defs);
+    }
+
+    // Returns the stub picked for the source, which must have been given its own meta, or
+    // -1. All the metas are freed by then.
+    int pick(const sp<DataSource> &source) {
+        EXPECT_EQ(nullptr, MediaExtractorFactory::CreateFromService(source).get());
+        EXPECT_EQ(gCreated, gCreatedMeta);
+        EXPECT_EQ(gNumMetas.load(), gNumFreedMetas.load());
+        return gCreated;
+    }
+};
+
+// The first plugin with the highest confidence wins, and every plugin runs.
+TEST_F(ExtractorSniffTest, TieGoesToFirstPlugin) {
+    setConfidences({0.5f, 0.8f, 0.0f, 0.8f, 0.2f});
+    EXPECT_EQ(1, pick(new StubDataSource(true)));
+    for (size_t i = 0; i < 5; i++) {
+        EXPECT_EQ(1, gStubs[i].numCalls.load()) << "stub " << i;
+        EXPECT_TRUE(gStubs[i].sawHeader.load()) << "stub " << i;
+    }
+    EXPECT_EQ(4, gNumMetas.load());
+}
+
+// Nothing is picked when no plugin recognizes the content.
+TEST_F(ExtractorSniffTest, NoMatch) {
+    setConfidences(std::vector<float>(kNumStubs, 0.0f));
+    EXPECT_EQ(-1, pick(new StubDataSource(true)));
+    for (size_t i = 0; i < kNumStubs; i++) {
+        EXPECT_EQ(1, gStubs[i].numCalls.load()) << "stub " << i;
+    }
+    EXPECT_EQ(0, gNumMetas.load());
+}
+
+// A plugin that is certain of the format wins over the plugins after it, even certain ones,
+// and stops those that have not started yet. The plugins before it still run.
+TEST_F(ExtractorSniffTest, CertainPluginStopsLaterPlugins) {
+    std::vector<float> confidences(kNumStubs, 1.0f);
+    confidences[0] = 0.5f;
+    setConfidences(confidences);
+    EXPECT_EQ(1, pick(new StubDataSource(true)));
+    EXPECT_EQ(1, gStubs[0].numCalls.load());
+    EXPECT_EQ(1, gStubs[1].numCalls.load());
+    int numLaterCalls = 0;
+    for (size_t i = 2; i < kNumStubs; i++) {
+        EXPECT_LE(gStubs[i].numCalls.load(), 1) << "stub " << i;
+        numLaterCalls += gStubs[i].numCalls;
+    }
+    // At most the plugins already taken by the other sniffing threads.
+    EXPECT_LT(numLaterCalls, 4);
+}
+
+// The start of a local source is read once for all the plugins.
+TEST_F(ExtractorSniffTest, WindowIsReadOnce) {
+    setConfidences({0.0f, 0.3f, 0.6f});
+    sp<StubDataSource> source = new StubDataSource(true);
+    EXPECT_EQ(2, pick(source));
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_TRUE(gStubs[i].sawHeader.load()) << "stub " << i;
+    }
+    EXPECT_EQ(1, source->getNumReads());
+}
+
+// A source of unknown size, which may be a live stream, is not read ahead: the plugins
+// read the header from the source itself and see the error from getSize().
+TEST_F(ExtractorSniffTest, UnknownSizeIsNotReadAhead) {
+    setConfidences({0.0f, 0.3f, 0.6f});
+    sp<StubDataSource> source = new StubDataSource(false);
+    EXPECT_EQ(2, pick(source));
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_TRUE(gStubs[i].sawHeader.load()) << "stub " << i;
+        EXPECT_EQ(ERROR_UNSUPPORTED, gStubs[i].sizeStatus.load()) << "stub " << i;
+    }
+    EXPECT_EQ(3, source->getNumReads());
+    EXPECT_EQ(sizeof(kHeader), source->getMaxReadSize());
+}
+
+// Caching and HTTP based sources, whose reads may wait for the network, are not read ahead.
+TEST_F(ExtractorSniffTest, NetworkSourceIsNotReadAhead) {
+    for (uint32_t flags : {DataSource::kIsCachingDataSource, DataSource::kIsHTTPBasedSource}) {
+        SetUp();
+        setConfidences({0.0f, 0.3f, 0.6f});
+        sp<StubDataSource> source = new StubDataSource(true, flags);
+        EXPECT_EQ(2, pick(source)) << "flags " << flags;
+        for (size_t i = 0; i < 3; i++) {
+            EXPECT_TRUE(gStubs[i].sawHeader.load()) << "flags " << flags << " stub " << i;
+        }
+        EXPECT_EQ(3, source->getNumReads()) << "flags " << flags;
+        EXPECT_EQ(sizeof(kHeader), source->getMaxReadSize()) << "flags " << flags;
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <android-base/file.h>
+#include <binder/Parcel.h>
+#include <media/stagefright/Codec2InfoBuilder.h>
+#include <media/stagefright/MediaCodecListWriter.h>
+#include <media/MediaCodecInfo.h>
+
+#include "MediaTestHelper.h"
+
+namespace android {
+
+namespace {
+
+constexpr char kCachePath[] = "/data/local/tmp/codec2_info_cache_test";
+
+// Builds the Codec2 codec list with the given options, and returns it
+// serialized so that lists can be compared.
+std::string buildCodecList(const Codec2InfoBuilder::Options &options) {
+    std::shared_ptr<MediaCodecListWriter> writer = MediaTestHelper::CreateCodecListWriter();
+    Codec2InfoBuilder builder(options);
+    EXPECT_EQ(OK, builder.buildMediaCodecList(writer.get()));
+
+    std::vector<sp<MediaCodecInfo>> codecInfos;
+    MediaTestHelper::WriteCodecInfos(writer, &codecInfos);
+    Parcel parcel;
+    for (const sp<MediaCodecInfo> &info : codecInfos) {
+        info->writeToParcel(&parcel);
+    }
+    return std::string(reinterpret_cast<const char *>(parcel.data()), parcel.dataSize());
+}
+
+// The cache is replaced by renaming a new file over it, so a rewrite changes
+// the inode.
+ino_t cacheInode() {
+    struct stat st;
+    return stat(kCachePath, &st) == 0 ? st.st_ino : 0;
+}
+
+}  // namespace
+
+class Codec2InfoBuilderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        unlink(kCachePath);
+        mSerialOptions.maxQueryThreads = 1;
+        mSerialOptions.useCache = false;
+        mCacheOptions.cachePath = kCachePath;
+        mSerialList = buildCodecList(mSerialOptions);
+        ASSERT_FALSE(mSerialList.empty());
+    }
+
+    void TearDown() override {
+        unlink(kCachePath);
+    }
+
+    Codec2InfoBuilder::Options mSerialOptions;
+    Codec2InfoBuilder::Options mCacheOptions;
+    std::string mSerialList;
+};
+
+// Querying the component interfaces in parallel produces the same list, in the
+// same order, as querying them one at a time.
+TEST_F(Codec2InfoBuilderTest, ParallelQueriesMatchSerial) {
+    Codec2InfoBuilder::Options options;
+    options.useCache = false;
+    for (size_t maxQueryThreads : {0, 2, 4, 16}) {
+        options.maxQueryThreads = maxQueryThreads;
+        EXPECT_EQ(mSerialList, buildCodecList(options)) << maxQueryThreads << " threads";
+    }
+    EXPECT_EQ(0u, cacheInode());
+}
+
+// The first build writes the cache, and the next ones read it back without
+// rewriting it.
+TEST_F(Codec2InfoBuilderTest, CacheIsWrittenThenReused) {
+    EXPECT_EQ(mSerialList, buildCodecList(mCacheOptions));
+    ino_t inode = cacheInode();
+    ASSERT_NE(0u, inode);
+
+    EXPECT_EQ(mSerialList, buildCodecList(mCacheOptions));
+    EXPECT_EQ(inode, cacheInode());
+}
+
+// A cache that does not belong to the current components, or that is
+// truncated, is ignored and replaced.
+TEST_F(Codec2InfoBuilderTest, InvalidCacheIsReplaced) {
+    EXPECT_EQ(mSerialList, buildCodecList(mCacheOptions));
+    std::string valid;
+    ASSERT_TRUE(base::ReadFileToString(kCachePath, &valid));
+
+    for (const std::string &invalid : {
+            std::string("not a cache"),
+            valid.substr(0, valid.size() / 2),
+            valid.substr(0, valid.size() - sizeof(uint64_t))}) {
+        ASSERT_TRUE(base::WriteStringToFile(invalid, kCachePath));
+        ino_t inode = cacheInode();
+        EXPECT_EQ(mSerialList, buildCodecList(mCacheOptions));
+        EXPECT_NE(inode, cacheInode());
+        std::string rewritten;
+        ASSERT_TRUE(base::ReadFileToString(kCachePath, &rewritten));
+        EXPECT_EQ(valid, rewritten);
+    }
+}
+
+// A cache that cannot be written does not fail the build.
+TEST_F(Codec2InfoBuilderTest, UnwritableCacheIsIgnored) {
+    Codec2InfoBuilder::Options options;
+    options.cachePath = "/data/local/tmp/codec2_info_cache_test_missing_dir/cache";
+    EXPECT_EQ(mSerialList, buildCodecList(options));
+    EXPECT_EQ(mSerialList, buildCodecList(options));
+}
+
+}  // namespace android
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks building the list of Codec2 codecs, as done once per boot by the
+// media server, with the component interfaces queried one at a time, in
+// parallel, or not at all because the results were persisted.
+
+#include <unistd.h>
+
+#include <memory>
+
+#include <benchmark/benchmark.h>
+#include <media/stagefright/Codec2InfoBuilder.h>
+#include <media/stagefright/MediaCodecListWriter.h>
+
+#include "MediaTestHelper.h"
+
+using namespace android;
+
+namespace {
+
+constexpr char kCachePath[] = "/data/local/tmp/codec2_info_cache_benchmark";
+
+void buildCodecList(benchmark::State &state, const Codec2InfoBuilder::Options &options) {
+    // Connect to the Codec2 services, and write the cache, before anything is
+    // timed.
+    {
+        std::shared_ptr<MediaCodecListWriter> writer = MediaTestHelper::CreateCodecListWriter();
+        Codec2InfoBuilder(options).buildMediaCodecList(writer.get());
+    }
+    for (auto _ : state) {
+        std::shared_ptr<MediaCodecListWriter> writer = MediaTestHelper::CreateCodecListWriter();
+        Codec2InfoBuilder builder(options);
+        if (builder.buildMediaCodecList(writer.get()) != OK) {
+            state.SkipWithError("buildMediaCodecList failed");
+            break;
+        }
+    }
+}
+
+}  // namespace
+
+// range(0) is the maximum number of component interfaces queried in parallel,
+// 0 picking the default.
+static void BM_BuildWithQueries(benchmark::State &state) {
+    Codec2InfoBuilder::Options options;
+    options.maxQueryThreads = state.range(0);
+    options.useCache = false;
+    buildCodecList(state, options);
+}
+
+BENCHMARK(BM_BuildWithQueries)
+        ->ArgName("maxQueryThreads")
+        ->Arg(1)
+        ->Arg(0)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+static void BM_BuildFromCache(benchmark::State &state) {
+    unlink(kCachePath);
+    Codec2InfoBuilder::Options options;
+    options.cachePath = kCachePath;
+    buildCodecList(state, options);
+    unlink(kCachePath);
+}
+
+BENCHMARK(BM_BuildFromCache)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
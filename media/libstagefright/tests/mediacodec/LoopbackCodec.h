@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOOPBACK_CODEC_H_
+
+#define LOOPBACK_CODEC_H_
+
+#include <mutex>
+#include <vector>
+
+#include <media/MediaCodecBuffer.h>
+#include <media/MediaCodecInfo.h>
+#include <media/stagefright/CodecBase.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaCodecListWriter.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ALooper.h>
+
+#include "MediaTestHelper.h"
+
+namespace android {
+
+constexpr size_t kNumLoopbackBuffers = 8;
+constexpr size_t kLoopbackBufferSize = 4096;
+
+const AString kLoopbackCodecName{"test.loopback"};
+const AString kLoopbackCodecOwner{"nobody"};
+const AString kLoopbackMediaType{"audio/x-test"};
+
+// Turns every queued input buffer into an output buffer right away, with the
+// same size and timestamp, so that only MediaCodec itself is exercised.
+class LoopbackBufferChannel : public BufferChannelBase {
+public:
+    void configure(const sp<AMessage> &inputFormat, const sp<AMessage> &outputFormat) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mInputBuffers.clear();
+        mOutputBuffers.clear();
+        mOutputFree.clear();
+        for (size_t i = 0; i < kNumLoopbackBuffers; ++i) {
+            mInputBuffers.push_back(
+                    new MediaCodecBuffer(inputFormat, new ABuffer(kLoopbackBufferSize)));
+            mOutputBuffers.push_back(
+                    new MediaCodecBuffer(outputFormat, new ABuffer(kLoopbackBufferSize)));
+            mOutputFree.push_back(true);
+        }
+    }
+
+    void start() {
+        for (size_t i = 0; i < kNumLoopbackBuffers; ++i) {
+            mCallback->onInputBufferAvailable(i, mInputBuffers[i]);
+        }
+    }
+
+    status_t queueInputBuffer(const sp<MediaCodecBuffer> &buffer) override {
+        size_t inIndex = kNumLoopbackBuffers;
+        size_t outIndex = kNumLoopbackBuffers;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            for (size_t i = 0; i < kNumLoopbackBuffers; ++i) {
+                if (mInputBuffers[i] == buffer) {
+                    inIndex = i;
+                }
+                if (outIndex == kNumLoopbackBuffers && mOutputFree[i]) {
+                    outIndex = i;
+                }
+            }
+            if (inIndex == kNumLoopbackBuffers || outIndex == kNumLoopbackBuffers) {
+                return -ENOENT;
+            }
+            mOutputFree[outIndex] = false;
+        }
+        int64_t timeUs = 0;
+        (void)buffer->meta()->findInt64("timeUs", &timeUs);
+        const sp<MediaCodecBuffer> &output = mOutputBuffers[outIndex];
+        output->meta()->clear();
+        output->meta()->setInt64("timeUs", timeUs);
+        output->meta()->setInt32("flags", 0);
+        output->setRange(0, buffer->size());
+        buffer->meta()->clear();
+
+        mCallback->onInputBufferAvailable(inIndex, buffer);
+        mCallback->onOutputBufferAvailable(outIndex, output);
+        return OK;
+    }
+
+    status_t queueSecureInputBuffer(
+            const sp<MediaCodecBuffer> &, bool, const uint8_t *, const uint8_t *,
+            CryptoPlugin::Mode, CryptoPlugin::Pattern, const CryptoPlugin::SubSample *,
+            size_t, AString *) override {
+        return -ENOSYS;
+    }
+
+    status_t renderOutputBuffer(const sp<MediaCodecBuffer> &buffer, int64_t) override {
+        return discardBuffer(buffer);
+    }
+
+    void pollForRenderedBuffers() override {}
+
+    status_t discardBuffer(const sp<MediaCodecBuffer> &buffer) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (size_t i = 0; i < mOutputBuffers.size(); ++i) {
+            if (mOutputBuffers[i] == buffer) {
+                mOutputFree[i] = true;
+            }
+        }
+        return OK;
+    }
+
+    void getInputBufferArray(Vector<sp<MediaCodecBuffer>> *array) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        array->clear();
+        for (const sp<MediaCodecBuffer> &buffer : mInputBuffers) {
+            array->push(buffer);
+        }
+    }
+
+    void getOutputBufferArray(Vector<sp<MediaCodecBuffer>> *array) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        array->clear();
+        for (const sp<MediaCodecBuffer> &buffer : mOutputBuffers) {
+            array->push(buffer);
+        }
+    }
+
+private:
+    std::mutex mLock;
+    std::vector<sp<MediaCodecBuffer>> mInputBuffers;
+    std::vector<sp<MediaCodecBuffer>> mOutputBuffers;
+    std::vector<bool> mOutputFree;
+};
+
+class LoopbackCodec : public CodecBase {
+public:
+    LoopbackCodec() : mChannel(std::make_shared<LoopbackBufferChannel>()) {}
+
+    std::shared_ptr<BufferChannelBase> getBufferChannel() override {
+        return mChannel;
+    }
+
+    void initiateAllocateComponent(const sp<AMessage> &) override {
+        mCallback->onComponentAllocated(kLoopbackCodecName.c_str());
+    }
+
+    void initiateConfigureComponent(const sp<AMessage> &msg) override {
+        sp<AMessage> inputFormat = msg->dup();
+        sp<AMessage> outputFormat = msg->dup();
+        mChannel->configure(inputFormat, outputFormat);
+        mCallback->onComponentConfigured(inputFormat, outputFormat);
+    }
+
+    void initiateCreateInputSurface() override {}
+    void initiateSetInputSurface(const sp<PersistentSurface> &) override {}
+
+    void initiateStart() override {
+        mCallback->onStartCompleted();
+        mChannel->start();
+    }
+
+    void initiateShutdown(bool keepComponentAllocated) override {
+        if (keepComponentAllocated) {
+            mCallback->onStopCompleted();
+        } else {
+            mCallback->onReleaseCompleted();
+        }
+    }
+
+    void onMessageReceived(const sp<AMessage> &) override {}
+    void signalFlush() override { mCallback->onFlushCompleted(); }
+    void signalResume() override {}
+    void signalRequestIDRFrame() override {}
+    void signalSetParameters(const sp<AMessage> &) override {}
+    void signalEndOfInputStream() override {}
+
+private:
+    std::shared_ptr<LoopbackBufferChannel> mChannel;
+};
+
+inline sp<MediaCodec> CreateLoopbackCodec(const sp<ALooper> &looper) {
+    std::shared_ptr<MediaCodecListWriter> listWriter = MediaTestHelper::CreateCodecListWriter();
+    std::unique_ptr<MediaCodecInfoWriter> infoWriter = listWriter->addMediaCodecInfo();
+    infoWriter->setName(kLoopbackCodecName.c_str());
+    infoWriter->setOwner(kLoopbackCodecOwner.c_str());
+    infoWriter->addMediaType(kLoopbackMediaType.c_str());
+    std::vector<sp<MediaCodecInfo>> codecInfos;
+    MediaTestHelper::WriteCodecInfos(listWriter, &codecInfos);
+    sp<MediaCodecInfo> codecInfo = codecInfos.front();
+
+    return MediaTestHelper::CreateCodec(
+            kLoopbackCodecName, looper,
+            [](const AString &, const char *) -> sp<CodecBase> {
+                return new LoopbackCodec;
+            },
+            [codecInfo](const AString &, sp<MediaCodecInfo> *info) -> status_t {
+                *info = codecInfo;
+                return OK;
+            });
+}
+
+}  // namespace android
+
+#endif  // LOOPBACK_CODEC_H_
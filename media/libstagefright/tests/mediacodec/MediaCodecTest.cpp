@@ -25,8 +25,10 @@
 #include <media/stagefright/CodecBase.h>
 #include <media/stagefright/MediaCodec.h>
 #include <media/stagefright/MediaCodecListWriter.h>
+#include <media/stagefright/MediaErrors.h>
 #include <media/MediaCodecInfo.h>
 
+#include "LoopbackCodec.h"
 #include "MediaTestHelper.h"
 
 namespace android {
@@ -444,3 +446,239 @@ TEST(MediaCodecTest, DeadWhileStoppingError) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
     looper->stop();
 }
+
+namespace {
+
+// What the client sees of a buffer cycle.
+struct CycleResult {
+    status_t dequeueInputErr;
+    status_t queueInputErr;
+    status_t dequeueOutputErr;
+    status_t releaseOutputErr;
+    size_t inputIndex;
+    size_t outputIndex;
+    size_t size;
+    int64_t timeUs;
+    uint32_t flags;
+
+    bool operator==(const CycleResult &other) const {
+        return dequeueInputErr == other.dequeueInputErr
+                && queueInputErr == other.queueInputErr
+                && dequeueOutputErr == other.dequeueOutputErr
+                && releaseOutputErr == other.releaseOutputErr
+                && inputIndex == other.inputIndex
+                && outputIndex == other.outputIndex
+                && size == other.size
+                && timeUs == other.timeUs
+                && flags == other.flags;
+    }
+};
+
+std::ostream &operator<<(std::ostream &os, const CycleResult &r) {
+    return os << "{" << r.dequeueInputErr << ", " << r.queueInputErr << ", "
+            << r.dequeueOutputErr << ", " << r.releaseOutputErr << ", in #" << r.inputIndex
+            << ", out #" << r.outputIndex << ", size " << r.size << ", timeUs " << r.timeUs
+            << ", flags " << r.flags << "}";
+}
+
+// Dequeues and queues an input buffer, then dequeues and releases the
+// matching output buffer, skipping the format and buffer change infos.
+CycleResult cycleBuffers(const sp<MediaCodec> &codec, size_t size, int64_t timeUs) {
+    CycleResult r{};
+    r.dequeueInputErr = codec->dequeueInputBuffer(&r.inputIndex, 100000);
+    r.queueInputErr = codec->queueInputBuffer(r.inputIndex, 0, size, timeUs, 0);
+    size_t offset;
+    do {
+        r.dequeueOutputErr = codec->dequeueOutputBuffer(
+                &r.outputIndex, &offset, &r.size, &r.timeUs, &r.flags, 100000);
+    } while (r.dequeueOutputErr == INFO_FORMAT_CHANGED
+            || r.dequeueOutputErr == INFO_OUTPUT_BUFFERS_CHANGED);
+    r.releaseOutputErr = codec->releaseOutputBuffer(r.outputIndex);
+    return r;
+}
+
+// The fast path is turned on once the looper is done with the last message,
+// so it may take a little while after a call went through the looper.
+bool waitForSyncFastPath(const sp<MediaCodec> &codec) {
+    for (int i = 0; i < 1000; ++i) {
+        if (MediaTestHelper::IsSyncFastPathEnabled(codec)) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+class MediaCodecSyncFastPathTest : public ::testing::TestWithParam<bool> {
+protected:
+    void SetUp() override {
+        mLooper = new ALooper;
+        mLooper->start();
+        mCodec = CreateLoopbackCodec(mLooper);
+        ASSERT_NE(nullptr, mCodec);
+        MediaTestHelper::SetSyncFastPathAllowed(mCodec, GetParam());
+    }
+
+    void TearDown() override {
+        if (mCodec != nullptr) {
+            mCodec->release();
+        }
+        mLooper->stop();
+    }
+
+    status_t configureAndStart(const sp<AMessage> &callback = nullptr) {
+        if (callback != nullptr) {
+            status_t err = mCodec->setCallback(callback);
+            if (err != OK) {
+                return err;
+            }
+        }
+        sp<AMessage> format = new AMessage;
+        format->setString("mime", kLoopbackMediaType);
+        status_t err = mCodec->configure(format, nullptr, nullptr, 0);
+        return err == OK ? mCodec->start() : err;
+    }
+
+    // Runs buffer cycles with increasing timestamps and sizes.
+    std::vector<CycleResult> runCycles(size_t count) {
+        std::vector<CycleResult> results;
+        for (size_t i = 0; i < count; ++i) {
+            ++mFrame;
+            results.push_back(cycleBuffers(mCodec, mFrame * 16, mFrame * 20000));
+        }
+        return results;
+    }
+
+    sp<ALooper> mLooper;
+    sp<MediaCodec> mCodec;
+    int64_t mFrame = 0;
+};
+
+}  // namespace
+
+// Buffers cycle through the codec unchanged, and the fast path is turned on
+// only when it is allowed.
+TEST_P(MediaCodecSyncFastPathTest, BuffersLoopBack) {
+    ASSERT_EQ(OK, configureAndStart());
+    std::vector<CycleResult> results = runCycles(1);
+    ASSERT_EQ(GetParam(), waitForSyncFastPath(mCodec));
+    std::vector<CycleResult> more = runCycles(3 * kNumLoopbackBuffers);
+    results.insert(results.end(), more.begin(), more.end());
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const CycleResult &r = results[i];
+        EXPECT_EQ(OK, r.dequeueInputErr) << "cycle #" << i;
+        EXPECT_EQ(OK, r.queueInputErr) << "cycle #" << i;
+        EXPECT_EQ(OK, r.dequeueOutputErr) << "cycle #" << i;
+        EXPECT_EQ(OK, r.releaseOutputErr) << "cycle #" << i;
+        EXPECT_EQ(size_t(i + 1) * 16, r.size) << "cycle #" << i;
+        EXPECT_EQ(int64_t(i + 1) * 20000, r.timeUs) << "cycle #" << i;
+        EXPECT_EQ(0u, r.flags) << "cycle #" << i;
+    }
+}
+
+// Nothing is dequeued without a timeout when no buffer is available.
+TEST_P(MediaCodecSyncFastPathTest, TryAgainLater) {
+    ASSERT_EQ(OK, configureAndStart());
+    runCycles(1);
+    ASSERT_EQ(GetParam(), waitForSyncFastPath(mCodec));
+
+    size_t index, offset, size;
+    int64_t timeUs;
+    uint32_t flags;
+    EXPECT_EQ(-EAGAIN, mCodec->dequeueOutputBuffer(&index, &offset, &size, &timeUs, &flags, 0));
+
+    std::vector<size_t> inputs;
+    while (mCodec->dequeueInputBuffer(&index, 0) == OK) {
+        inputs.push_back(index);
+        ASSERT_LE(inputs.size(), kNumLoopbackBuffers);
+    }
+    EXPECT_EQ(kNumLoopbackBuffers, inputs.size());
+    EXPECT_EQ(-EAGAIN, mCodec->dequeueInputBuffer(&index, 0));
+}
+
+// Releasing a buffer the client does not own fails, and leaves the codec
+// usable.
+TEST_P(MediaCodecSyncFastPathTest, ReleaseUnownedBuffer) {
+    ASSERT_EQ(OK, configureAndStart());
+    runCycles(1);
+    ASSERT_EQ(GetParam(), waitForSyncFastPath(mCodec));
+
+    EXPECT_EQ(-EACCES, mCodec->releaseOutputBuffer(0));
+    EXPECT_EQ(-ERANGE, mCodec->releaseOutputBuffer(kNumLoopbackBuffers));
+    CycleResult r = runCycles(1).front();
+    EXPECT_EQ(OK, r.dequeueOutputErr);
+    EXPECT_EQ(OK, r.releaseOutputErr);
+}
+
+// Once stopped, the buffer calls fail and the fast path is off.
+TEST_P(MediaCodecSyncFastPathTest, StateErrorsAfterStop) {
+    ASSERT_EQ(OK, configureAndStart());
+    runCycles(1);
+    ASSERT_EQ(GetParam(), waitForSyncFastPath(mCodec));
+    ASSERT_EQ(OK, mCodec->stop());
+    EXPECT_FALSE(MediaTestHelper::IsSyncFastPathEnabled(mCodec));
+
+    size_t index = 0, offset, size;
+    int64_t timeUs;
+    uint32_t flags;
+    EXPECT_EQ(INVALID_OPERATION, mCodec->dequeueInputBuffer(&index, 0));
+    EXPECT_EQ(INVALID_OPERATION, mCodec->queueInputBuffer(0, 0, 16, 0, 0));
+    EXPECT_EQ(INVALID_OPERATION,
+              mCodec->dequeueOutputBuffer(&index, &offset, &size, &timeUs, &flags, 0));
+    EXPECT_EQ(INVALID_OPERATION, mCodec->releaseOutputBuffer(0));
+    EXPECT_FALSE(MediaTestHelper::IsSyncFastPathEnabled(mCodec));
+}
+
+// The fast path is never used in async mode, where the synchronous buffer
+// calls are rejected.
+TEST_P(MediaCodecSyncFastPathTest, OffInAsyncMode) {
+    ASSERT_EQ(OK, configureAndStart(new AMessage));
+    EXPECT_FALSE(waitForSyncFastPath(mCodec));
+
+    size_t index, offset, size;
+    int64_t timeUs;
+    uint32_t flags;
+    EXPECT_EQ(INVALID_OPERATION, mCodec->dequeueInputBuffer(&index, 0));
+    EXPECT_EQ(INVALID_OPERATION,
+              mCodec->dequeueOutputBuffer(&index, &offset, &size, &timeUs, &flags, 0));
+    EXPECT_FALSE(MediaTestHelper::IsSyncFastPathEnabled(mCodec));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        SyncFastPath, MediaCodecSyncFastPathTest, ::testing::Bool(),
+        [](const ::testing::TestParamInfo<bool> &info) {
+            return info.param ? "Allowed" : "Disallowed";
+        });
+
+// The fast path gives the client the same results as the looper.
+TEST(MediaCodecSyncFastPathResultsTest, MatchLooperPath) {
+    std::vector<CycleResult> results[2];
+    for (bool allowed : {false, true}) {
+        sp<ALooper> looper{new ALooper};
+        looper->start();
+        sp<MediaCodec> codec = CreateLoopbackCodec(looper);
+        ASSERT_NE(nullptr, codec);
+        MediaTestHelper::SetSyncFastPathAllowed(codec, allowed);
+
+        sp<AMessage> format = new AMessage;
+        format->setString("mime", kLoopbackMediaType);
+        ASSERT_EQ(OK, codec->configure(format, nullptr, nullptr, 0));
+        ASSERT_EQ(OK, codec->start());
+        for (int64_t i = 1; i <= int64_t(3 * kNumLoopbackBuffers); ++i) {
+            results[allowed].push_back(cycleBuffers(codec, i * 16, i * 20000));
+            if (i == 1) {
+                ASSERT_EQ(allowed, waitForSyncFastPath(codec));
+            }
+        }
+        // The unowned buffer is released on the calling thread too.
+        CycleResult r{};
+        r.releaseOutputErr = codec->releaseOutputBuffer(0);
+        results[allowed].push_back(r);
+
+        codec->stop();
+        codec->release();
+        looper->stop();
+    }
+    EXPECT_EQ(results[false], results[true]);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the synchronous MediaCodec buffer calls against a loopback codec
+// that turns every queued input buffer into an output buffer right away, so
+// that only the MediaCodec overhead is measured. Each iteration dequeues and
+// queues an input buffer, then dequeues and releases an output buffer, with
+// the calls served either on the calling thread or through the looper.
+
+#include <benchmark/benchmark.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include "LoopbackCodec.h"
+
+using namespace android;
+
+constexpr size_t kFrameSize = 960 * 2 * sizeof(int16_t);  // 20 ms of 48 kHz stereo
+
+static void BM_SyncBufferCycle(benchmark::State& state) {
+    const bool fastPath = state.range(0);
+    sp<ALooper> looper{new ALooper};
+    looper->start();
+    sp<MediaCodec> codec = CreateLoopbackCodec(looper);
+    if (codec == nullptr) {
+        state.SkipWithError("failed to create the loopback codec");
+        return;
+    }
+    MediaTestHelper::SetSyncFastPathAllowed(codec, fastPath);
+
+    sp<AMessage> format = new AMessage;
+    format->setString("mime", kLoopbackMediaType);
+    if (codec->configure(format, nullptr, nullptr, 0) != OK || codec->start() != OK) {
+        state.SkipWithError("failed to start the loopback codec");
+        codec->release();
+        looper->stop();
+        return;
+    }
+
+    int64_t timeUs = 0;
+    for (auto _ : state) {
+        size_t index;
+        if (codec->dequeueInputBuffer(&index, -1) != OK) {
+            state.SkipWithError("dequeueInputBuffer failed");
+            break;
+        }
+        timeUs += 20000;
+        if (codec->queueInputBuffer(index, 0, kFrameSize, timeUs, 0) != OK) {
+            state.SkipWithError("queueInputBuffer failed");
+            break;
+        }
+
+        size_t offset, size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        status_t err;
+        do {
+            err = codec->dequeueOutputBuffer(
+                    &index, &offset, &size, &presentationTimeUs, &flags, -1);
+        } while (err == INFO_FORMAT_CHANGED || err == INFO_OUTPUT_BUFFERS_CHANGED);
+        if (err != OK || codec->releaseOutputBuffer(index) != OK) {
+            state.SkipWithError("output buffer cycle failed");
+            break;
+        }
+    }
+    // dequeueInputBuffer, queueInputBuffer, dequeueOutputBuffer and releaseOutputBuffer
+    state.counters["calls"] = benchmark::Counter(
+            state.iterations() * 4, benchmark::Counter::kIsRate);
+    state.SetItemsProcessed(state.iterations());
+
+    codec->stop();
+    codec->release();
+    looper->stop();
+}
+
+BENCHMARK(BM_SyncBufferCycle)->ArgName("fastPath")->Arg(0)->Arg(1)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -40,6 +40,19 @@ void MediaTestHelper::Reclaim(const sp<MediaCodec> &codec, bool force) {
     codec->reclaim(force);
 }
 
+// static
+void MediaTestHelper::SetSyncFastPathAllowed(const sp<MediaCodec> &codec, bool allowed) {
+    Mutex::Autolock al(codec->mSyncFastPathLock);
+    codec->mSyncFastPathAllowed = allowed;
+    codec->mSyncFastPathEnabled = codec->mSyncFastPathEnabled && allowed;
+}
+
+// static
+bool MediaTestHelper::IsSyncFastPathEnabled(const sp<MediaCodec> &codec) {
+    Mutex::Autolock al(codec->mSyncFastPathLock);
+    return codec->mSyncFastPathEnabled;
+}
+
 // static
 std::shared_ptr<MediaCodecListWriter> MediaTestHelper::CreateCodecListWriter() {
     return std::shared_ptr<MediaCodecListWriter>(new MediaCodecListWriter);
@@ -38,6 +38,8 @@ public:
             std::function<sp<CodecBase>(const AString &, const char *)> getCodecBase,
             std::function<status_t(const AString &, sp<MediaCodecInfo> *)> getCodecInfo);
     static void Reclaim(const sp<MediaCodec> &codec, bool force);
+    static void SetSyncFastPathAllowed(const sp<MediaCodec> &codec, bool allowed);
+    static bool IsSyncFastPathEnabled(const sp<MediaCodec> &codec);
 
     // MediaCodecListWriter
     static std::shared_ptr<MediaCodecListWriter> CreateCodecListWriter();
@@ -21,10 +21,13 @@
 #include <binder/ProcessState.h>
 
 #include <inttypes.h>
+#include <malloc.h>
 #include <fstream>
 #include <iostream>
 
 #include <media/NdkMediaExtractor.h>
+#include <media/stagefright/foundation/ByteUtils.h>
+#include <media/stagefright/MediaBuffer.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/Utils.h>
@@ -172,7 +175,7 @@ class WriterTest {
                  uint8_t *buffer, size_t bufSize, size_t *bytesExtracted, int32_t idx);
 
     void compareParams(configFormat srcParam, configFormat dstParam, vector<BufferInfo> dstBufInfo,
-                       int32_t index);
+                       int32_t index, bool compareFlags = true);
 
     enum standardWriters {
         OGG,
@@ -429,7 +432,7 @@ void WriterTest::extract(AMediaExtractor *extractor, configFormat &params,
 }
 
 void WriterTest::compareParams(configFormat srcParam, configFormat dstParam,
-                               vector<BufferInfo> dstBufInfo, int32_t index) {
+                               vector<BufferInfo> dstBufInfo, int32_t index, bool compareFlags) {
     ASSERT_STREQ(srcParam.mime, dstParam.mime)
             << "Extracted mime type does not match with input mime type";
 
@@ -455,9 +458,11 @@ void WriterTest::compareParams(configFormat srcParam, configFormat dstParam,
         ASSERT_EQ(mBufferInfo[index][i].size, dstBufInfo[i].size)
                 << "Input size " << mBufferInfo[index][i].size << " mismatched with extracted size "
                 << dstBufInfo[i].size;
-        ASSERT_EQ(mBufferInfo[index][i].flags, dstBufInfo[i].flags)
-                << "Input flag " << mBufferInfo[index][i].flags
-                << " mismatched with extracted size " << dstBufInfo[i].flags;
+        if (compareFlags) {
+            ASSERT_EQ(mBufferInfo[index][i].flags, dstBufInfo[i].flags)
+                    << "Input flag " << mBufferInfo[index][i].flags
+                    << " mismatched with extracted size " << dstBufInfo[i].flags;
+        }
         ASSERT_LE(abs(mBufferInfo[index][i].timeUs - dstBufInfo[i].timeUs), toleranceValueUs)
                 << "Difference between original timestamp " << mBufferInfo[index][i].timeUs
                 << " and extracted timestamp " << dstBufInfo[i].timeUs
@@ -896,6 +901,276 @@ TEST_P(WriteFunctionalityTest, Mpeg4WriterTest) {
     close(fd);
 }
 
+class Mpeg4FragmentedWriterTest
+    : public WriterTest,
+      public ::testing::TestWithParam<
+              tuple<inputId /* inputId0*/, inputId /* inputId1*/,
+                    int64_t /* fragmentDurationUs*/, int64_t /* cmafChunkDurationUs*/>> {
+  public:
+    virtual void SetUp() override { setupWriterType("mpeg4"); }
+
+    // Extracts all tracks of the given file and compares them with the input. Sync flags are
+    // not compared as the extractor only reports the first sample of each moof as sync.
+    void validateOutput(const string &outputFile, int32_t numTracks, configFormat *param,
+                        size_t *fileSize, size_t *sampleCount);
+
+    // Creates a fragmented writer on fd with the tracks of the test parameters.
+    void setupFragmentedWriter(int32_t fd, int32_t *numTracks, configFormat *param,
+                               size_t *fileSize);
+};
+
+void Mpeg4FragmentedWriterTest::setupFragmentedWriter(int32_t fd, int32_t *numTracks,
+                                                      configFormat *param, size_t *fileSize) {
+    int32_t status = createWriter(fd);
+    ASSERT_EQ((status_t)OK, status) << "Failed to create writer for mpeg4 output format";
+    mFileMeta->setInt64(kKeyFragmentDurationUs, get<2>(GetParam()));
+    mFileMeta->setInt64(kKeyCmafChunkDurationUs, get<3>(GetParam()));
+
+    inputId inpId[] = {get<0>(GetParam()), get<1>(GetParam())};
+    ASSERT_NE(inpId[0], UNUSED_ID) << "Test expects first inputId to be a valid id";
+    *numTracks = (inpId[1] != UNUSED_ID) ? 2 : 1;
+
+    for (int32_t idx = 0; idx < *numTracks; idx++) {
+        string inputFile = gEnv->getRes();
+        string inputInfo = gEnv->getRes();
+        bool isAudio;
+        getFileDetails(inputFile, inputInfo, param[idx], isAudio, inpId[idx]);
+        ASSERT_NE(inputFile.compare(gEnv->getRes()), 0) << "No input file specified";
+
+        struct stat buf;
+        status = stat(inputFile.c_str(), &buf);
+        ASSERT_EQ(status, 0) << "Failed to get properties of input file:" << inputFile;
+        fileSize[idx] = buf.st_size;
+
+        ASSERT_NO_FATAL_FAILURE(getInputBufferInfo(inputFile, inputInfo, idx));
+        status = addWriterSource(isAudio, param[idx], idx);
+        ASSERT_EQ((status_t)OK, status) << "Failed to add source for mpeg4 Writer";
+    }
+}
+
+// Returns the offset of the last top level box of the given type, or -1.
+static off64_t findLastTopLevelBox(const string &file, const char *type) {
+    int32_t fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+    off64_t found = -1;
+    off64_t offset = 0;
+    uint8_t header[16];
+    while (pread64(fd, header, 8, offset) == 8) {
+        uint64_t size = U32_AT(header);
+        if (size == 1) {
+            if (pread64(fd, header + 8, 8, offset + 8) != 8) break;
+            size = U64_AT(header + 8);
+        }
+        if (size < 8) break;
+        if (!memcmp(header + 4, type, 4)) found = offset;
+        offset += size;
+    }
+    close(fd);
+    return found;
+}
+
+void Mpeg4FragmentedWriterTest::validateOutput(const string &outputFile, int32_t numTracks,
+                                               configFormat *param, size_t *fileSize,
+                                               size_t *sampleCount) {
+    AMediaExtractor *extractor = AMediaExtractor_new();
+    ASSERT_NE(extractor, nullptr) << "Failed to create extractor";
+    int32_t trackCount = -1;
+    ASSERT_NO_FATAL_FAILURE(setupExtractor(extractor, outputFile, trackCount));
+    ASSERT_EQ(trackCount, numTracks)
+            << "Tracks reported by extractor does not match with input number of tracks";
+
+    for (int32_t idx = 0; idx < numTracks; idx++) {
+        configFormat extractorParams;
+        vector<BufferInfo> extractorBufferInfo;
+        std::unique_ptr<char[]> inputBuffer(new char[fileSize[idx]]);
+        mInputStream[idx].clear();
+        mInputStream[idx].seekg(0, mInputStream[idx].beg);
+        mInputStream[idx].read(inputBuffer.get(), fileSize[idx]);
+        ASSERT_EQ(mInputStream[idx].gcount(), fileSize[idx]);
+
+        std::unique_ptr<uint8_t[]> extractedBuffer(new uint8_t[fileSize[idx]]);
+        size_t bytesExtracted = 0;
+        ASSERT_NO_FATAL_FAILURE(extract(extractor, extractorParams, extractorBufferInfo,
+                                        extractedBuffer.get(), fileSize[idx], &bytesExtracted,
+                                        idx));
+        ASSERT_GT(bytesExtracted, 0) << "Total bytes extracted by extractor cannot be zero";
+        ASSERT_LE(extractorBufferInfo.size(), mBufferInfo[idx].size());
+        ASSERT_NO_FATAL_FAILURE(compareParams(param[idx], extractorParams, extractorBufferInfo,
+                                              idx, false /* compareFlags */));
+        ASSERT_EQ(memcmp(extractedBuffer.get(), inputBuffer.get(), bytesExtracted), 0)
+                << "Extracted bit stream does not match with input bit stream";
+        sampleCount[idx] = extractorBufferInfo.size();
+    }
+    AMediaExtractor_delete(extractor);
+}
+
+TEST_P(Mpeg4FragmentedWriterTest, FragmentedWriterTest) {
+    if (mDisableTest) return;
+    ALOGV("Checks fragmented mpeg4 output, and that it stays playable when truncated");
+
+    string outputFile = OUTPUT_FILE_NAME;
+    int32_t fd =
+            open(outputFile.c_str(), O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+    ASSERT_GE(fd, 0) << "Failed to open output file to dump writer's data";
+
+    int32_t numTracks = 0;
+    size_t fileSize[kMaxTrackCount]{};
+    configFormat param[kMaxTrackCount];
+    ASSERT_NO_FATAL_FAILURE(setupFragmentedWriter(fd, &numTracks, param, fileSize));
+
+    int32_t status = mWriter->start(mFileMeta.get());
+    ASSERT_EQ((status_t)OK, status) << "Could not start the writer";
+    // Interleave the tracks so that each of them has several fragments in the file.
+    constexpr float kInterval = 0.25;
+    int32_t offset[kMaxTrackCount]{};
+    for (int32_t loopCount = 0; loopCount < ceil(1.0 / kInterval); loopCount++) {
+        for (int32_t idx = 0; idx < numTracks; idx++) {
+            size_t range = mBufferInfo[idx].size() * kInterval + 1;
+            status = sendBuffersToWriter(mInputStream[idx], mBufferInfo[idx], mInputFrameId[idx],
+                                         mCurrentTrack[idx], offset[idx], range);
+            ASSERT_EQ((status_t)OK, status) << "mpeg4 writer failed";
+            offset[idx] += range;
+        }
+    }
+    for (int32_t idx = 0; idx < numTracks; idx++) {
+        mCurrentTrack[idx]->stop();
+    }
+    status = mWriter->stop();
+    ASSERT_EQ((status_t)OK, status) << "Failed to stop the writer";
+    close(fd);
+
+    size_t sampleCount[kMaxTrackCount]{};
+    ASSERT_NO_FATAL_FAILURE(validateOutput(outputFile, numTracks, param, fileSize, sampleCount));
+    for (int32_t idx = 0; idx < numTracks; idx++) {
+        ASSERT_EQ(sampleCount[idx], mBufferInfo[idx].size())
+                << "Extracted sample count does not match with input sample count";
+    }
+
+    // Drop the last fragment, as if the recording had been interrupted while writing it.
+    off64_t lastMoofOffset = findLastTopLevelBox(outputFile, "moof");
+    ASSERT_GT(lastMoofOffset, 0) << "No movie fragment in the output file";
+    ASSERT_EQ(findLastTopLevelBox(outputFile, "moov") < lastMoofOffset, true)
+            << "moov box is expected before the movie fragments";
+    string truncatedFile = outputFile + ".truncated";
+    {
+        std::ifstream src(outputFile, std::ios::binary);
+        std::ofstream dst(truncatedFile, std::ios::binary | std::ios::trunc);
+        std::vector<char> data(lastMoofOffset);
+        src.read(data.data(), lastMoofOffset);
+        ASSERT_EQ(src.gcount(), lastMoofOffset);
+        dst.write(data.data(), lastMoofOffset);
+    }
+    size_t truncatedSampleCount[kMaxTrackCount]{};
+    ASSERT_NO_FATAL_FAILURE(
+            validateOutput(truncatedFile, numTracks, param, fileSize, truncatedSampleCount));
+    size_t totalSamples = 0, totalTruncatedSamples = 0;
+    for (int32_t idx = 0; idx < numTracks; idx++) {
+        totalSamples += sampleCount[idx];
+        totalTruncatedSamples += truncatedSampleCount[idx];
+    }
+    ASSERT_LT(totalTruncatedSamples, totalSamples)
+            << "Truncated file is expected to have fewer samples";
+    if (gEnv->cleanUp()) remove(truncatedFile.c_str());
+}
+
+TEST_P(Mpeg4FragmentedWriterTest, FragmentedWriterLateTrackTest) {
+    if (mDisableTest) return;
+    ALOGV("Checks that the moov box of a fragmented file waits for a track that starts late");
+
+    string outputFile = OUTPUT_FILE_NAME;
+    int32_t fd =
+            open(outputFile.c_str(), O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+    ASSERT_GE(fd, 0) << "Failed to open output file to dump writer's data";
+
+    int32_t numTracks = 0;
+    size_t fileSize[kMaxTrackCount]{};
+    configFormat param[kMaxTrackCount];
+    ASSERT_NO_FATAL_FAILURE(setupFragmentedWriter(fd, &numTracks, param, fileSize));
+
+    int32_t status = mWriter->start(mFileMeta.get());
+    ASSERT_EQ((status_t)OK, status) << "Could not start the writer";
+    // Each track is only fed once the previous one has produced all of its fragments, while
+    // its track thread keeps running.
+    for (int32_t idx = 0; idx < numTracks; idx++) {
+        status = sendBuffersToWriter(mInputStream[idx], mBufferInfo[idx], mInputFrameId[idx],
+                                     mCurrentTrack[idx], 0, mBufferInfo[idx].size());
+        ASSERT_EQ((status_t)OK, status) << "mpeg4 writer failed";
+    }
+    for (int32_t idx = 0; idx < numTracks; idx++) {
+        mCurrentTrack[idx]->stop();
+    }
+    status = mWriter->stop();
+    ASSERT_EQ((status_t)OK, status) << "Failed to stop the writer";
+    close(fd);
+
+    // Every track has a sample description, and all of its samples.
+    size_t sampleCount[kMaxTrackCount]{};
+    ASSERT_NO_FATAL_FAILURE(validateOutput(outputFile, numTracks, param, fileSize, sampleCount));
+    for (int32_t idx = 0; idx < numTracks; idx++) {
+        ASSERT_EQ(sampleCount[idx], mBufferInfo[idx].size())
+                << "Extracted sample count does not match with input sample count";
+    }
+}
+
+// Feeds an hour of synthetic AMR-NB frames and returns how much heap the writer used
+// for it, measured before stop() writes the moov box and releases the sample tables.
+static size_t recordAmrNbHour(WriterTest &test, int64_t fragmentDurationUs) {
+    constexpr int64_t kDurationUs = 3600LL * 1000000LL;
+    constexpr int64_t kFrameDurationUs = 20000;
+    constexpr int32_t kFrameSize = 32;
+
+    int32_t fd = open(OUTPUT_FILE_NAME, O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR,
+                      S_IRUSR | S_IWUSR);
+    if (fd < 0) return 0;
+    if (test.createWriter(fd) != 0) {
+        close(fd);
+        return 0;
+    }
+    test.mFileMeta->setInt64(kKeyFragmentDurationUs, fragmentDurationUs);
+    sp<MetaData> trackMeta = new MetaData;
+    trackMeta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_AMR_NB);
+    trackMeta->setInt32(kKeySampleRate, 8000);
+    trackMeta->setInt32(kKeyChannelCount, 1);
+    sp<MediaAdapter> track = new MediaAdapter(trackMeta);
+    if (test.mWriter->addSource(track) != OK || test.mWriter->start(test.mFileMeta.get()) != OK) {
+        close(fd);
+        return 0;
+    }
+
+    const size_t startInUse = mallinfo().uordblks;
+    uint8_t frame[kFrameSize] = {0x3c};
+    for (int64_t timeUs = 0; timeUs < kDurationUs; timeUs += kFrameDurationUs) {
+        MediaBuffer *mediaBuffer = new MediaBuffer(kFrameSize);
+        memcpy(mediaBuffer->data(), frame, kFrameSize);
+        // Released in MediaAdapter::signalBufferReturned().
+        mediaBuffer->add_ref();
+        mediaBuffer->meta_data().setInt64(kKeyTime, timeUs);
+        mediaBuffer->meta_data().setInt64(kKeyDecodingTime, timeUs);
+        mediaBuffer->meta_data().setInt32(kKeyIsSyncFrame, true);
+        if (track->pushBuffer(mediaBuffer) != OK) break;
+    }
+    const size_t endInUse = mallinfo().uordblks;
+
+    track->stop();
+    test.mWriter->stop();
+    test.mWriter.clear();
+    close(fd);
+    return endInUse > startInUse ? endInUse - startInUse : 0;
+}
+
+TEST(Mpeg4FragmentedWriterMemoryTest, SampleTableMemory) {
+    WriterTest test;
+    test.setupWriterType("mpeg4");
+    const size_t regularBytes = recordAmrNbHour(test, 0 /* fragmentDurationUs */);
+    const size_t fragmentedBytes = recordAmrNbHour(test, 1000000 /* fragmentDurationUs */);
+    ALOGI("Heap growth for an hour of AMR-NB: regular %zu bytes, fragmented %zu bytes",
+          regularBytes, fragmentedBytes);
+    // The stsz table alone holds 4 bytes for each of the 180000 samples.
+    ASSERT_GT(regularBytes, 180000u * 4) << "Sample tables are expected to grow";
+    ASSERT_LT(fragmentedBytes, regularBytes / 4)
+            << "Fragmented output is not expected to keep per sample tables";
+}
+
 class ListenerTest
     : public WriterTest,
       public ::testing::TestWithParam<tuple<
@@ -1098,6 +1373,16 @@ INSTANTIATE_TEST_SUITE_P(
                 make_tuple("webm", VP8_1, false),
                 make_tuple("webm", VP9_1, false)));
 
+INSTANTIATE_TEST_SUITE_P(
+        Mpeg4FragmentedWriterTestAll, Mpeg4FragmentedWriterTest,
+        // Video fragments only start at sync frames, so video inputs are also split into
+        // chunks to make sure there are several movie fragments to truncate.
+        ::testing::Values(make_tuple(AAC_1, UNUSED_ID, 1000000LL, 0LL),
+                          make_tuple(AMR_WB_1, AAC_1, 500000LL, 0LL),
+                          make_tuple(AVC_1, UNUSED_ID, 1000000LL, 250000LL),
+                          make_tuple(HEVC_1, UNUSED_ID, 500000LL, 100000LL),
+                          make_tuple(AVC_1, AAC_1, 1000000LL, 200000LL)));
+
 int main(int argc, char **argv) {
     ProcessState::self()->startThreadPool();
     gEnv = new WriterTestEnvironment();
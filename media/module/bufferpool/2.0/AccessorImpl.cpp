@@ -22,6 +22,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <utils/Log.h>
+#include <algorithm>
 #include <thread>
 #include "AccessorImpl.h"
 #include "Connection.h"
@@ -44,6 +45,8 @@ namespace {
 
     static constexpr nsecs_t kEvictGranularityNs = 1000000000; // 1 sec
     static constexpr nsecs_t kEvictDurationNs = 5000000000; // 5 secs
+
+    static constexpr ConnectionId kInvalidConnectionId = -1LL;
 }
 
 // Buffer structure in bufferpool process
@@ -55,6 +58,9 @@ struct InternalBuffer {
     const size_t mAllocSize;
     const std::vector<uint8_t> mConfig;
     bool mInvalidated;
+    bool mFree;
+    // Owning connections, indexed by connection slot.
+    std::vector<bool> mOwners;
 
     InternalBuffer(
             BufferId id,
@@ -63,7 +69,7 @@ struct InternalBuffer {
             const std::vector<uint8_t> &allocConfig)
             : mId(id), mOwnerCount(0), mTransactionCount(0),
             mAllocation(alloc), mAllocSize(allocSize), mConfig(allocConfig),
-            mInvalidated(false) {}
+            mInvalidated(false), mFree(false) {}
 
     const native_handle_t *handle() {
         return mAllocation->handle();
@@ -72,6 +78,35 @@ struct InternalBuffer {
     void invalidate() {
         mInvalidated = true;
     }
+
+    bool isIdle() const {
+        return mOwnerCount == 0 && mTransactionCount == 0;
+    }
+
+    bool isOwnedBy(size_t slot) const {
+        return slot < mOwners.size() && mOwners[slot];
+    }
+
+    bool addOwner(size_t slot) {
+        if (isOwnedBy(slot)) {
+            return false;
+        }
+        if (slot >= mOwners.size()) {
+            mOwners.resize(slot + 1);
+        }
+        mOwners[slot] = true;
+        mOwnerCount++;
+        return true;
+    }
+
+    bool removeOwner(size_t slot) {
+        if (!isOwnedBy(slot)) {
+            return false;
+        }
+        mOwners[slot] = false;
+        mOwnerCount--;
+        return true;
+    }
 };
 
 struct TransactionStatus {
@@ -100,46 +135,6 @@ struct TransactionStatus {
     }
 };
 
-// Helper template methods for handling map of set.
-template<class T, class U>
-bool insert(std::map<T, std::set<U>> *mapOfSet, T key, U value) {
-    auto iter = mapOfSet->find(key);
-    if (iter == mapOfSet->end()) {
-        std::set<U> valueSet{value};
-        mapOfSet->insert(std::make_pair(key, valueSet));
-        return true;
-    } else if (iter->second.find(value)  == iter->second.end()) {
-        iter->second.insert(value);
-        return true;
-    }
-    return false;
-}
-
-template<class T, class U>
-bool erase(std::map<T, std::set<U>> *mapOfSet, T key, U value) {
-    bool ret = false;
-    auto iter = mapOfSet->find(key);
-    if (iter != mapOfSet->end()) {
-        if (iter->second.erase(value) > 0) {
-            ret = true;
-        }
-        if (iter->second.size() == 0) {
-            mapOfSet->erase(iter);
-        }
-    }
-    return ret;
-}
-
-template<class T, class U>
-bool contains(std::map<T, std::set<U>> *mapOfSet, T key, U value) {
-    auto iter = mapOfSet->find(key);
-    if (iter != mapOfSet->end()) {
-        auto setIter = iter->second.find(value);
-        return setIter != iter->second.end();
-    }
-    return false;
-}
-
 #ifdef __ANDROID_VNDK__
 static constexpr uint32_t kSeqIdVndkBit = 1U << 31;
 #else
@@ -176,7 +171,14 @@ ResultStatus Accessor::Impl::connect(
                 *connection = newConnection;
                 *pConnectionId = id;
                 *pMsgId = mBufferPool.mInvalidation.mInvalidationId;
-                mBufferPool.mConnectionIds.insert(id);
+                auto slot = std::find(mBufferPool.mConnectionIds.begin(),
+                                      mBufferPool.mConnectionIds.end(),
+                                      kInvalidConnectionId);
+                if (slot != mBufferPool.mConnectionIds.end()) {
+                    *slot = id;
+                } else {
+                    mBufferPool.mConnectionIds.push_back(id);
+                }
                 mBufferPool.mInvalidationChannel.getDesc(invDescPtr);
                 mBufferPool.mInvalidation.onConnect(id, observer);
                 if (sSeqId == kSeqIdMax) {
@@ -240,14 +242,12 @@ ResultStatus Accessor::Impl::fetch(
         BufferId bufferId, const native_handle_t** handle) {
     std::lock_guard<std::mutex> lock(mBufferPool.mMutex);
     mBufferPool.processStatusMessages();
-    auto found = mBufferPool.mTransactions.find(transactionId);
-    if (found != mBufferPool.mTransactions.end() &&
-            contains(&mBufferPool.mPendingTransactions,
-                     connectionId, transactionId)) {
-        if (found->second->mSenderValidated &&
-                found->second->mStatus == BufferStatus::TRANSFER_FROM &&
-                found->second->mBufferId == bufferId) {
-            found->second->mStatus = BufferStatus::TRANSFER_FETCH;
+    TransactionStatus *found = mBufferPool.findTransaction(transactionId);
+    if (found && found->mReceiver == connectionId) {
+        if (found->mSenderValidated &&
+                found->mStatus == BufferStatus::TRANSFER_FROM &&
+                found->mBufferId == bufferId) {
+            found->mStatus = BufferStatus::TRANSFER_FETCH;
             auto bufferIt = mBufferPool.mBuffers.find(bufferId);
             if (bufferIt != mBufferPool.mBuffers.end()) {
                 mBufferPool.mStats.onBufferFetched();
@@ -439,126 +439,167 @@ void Accessor::Impl::BufferPool::Invalidation::onHandleAck(
     }
 }
 
+bool Accessor::Impl::BufferPool::findConnectionSlot(
+        ConnectionId connectionId, size_t *slot) const {
+    if (connectionId == kInvalidConnectionId) {
+        return false;
+    }
+    for (size_t i = 0; i < mConnectionIds.size(); ++i) {
+        if (mConnectionIds[i] == connectionId) {
+            *slot = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+TransactionStatus *Accessor::Impl::BufferPool::findTransaction(
+        TransactionId transactionId) {
+    for (TransactionStatus &transaction : mTransactions) {
+        if (transaction.mId == transactionId) {
+            return &transaction;
+        }
+    }
+    return nullptr;
+}
+
+void Accessor::Impl::BufferPool::eraseTransaction(TransactionStatus *transaction) {
+    if (transaction != &mTransactions.back()) {
+        *transaction = mTransactions.back();
+    }
+    mTransactions.pop_back();
+}
+
+void Accessor::Impl::BufferPool::handleBufferIdle(
+        std::map<BufferId, std::unique_ptr<InternalBuffer>>::iterator bufferIter) {
+    InternalBuffer *buffer = bufferIter->second.get();
+    mStats.onBufferUnused(buffer->mAllocSize);
+    if (!buffer->mInvalidated) {
+        // TODO: handle freebuffer insert fail
+        buffer->mFree = true;
+        mFreeBuffers[buffer->mConfig].push_back(buffer->mId);
+    } else {
+        BufferId bufferId = buffer->mId;
+        mStats.onBufferEvicted(buffer->mAllocSize);
+        mBuffers.erase(bufferIter);
+        mInvalidation.onBufferInvalidated(bufferId, mInvalidationChannel);
+    }
+}
+
+bool Accessor::Impl::BufferPool::removeFreeBuffer(const InternalBuffer &buffer) {
+    auto bucket = mFreeBuffers.find(buffer.mConfig);
+    if (bucket == mFreeBuffers.end()) {
+        return false;
+    }
+    auto it = std::find(bucket->second.begin(), bucket->second.end(), buffer.mId);
+    if (it == bucket->second.end()) {
+        return false;
+    }
+    bucket->second.erase(it);
+    return true;
+}
+
 bool Accessor::Impl::BufferPool::handleOwnBuffer(
         ConnectionId connectionId, BufferId bufferId) {
-
-    bool added = insert(&mUsingBuffers, connectionId, bufferId);
-    if (added) {
-        auto iter = mBuffers.find(bufferId);
-        iter->second->mOwnerCount++;
+    size_t slot;
+    auto iter = mBuffers.find(bufferId);
+    if (iter == mBuffers.end() || !findConnectionSlot(connectionId, &slot)) {
+        return false;
     }
-    insert(&mUsingConnections, bufferId, connectionId);
-    return added;
+    return iter->second->addOwner(slot);
 }
 
 bool Accessor::Impl::BufferPool::handleReleaseBuffer(
         ConnectionId connectionId, BufferId bufferId) {
-    bool deleted = erase(&mUsingBuffers, connectionId, bufferId);
-    if (deleted) {
-        auto iter = mBuffers.find(bufferId);
-        iter->second->mOwnerCount--;
-        if (iter->second->mOwnerCount == 0 &&
-                iter->second->mTransactionCount == 0) {
-            if (!iter->second->mInvalidated) {
-                mStats.onBufferUnused(iter->second->mAllocSize);
-                mFreeBuffers.insert(bufferId);
-            } else {
-                mStats.onBufferUnused(iter->second->mAllocSize);
-                mStats.onBufferEvicted(iter->second->mAllocSize);
-                mBuffers.erase(iter);
-                mInvalidation.onBufferInvalidated(bufferId, mInvalidationChannel);
-            }
+    bool deleted = false;
+    size_t slot;
+    auto iter = mBuffers.find(bufferId);
+    if (iter != mBuffers.end() && findConnectionSlot(connectionId, &slot)) {
+        deleted = iter->second->removeOwner(slot);
+        if (deleted && iter->second->isIdle()) {
+            handleBufferIdle(iter);
         }
     }
-    erase(&mUsingConnections, bufferId, connectionId);
     ALOGV("release buffer %u : %d", bufferId, deleted);
     return deleted;
 }
 
 bool Accessor::Impl::BufferPool::handleTransferTo(const BufferStatusMessage &message) {
-    auto completed = mCompletedTransactions.find(
+    auto completed = std::find(
+            mCompletedTransactions.begin(), mCompletedTransactions.end(),
             message.transactionId);
     if (completed != mCompletedTransactions.end()) {
         // already completed
-        mCompletedTransactions.erase(completed);
+        *completed = mCompletedTransactions.back();
+        mCompletedTransactions.pop_back();
         return true;
     }
     // the buffer should exist and be owned.
+    size_t slot;
     auto bufferIter = mBuffers.find(message.bufferId);
     if (bufferIter == mBuffers.end() ||
-            !contains(&mUsingBuffers, message.connectionId, message.bufferId)) {
+            !findConnectionSlot(message.connectionId, &slot) ||
+            !bufferIter->second->isOwnedBy(slot)) {
         return false;
     }
-    auto found = mTransactions.find(message.transactionId);
-    if (found != mTransactions.end()) {
+    TransactionStatus *found = findTransaction(message.transactionId);
+    if (found) {
         // transfer_from was received earlier.
-        found->second->mSender = message.connectionId;
-        found->second->mSenderValidated = true;
+        found->mSender = message.connectionId;
+        found->mSenderValidated = true;
         return true;
     }
-    if (mConnectionIds.find(message.targetConnectionId) == mConnectionIds.end()) {
+    if (!findConnectionSlot(message.targetConnectionId, &slot)) {
         // N.B: it could be fake or receive connection already closed.
         ALOGD("bufferpool2 %p receiver connection %lld is no longer valid",
               this, (long long)message.targetConnectionId);
         return false;
     }
     mStats.onBufferSent();
-    mTransactions.insert(std::make_pair(
-            message.transactionId,
-            std::make_unique<TransactionStatus>(message, mTimestampUs)));
-    insert(&mPendingTransactions, message.targetConnectionId,
-           message.transactionId);
+    mTransactions.emplace_back(message, mTimestampUs);
     bufferIter->second->mTransactionCount++;
     return true;
 }
 
 bool Accessor::Impl::BufferPool::handleTransferFrom(const BufferStatusMessage &message) {
-    auto found = mTransactions.find(message.transactionId);
-    if (found == mTransactions.end()) {
+    TransactionStatus *found = findTransaction(message.transactionId);
+    if (!found) {
         // TODO: is it feasible to check ownership here?
-        mStats.onBufferSent();
-        mTransactions.insert(std::make_pair(
-                message.transactionId,
-                std::make_unique<TransactionStatus>(message, mTimestampUs)));
-        insert(&mPendingTransactions, message.connectionId,
-               message.transactionId);
         auto bufferIter = mBuffers.find(message.bufferId);
+        if (bufferIter == mBuffers.end()) {
+            return false;
+        }
+        mStats.onBufferSent();
+        mTransactions.emplace_back(message, mTimestampUs);
         bufferIter->second->mTransactionCount++;
     } else {
-        if (message.connectionId == found->second->mReceiver) {
-            found->second->mStatus = BufferStatus::TRANSFER_FROM;
+        if (message.connectionId == found->mReceiver) {
+            found->mStatus = BufferStatus::TRANSFER_FROM;
         }
     }
     return true;
 }
 
 bool Accessor::Impl::BufferPool::handleTransferResult(const BufferStatusMessage &message) {
-    auto found = mTransactions.find(message.transactionId);
-    if (found != mTransactions.end()) {
-        bool deleted = erase(&mPendingTransactions, message.connectionId,
-                             message.transactionId);
+    TransactionStatus *found = findTransaction(message.transactionId);
+    if (found) {
+        // Only the receiver, which the transaction is pending on, finishes it.
+        bool deleted = found->mReceiver == message.connectionId;
         if (deleted) {
-            if (!found->second->mSenderValidated) {
-                mCompletedTransactions.insert(message.transactionId);
+            if (!found->mSenderValidated) {
+                mCompletedTransactions.push_back(message.transactionId);
             }
-            auto bufferIter = mBuffers.find(message.bufferId);
+            eraseTransaction(found);
             if (message.newStatus == BufferStatus::TRANSFER_OK) {
                 handleOwnBuffer(message.connectionId, message.bufferId);
             }
-            bufferIter->second->mTransactionCount--;
-            if (bufferIter->second->mOwnerCount == 0
-                && bufferIter->second->mTransactionCount == 0) {
-                if (!bufferIter->second->mInvalidated) {
-                    mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                    mFreeBuffers.insert(message.bufferId);
-                } else {
-                    mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                    mStats.onBufferEvicted(bufferIter->second->mAllocSize);
-                    mBuffers.erase(bufferIter);
-                    mInvalidation.onBufferInvalidated(message.bufferId, mInvalidationChannel);
+            auto bufferIter = mBuffers.find(message.bufferId);
+            if (bufferIter != mBuffers.end()) {
+                bufferIter->second->mTransactionCount--;
+                if (bufferIter->second->isIdle()) {
+                    handleBufferIdle(bufferIter);
                 }
             }
-            mTransactions.erase(found);
         }
         ALOGV("transfer finished %llu %u - %d", (unsigned long long)message.transactionId,
               message.bufferId, deleted);
@@ -570,10 +611,9 @@ bool Accessor::Impl::BufferPool::handleTransferResult(const BufferStatusMessage
 }
 
 void Accessor::Impl::BufferPool::processStatusMessages() {
-    std::vector<BufferStatusMessage> messages;
-    mObserver.getBufferStatusChanges(messages);
+    mObserver.getBufferStatusChanges(mMessages);
     mTimestampUs = getTimestampNow();
-    for (BufferStatusMessage& message: messages) {
+    for (BufferStatusMessage& message: mMessages) {
         bool ret = false;
         switch (message.newStatus) {
             case BufferStatus::NOT_USED:
@@ -612,66 +652,42 @@ void Accessor::Impl::BufferPool::processStatusMessages() {
                   message.newStatus, (long long)message.connectionId);
         }
     }
-    messages.clear();
+    mMessages.clear();
 }
 
 bool Accessor::Impl::BufferPool::handleClose(ConnectionId connectionId) {
+    size_t slot;
+    bool found = findConnectionSlot(connectionId, &slot);
     // Cleaning buffers
-    auto buffers = mUsingBuffers.find(connectionId);
-    if (buffers != mUsingBuffers.end()) {
-        for (const BufferId& bufferId : buffers->second) {
-            bool deleted = erase(&mUsingConnections, bufferId, connectionId);
-            if (deleted) {
-                auto bufferIter = mBuffers.find(bufferId);
-                bufferIter->second->mOwnerCount--;
-                if (bufferIter->second->mOwnerCount == 0 &&
-                        bufferIter->second->mTransactionCount == 0) {
-                    // TODO: handle freebuffer insert fail
-                    if (!bufferIter->second->mInvalidated) {
-                        mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                        mFreeBuffers.insert(bufferId);
-                    } else {
-                        mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                        mStats.onBufferEvicted(bufferIter->second->mAllocSize);
-                        mBuffers.erase(bufferIter);
-                        mInvalidation.onBufferInvalidated(bufferId, mInvalidationChannel);
-                    }
-                }
-            }
+    for (auto it = mBuffers.begin(); found && it != mBuffers.end();) {
+        auto bufferIter = it++;
+        if (bufferIter->second->removeOwner(slot) && bufferIter->second->isIdle()) {
+            handleBufferIdle(bufferIter);
         }
-        mUsingBuffers.erase(buffers);
     }
 
     // Cleaning transactions
-    auto pending = mPendingTransactions.find(connectionId);
-    if (pending != mPendingTransactions.end()) {
-        for (const TransactionId& transactionId : pending->second) {
-            auto iter = mTransactions.find(transactionId);
-            if (iter != mTransactions.end()) {
-                if (!iter->second->mSenderValidated) {
-                    mCompletedTransactions.insert(transactionId);
-                }
-                BufferId bufferId = iter->second->mBufferId;
-                auto bufferIter = mBuffers.find(bufferId);
-                bufferIter->second->mTransactionCount--;
-                if (bufferIter->second->mOwnerCount == 0 &&
-                    bufferIter->second->mTransactionCount == 0) {
-                    // TODO: handle freebuffer insert fail
-                    if (!bufferIter->second->mInvalidated) {
-                        mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                        mFreeBuffers.insert(bufferId);
-                    } else {
-                        mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                        mStats.onBufferEvicted(bufferIter->second->mAllocSize);
-                        mBuffers.erase(bufferIter);
-                        mInvalidation.onBufferInvalidated(bufferId, mInvalidationChannel);
-                    }
-                }
-                mTransactions.erase(iter);
+    for (size_t i = 0; i < mTransactions.size();) {
+        TransactionStatus &transaction = mTransactions[i];
+        if (transaction.mReceiver != connectionId) {
+            ++i;
+            continue;
+        }
+        if (!transaction.mSenderValidated) {
+            mCompletedTransactions.push_back(transaction.mId);
+        }
+        auto bufferIter = mBuffers.find(transaction.mBufferId);
+        eraseTransaction(&transaction);
+        if (bufferIter != mBuffers.end()) {
+            bufferIter->second->mTransactionCount--;
+            if (bufferIter->second->isIdle()) {
+                handleBufferIdle(bufferIter);
             }
         }
     }
-    mConnectionIds.erase(connectionId);
+    if (found) {
+        mConnectionIds[slot] = kInvalidConnectionId;
+    }
     return true;
 }
 
@@ -679,18 +695,26 @@ bool Accessor::Impl::BufferPool::getFreeBuffer(
         const std::shared_ptr<BufferPoolAllocator> &allocator,
         const std::vector<uint8_t> &params, BufferId *pId,
         const native_handle_t** handle) {
-    auto bufferIt = mFreeBuffers.begin();
-    for (;bufferIt != mFreeBuffers.end(); ++bufferIt) {
-        BufferId bufferId = *bufferIt;
-        if (allocator->compatible(params, mBuffers[bufferId]->mConfig)) {
-            break;
-        }
-    }
-    if (bufferIt != mFreeBuffers.end()) {
-        BufferId id = *bufferIt;
-        mFreeBuffers.erase(bufferIt);
-        mStats.onBufferRecycled(mBuffers[id]->mAllocSize);
-        *handle = mBuffers[id]->handle();
+    // Buffers allocated with the same parameters are tried first. Otherwise
+    // compatibility is checked once per bucket rather than per buffer.
+    auto bucket = mFreeBuffers.find(params);
+    if (bucket == mFreeBuffers.end() || bucket->second.empty() ||
+            !allocator->compatible(params, bucket->first)) {
+        for (bucket = mFreeBuffers.begin(); bucket != mFreeBuffers.end(); ++bucket) {
+            if (!bucket->second.empty() && bucket->first != params &&
+                    allocator->compatible(params, bucket->first)) {
+                break;
+            }
+        }
+    }
+    if (bucket != mFreeBuffers.end()) {
+        // The most recently freed buffer is the most likely to be cache hot.
+        BufferId id = bucket->second.back();
+        bucket->second.pop_back();
+        InternalBuffer *buffer = mBuffers[id].get();
+        buffer->mFree = false;
+        mStats.onBufferRecycled(buffer->mAllocSize);
+        *handle = buffer->handle();
         *pId = id;
         ALOGV("recycle a buffer %u %p", id, *handle);
         return true;
@@ -740,20 +764,22 @@ void Accessor::Impl::BufferPool::cleanUp(bool clearCache) {
                   mStats.mTotalRecycles, mStats.mTotalAllocations,
                   mStats.mTotalFetches, mStats.mTotalTransfers);
         }
-        for (auto freeIt = mFreeBuffers.begin(); freeIt != mFreeBuffers.end();) {
+        // Evicts the free buffers in the order of their ids.
+        for (auto it = mBuffers.begin(); it != mBuffers.end();) {
             if (!clearCache && mStats.buffersNotInUse() <= kUnusedBufferCountTarget &&
                     (mStats.mSizeCached < kMinAllocBytesForEviction ||
                      mBuffers.size() < kMinBufferCountForEviction)) {
                 break;
             }
-            auto it = mBuffers.find(*freeIt);
-            if (it != mBuffers.end() &&
-                    it->second->mOwnerCount == 0 && it->second->mTransactionCount == 0) {
+            if (!it->second->mFree) {
+                ++it;
+                continue;
+            }
+            if (removeFreeBuffer(*it->second) && it->second->isIdle()) {
                 mStats.onBufferEvicted(it->second->mAllocSize);
-                mBuffers.erase(it);
-                freeIt = mFreeBuffers.erase(freeIt);
+                it = mBuffers.erase(it);
             } else {
-                ++freeIt;
+                ++it;
                 ALOGW("bufferpool2 inconsistent!");
             }
         }
@@ -763,28 +789,23 @@ void Accessor::Impl::BufferPool::cleanUp(bool clearCache) {
 void Accessor::Impl::BufferPool::invalidate(
         bool needsAck, BufferId from, BufferId to,
         const std::shared_ptr<Accessor::Impl> &impl) {
-    for (auto freeIt = mFreeBuffers.begin(); freeIt != mFreeBuffers.end();) {
-        if (isBufferInRange(from, to, *freeIt)) {
-            auto it = mBuffers.find(*freeIt);
-            if (it != mBuffers.end() &&
-                it->second->mOwnerCount == 0 && it->second->mTransactionCount == 0) {
+    size_t left = 0;
+    for (auto it = mBuffers.begin(); it != mBuffers.end();) {
+        if (!isBufferInRange(from, to, it->first)) {
+            ++it;
+            continue;
+        }
+        if (it->second->mFree) {
+            if (removeFreeBuffer(*it->second) && it->second->isIdle()) {
                 mStats.onBufferEvicted(it->second->mAllocSize);
-                mBuffers.erase(it);
-                freeIt = mFreeBuffers.erase(freeIt);
+                it = mBuffers.erase(it);
                 continue;
-            } else {
-                ALOGW("bufferpool2 inconsistent!");
             }
+            ALOGW("bufferpool2 inconsistent!");
         }
-        ++freeIt;
-    }
-
-    size_t left = 0;
-    for (auto it = mBuffers.begin(); it != mBuffers.end(); ++it) {
-        if (isBufferInRange(from, to, it->first)) {
-            it->second->invalidate();
-            ++left;
-        }
+        it->second->invalidate();
+        ++left;
+        ++it;
     }
     mInvalidation.onInvalidationRequest(needsAck, from, to, left, mInvalidationChannel, impl);
 }
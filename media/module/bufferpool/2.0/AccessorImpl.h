@@ -19,6 +19,7 @@
 
 #include <map>
 #include <set>
+#include <vector>
 #include <condition_variable>
 #include <utils/Timers.h>
 #include "Accessor.h"
@@ -101,21 +102,30 @@ private:
         BufferStatusObserver mObserver;
         BufferInvalidationChannel mInvalidationChannel;
 
-        std::map<ConnectionId, std::set<BufferId>> mUsingBuffers;
-        std::map<BufferId, std::set<ConnectionId>> mUsingConnections;
+        // Open connections, indexed by a dense connection slot. Buffer
+        // ownership is tracked by per buffer bitsets of the slots, so that
+        // ownership changes do not allocate. A closed slot is kept as
+        // kInvalidConnectionId and reused by the next connection.
+        std::vector<ConnectionId> mConnectionIds;
 
-        std::map<ConnectionId, std::set<TransactionId>> mPendingTransactions;
         // Transactions completed before TRANSFER_TO message arrival.
         // Fetch does not occur for the transactions.
         // Only transaction id is kept for the transactions in short duration.
-        std::set<TransactionId> mCompletedTransactions;
+        std::vector<TransactionId> mCompletedTransactions;
         // Currently active(pending) transations' status & information.
-        std::map<TransactionId, std::unique_ptr<TransactionStatus>>
-                mTransactions;
+        // A transaction is pending on its receiver connection. Only a handful
+        // of transactions are in flight at once, so they are kept in a flat
+        // array whose storage is reused by the later transactions.
+        std::vector<TransactionStatus> mTransactions;
 
         std::map<BufferId, std::unique_ptr<InternalBuffer>> mBuffers;
-        std::set<BufferId> mFreeBuffers;
-        std::set<ConnectionId> mConnectionIds;
+        // Free buffers bucketed by their allocation parameters. Buckets are
+        // kept after being emptied, since codecs keep asking for the same
+        // parameters.
+        std::map<std::vector<uint8_t>, std::vector<BufferId>> mFreeBuffers;
+
+        // Buffer status messages read from the FMQs; reused between calls.
+        std::vector<BufferStatusMessage> mMessages;
 
         struct Invalidation {
             static std::atomic<std::uint32_t> sInvSeqId;
@@ -328,6 +338,46 @@ private:
          */
         bool handleClose(ConnectionId connectionId);
 
+        /**
+         * Finds the dense slot of an open connection.
+         *
+         * @param connectionId  the id of the connection.
+         * @param slot          the slot of the connection.
+         *
+         * @return {@code true} when the connection is open,
+         *         {@code false} otherwise.
+         */
+        bool findConnectionSlot(ConnectionId connectionId, size_t *slot) const;
+
+        /**
+         * Returns the active transaction of the id, or nullptr.
+         */
+        TransactionStatus *findTransaction(TransactionId transactionId);
+
+        /**
+         * Removes an active transaction. Pointers to the other transactions
+         * may be invalidated.
+         */
+        void eraseTransaction(TransactionStatus *transaction);
+
+        /**
+         * Handles a buffer which is neither owned nor being transferred.
+         * The buffer is added to the free buffers, or evicted if it was
+         * invalidated earlier.
+         *
+         * @param bufferIter    the buffer, which may be erased.
+         */
+        void handleBufferIdle(
+                std::map<BufferId, std::unique_ptr<InternalBuffer>>::iterator bufferIter);
+
+        /**
+         * Removes a buffer from the free buffers.
+         *
+         * @return {@code true} when the buffer was free,
+         *         {@code false} otherwise.
+         */
+        bool removeFreeBuffer(const InternalBuffer &buffer);
+
         /**
          * Recycles a existing free buffer if it is possible.
          *
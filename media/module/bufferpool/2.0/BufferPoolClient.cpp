@@ -17,6 +17,8 @@
 #define LOG_TAG "BufferPoolClient"
 //#define LOG_NDEBUG 0
 
+#include <chrono>
+#include <condition_variable>
 #include <thread>
 #include <utils/Log.h>
 #include "BufferPoolClient.h"
@@ -34,6 +36,10 @@ static constexpr int kPostMaxRetry = 3;
 static constexpr int kCacheTtlUs = 1000000; // TODO: tune
 static constexpr size_t kMaxCachedBufferCount = 64;
 static constexpr size_t kCachedBufferCountTarget = kMaxCachedBufferCount - 16;
+// Buffer releases of a remote client are coalesced and posted with the next
+// status message, or once this many are pending or the oldest is this old.
+static constexpr size_t kReleaseBatchCount = 8;
+static constexpr int64_t kReleaseBatchDelayUs = 4000;
 
 class BufferPoolClient::Impl
         : public std::enable_shared_from_this<BufferPoolClient::Impl> {
@@ -75,6 +81,8 @@ public:
 
     void postBufferRelease(BufferId bufferId);
 
+    void flushBufferRelease();
+
     bool postSend(
             BufferId bufferId, ConnectionId receiver,
             TransactionId *transactionId, int64_t *timestampUs);
@@ -150,17 +158,38 @@ private:
         // TODO: use only one list?(using one list may dealy sending messages?)
         std::list<BufferId> mReleasingIds;
         std::list<BufferId> mReleasedIds;
+        int64_t mReleasingSinceUs;
         uint32_t mInvalidateId; // TODO: invalidation ACK to bufferpool
         bool mInvalidateAck;
         std::unique_ptr<BufferStatusChannel> mStatusChannel;
 
-        ReleaseCache() : mInvalidateId(0), mInvalidateAck(true) {}
+        ReleaseCache() : mReleasingSinceUs(0), mInvalidateId(0), mInvalidateAck(true) {}
     } mReleasing;
 
     // This lock is held during synchronization from remote side.
     // In order to minimize remote calls and locking durtaion, this lock is held
     // by best effort approach using try_lock().
     std::mutex mRemoteSyncLock;
+
+    // Posts the coalesced releases of remote clients which were not flushed by
+    // another status message in time.
+    struct ReleaseFlusher {
+        std::map<const std::weak_ptr<BufferPoolClient::Impl>, int64_t,
+                 std::owner_less<>> mClients;
+        std::mutex mMutex;
+        std::condition_variable mCv;
+
+        ReleaseFlusher();
+        void addClient(const std::weak_ptr<BufferPoolClient::Impl> &impl, int64_t flushUs);
+    };
+
+    static ReleaseFlusher &getReleaseFlusher();
+
+    static void flusherThread(
+        std::map<const std::weak_ptr<BufferPoolClient::Impl>, int64_t,
+                 std::owner_less<>> &clients,
+        std::mutex &mutex,
+        std::condition_variable &cv);
 };
 
 struct BufferPoolClient::Impl::BlockPoolDataDtor {
@@ -497,9 +526,109 @@ ResultStatus BufferPoolClient::Impl::receive(
 
 void BufferPoolClient::Impl::postBufferRelease(BufferId bufferId) {
     std::lock_guard<std::mutex> lock(mReleasing.mLock);
+    int64_t now = getTimestampNow();
+    if (mReleasing.mReleasingIds.empty()) {
+        mReleasing.mReleasingSinceUs = now;
+    }
     mReleasing.mReleasingIds.push_back(bufferId);
+    // A local client allocates from the buffer pool right away, so it does
+    // not delay releases. Releases of a remote client are flushed by the
+    // next status message, e.g. TRANSFER_FROM of the next frame, when the
+    // batch is full or old enough, or by the release flusher if the client
+    // goes quiet.
+    if (mLocal || mReleasing.mReleasingIds.size() >= kReleaseBatchCount ||
+            now >= mReleasing.mReleasingSinceUs + kReleaseBatchDelayUs) {
+        mReleasing.mStatusChannel->postBufferRelease(
+                mConnectionId, mReleasing.mReleasingIds, mReleasing.mReleasedIds);
+    }
+    if (!mLocal && mReleasing.mReleasingIds.size() == 1) {
+        getReleaseFlusher().addClient(
+                shared_from_this(), mReleasing.mReleasingSinceUs + kReleaseBatchDelayUs);
+    }
+}
+
+void BufferPoolClient::Impl::flushBufferRelease() {
+    std::lock_guard<std::mutex> lock(mReleasing.mLock);
+    if (!mValid || mReleasing.mReleasingIds.empty()) {
+        return;
+    }
     mReleasing.mStatusChannel->postBufferRelease(
             mConnectionId, mReleasing.mReleasingIds, mReleasing.mReleasedIds);
+    if (!mReleasing.mReleasingIds.empty()) {
+        // The FMQ is full; retries later.
+        getReleaseFlusher().addClient(
+                shared_from_this(), getTimestampNow() + kReleaseBatchDelayUs);
+    }
+}
+
+void BufferPoolClient::Impl::flusherThread(
+        std::map<const std::weak_ptr<BufferPoolClient::Impl>, int64_t,
+                 std::owner_less<>> &clients,
+        std::mutex &mutex,
+        std::condition_variable &cv) {
+    std::list<std::weak_ptr<BufferPoolClient::Impl>> flushList;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (clients.empty()) {
+                cv.wait(lock);
+                continue;
+            }
+            int64_t now = getTimestampNow();
+            int64_t nextFlushUs = INT64_MAX;
+            auto it = clients.begin();
+            while (it != clients.end()) {
+                if (it->second <= now) {
+                    flushList.push_back(it->first);
+                    it = clients.erase(it);
+                } else {
+                    nextFlushUs = std::min(nextFlushUs, it->second);
+                    ++it;
+                }
+            }
+            if (flushList.empty()) {
+                cv.wait_for(lock, std::chrono::microseconds(nextFlushUs - now));
+                continue;
+            }
+        }
+        for (auto it = flushList.begin(); it != flushList.end(); ++it) {
+            const std::shared_ptr<BufferPoolClient::Impl> impl = it->lock();
+            if (impl) {
+                impl->flushBufferRelease();
+            }
+        }
+        flushList.clear();
+    }
+}
+
+BufferPoolClient::Impl::ReleaseFlusher::ReleaseFlusher() {
+    std::thread flusher(
+            flusherThread,
+            std::ref(mClients),
+            std::ref(mMutex),
+            std::ref(mCv));
+    flusher.detach();
+}
+
+void BufferPoolClient::Impl::ReleaseFlusher::addClient(
+        const std::weak_ptr<BufferPoolClient::Impl> &impl, int64_t flushUs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    bool notify = mClients.empty();
+    auto it = mClients.find(impl);
+    if (it == mClients.end()) {
+        mClients.emplace(impl, flushUs);
+    } else {
+        it->second = std::min(it->second, flushUs);
+    }
+    if (notify) {
+        mCv.notify_one();
+    }
+}
+
+BufferPoolClient::Impl::ReleaseFlusher &BufferPoolClient::Impl::getReleaseFlusher() {
+    // The flusher thread is detached, so the flusher is never destroyed.
+    static ReleaseFlusher *sFlusher = new ReleaseFlusher();
+    return *sFlusher;
 }
 
 // TODO: revise ad-hoc posting data structure
@@ -17,6 +17,7 @@
 #define LOG_TAG "BufferPoolStatus"
 //#define LOG_NDEBUG 0
 
+#include <iterator>
 #include <thread>
 #include <time.h>
 #include "BufferStatus.h"
@@ -86,19 +87,23 @@ ResultStatus BufferStatusObserver::close(ConnectionId id) {
 
 void BufferStatusObserver::getBufferStatusChanges(std::vector<BufferStatusMessage> &messages) {
     for (auto it = mBufferStatusQueues.begin(); it != mBufferStatusQueues.end(); ++it) {
-        BufferStatusMessage message;
         size_t avail = it->second->availableToRead();
-        while (avail > 0) {
-            if (!it->second->read(&message, 1)) {
-                // Since avaliable # of reads are already confirmed,
-                // this should not happen.
-                // TODO: error handling (spurious client?)
-                ALOGW("FMQ message cannot be read from %lld", (long long)it->first);
-                return;
-            }
-            message.connectionId = it->first;
-            messages.push_back(message);
-            --avail;
+        if (avail == 0) {
+            continue;
+        }
+        // Reads all the available messages at once.
+        size_t first = messages.size();
+        messages.resize(first + avail);
+        if (!it->second->read(&messages[first], avail)) {
+            // Since avaliable # of reads are already confirmed,
+            // this should not happen.
+            // TODO: error handling (spurious client?)
+            ALOGW("FMQ message cannot be read from %lld", (long long)it->first);
+            messages.resize(first);
+            return;
+        }
+        for (size_t i = first; i < messages.size(); ++i) {
+            messages[i].connectionId = it->first;
         }
     }
 }
@@ -127,27 +132,44 @@ bool BufferStatusChannel::needsSync() {
     return false;
 }
 
+void BufferStatusChannel::appendReleases(
+        ConnectionId connectionId, const std::list<BufferId> &pending, size_t count) {
+    BufferStatusMessage release;
+    release.newStatus = BufferStatus::NOT_USED;
+    release.connectionId = connectionId;
+    auto it = pending.begin();
+    for (size_t i = 0; i < count; ++i, ++it) {
+        release.bufferId = *it;
+        mMessages.push_back(release);
+    }
+}
+
+bool BufferStatusChannel::writeMessages(
+        ConnectionId connectionId, size_t numReleases,
+        std::list<BufferId> &pending, std::list<BufferId> &posted) {
+    bool written = mBufferStatusQueue->write(mMessages.data(), mMessages.size());
+    mMessages.clear();
+    if (!written) {
+        // Since avaliable # of writes are already confirmed,
+        // this should not happen.
+        // TODO: error handing?
+        ALOGW("FMQ message cannot be sent from %lld", (long long)connectionId);
+        return false;
+    }
+    posted.splice(posted.end(), pending, pending.begin(),
+                  std::next(pending.begin(), numReleases));
+    return true;
+}
+
 void BufferStatusChannel::postBufferRelease(
         ConnectionId connectionId,
         std::list<BufferId> &pending, std::list<BufferId> &posted) {
     if (mValid && pending.size() > 0) {
         size_t avail = mBufferStatusQueue->availableToWrite();
         avail = std::min(avail, pending.size());
-        BufferStatusMessage message;
-        for (size_t i = 0 ; i < avail; ++i) {
-            BufferId id = pending.front();
-            message.newStatus = BufferStatus::NOT_USED;
-            message.bufferId = id;
-            message.connectionId = connectionId;
-            if (!mBufferStatusQueue->write(&message, 1)) {
-                // Since avaliable # of writes are already confirmed,
-                // this should not happen.
-                // TODO: error handing?
-                ALOGW("FMQ message cannot be sent from %lld", (long long)connectionId);
-                return;
-            }
-            pending.pop_front();
-            posted.push_back(id);
+        if (avail > 0) {
+            appendReleases(connectionId, pending, avail);
+            writeMessages(connectionId, avail, pending, posted);
         }
     }
 }
@@ -183,22 +205,9 @@ bool BufferStatusChannel::postBufferStatusMessage(
         size_t avail = mBufferStatusQueue->availableToWrite();
         size_t numPending = pending.size();
         if (avail >= numPending + 1) {
-            BufferStatusMessage release, message;
-            for (size_t i = 0; i < numPending; ++i) {
-                BufferId id = pending.front();
-                release.newStatus = BufferStatus::NOT_USED;
-                release.bufferId = id;
-                release.connectionId = connectionId;
-                if (!mBufferStatusQueue->write(&release, 1)) {
-                    // Since avaliable # of writes are already confirmed,
-                    // this should not happen.
-                    // TODO: error handling?
-                    ALOGW("FMQ message cannot be sent from %lld", (long long)connectionId);
-                    return false;
-                }
-                pending.pop_front();
-                posted.push_back(id);
-            }
+            // The pending releases and the message are written at once.
+            BufferStatusMessage message;
+            appendReleases(connectionId, pending, numPending);
             message.transactionId = transactionId;
             message.bufferId = bufferId;
             message.newStatus = status;
@@ -206,13 +215,8 @@ bool BufferStatusChannel::postBufferStatusMessage(
             message.targetConnectionId = targetId;
             // TODO : timesatamp
             message.timestampUs = 0;
-            if (!mBufferStatusQueue->write(&message, 1)) {
-                // Since avaliable # of writes are already confirmed,
-                // this should not happen.
-                ALOGW("FMQ message cannot be sent from %lld", (long long)connectionId);
-                return false;
-            }
-            return true;
+            mMessages.push_back(message);
+            return writeMessages(connectionId, numPending, pending, posted);
         }
     }
     return false;
@@ -245,14 +249,12 @@ void BufferInvalidationListener::getInvalidations(
         size_t avail = std::min(
                 mBufferInvalidationQueue->availableToRead(), (size_t) kNumElementsInQueue);
         if (avail > 0) {
-            std::vector<BufferInvalidationMessage> temp(avail);
-            if (mBufferInvalidationQueue->read(temp.data(), avail)) {
-                messages.reserve(messages.size() + avail);
-                for (auto it = temp.begin(); it != temp.end(); ++it) {
-                    messages.push_back(*it);
-                }
+            size_t first = messages.size();
+            messages.resize(first + avail);
+            if (mBufferInvalidationQueue->read(&messages[first], avail)) {
                 break;
             }
+            messages.resize(first);
         } else {
             return;
         }
@@ -88,6 +88,20 @@ class BufferStatusChannel {
 private:
     bool mValid;
     std::unique_ptr<BufferStatusQueue> mBufferStatusQueue;
+    // Messages to be written to the FMQ at once; reused between posts.
+    std::vector<BufferStatusMessage> mMessages;
+
+    /** Appends release messages of the first count pending buffers. */
+    void appendReleases(
+            ConnectionId connectionId, const std::list<BufferId> &pending, size_t count);
+
+    /**
+     * Writes the appended messages to the FMQ at once. When the messages are
+     * written, the first numReleases pending buffers are moved to posted.
+     */
+    bool writeMessages(
+            ConnectionId connectionId, size_t numReleases,
+            std::list<BufferId> &pending, std::list<BufferId> &posted);
 
 public:
     /**
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the buffer pool transfer paths a codec uses for each frame.
+
+#include <benchmark/benchmark.h>
+
+#include <bufferpool/ClientManager.h>
+#include <hidl/HidlTransportSupport.h>
+#include <hidl/LegacySupport.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <memory>
+#include <set>
+#include <vector>
+#include "allocator.h"
+
+using android::hardware::configureRpcThreadpool;
+using android::hardware::media::bufferpool::V2_0::IClientManager;
+using android::hardware::media::bufferpool::V2_0::ResultStatus;
+using android::hardware::media::bufferpool::V2_0::implementation::BufferId;
+using android::hardware::media::bufferpool::V2_0::implementation::ClientManager;
+using android::hardware::media::bufferpool::V2_0::implementation::ConnectionId;
+using android::hardware::media::bufferpool::V2_0::implementation::TransactionId;
+using android::hardware::media::bufferpool::BufferPoolData;
+
+namespace {
+
+void closeHandle(native_handle_t *handle) {
+  if (handle) {
+    native_handle_close(handle);
+    native_handle_delete(handle);
+  }
+}
+
+// Buffer sent to the receiver process.
+struct SendMessage {
+  BufferId bufferId;
+  ConnectionId connectionId;
+  TransactionId transactionId;
+  int64_t timestampUs;
+};
+
+// Receives buffers from the command pipe and releases each one before
+// replying on the result pipe, until the command pipe is closed.
+void runReceiver(int commandFd, int resultFd) {
+  configureRpcThreadpool(1, false);
+  android::sp<ClientManager> manager = ClientManager::getInstance();
+  bool ok = manager && manager->registerAsService() == android::OK;
+  if (write(resultFd, &ok, sizeof(ok)) != sizeof(ok) || !ok) {
+    return;
+  }
+  SendMessage message;
+  while (read(commandFd, &message, sizeof(message)) == sizeof(message)) {
+    native_handle_t *rhandle = nullptr;
+    std::shared_ptr<BufferPoolData> rbuffer;
+    ok = manager->receive(message.connectionId, message.transactionId,
+                          message.bufferId, message.timestampUs, &rhandle,
+                          &rbuffer) == ResultStatus::OK;
+    closeHandle(rhandle);
+    rbuffer.reset();
+    if (write(resultFd, &ok, sizeof(ok)) != sizeof(ok)) {
+      break;
+    }
+  }
+}
+
+}  // anonymous namespace
+
+// Allocate/transfer/release cycles within a process with several buffers in
+// flight, after the buffers were allocated once.
+static void BM_LocalTransfer(benchmark::State &state) {
+  const size_t numBuffers = state.range(0);
+  android::sp<ClientManager> manager = ClientManager::getInstance();
+  std::shared_ptr<BufferPoolAllocator> allocator =
+      std::make_shared<TestBufferPoolAllocator>();
+  ConnectionId connectionId;
+  if (manager->create(allocator, &connectionId) != ResultStatus::OK) {
+    state.SkipWithError("cannot create a buffer pool");
+    return;
+  }
+  std::vector<uint8_t> vecParams;
+  getTestAllocatorParams(&vecParams);
+
+  std::vector<std::shared_ptr<BufferPoolData>> buffers(numBuffers);
+  size_t i = 0;
+  for (auto _ : state) {
+    std::shared_ptr<BufferPoolData> &held = buffers[i++ % numBuffers];
+    held.reset();
+
+    std::shared_ptr<BufferPoolData> sbuffer;
+    native_handle_t *allocHandle = nullptr;
+    native_handle_t *recvHandle = nullptr;
+    TransactionId transactionId;
+    int64_t postUs;
+    if (manager->allocate(connectionId, vecParams, &allocHandle, &sbuffer) !=
+            ResultStatus::OK ||
+        manager->postSend(connectionId, sbuffer, &transactionId, &postUs) !=
+            ResultStatus::OK ||
+        manager->receive(connectionId, transactionId, sbuffer->mId, postUs,
+                         &recvHandle, &held) != ResultStatus::OK) {
+      state.SkipWithError("transfer failed");
+      break;
+    }
+    closeHandle(allocHandle);
+    closeHandle(recvHandle);
+  }
+  buffers.clear();
+  manager->close(connectionId);
+}
+
+BENCHMARK(BM_LocalTransfer)->ArgName("buffers")->Arg(4)->Arg(16);
+
+// Round trips of a buffer sent to another process, which releases it before
+// replying. The releases of the receiver are coalesced, so the number of
+// buffers the sender needs to allocate is reported too.
+static void BM_RemoteRoundTrip(benchmark::State &state) {
+  int commandFds[2];
+  int resultFds[2];
+  if (pipe(commandFds) != 0 || pipe(resultFds) != 0) {
+    state.SkipWithError("cannot create pipes");
+    return;
+  }
+  pid_t receiverPid = fork();
+  if (receiverPid == 0) {
+    close(commandFds[1]);
+    close(resultFds[0]);
+    runReceiver(commandFds[0], resultFds[1]);
+    _exit(0);
+  }
+  close(commandFds[0]);
+  close(resultFds[1]);
+
+  bool ok = false;
+  android::sp<ClientManager> manager = ClientManager::getInstance();
+  std::shared_ptr<BufferPoolAllocator> allocator =
+      std::make_shared<TestBufferPoolAllocator>();
+  ConnectionId connectionId = -1;
+  ConnectionId receiverId;
+  android::sp<IClientManager> receiver;
+  if (receiverPid < 0 ||
+      read(resultFds[0], &ok, sizeof(ok)) != sizeof(ok) || !ok ||
+      !(receiver = IClientManager::getService()) ||
+      manager->create(allocator, &connectionId) != ResultStatus::OK ||
+      manager->registerSender(receiver, connectionId, &receiverId) !=
+          ResultStatus::OK) {
+    state.SkipWithError("cannot connect to the receiver process");
+  } else {
+    std::vector<uint8_t> vecParams;
+    getTestAllocatorParams(&vecParams);
+    std::set<BufferId> bufferIds;
+    for (auto _ : state) {
+      native_handle_t *shandle = nullptr;
+      std::shared_ptr<BufferPoolData> sbuffer;
+      SendMessage message;
+      if (manager->allocate(connectionId, vecParams, &shandle, &sbuffer) !=
+              ResultStatus::OK ||
+          manager->postSend(receiverId, sbuffer, &message.transactionId,
+                            &message.timestampUs) != ResultStatus::OK) {
+        closeHandle(shandle);
+        state.SkipWithError("send failed");
+        break;
+      }
+      closeHandle(shandle);
+      bufferIds.insert(sbuffer->mId);
+      message.bufferId = sbuffer->mId;
+      message.connectionId = receiverId;
+      if (write(commandFds[1], &message, sizeof(message)) != sizeof(message) ||
+          read(resultFds[0], &ok, sizeof(ok)) != sizeof(ok) || !ok) {
+        state.SkipWithError("receive failed");
+        break;
+      }
+    }
+    state.counters["buffers"] = bufferIds.size();
+  }
+
+  close(commandFds[1]);
+  close(resultFds[0]);
+  if (receiverPid > 0) {
+    kill(receiverPid, SIGKILL);
+    waitpid(receiverPid, nullptr, 0);
+  }
+  if (connectionId != -1) {
+    manager->close(connectionId);
+  }
+}
+
+// A single run, so that only one receiver process registers as the service.
+BENCHMARK(BM_RemoteRoundTrip)->Iterations(1000)->UseRealTime();
+
+int main(int argc, char **argv) {
+  android::hardware::details::setTrebleTestingOverride(true);
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
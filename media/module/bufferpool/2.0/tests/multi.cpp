@@ -29,8 +29,11 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <chrono>
 #include <iostream>
 #include <memory>
+#include <set>
+#include <thread>
 #include <vector>
 #include "allocator.h"
 
@@ -46,6 +49,12 @@ using android::hardware::media::bufferpool::BufferPoolData;
 
 namespace {
 
+// Number of buffers released by the receiver for release flush test; fewer
+// than a release batch.
+constexpr static int kNumQuietReleaseTest = 3;
+// Time to wait for the coalesced releases of a quiet receiver.
+constexpr static std::chrono::milliseconds kQuietReleaseWait(100);
+
 // communication message types between processes.
 enum PipeCommand : int32_t {
     INIT_OK = 0,
@@ -152,31 +161,39 @@ class BufferpoolMultiTest : public ::testing::Test {
     message.data.command = PipeCommand::INIT_OK;
     sendMessage(mResultPipeFds, message);
 
-    receiveMessage(mCommandPipeFds, &message);
-    {
+    // Receives buffers until the sender stops sending.
+    ConnectionId connectionId = -1;
+    while (receiveMessage(mCommandPipeFds, &message) &&
+           message.data.command == PipeCommand::SEND) {
       native_handle_t *rhandle = nullptr;
       std::shared_ptr<BufferPoolData> rbuffer;
+      connectionId = message.data.connectionId;
       ResultStatus status = mManager->receive(
           message.data.connectionId, message.data.transactionId,
           message.data.bufferId, message.data.timestampUs, &rhandle, &rbuffer);
-      mManager->close(message.data.connectionId);
       if (status != ResultStatus::OK) {
+        mManager->close(connectionId);
         message.data.command = PipeCommand::RECEIVE_ERROR;
         sendMessage(mResultPipeFds, message);
         return;
       }
-      if (!TestBufferPoolAllocator::Verify(rhandle, 0x77)) {
-        message.data.command = PipeCommand::RECEIVE_ERROR;
-        sendMessage(mResultPipeFds, message);
-        return;
-      }
+      bool verified = TestBufferPoolAllocator::Verify(rhandle, 0x77);
       if (rhandle) {
         native_handle_close(rhandle);
         native_handle_delete(rhandle);
       }
+      if (!verified) {
+        mManager->close(connectionId);
+        message.data.command = PipeCommand::RECEIVE_ERROR;
+        sendMessage(mResultPipeFds, message);
+        return;
+      }
+      message.data.command = PipeCommand::RECEIVE_OK;
+      sendMessage(mResultPipeFds, message);
+    }
+    if (connectionId != -1) {
+      mManager->close(connectionId);
     }
-    message.data.command = PipeCommand::RECEIVE_OK;
-    sendMessage(mResultPipeFds, message);
   }
 };
 
@@ -224,6 +241,76 @@ TEST_F(BufferpoolMultiTest, TransferBuffer) {
   EXPECT_TRUE(message.data.command == PipeCommand::RECEIVE_OK);
 }
 
+// Buffer release flush test between processes.
+// The receiver process releases fewer buffers than a release batch and then
+// stays quiet. Check whether its coalesced releases are still posted, so that
+// the sender recycles the buffers.
+TEST_F(BufferpoolMultiTest, FlushQuietReleases) {
+  ResultStatus status;
+  PipeMessage message;
+
+  ASSERT_TRUE(receiveMessage(mResultPipeFds, &message));
+
+  android::sp<IClientManager> receiver = IClientManager::getService();
+  ConnectionId receiverId;
+  ASSERT_TRUE((bool)receiver);
+
+  status = mManager->registerSender(receiver, mConnectionId, &receiverId);
+  ASSERT_TRUE(status == ResultStatus::OK);
+
+  std::vector<uint8_t> vecParams;
+  getTestAllocatorParams(&vecParams);
+  std::vector<std::shared_ptr<BufferPoolData>> sbuffers;
+  std::set<BufferId> bufferIds;
+  for (int i = 0; i < kNumQuietReleaseTest; ++i) {
+    native_handle_t *shandle = nullptr;
+    std::shared_ptr<BufferPoolData> sbuffer;
+    TransactionId transactionId;
+    int64_t postUs;
+
+    // holds the sent buffers, so that each transfer uses a new buffer.
+    status = mManager->allocate(mConnectionId, vecParams, &shandle, &sbuffer);
+    ASSERT_TRUE(status == ResultStatus::OK);
+    ASSERT_TRUE(TestBufferPoolAllocator::Fill(shandle, 0x77));
+    if (shandle) {
+        native_handle_close(shandle);
+        native_handle_delete(shandle);
+    }
+    sbuffers.push_back(sbuffer);
+    bufferIds.insert(sbuffer->mId);
+
+    status = mManager->postSend(receiverId, sbuffer, &transactionId, &postUs);
+    ASSERT_TRUE(status == ResultStatus::OK);
+
+    message.data.command = PipeCommand::SEND;
+    message.data.bufferId = sbuffer->mId;
+    message.data.connectionId = receiverId;
+    message.data.transactionId = transactionId;
+    message.data.timestampUs = postUs;
+    ASSERT_TRUE(sendMessage(mCommandPipeFds, message));
+    ASSERT_TRUE(receiveMessage(mResultPipeFds, &message));
+    ASSERT_TRUE(message.data.command == PipeCommand::RECEIVE_OK);
+  }
+  ASSERT_EQ((size_t)kNumQuietReleaseTest, bufferIds.size());
+  sbuffers.clear();
+
+  // The receiver does not send any status message from now on.
+  std::this_thread::sleep_for(kQuietReleaseWait);
+  for (int i = 0; i < kNumQuietReleaseTest; ++i) {
+    native_handle_t *shandle = nullptr;
+    std::shared_ptr<BufferPoolData> sbuffer;
+    status = mManager->allocate(mConnectionId, vecParams, &shandle, &sbuffer);
+    ASSERT_TRUE(status == ResultStatus::OK);
+    if (shandle) {
+        native_handle_close(shandle);
+        native_handle_delete(shandle);
+    }
+    EXPECT_EQ(1u, bufferIds.count(sbuffer->mId))
+        << "buffer " << sbuffer->mId << " was allocated instead of recycled";
+    sbuffers.push_back(sbuffer);
+  }
+}
+
 }  // anonymous namespace
 
 int main(int argc, char** argv) {
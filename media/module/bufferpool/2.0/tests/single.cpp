@@ -28,6 +28,7 @@
 #include <unistd.h>
 #include <iostream>
 #include <memory>
+#include <set>
 #include <vector>
 #include "allocator.h"
 
@@ -47,6 +48,10 @@ constexpr static int kNumAllocationTest = 3;
 // Number of iteration for buffer recycling test.
 constexpr static int kNumRecycleTest = 3;
 
+// Number of iteration and of buffers in flight for in flight recycling test.
+constexpr static int kNumInFlightTest = 100;
+constexpr static int kNumInFlightBuffers = 16;
+
 // media.bufferpool test setup
 class BufferpoolSingleTest : public ::testing::Test {
  public:
@@ -173,6 +178,50 @@ TEST_F(BufferpoolSingleTest, TransferBuffer) {
   }
 }
 
+// Buffer recycle test with several buffers in flight.
+// Check whether each allocate/transfer/release cycle recycles the buffer
+// which was just released, as a codec does, once the buffers in flight are
+// allocated.
+TEST_F(BufferpoolSingleTest, RecycleBuffersInFlight) {
+  ResultStatus status;
+  std::vector<uint8_t> vecParams;
+  getTestAllocatorParams(&vecParams);
+
+  std::vector<std::shared_ptr<BufferPoolData>> buffers(kNumInFlightBuffers);
+  std::set<BufferId> bufferIds;
+  for (int i = 0; i < kNumInFlightTest; ++i) {
+    std::shared_ptr<BufferPoolData> &held = buffers[i % kNumInFlightBuffers];
+    BufferId releasedId = held ? held->mId : 0;
+    held.reset();
+
+    std::shared_ptr<BufferPoolData> sbuffer;
+    native_handle_t *allocHandle = nullptr;
+    native_handle_t *recvHandle = nullptr;
+    TransactionId transactionId;
+    int64_t postUs;
+    status = mManager->allocate(mConnectionId, vecParams, &allocHandle, &sbuffer);
+    ASSERT_TRUE(status == ResultStatus::OK);
+    if (i >= kNumInFlightBuffers) {
+      EXPECT_EQ(releasedId, sbuffer->mId);
+    }
+    bufferIds.insert(sbuffer->mId);
+    status = mManager->postSend(mReceiverId, sbuffer, &transactionId, &postUs);
+    ASSERT_TRUE(status == ResultStatus::OK);
+    status = mManager->receive(mReceiverId, transactionId, sbuffer->mId, postUs,
+                               &recvHandle, &held);
+    ASSERT_TRUE(status == ResultStatus::OK);
+    if (allocHandle) {
+      native_handle_close(allocHandle);
+      native_handle_delete(allocHandle);
+    }
+    if (recvHandle) {
+      native_handle_close(recvHandle);
+      native_handle_delete(recvHandle);
+    }
+  }
+  EXPECT_EQ((size_t)kNumInFlightBuffers, bufferIds.size());
+}
+
 }  // anonymous namespace
 
 int main(int argc, char** argv) {
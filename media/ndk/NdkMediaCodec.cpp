@@ -25,6 +25,7 @@
 #include <media/NdkMediaCodecPlatform.h>
 #include <media/NdkMediaError.h>
 #include <media/NdkMediaFormatPriv.h>
+#include "NdkMediaCodecPriv.h"
 #include "NdkMediaCryptoPriv.h"
 
 #include <utils/Log.h>
@@ -104,6 +105,7 @@ public:
 };
 
 typedef void (*OnCodecEvent)(AMediaCodec *codec, void *userdata);
+typedef CodecBufferTables<android::MediaCodec, MediaCodecBuffer> BufferTables;
 
 struct AMediaCodec {
     sp<android::MediaCodec> mCodec;
@@ -124,6 +126,8 @@ struct AMediaCodec {
     mutable Mutex mFrameRenderedCallbackLock;
     AMediaCodecOnFrameRendered mFrameRenderedCallback;
     void *mFrameRenderedCallbackUserData;
+
+    BufferTables mBufferTables;
 };
 
 CodecHandler::CodecHandler(AMediaCodec *codec) {
@@ -551,6 +555,7 @@ media_status_t AMediaCodec_configure(
         surface = (Surface*) window;
     }
 
+    mData->mBufferTables.onConfigure();
     status_t err = mData->mCodec->configure(dupNativeFormat, surface,
             crypto ? crypto->mCrypto : NULL, flags);
     if (err != OK) {
@@ -622,6 +627,7 @@ media_status_t AMediaCodec_releaseCrypto(AMediaCodec *mData) {
 
 EXPORT
 media_status_t AMediaCodec_start(AMediaCodec *mData) {
+    mData->mBufferTables.onStart();
     status_t ret =  mData->mCodec->start();
     if (ret != OK) {
         return translate_error(ret);
@@ -635,6 +641,7 @@ media_status_t AMediaCodec_start(AMediaCodec *mData) {
 EXPORT
 media_status_t AMediaCodec_stop(AMediaCodec *mData) {
     media_status_t ret = translate_error(mData->mCodec->stop());
+    mData->mBufferTables.onStop();
 
     sp<AMessage> msg = new AMessage(kWhatStopActivityNotifications, mData->mHandler);
     sp<AMessage> response;
@@ -646,7 +653,9 @@ media_status_t AMediaCodec_stop(AMediaCodec *mData) {
 
 EXPORT
 media_status_t AMediaCodec_flush(AMediaCodec *mData) {
-    return translate_error(mData->mCodec->flush());
+    status_t ret = mData->mCodec->flush();
+    mData->mBufferTables.onFlush();
+    return translate_error(ret);
 }
 
 EXPORT
@@ -675,24 +684,7 @@ uint8_t* AMediaCodec_getInputBuffer(AMediaCodec *mData, size_t idx, size_t *out_
         return abuf->data();
     }
 
-    android::Vector<android::sp<android::MediaCodecBuffer> > abufs;
-    if (mData->mCodec->getInputBuffers(&abufs) == 0) {
-        size_t n = abufs.size();
-        if (idx >= n) {
-            ALOGE("buffer index %zu out of range", idx);
-            return NULL;
-        }
-        if (abufs[idx] == NULL) {
-            ALOGE("buffer index %zu is NULL", idx);
-            return NULL;
-        }
-        if (out_size != NULL) {
-            *out_size = abufs[idx]->capacity();
-        }
-        return abufs[idx]->data();
-    }
-    ALOGE("couldn't get input buffers");
-    return NULL;
+    return mData->mBufferTables.get(mData->mCodec.get(), BufferTables::kInput, idx, out_size);
 }
 
 EXPORT
@@ -710,20 +702,7 @@ uint8_t* AMediaCodec_getOutputBuffer(AMediaCodec *mData, size_t idx, size_t *out
         return abuf->data();
     }
 
-    android::Vector<android::sp<android::MediaCodecBuffer> > abufs;
-    if (mData->mCodec->getOutputBuffers(&abufs) == 0) {
-        size_t n = abufs.size();
-        if (idx >= n) {
-            ALOGE("buffer index %zu out of range", idx);
-            return NULL;
-        }
-        if (out_size != NULL) {
-            *out_size = abufs[idx]->capacity();
-        }
-        return abufs[idx]->data();
-    }
-    ALOGE("couldn't get output buffers");
-    return NULL;
+    return mData->mBufferTables.get(mData->mCodec.get(), BufferTables::kOutput, idx, out_size);
 }
 
 EXPORT
@@ -756,8 +735,10 @@ ssize_t AMediaCodec_dequeueOutputBuffer(AMediaCodec *mData,
         case -EAGAIN:
             return AMEDIACODEC_INFO_TRY_AGAIN_LATER;
         case android::INFO_FORMAT_CHANGED:
+            mData->mBufferTables.onOutputFormatChanged();
             return AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED;
         case INFO_OUTPUT_BUFFERS_CHANGED:
+            mData->mBufferTables.onOutputBuffersChanged();
             return AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED;
         default:
             break;
@@ -808,6 +789,7 @@ media_status_t AMediaCodec_setOutputSurface(AMediaCodec *mData, ANativeWindow* w
     if (window != NULL) {
         surface = (Surface*) window;
     }
+    mData->mBufferTables.onSetOutputSurface();
     return translate_error(mData->mCodec->setSurface(surface));
 }
 
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _NDK_MEDIA_CODEC_PRIV_H
+#define _NDK_MEDIA_CODEC_PRIV_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <utils/Errors.h>
+#include <utils/Log.h>
+#include <utils/Mutex.h>
+#include <utils/StrongPointer.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+/**
+ * The buffer arrays of a codec in synchronous mode, indexed by buffer index, so that
+ * AMediaCodec_getInputBuffer() and AMediaCodec_getOutputBuffer() do not fetch a whole
+ * array from the codec, a round trip to its looper, for every buffer.
+ *
+ * An array is fetched again on the first lookup after an event that may change it, or
+ * when asked for a slot it does not hold. Lookups return no buffer while the codec would
+ * not hand out its arrays, e.g. once it is in an error state.
+ *
+ * Codec provides getInputBuffers(), getOutputBuffers() and getBufferArraysStatus() as
+ * MediaCodec does, and Buffer provides data() and capacity() as MediaCodecBuffer does.
+ */
+template <typename Codec, typename Buffer>
+class CodecBufferTables {
+public:
+    enum Port {
+        kInput = 0,
+        kOutput = 1,
+        kNumPorts,
+    };
+
+    CodecBufferTables() {
+        mValid[kInput] = false;
+        mValid[kOutput] = false;
+    }
+
+    // The events after which the arrays are fetched again.
+    void onConfigure() { invalidateAll(); }
+    void onStart() { invalidateAll(); }
+    void onStop() { invalidateAll(); }
+    void onFlush() { invalidateAll(); }
+    void onOutputFormatChanged() { invalidate(kOutput); }
+    void onOutputBuffersChanged() { invalidate(kOutput); }
+    void onSetOutputSurface() { invalidate(kOutput); }
+
+    // Returns the data of buffer idx of the port, and its capacity in *outSize, or NULL.
+    uint8_t *get(Codec *codec, Port port, size_t idx, size_t *outSize) {
+        const char *portName = (port == kInput) ? "input" : "output";
+        Mutex::Autolock _l(mLock);
+        Vector<sp<Buffer>> &table = mTables[port];
+        status_t err = codec->getBufferArraysStatus();
+        if (err != OK) {
+            // The codec may have given the buffers back by now.
+            invalidate_l(port);
+            ALOGE("couldn't get %s buffers: %d", portName, err);
+            return NULL;
+        }
+        if (!mValid[port] || idx >= table.size() || table[idx] == NULL) {
+            table.clear();
+            err = (port == kInput) ? codec->getInputBuffers(&table)
+                                   : codec->getOutputBuffers(&table);
+            mValid[port] = (err == OK);
+            if (err != OK) {
+                ALOGE("couldn't get %s buffers: %d", portName, err);
+                return NULL;
+            }
+        }
+        if (idx >= table.size()) {
+            ALOGE("buffer index %zu out of range", idx);
+            return NULL;
+        }
+        if (table[idx] == NULL) {
+            ALOGE("buffer index %zu is NULL", idx);
+            return NULL;
+        }
+        if (outSize != NULL) {
+            *outSize = table[idx]->capacity();
+        }
+        return table[idx]->data();
+    }
+
+private:
+    void invalidate(Port port) {
+        Mutex::Autolock _l(mLock);
+        invalidate_l(port);
+    }
+
+    void invalidateAll() {
+        Mutex::Autolock _l(mLock);
+        invalidate_l(kInput);
+        invalidate_l(kOutput);
+    }
+
+    void invalidate_l(Port port) {
+        mValid[port] = false;
+        mTables[port].clear();
+    }
+
+    Mutex mLock;
+    Vector<sp<Buffer>> mTables[kNumPorts];
+    bool mValid[kNumPorts];
+};
+
+}  // namespace android
+
+#endif  // _NDK_MEDIA_CODEC_PRIV_H
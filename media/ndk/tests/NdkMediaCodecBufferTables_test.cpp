@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks when the buffer tables behind AMediaCodec_getInputBuffer() and
+// AMediaCodec_getOutputBuffer() fetch the arrays from the codec, against a stub codec
+// that counts the fetches and hands out new buffers each time. The stub keeps every buffer
+// alive, so that a new buffer never reuses the address of an old one.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "NdkMediaCodecBufferTables_test"
+
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/RefBase.h>
+
+#include "NdkMediaCodecPriv.h"
+
+namespace android {
+
+namespace {
+
+constexpr size_t kNumBuffers = 4;
+constexpr size_t kCapacity = 16;
+
+struct StubBuffer : public RefBase {
+    explicit StubBuffer(size_t capacity) : mData(capacity) {}
+    uint8_t *data() { return mData.data(); }
+    size_t capacity() const { return mData.size(); }
+
+private:
+    std::vector<uint8_t> mData;
+};
+
+class StubCodec {
+public:
+    status_t getInputBuffers(Vector<sp<StubBuffer>> *buffers) {
+        return getBuffers(kPortInput, buffers);
+    }
+
+    status_t getOutputBuffers(Vector<sp<StubBuffer>> *buffers) {
+        return getBuffers(kPortOutput, buffers);
+    }
+
+    status_t getBufferArraysStatus() const { return mStatus; }
+
+    void setStatus(status_t status) { mStatus = status; }
+    void setNumBuffers(size_t numBuffers) { mNumBuffers = numBuffers; }
+    int numInputFetches() const { return mNumFetches[kPortInput]; }
+    int numOutputFetches() const { return mNumFetches[kPortOutput]; }
+
+private:
+    enum { kPortInput, kPortOutput };
+
+    status_t getBuffers(int port, Vector<sp<StubBuffer>> *buffers) {
+        mNumFetches[port]++;
+        if (mStatus != OK) {
+            return mStatus;
+        }
+        buffers->clear();
+        for (size_t i = 0; i < mNumBuffers; i++) {
+            sp<StubBuffer> buffer = new StubBuffer(kCapacity);
+            mAllBuffers.push_back(buffer);
+            buffers->push_back(buffer);
+        }
+        return OK;
+    }
+
+    status_t mStatus = OK;
+    size_t mNumBuffers = kNumBuffers;
+    int mNumFetches[2] = {0, 0};
+    std::vector<sp<StubBuffer>> mAllBuffers;
+};
+
+typedef CodecBufferTables<StubCodec, StubBuffer> Tables;
+
+}  // namespace
+
+class NdkMediaCodecBufferTablesTest : public ::testing::Test {
+protected:
+    uint8_t *getInput(size_t idx) {
+        return mTables.get(&mCodec, Tables::kInput, idx, nullptr);
+    }
+
+    uint8_t *getOutput(size_t idx) {
+        return mTables.get(&mCodec, Tables::kOutput, idx, nullptr);
+    }
+
+    // Looks up every buffer of both ports once, so that both arrays are cached.
+    void fillTables() {
+        for (size_t i = 0; i < kNumBuffers; i++) {
+            ASSERT_NE(nullptr, getInput(i));
+            ASSERT_NE(nullptr, getOutput(i));
+        }
+    }
+
+    StubCodec mCodec;
+    Tables mTables;
+};
+
+// The arrays are fetched once, on the first lookup, and then served from the tables.
+TEST_F(NdkMediaCodecBufferTablesTest, FetchesOnce) {
+    fillTables();
+    size_t size = 0;
+    uint8_t *data = mTables.get(&mCodec, Tables::kOutput, 1, &size);
+    EXPECT_EQ(kCapacity, size);
+    EXPECT_EQ(data, getOutput(1));
+    EXPECT_EQ(1, mCodec.numInputFetches());
+    EXPECT_EQ(1, mCodec.numOutputFetches());
+}
+
+// Output format and buffers changes, and a new output surface, refetch the output array
+// only, and the buffers looked up afterwards are the new ones.
+TEST_F(NdkMediaCodecBufferTablesTest, OutputEventsRefetchOutput) {
+    const std::vector<std::pair<const char *, void (Tables::*)()>> events = {
+        {"output format changed", &Tables::onOutputFormatChanged},
+        {"output buffers changed", &Tables::onOutputBuffersChanged},
+        {"set output surface", &Tables::onSetOutputSurface},
+    };
+    fillTables();
+    int numOutputFetches = 1;
+    for (const auto &[name, event] : events) {
+        uint8_t *input = getInput(0);
+        uint8_t *output = getOutput(0);
+        (mTables.*event)();
+        EXPECT_EQ(input, getInput(0)) << name;
+        EXPECT_NE(output, getOutput(0)) << name;
+        EXPECT_EQ(1, mCodec.numInputFetches()) << name;
+        EXPECT_EQ(++numOutputFetches, mCodec.numOutputFetches()) << name;
+    }
+}
+
+// Configure, start, stop and flush refetch both arrays.
+TEST_F(NdkMediaCodecBufferTablesTest, CodecEventsRefetchBoth) {
+    const std::vector<std::pair<const char *, void (Tables::*)()>> events = {
+        {"configure", &Tables::onConfigure},
+        {"start", &Tables::onStart},
+        {"stop", &Tables::onStop},
+        {"flush", &Tables::onFlush},
+    };
+    fillTables();
+    int numFetches = 1;
+    for (const auto &[name, event] : events) {
+        uint8_t *input = getInput(0);
+        uint8_t *output = getOutput(0);
+        (mTables.*event)();
+        EXPECT_NE(input, getInput(0)) << name;
+        EXPECT_NE(output, getOutput(0)) << name;
+        ++numFetches;
+        EXPECT_EQ(numFetches, mCodec.numInputFetches()) << name;
+        EXPECT_EQ(numFetches, mCodec.numOutputFetches()) << name;
+    }
+}
+
+// After a stop and a start, the buffers are those of the restarted codec, even when it
+// has more of them.
+TEST_F(NdkMediaCodecBufferTablesTest, StopStartRefetches) {
+    fillTables();
+    mTables.onStop();
+    mCodec.setNumBuffers(kNumBuffers + 1);
+    mTables.onStart();
+    EXPECT_NE(nullptr, getInput(kNumBuffers));
+    EXPECT_NE(nullptr, getOutput(kNumBuffers));
+    EXPECT_EQ(2, mCodec.numInputFetches());
+    EXPECT_EQ(2, mCodec.numOutputFetches());
+}
+
+// A slot the tables do not hold refetches the array, which may have grown.
+TEST_F(NdkMediaCodecBufferTablesTest, MissingSlotRefetches) {
+    fillTables();
+    mCodec.setNumBuffers(kNumBuffers + 1);
+    EXPECT_NE(nullptr, getOutput(kNumBuffers));
+    EXPECT_EQ(2, mCodec.numOutputFetches());
+    EXPECT_EQ(nullptr, getOutput(kNumBuffers + 1));
+    EXPECT_EQ(3, mCodec.numOutputFetches());
+}
+
+// A codec in an error state hands out no buffers, cached or not, and the arrays are
+// fetched again once it recovers.
+TEST_F(NdkMediaCodecBufferTablesTest, ErrorStateHandsOutNoBuffers) {
+    fillTables();
+    mCodec.setStatus(UNKNOWN_ERROR);
+    for (size_t i = 0; i < kNumBuffers; i++) {
+        EXPECT_EQ(nullptr, getInput(i)) << "buffer " << i;
+        EXPECT_EQ(nullptr, getOutput(i)) << "buffer " << i;
+    }
+    EXPECT_EQ(1, mCodec.numInputFetches());
+    EXPECT_EQ(1, mCodec.numOutputFetches());
+
+    mCodec.setStatus(OK);
+    EXPECT_NE(nullptr, getInput(0));
+    EXPECT_NE(nullptr, getOutput(0));
+    EXPECT_EQ(2, mCodec.numInputFetches());
+    EXPECT_EQ(2, mCodec.numOutputFetches());
+}
+
+// A codec that is not executing, or runs in asynchronous mode, hands out no buffers.
+TEST_F(NdkMediaCodecBufferTablesTest, NotExecutingHandsOutNoBuffers) {
+    mCodec.setStatus(INVALID_OPERATION);
+    EXPECT_EQ(nullptr, getInput(0));
+    EXPECT_EQ(nullptr, getOutput(0));
+    EXPECT_EQ(0, mCodec.numInputFetches());
+    EXPECT_EQ(0, mCodec.numOutputFetches());
+}
+
+}  // namespace android
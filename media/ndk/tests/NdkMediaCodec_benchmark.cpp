@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the per-frame overhead of a synchronous AMediaCodec decode loop,
+// using the raw audio decoder so that the codec itself does almost no work.
+
+#include <cstring>
+
+#include <benchmark/benchmark.h>
+#include <media/NdkMediaCodec.h>
+#include <media/NdkMediaFormat.h>
+
+namespace {
+
+constexpr char kMediaType[] = "audio/raw";
+constexpr int32_t kSampleRate = 48000;
+constexpr int32_t kChannelCount = 2;
+constexpr size_t kFrameSize = kSampleRate / 50 * kChannelCount * sizeof(int16_t);  // 20 ms
+
+AMediaCodec *createDecoder() {
+    AMediaCodec *codec = AMediaCodec_createDecoderByType(kMediaType);
+    if (codec == nullptr) {
+        return nullptr;
+    }
+    AMediaFormat *format = AMediaFormat_new();
+    AMediaFormat_setString(format, AMEDIAFORMAT_KEY_MIME, kMediaType);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_SAMPLE_RATE, kSampleRate);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_CHANNEL_COUNT, kChannelCount);
+    media_status_t status = AMediaCodec_configure(codec, format, nullptr, nullptr, 0);
+    AMediaFormat_delete(format);
+    if (status != AMEDIA_OK || AMediaCodec_start(codec) != AMEDIA_OK) {
+        AMediaCodec_delete(codec);
+        return nullptr;
+    }
+    return codec;
+}
+
+}  // namespace
+
+// One iteration decodes one frame: dequeue, fill and queue an input buffer,
+// then dequeue, read and release the output buffer.
+static void BM_SyncDecodeLoop(benchmark::State& state) {
+    AMediaCodec *codec = createDecoder();
+    if (codec == nullptr) {
+        state.SkipWithError("failed to start the raw audio decoder");
+        return;
+    }
+
+    uint8_t pattern[kFrameSize];
+    memset(pattern, 0x5A, sizeof(pattern));
+    uint64_t timeUs = 0;
+    for (auto _ : state) {
+        ssize_t index = AMediaCodec_dequeueInputBuffer(codec, -1);
+        size_t capacity = 0;
+        uint8_t *data = index >= 0 ? AMediaCodec_getInputBuffer(codec, index, &capacity) : nullptr;
+        if (data == nullptr || capacity < kFrameSize) {
+            state.SkipWithError("failed to get an input buffer");
+            break;
+        }
+        memcpy(data, pattern, kFrameSize);
+        timeUs += 20000;
+        if (AMediaCodec_queueInputBuffer(codec, index, 0, kFrameSize, timeUs, 0) != AMEDIA_OK) {
+            state.SkipWithError("failed to queue an input buffer");
+            break;
+        }
+
+        AMediaCodecBufferInfo info;
+        do {
+            index = AMediaCodec_dequeueOutputBuffer(codec, &info, -1);
+        } while (index == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED
+                || index == AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED);
+        data = index >= 0 ? AMediaCodec_getOutputBuffer(codec, index, &capacity) : nullptr;
+        if (data == nullptr) {
+            state.SkipWithError("failed to get an output buffer");
+            break;
+        }
+        benchmark::DoNotOptimize(data[info.offset]);
+        AMediaCodec_releaseOutputBuffer(codec, index, false /* render */);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    AMediaCodec_stop(codec);
+    AMediaCodec_delete(codec);
+}
+
+// Looks up the same input buffer repeatedly, which is what a client filling
+// an input buffer in several steps does.
+static void BM_GetInputBuffer(benchmark::State& state) {
+    AMediaCodec *codec = createDecoder();
+    if (codec == nullptr) {
+        state.SkipWithError("failed to start the raw audio decoder");
+        return;
+    }
+
+    ssize_t index = AMediaCodec_dequeueInputBuffer(codec, -1);
+    if (index < 0) {
+        state.SkipWithError("failed to dequeue an input buffer");
+    } else {
+        for (auto _ : state) {
+            size_t capacity;
+            benchmark::DoNotOptimize(AMediaCodec_getInputBuffer(codec, index, &capacity));
+        }
+    }
+
+    AMediaCodec_stop(codec);
+    AMediaCodec_delete(codec);
+}
+
+BENCHMARK(BM_SyncDecodeLoop)->UseRealTime();
+BENCHMARK(BM_GetInputBuffer)->UseRealTime();
+
+BENCHMARK_MAIN();
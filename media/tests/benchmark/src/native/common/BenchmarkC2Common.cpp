@@ -88,6 +88,14 @@ void BenchmarkC2Common::waitOnInputConsumption() {
     }
 }
 
+int32_t BenchmarkC2Common::waitForOutputFrames(int32_t numFrames) {
+    typedef std::unique_lock<std::mutex> ULock;
+    ULock l(mQueueLock);
+    mQueueCondition.wait_for(l, MAX_RETRY * TIME_OUT,
+                             [this, numFrames] { return mNumOutputFrames >= numFrames; });
+    return mNumOutputFrames;
+}
+
 void BenchmarkC2Common::handleWorkDone(std::list<std::unique_ptr<C2Work>> &workItems) {
     ALOGV("In %s", __func__);
     mStats->addOutputTime();
@@ -98,11 +106,13 @@ void BenchmarkC2Common::handleWorkDone(std::list<std::unique_ptr<C2Work>> &workI
                        0;
                 ALOGV("WorkDone: frameID received %d , mEos : %d",
                       (int)work->worklets.front()->output.ordinal.frameIndex.peeku(), mEos);
+                const bool hasOutput = !work->worklets.front()->output.buffers.empty();
                 work->input.buffers.clear();
                 work->worklets.clear();
                 {
                     typedef std::unique_lock<std::mutex> ULock;
                     ULock l(mQueueLock);
+                    if (hasOutput) mNumOutputFrames++;
                     mWorkQueue.push_back(std::move(work));
                     mQueueCondition.notify_all();
                 }
@@ -104,6 +104,7 @@ class BenchmarkC2Common {
   public:
     BenchmarkC2Common()
         : mEos(false),
+          mNumOutputFrames(0),
           mStats(nullptr),
           mClient(nullptr),
           mBlockPoolId(0),
@@ -118,6 +119,9 @@ class BenchmarkC2Common {
 
     void waitOnInputConsumption();
 
+    // Waits until numFrames frames have been output. Returns the number of frames output.
+    int32_t waitForOutputFrames(int32_t numFrames);
+
     // callback function to process onWorkDone received by Listener
     void handleWorkDone(std::list<std::unique_ptr<C2Work>> &workItems);
 
@@ -136,6 +140,8 @@ class BenchmarkC2Common {
     std::mutex mQueueLock;
     std::condition_variable mQueueCondition;
     std::list<std::unique_ptr<C2Work>> mWorkQueue;
+    // Works returned with an output buffer, guarded by mQueueLock.
+    int32_t mNumOutputFrames;
 };
 
 #endif  // __BENCHMARK_C2_COMMON_H__
@@ -21,7 +21,8 @@
 #include "C2Decoder.h"
 #include <iostream>
 
-int32_t C2Decoder::createCodec2Component(string compName, AMediaFormat *format) {
+int32_t C2Decoder::createCodec2Component(string compName, AMediaFormat *format,
+                                         uint32_t threadCount) {
     ALOGV("In %s", __func__);
     mListener.reset(new CodecListener(
             [this](std::list<std::unique_ptr<C2Work>> &workItems) { handleWorkDone(workItems); }));
@@ -51,6 +52,10 @@ int32_t C2Decoder::createCodec2Component(string compName, AMediaFormat *format)
         C2StreamPictureSizeInfo::input inputSize(0u, width, height);
         configParam.push_back(&inputSize);
     }
+    C2GlobalThreadCountTuning threadCountTuning(threadCount);
+    if (threadCount > 0) {
+        configParam.push_back(&threadCountTuning);
+    }
 
     int64_t sTime = mStats->getCurTime();
     if (mClient->CreateComponentByName(compName.c_str(), mListener, &mComponent, &mClient) !=
@@ -72,7 +77,8 @@ int32_t C2Decoder::createCodec2Component(string compName, AMediaFormat *format)
     return status;
 }
 
-int32_t C2Decoder::decodeFrames(uint8_t *inputBuffer, vector<AMediaCodecBufferInfo> &frameInfo) {
+int32_t C2Decoder::decodeFrames(uint8_t *inputBuffer, vector<AMediaCodecBufferInfo> &frameInfo,
+                                bool signalEos) {
     ALOGV("In %s", __func__);
     typedef std::unique_lock<std::mutex> ULock;
     c2_status_t status = C2_OK;
@@ -98,7 +104,7 @@ int32_t C2Decoder::decodeFrames(uint8_t *inputBuffer, vector<AMediaCodecBufferIn
         if (flags == AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG) {
             flags = C2FrameData::FLAG_CODEC_CONFIG;
         }
-        if (mNumInputFrame == (frameInfo.size() - 1)) {
+        if (signalEos && mNumInputFrame == (frameInfo.size() - 1)) {
             flags |= C2FrameData::FLAG_END_OF_STREAM;
         }
         work->input.flags = (C2FrameData::flags_t)flags;
@@ -143,6 +149,12 @@ int32_t C2Decoder::decodeFrames(uint8_t *inputBuffer, vector<AMediaCodecBufferIn
     return status;
 }
 
+int32_t C2Decoder::drain() {
+    ALOGV("In %s", __func__);
+    if (!mComponent) return -1;
+    return mComponent->drain(C2Component::DRAIN_COMPONENT_NO_EOS);
+}
+
 void C2Decoder::deInitCodec() {
     ALOGV("In %s", __func__);
     if (!mComponent) return;
@@ -166,5 +178,9 @@ void C2Decoder::dumpStatistics(string inputReference, int64_t durationUs, string
 void C2Decoder::resetDecoder() {
     mOffset = 0;
     mNumInputFrame = 0;
+    {
+        std::lock_guard<std::mutex> l(mQueueLock);
+        mNumOutputFrames = 0;
+    }
     if (mStats) mStats->reset();
 }
@@ -25,9 +25,16 @@ class C2Decoder : public BenchmarkC2Common {
   public:
     C2Decoder() : mOffset(0), mNumInputFrame(0), mComponent(nullptr) {}
 
-    int32_t createCodec2Component(string codecName, AMediaFormat *format);
+    // A non-zero threadCount limits the number of threads the component may use.
+    int32_t createCodec2Component(string codecName, AMediaFormat *format,
+                                  uint32_t threadCount = 0);
 
-    int32_t decodeFrames(uint8_t *inputBuffer, vector<AMediaCodecBufferInfo> &frameInfo);
+    // Without signalEos, the last frame is queued without the end of stream flag.
+    int32_t decodeFrames(uint8_t *inputBuffer, vector<AMediaCodecBufferInfo> &frameInfo,
+                         bool signalEos = true);
+
+    // Drains the component without an end of stream work.
+    int32_t drain();
 
     void deInitCodec();
 
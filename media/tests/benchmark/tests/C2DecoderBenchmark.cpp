@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the decoding throughput of the AV1 decoders for a given thread budget. Each
+// iteration decodes a whole clip, up to the end of stream.
+//
+// usage: C2DecoderBenchmark [benchmark options] [path_to_res_folder]
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "C2DecoderBenchmark"
+#include <log/log.h>
+
+#include <sys/stat.h>
+
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "C2Decoder.h"
+#include "Extractor.h"
+
+namespace {
+
+const char *kDefaultRes = "/data/local/tmp/MediaBenchmark/res/";
+
+const char *kClips[] = {
+        "crowd_1920x1080_25fps_4000kbps_av1.webm",
+        "crowd_3840x2160_25fps_8000kbps_av1.webm",
+};
+
+const uint32_t kThreadCounts[] = {1, 2, 4, 8};
+
+// The frames of the first track of a clip, read once for all the iterations.
+struct Clip {
+    std::unique_ptr<Extractor> extractor;
+    std::unique_ptr<uint8_t[]> inputBuffer;
+    vector<AMediaCodecBufferInfo> frameInfo;
+};
+
+bool readClip(const std::string &path, Clip *clip) {
+    FILE *inputFp = fopen(path.c_str(), "rb");
+    if (!inputFp) return false;
+    struct stat buf;
+    stat(path.c_str(), &buf);
+    size_t fileSize = buf.st_size;
+
+    clip->extractor.reset(new (std::nothrow) Extractor());
+    if (!clip->extractor || fileSize > kMaxBufferSize ||
+        clip->extractor->initExtractor(fileno(inputFp), fileSize) <= 0 ||
+        clip->extractor->setupTrackFormat(0) != 0) {
+        fclose(inputFp);
+        return false;
+    }
+    clip->inputBuffer.reset(new (std::nothrow) uint8_t[fileSize]);
+    if (!clip->inputBuffer) {
+        fclose(inputFp);
+        return false;
+    }
+
+    AMediaCodecBufferInfo info;
+    uint32_t inputBufferOffset = 0;
+    for (int32_t idx = 0;; idx++) {
+        void *csdBuffer = clip->extractor->getCSDSample(info, idx);
+        if (!csdBuffer || !info.size || inputBufferOffset + info.size > fileSize) break;
+        memcpy(clip->inputBuffer.get() + inputBufferOffset, csdBuffer, info.size);
+        clip->frameInfo.push_back(info);
+        inputBufferOffset += info.size;
+    }
+    while (clip->extractor->getFrameSample(info) == 0 && info.size &&
+           inputBufferOffset + info.size <= fileSize) {
+        memcpy(clip->inputBuffer.get() + inputBufferOffset, clip->extractor->getFrameBuf(),
+               info.size);
+        clip->frameInfo.push_back(info);
+        inputBufferOffset += info.size;
+    }
+    fclose(inputFp);
+    return !clip->frameInfo.empty();
+}
+
+void BM_Decode(benchmark::State &state, const std::string &codecName, Clip *clip,
+               uint32_t threadCount) {
+    C2Decoder decoder;
+    if (decoder.setupCodec2() != 0) {
+        state.SkipWithError("Codec2 setup failed");
+        return;
+    }
+    for (auto _ : state) {
+        if (decoder.createCodec2Component(codecName, clip->extractor->getFormat(),
+                                          threadCount) != 0) {
+            state.SkipWithError("Create component failed");
+            break;
+        }
+        if (decoder.decodeFrames(clip->inputBuffer.get(), clip->frameInfo) != 0) {
+            state.SkipWithError("Decoder failed");
+            break;
+        }
+        decoder.waitOnInputConsumption();
+        if (!decoder.mEos) {
+            state.SkipWithError("Didn't receive EOS");
+            break;
+        }
+        decoder.deInitCodec();
+        decoder.resetDecoder();
+    }
+    decoder.deInitCodec();
+    state.SetItemsProcessed(state.iterations() * clip->frameInfo.size());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    const std::string res = argc > 1 ? argv[1] : kDefaultRes;
+
+    vector<string> codecList;
+    {
+        C2Decoder decoder;
+        if (decoder.setupCodec2() != 0) {
+            ALOGE("Codec2 setup failed");
+            return -1;
+        }
+        codecList = decoder.getSupportedComponentList(false /* isEncoder */);
+    }
+
+    std::vector<std::unique_ptr<Clip>> clips;
+    for (const char *file : kClips) {
+        std::unique_ptr<Clip> clip = std::make_unique<Clip>();
+        if (!readClip(res + file, clip.get())) {
+            ALOGW("Skipping %s%s", res.c_str(), file);
+            continue;
+        }
+        for (const string &codecName : codecList) {
+            if (codecName.find("av1") == string::npos ||
+                codecName.find("secure") != string::npos) {
+                continue;
+            }
+            for (uint32_t threadCount : kThreadCounts) {
+                std::string name = codecName + "/" + file + "/threads:" +
+                        std::to_string(threadCount);
+                benchmark::RegisterBenchmark(name.c_str(), BM_Decode, codecName, clip.get(),
+                                             threadCount)
+                        ->Unit(benchmark::kMillisecond)
+                        ->UseRealTime();
+            }
+        }
+        clips.push_back(std::move(clip));
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    for (const std::unique_ptr<Clip> &clip : clips) {
+        clip->extractor->deInitExtractor();
+    }
+    return 0;
+}
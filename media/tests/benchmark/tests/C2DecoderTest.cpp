@@ -21,6 +21,7 @@
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <tuple>
 
 #include "BenchmarkTestEnvironment.h"
 #include "C2Decoder.h"
@@ -28,11 +29,12 @@
 
 static BenchmarkTestEnvironment *gEnv = nullptr;
 
-class C2DecoderTest : public ::testing::TestWithParam<pair<string, string>> {
+template <typename Param>
+class C2DecoderTestBase : public ::testing::TestWithParam<Param> {
   public:
-    C2DecoderTest() : mDecoder(nullptr) {}
+    C2DecoderTestBase() : mDecoder(nullptr) {}
 
-    ~C2DecoderTest() {
+    ~C2DecoderTestBase() {
         if (!mCodecList.empty()) {
             mCodecList.clear();
         }
@@ -50,7 +52,46 @@ class C2DecoderTest : public ::testing::TestWithParam<pair<string, string>> {
     C2Decoder *mDecoder;
 };
 
-void C2DecoderTest::setupC2DecoderTest() {
+using C2DecoderTest = C2DecoderTestBase<pair<string, string>>;
+// Parameterized on the input file and the thread count.
+using C2DecoderThreadTest = C2DecoderTestBase<tuple<string, uint32_t>>;
+
+// Reads the codec specific data and the frames of the extractor's current track
+// into inputBuffer, which is fileSize bytes long.
+static void readSamples(Extractor *extractor, uint8_t *inputBuffer, size_t fileSize,
+                        vector<AMediaCodecBufferInfo> &frameInfo) {
+    AMediaCodecBufferInfo info;
+    uint32_t inputBufferOffset = 0;
+    int32_t idx = 0;
+
+    // Get CSD data
+    while (1) {
+        void *csdBuffer = extractor->getCSDSample(info, idx);
+        if (!csdBuffer || !info.size) break;
+        // copy the meta data and buffer to be passed to decoder
+        ASSERT_LE(inputBufferOffset + info.size, fileSize) << "Memory allocated not sufficient";
+
+        memcpy(inputBuffer + inputBufferOffset, csdBuffer, info.size);
+        frameInfo.push_back(info);
+        inputBufferOffset += info.size;
+        idx++;
+    }
+
+    // Get frame data
+    while (1) {
+        int32_t status = extractor->getFrameSample(info);
+        if (status || !info.size) break;
+        // copy the meta data and buffer to be passed to decoder
+        ASSERT_LE(inputBufferOffset + info.size, fileSize) << "Memory allocated not sufficient";
+
+        memcpy(inputBuffer + inputBufferOffset, extractor->getFrameBuf(), info.size);
+        frameInfo.push_back(info);
+        inputBufferOffset += info.size;
+    }
+}
+
+template <typename Param>
+void C2DecoderTestBase<Param>::setupC2DecoderTest() {
     mDecoder = new (std::nothrow) C2Decoder();
     ASSERT_NE(mDecoder, nullptr) << "C2Decoder creation failed";
 
@@ -90,34 +131,8 @@ TEST_P(C2DecoderTest, Codec2Decode) {
         ASSERT_NE(inputBuffer, nullptr) << "Insufficient memory";
 
         vector<AMediaCodecBufferInfo> frameInfo;
-        AMediaCodecBufferInfo info;
-        uint32_t inputBufferOffset = 0;
-        int32_t idx = 0;
-
-        // Get CSD data
-        while (1) {
-            void *csdBuffer = extractor->getCSDSample(info, idx);
-            if (!csdBuffer || !info.size) break;
-            // copy the meta data and buffer to be passed to decoder
-            ASSERT_LE(inputBufferOffset + info.size, fileSize) << "Memory allocated not sufficient";
-
-            memcpy(inputBuffer.get() + inputBufferOffset, csdBuffer, info.size);
-            frameInfo.push_back(info);
-            inputBufferOffset += info.size;
-            idx++;
-        }
-
-        // Get frame data
-        while (1) {
-            status = extractor->getFrameSample(info);
-            if (status || !info.size) break;
-            // copy the meta data and buffer to be passed to decoder
-            ASSERT_LE(inputBufferOffset + info.size, fileSize) << "Memory allocated not sufficient";
-
-            memcpy(inputBuffer.get() + inputBufferOffset, extractor->getFrameBuf(), info.size);
-            frameInfo.push_back(info);
-            inputBufferOffset += info.size;
-        }
+        ASSERT_NO_FATAL_FAILURE(readSamples(extractor.get(), inputBuffer.get(), fileSize,
+                                            frameInfo));
 
         AMediaFormat *format = extractor->getFormat();
         // Decode the given input stream for all C2 codecs supported by device
@@ -149,6 +164,72 @@ TEST_P(C2DecoderTest, Codec2Decode) {
     }
 }
 
+// Draining the AV1 decoders outputs all the frames queued without the end of stream flag, as
+// many as decoding up to the end of stream, including the frames still being decoded by the
+// frame threads.
+TEST_P(C2DecoderThreadTest, Codec2DrainOutputsAllFrames) {
+    string inputFile = gEnv->getRes() + std::get<0>(GetParam());
+    uint32_t threadCount = std::get<1>(GetParam());
+    FILE *inputFp = fopen(inputFile.c_str(), "rb");
+    if (!inputFp) {
+        GTEST_SKIP() << "Unable to open " << inputFile << " file for reading";
+    }
+
+    std::unique_ptr<Extractor> extractor(new (std::nothrow) Extractor());
+    ASSERT_NE(extractor, nullptr) << "Extractor creation failed";
+
+    struct stat buf;
+    stat(inputFile.c_str(), &buf);
+    size_t fileSize = buf.st_size;
+    int32_t fd = fileno(inputFp);
+    ASSERT_LE(fileSize, kMaxBufferSize)
+            << "Input file size is greater than the threshold memory dedicated to the test";
+
+    int32_t trackCount = extractor->initExtractor(fd, fileSize);
+    ASSERT_GT(trackCount, 0) << "initExtractor failed";
+    ASSERT_EQ(extractor->setupTrackFormat(0), 0) << "Track Format invalid";
+
+    std::unique_ptr<uint8_t[]> inputBuffer(new (std::nothrow) uint8_t[fileSize]);
+    ASSERT_NE(inputBuffer, nullptr) << "Insufficient memory";
+    vector<AMediaCodecBufferInfo> frameInfo;
+    ASSERT_NO_FATAL_FAILURE(readSamples(extractor.get(), inputBuffer.get(), fileSize, frameInfo));
+
+    AMediaFormat *format = extractor->getFormat();
+    for (string codecName : mCodecList) {
+        if (codecName.find("av1") == string::npos || codecName.find("secure") != string::npos) {
+            continue;
+        }
+        int32_t status = mDecoder->createCodec2Component(codecName, format, threadCount);
+        ASSERT_EQ(status, 0) << "Create component failed for " << codecName;
+        status = mDecoder->decodeFrames(inputBuffer.get(), frameInfo);
+        ASSERT_EQ(status, 0) << "Decoder failed for " << codecName;
+        mDecoder->waitOnInputConsumption();
+        ASSERT_TRUE(mDecoder->mEos) << "Test Failed. Didn't receive EOS \n";
+        int32_t numOutputFrames = mDecoder->waitForOutputFrames(0);
+        ASSERT_GT(numOutputFrames, 0) << "No output from " << codecName;
+        mDecoder->deInitCodec();
+        mDecoder->resetDecoder();
+
+        status = mDecoder->createCodec2Component(codecName, format, threadCount);
+        ASSERT_EQ(status, 0) << "Create component failed for " << codecName;
+        status = mDecoder->decodeFrames(inputBuffer.get(), frameInfo, false /* signalEos */);
+        ASSERT_EQ(status, 0) << "Decoder failed for " << codecName;
+        ASSERT_EQ(mDecoder->drain(), 0) << "Drain failed for " << codecName;
+        EXPECT_EQ(numOutputFrames, mDecoder->waitForOutputFrames(numOutputFrames))
+                << codecName << " with " << threadCount << " threads";
+        mDecoder->deInitCodec();
+        mDecoder->resetDecoder();
+    }
+    fclose(inputFp);
+    extractor->deInitExtractor();
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        Av1DrainTest, C2DecoderThreadTest,
+        ::testing::Combine(
+                ::testing::Values(string("crowd_1920x1080_25fps_4000kbps_av1.webm")),
+                ::testing::Values(1u, 4u)));
+
 // TODO: (b/140549596)
 // Add wav files
 INSTANTIATE_TEST_SUITE_P(
@@ -32,6 +32,10 @@
 // uncomment to enable fast threads to take performance samples for later statistical analysis
 #define FAST_THREAD_STATISTICS
 
+// uncomment to have fast threads also sample per-cycle scheduler counters (context switches and
+// CPU migrations) and correlate them with underruns; requires FAST_THREAD_STATISTICS
+//#define FAST_THREAD_SCHED_STATISTICS
+
 // uncomment for debugging timing problems related to StateQueue::push()
 //#define STATE_QUEUE_DUMP
 
@@ -28,6 +28,7 @@
 #include <media/DeviceDescriptorBase.h>
 #include <media/PatchBuilder.h>
 #include <mediautils/ServiceUtilities.h>
+#include <timing/SoftwarePatchSizing.h>
 #include <utils/Log.h>
 
 // ----------------------------------------------------------------------------
@@ -551,6 +552,12 @@ status_t PatchPanel::Patch::createConnections_l(const sp<IAfPatchPanel>& panel)
     const size_t playbackFrameCount = mPlayback.thread()->frameCount();
     const size_t recordFrameCount = mRecord.thread()->frameCount();
     size_t frameCount = 0;
+    // Default behaviour is to start as soon as possible to have the lowest possible latency even if
+    // it might glitch.
+    // Disable this behavior for FM Tuner source if no fast capture/mixer available.
+    const bool isFmBridge = mAudioPatch.sources[0].ext.device.type == AUDIO_DEVICE_IN_FM_TUNER;
+    const size_t frameCountToBeReady = isFmBridge && !usePassthruPatchRecord
+            ? audioflinger::fmBridgeFrameCountToBeReady(recordFrameCount, playbackFrameCount) : 1;
     if (usePassthruPatchRecord) {
         // PassthruPatchRecord producesBufferOnDemand, so use
         // maximum of playback and record thread framecounts
@@ -566,13 +573,16 @@ status_t PatchPanel::Patch::createConnections_l(const sp<IAfPatchPanel>& panel)
                                                  inputFlags,
                                                  source);
     } else {
-        // use a pseudo LCM between input and output framecount
-        int playbackShift = __builtin_ctz(playbackFrameCount);
-        int shift = __builtin_ctz(recordFrameCount);
-        if (playbackShift < shift) {
-            shift = playbackShift;
-        }
-        frameCount = (playbackFrameCount * recordFrameCount) >> shift;
+        // Size the shared buffer for the start threshold, one playback burst, the record bursts
+        // filling it and a scheduling jitter margin. A common multiple of both frame counts can
+        // hold well over 100 ms, and the buffer size bounds the latency of the bridge.
+        // TODO: The audio still goes through both thread loops and their periods. Consider a
+        // bridge thread reading the input stream and writing the output stream directly,
+        // through a lock-free ring with a single conversion stage, reporting its latency and
+        // the drift between the two devices.
+        frameCount = audioflinger::softwarePatchFrameCount(
+                recordFrameCount, mRecord.thread()->sampleRate(), playbackFrameCount, sampleRate,
+                frameCountToBeReady);
         ALOGV("%s() playframeCount %zu recordFrameCount %zu frameCount %zu",
             __func__, playbackFrameCount, recordFrameCount, frameCount);
 
@@ -596,11 +606,6 @@ status_t PatchPanel::Patch::createConnections_l(const sp<IAfPatchPanel>& panel)
     // create a special playback track to render to playback thread.
     // this track is given the same buffer as the PatchRecord buffer
 
-    // Default behaviour is to start as soon as possible to have the lowest possible latency even if
-    // it might glitch.
-    // Disable this behavior for FM Tuner source if no fast capture/mixer available.
-    const bool isFmBridge = mAudioPatch.sources[0].ext.device.type == AUDIO_DEVICE_IN_FM_TUNER;
-    const size_t frameCountToBeReady = isFmBridge && !usePassthruPatchRecord ? frameCount / 4 : 1;
     sp<IAfPatchTrack> tempPatchTrack = IAfPatchTrack::create(
                                            mPlayback.thread().get(),
                                            streamType,
@@ -39,9 +39,7 @@
 #include <utils/Log.h>
 #include <utils/Trace.h>
 
-#include <linux/futex.h>
 #include <math.h>
-#include <sys/syscall.h>
 
 // ----------------------------------------------------------------------------
 
@@ -1862,12 +1860,7 @@ void Track::disable()
 
 void Track::signalClientFlag(int32_t flag)
 {
-    // FIXME should use proxy, and needs work
-    audio_track_cblk_t* cblk = mCblk;
-    android_atomic_or(flag, &cblk->mFlags);
-    android_atomic_release_store(0x40000000, &cblk->mFutex);
-    // client is not in server, so FUTEX_WAKE is needed instead of FUTEX_WAKE_PRIVATE
-    (void) syscall(__NR_futex, &cblk->mFutex, FUTEX_WAKE, INT_MAX);
+    mServerProxy->signalClientFlag(flag);
 }
 
 void Track::signal()
@@ -2886,12 +2879,7 @@ void RecordTrack::destroy()
 void RecordTrack::invalidate()
 {
     TrackBase::invalidate();
-    // FIXME should use proxy, and needs work
-    audio_track_cblk_t* cblk = mCblk;
-    android_atomic_or(CBLK_INVALID, &cblk->mFlags);
-    android_atomic_release_store(0x40000000, &cblk->mFutex);
-    // client is not in server, so FUTEX_WAKE is needed instead of FUTEX_WAKE_PRIVATE
-    (void) syscall(__NR_futex, &cblk->mFutex, FUTEX_WAKE, INT_MAX);
+    mServerProxy->signalClientFlag(CBLK_INVALID);
 }
 
 
@@ -220,7 +220,8 @@ void FastCapture::onWork()
                 android_atomic_release_store(framesWritten + rear, &cblk->u.mStreaming.mRear);
                 cblk->mServer += framesWritten;
                 const int32_t old = android_atomic_or(CBLK_FUTEX_WAKE, &cblk->mFutex);
-                if (!(old & CBLK_FUTEX_WAKE)) {
+                // the client only needs the syscall if it is waiting, see CBLK_FUTEX_WAITER
+                if (!(old & CBLK_FUTEX_WAKE) && (old & ~CBLK_FUTEX_WAKE) != 0) {
                     // client is never in server process, so don't use FUTEX_WAKE_PRIVATE
                     (void) syscall(__NR_futex, &cblk->mFutex, FUTEX_WAKE, 1);
                 }
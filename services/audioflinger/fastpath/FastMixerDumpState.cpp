@@ -82,6 +82,10 @@ void FastMixerDumpState::dump(int fd) const
 #ifdef CPU_FREQUENCY_STATISTICS
     audio_utils::Statistics<double> kHz, loadMHz;
     uint32_t previousCpukHz = 0;
+#endif
+#ifdef FAST_THREAD_SCHED_STATISTICS
+    audio_utils::Statistics<double> voluntary, involuntary;
+    uint32_t preemptedCycles = 0, migratedCycles = 0;
 #endif
     // Assuming a normal distribution for cycle times, three standard deviations on either side of
     // the mean account for 99.73% of the population.  So if we take each tail to be 1/1000 of the
@@ -110,6 +114,17 @@ void FastMixerDumpState::dump(int fd) const
             }
         }
         previousCpukHz = sampleCpukHz;
+#endif
+#ifdef FAST_THREAD_SCHED_STATISTICS
+        const uint32_t schedStats = mSchedStats[i];
+        voluntary.add(voluntarySwitches(schedStats));
+        involuntary.add(involuntarySwitches(schedStats));
+        if (involuntarySwitches(schedStats) > 0) {
+            ++preemptedCycles;
+        }
+        if (migrated(schedStats)) {
+            ++migratedCycles;
+        }
 #endif
     }
     if (n) {
@@ -133,6 +148,19 @@ void FastMixerDumpState::dump(int fd) const
     dprintf(fd, "  adjusted CPU load in MHz (i.e. normalized for CPU clock frequency):\n"
                 "    mean=%.1f min=%.1f max=%.1f stddev=%.1f\n",
                 loadMHz.getMean(), loadMHz.getMin(), loadMHz.getMax(), loadMHz.getStdDev());
+#endif
+#ifdef FAST_THREAD_SCHED_STATISTICS
+    if (n) {
+        dprintf(fd, "    context switches per mix cycle:\n"
+                    "      voluntary: mean=%.2f max=%.0f\n"
+                    "      involuntary: mean=%.2f max=%.0f\n"
+                    "    cycles preempted=%u migrated=%u\n",
+                    voluntary.getMean(), voluntary.getMax(),
+                    involuntary.getMean(), involuntary.getMax(),
+                    preemptedCycles, migratedCycles);
+    }
+    dprintf(fd, "  Underruns coinciding with preemption=%u with CPU migration=%u\n",
+                mUnderrunsPreempted, mUnderrunsMigrated);
 #endif
     if (tail != nullptr) {
         qsort(tail, n, sizeof(uint32_t), compare_uint32_t);
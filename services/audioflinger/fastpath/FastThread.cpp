@@ -21,6 +21,9 @@
 
 #include "Configuration.h"
 #include <linux/futex.h>
+#ifdef FAST_THREAD_SCHED_STATISTICS
+#include <sys/resource.h>
+#endif
 #include <sys/syscall.h>
 #include <audio_utils/clock.h>
 #include <cutils/atomic.h>
@@ -101,6 +104,9 @@ bool FastThread::threadLoop()
                     mOldTsValid = false;
 #ifdef FAST_THREAD_STATISTICS
                     mOldLoadValid = false;
+#endif
+#ifdef FAST_THREAD_SCHED_STATISTICS
+                    mOldSchedValid = false;
 #endif
                     mIgnoreNextOverrun = true;
                 }
@@ -148,6 +154,9 @@ bool FastThread::threadLoop()
 #ifdef FAST_THREAD_STATISTICS
                 mBounds = 0;
                 mFull = false;
+#endif
+#ifdef FAST_THREAD_SCHED_STATISTICS
+                mOldSchedValid = false;
 #endif
                 mOldTsValid = !clock_gettime(CLOCK_MONOTONIC, &mOldTs);
                 mTimestampStatus = INVALID_OPERATION;
@@ -192,6 +201,31 @@ bool FastThread::threadLoop()
                     --sec;
                     nsec += 1000000000;
                 }
+#ifdef FAST_THREAD_SCHED_STATISTICS
+                // Sample scheduler counters for this cycle, so that an underrun detected below
+                // can be attributed to a preemption or a CPU migration.
+                // getrusage(RUSAGE_THREAD) is a system call, which is why this is optional.
+                mSchedStats = 0;
+                {
+                    struct rusage ru;
+                    const int cpuNum = sched_getcpu();
+                    if (getrusage(RUSAGE_THREAD, &ru) == 0) {
+                        if (mOldSchedValid) {
+                            mSchedStats = FastThreadDumpState::packSchedStats(
+                                    static_cast<uint32_t>(ru.ru_nvcsw - mOldNvcsw),
+                                    static_cast<uint32_t>(ru.ru_nivcsw - mOldNivcsw),
+                                    cpuNum >= 0 && mOldCpu >= 0 && cpuNum != mOldCpu,
+                                    static_cast<uint32_t>(std::max(cpuNum, 0)));
+                        }
+                        mOldNvcsw = ru.ru_nvcsw;
+                        mOldNivcsw = ru.ru_nivcsw;
+                        mOldCpu = cpuNum;
+                        mOldSchedValid = true;
+                    } else {
+                        mOldSchedValid = false;
+                    }
+                }
+#endif
                 // To avoid an initial underrun on fast tracks after exiting standby,
                 // do not start pulling data from tracks and mixing until warmup is complete.
                 // Warmup is considered complete after the earlier of:
@@ -233,6 +267,26 @@ bool FastThread::threadLoop()
                                 (int) sec, nsec / 1000000L);
                         mDumpState->mUnderruns++;
                         LOG_UNDERRUN(audio_utils_ns_from_timespec(&newTs));
+#ifdef FAST_THREAD_SCHED_STATISTICS
+                        const uint32_t involuntary =
+                                FastThreadDumpState::involuntarySwitches(mSchedStats);
+                        const bool migrated = FastThreadDumpState::migrated(mSchedStats);
+                        if (involuntary > 0) {
+                            mDumpState->mUnderrunsPreempted++;
+                        }
+                        if (migrated) {
+                            mDumpState->mUnderrunsMigrated++;
+                        }
+                        if (involuntary > 0 || migrated) {
+                            // NBLog format only supports %d for integers
+                            LOGT("underrun: preempted %d time(s), voluntary switches %d, "
+                                    "%s cpu %d", static_cast<int>(involuntary),
+                                    static_cast<int>(
+                                            FastThreadDumpState::voluntarySwitches(mSchedStats)),
+                                    migrated ? "migrated to" : "on",
+                                    static_cast<int>(FastThreadDumpState::cpu(mSchedStats)));
+                        }
+#endif
                         mIgnoreNextOverrun = true;
                     } else if (nsec < mOverrunNs) {
                         if (mIgnoreNextOverrun) {
@@ -307,6 +361,9 @@ bool FastThread::threadLoop()
                     mDumpState->mLoadNs[i] = loadNs;
 #ifdef CPU_FREQUENCY_STATISTICS
                     mDumpState->mCpukHz[i] = kHz;
+#endif
+#ifdef FAST_THREAD_SCHED_STATISTICS
+                    mDumpState->mSchedStats[i] = mSchedStats;
 #endif
                     // this store #4 is not atomic with respect to stores #1, #2, #3 above, but
                     // the newest open & oldest closed halves are atomic with respect to each other
@@ -74,6 +74,14 @@ protected:
 #ifdef CPU_FREQUENCY_STATISTICS
     ThreadCpuUsage  mTcu;           // for reading the current CPU clock frequency in kHz
 #endif
+#ifdef FAST_THREAD_SCHED_STATISTICS
+    int64_t         mOldNvcsw = 0;      // previous getrusage(RUSAGE_THREAD) ru_nvcsw
+    int64_t         mOldNivcsw = 0;     // previous getrusage(RUSAGE_THREAD) ru_nivcsw
+    int             mOldCpu = -1;       // CPU number observed at end of previous cycle
+    bool            mOldSchedValid = false; // whether the above are valid
+    uint32_t        mSchedStats = 0;    // packed counters for the current cycle, see
+                                        // FastThreadDumpState::packSchedStats()
+#endif
 #endif
     unsigned        mColdGen = 0;       // last observed mColdGen
     bool            mIsWarm = false;        // true means ready to mix,
@@ -39,6 +39,9 @@ void FastThreadDumpState::increaseSamplingN(uint32_t samplingN)
     memset(&mLoadNs[mSamplingN], 0, sizeof(mLoadNs[0]) * additional);
 #ifdef CPU_FREQUENCY_STATISTICS
     memset(&mCpukHz[mSamplingN], 0, sizeof(mCpukHz[0]) * additional);
+#endif
+#ifdef FAST_THREAD_SCHED_STATISTICS
+    memset(&mSchedStats[mSamplingN], 0, sizeof(mSchedStats[0]) * additional);
 #endif
     mSamplingN = samplingN;
 }
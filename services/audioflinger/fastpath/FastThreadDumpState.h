@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <type_traits>
 
 #include "Configuration.h"
@@ -60,6 +61,28 @@ struct FastThreadDumpState {
 #ifdef CPU_FREQUENCY_STATISTICS
     uint32_t mCpukHz[kSamplingN];       // absolute CPU clock frequency in kHz, bits 0-3 are CPU#
 #endif
+#ifdef FAST_THREAD_SCHED_STATISTICS
+    // Per-cycle scheduler counters, packed so that each sample is a single word:
+    //      bits  0-7   voluntary context switches during the cycle, saturated at 255
+    //      bits  8-15  involuntary context switches (preemptions) during the cycle, saturated
+    //      bit   16    set if the thread ran on a different CPU than in the previous cycle
+    //      bits 24-31  CPU number at the end of the cycle
+    uint32_t mSchedStats[kSamplingN];
+    // Cumulative count of underruns coinciding with a preemption or with a CPU migration
+    // respectively.  An underrun may be counted in both.
+    uint32_t mUnderrunsPreempted = 0;
+    uint32_t mUnderrunsMigrated = 0;
+
+    static constexpr uint32_t packSchedStats(
+            uint32_t voluntary, uint32_t involuntary, bool migrated, uint32_t cpu) {
+        return std::min(voluntary, 0xFFu) | (std::min(involuntary, 0xFFu) << 8) |
+                (migrated ? 1u << 16 : 0) | ((cpu & 0xFF) << 24);
+    }
+    static constexpr uint32_t voluntarySwitches(uint32_t stats) { return stats & 0xFF; }
+    static constexpr uint32_t involuntarySwitches(uint32_t stats) { return (stats >> 8) & 0xFF; }
+    static constexpr bool migrated(uint32_t stats) { return (stats >> 16) & 1; }
+    static constexpr uint32_t cpu(uint32_t stats) { return stats >> 24; }
+#endif
 
     // Increase sampling window after construction, must be a power of 2 <= kSamplingN
     void    increaseSamplingN(uint32_t samplingN);
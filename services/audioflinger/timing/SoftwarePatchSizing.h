@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace android::audioflinger {
+
+/**
+ * Returns the frame count used before softwarePatchFrameCount(): a pseudo least common
+ * multiple of the record and playback thread frame counts.
+ */
+inline size_t legacySoftwarePatchFrameCount(size_t recordFrameCount, size_t playbackFrameCount) {
+    int shift = __builtin_ctz(recordFrameCount);
+    const int playbackShift = __builtin_ctz(playbackFrameCount);
+    if (playbackShift < shift) {
+        shift = playbackShift;
+    }
+    return (playbackFrameCount * recordFrameCount) >> shift;
+}
+
+/**
+ * Returns the number of frames the PatchTrack of an FM tuner bridge waits for before starting.
+ *
+ * This is a quarter of the legacy buffer size, as it was when the buffer was sized with
+ * legacySoftwarePatchFrameCount(), so that the prebuffer protecting the FM bridge from
+ * glitches does not shrink with the buffer.
+ */
+inline size_t fmBridgeFrameCountToBeReady(size_t recordFrameCount, size_t playbackFrameCount) {
+    if (recordFrameCount == 0 || playbackFrameCount == 0) {
+        return 1;
+    }
+    return legacySoftwarePatchFrameCount(recordFrameCount, playbackFrameCount) / 4;
+}
+
+/**
+ * Returns the frame count of the buffer shared by the PatchRecord and the PatchTrack
+ * of a software patch, in frames at the playback sample rate.
+ *
+ * The record thread writes bursts of recordFrameCount frames at recordSampleRate
+ * (converted by the record thread to the playback sample rate) and the playback thread
+ * reads bursts of playbackFrameCount frames.  With ideal scheduling the buffer never holds
+ * more than frameCountToBeReady, one playback burst and the whole record bursts needed to
+ * cover a playback burst.  As for the secondary output tee patches, a margin of two record
+ * and two playback bursts is kept on top of that in case the thread scheduling has some jitter.
+ *
+ * The buffer size bounds the latency of the bridge, so this stays well below a common
+ * multiple of both periods. It does not remove the periods of the two threads the audio
+ * goes through.
+ */
+inline size_t softwarePatchFrameCount(
+        size_t recordFrameCount, uint32_t recordSampleRate,
+        size_t playbackFrameCount, uint32_t playbackSampleRate,
+        size_t frameCountToBeReady) {
+    if (recordFrameCount == 0 || playbackFrameCount == 0
+            || recordSampleRate == 0 || playbackSampleRate == 0) {
+        return frameCountToBeReady + 3 * (recordFrameCount + playbackFrameCount);
+    }
+    // record burst expressed in frames at the playback sample rate, rounded up.
+    const size_t recordBurst = (size_t)(((uint64_t)recordFrameCount * playbackSampleRate
+            + recordSampleRate - 1) / recordSampleRate);
+    const size_t recordBurstsPerPlaybackBurst =
+            (playbackFrameCount + recordBurst - 1) / recordBurst;
+    const size_t jitterMargin = 2 * (recordBurst + playbackFrameCount);
+    return frameCountToBeReady + playbackFrameCount
+            + recordBurstsPerPlaybackBurst * recordBurst + jitterMargin;
+}
+
+} // namespace android::audioflinger
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "softwarepatchsizing_tests"
+
+#include "../SoftwarePatchSizing.h"
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+using namespace android::audioflinger;
+
+namespace {
+
+struct BridgeResult {
+    size_t maxFill = 0;        // maximum frames held by the shared buffer
+    size_t underruns = 0;      // steady state playback bursts finding less than a burst of data
+    double meanLatencyMs = 0;  // average time a frame spends in the shared buffer
+};
+
+// Simulates a software patch between a fake input stream delivering recordFrameCount frames
+// every period at recordSampleRate, and a fake output stream consuming playbackFrameCount frames
+// every period at playbackSampleRate.  The output stream period starts with the given phase
+// offset (in units of its period) and, as a PatchTrack, only starts reading once
+// frameCountToBeReady frames are ready.  Each thread wakes up late by a random amount of up to
+// jitter times its own period.  All frame counts are expressed at the playback sample rate.
+BridgeResult simulateBridge(size_t recordFrameCount, uint32_t recordSampleRate,
+        size_t playbackFrameCount, uint32_t playbackSampleRate, size_t frameCountToBeReady,
+        double phase, double jitter = 0, uint32_t seed = 0) {
+    constexpr int kBursts = 4000;
+    // Starting as soon as a single burst is ready may leave the first few bursts partial
+    // until the two periods have realigned; that priming is not counted as underrun.
+    constexpr int kWarmupBursts = 32;
+    // Time is counted in units of 1 / (recordSampleRate * playbackSampleRate) seconds,
+    // so that both periods are exact and the fake streams do not drift.
+    const int64_t recordPeriod = (int64_t)recordFrameCount * playbackSampleRate;
+    const int64_t playbackPeriod = (int64_t)playbackFrameCount * recordSampleRate;
+    std::minstd_rand random(seed);
+    std::uniform_real_distribution<double> lateness(0, jitter);
+    auto wakeup = [&](int64_t time, int64_t period) {
+        return time + (int64_t)(lateness(random) * period);
+    };
+
+    BridgeResult result;
+    int64_t recordTime = 0;
+    int64_t playbackTime = (int64_t)(phase * playbackPeriod);
+    int64_t recordWakeup = wakeup(recordTime, recordPeriod);
+    int64_t playbackWakeup = wakeup(playbackTime, playbackPeriod);
+    uint64_t recordFramesIn = 0;   // at the record sample rate
+    uint64_t written = 0;          // at the playback sample rate
+    uint64_t read = 0;
+    bool started = false;
+    double fillTimeSum = 0;
+    int samples = 0;
+    for (int i = 0; i < kBursts; ) {
+        if (recordWakeup <= playbackWakeup) {
+            recordFramesIn += recordFrameCount;
+            written = recordFramesIn * playbackSampleRate / recordSampleRate;
+            result.maxFill = std::max(result.maxFill, (size_t)(written - read));
+            recordTime += recordPeriod;
+            recordWakeup = wakeup(recordTime, recordPeriod);
+        } else {
+            const size_t fill = written - read;
+            if (!started && fill >= std::max(frameCountToBeReady, playbackFrameCount)) {
+                started = true;
+            }
+            if (started) {
+                if (fill < playbackFrameCount && i >= kWarmupBursts) {
+                    ++result.underruns;
+                }
+                fillTimeSum += (double)fill * 1e3 / playbackSampleRate;
+                ++samples;
+                read += std::min(fill, playbackFrameCount);
+                ++i;
+            }
+            playbackTime += playbackPeriod;
+            playbackWakeup = wakeup(playbackTime, playbackPeriod);
+        }
+    }
+    result.meanLatencyMs = samples > 0 ? fillTimeSum / samples : 0;
+    return result;
+}
+
+using PatchConfig = std::tuple<size_t /* recordFrameCount */, uint32_t /* recordSampleRate */,
+        size_t /* playbackFrameCount */, uint32_t /* playbackSampleRate */>;
+
+class SoftwarePatchSizingTest : public ::testing::TestWithParam<PatchConfig> {};
+
+constexpr int kPhases = 17;
+
+TEST_P(SoftwarePatchSizingTest, BufferHoldsBridgeWithoutOverrun) {
+    const auto [recordFrameCount, recordSampleRate, playbackFrameCount, playbackSampleRate] =
+            GetParam();
+    const size_t frameCount = softwarePatchFrameCount(recordFrameCount, recordSampleRate,
+            playbackFrameCount, playbackSampleRate, 1 /* frameCountToBeReady */);
+    const size_t legacyFrameCount =
+            legacySoftwarePatchFrameCount(recordFrameCount, playbackFrameCount);
+
+    double worstLatencyMs = 0;
+    for (int i = 0; i < kPhases; ++i) {
+        const BridgeResult result = simulateBridge(recordFrameCount, recordSampleRate,
+                playbackFrameCount, playbackSampleRate, 1 /* frameCountToBeReady */,
+                (double)i / kPhases);
+        EXPECT_LE(result.maxFill, frameCount) << "phase " << i;
+        EXPECT_EQ(0u, result.underruns) << "phase " << i;
+        worstLatencyMs = std::max(worstLatencyMs, result.meanLatencyMs);
+    }
+    // The bridge latency can never exceed the time it takes to play the whole buffer.
+    const double bufferMs = frameCount * 1e3 / playbackSampleRate;
+    EXPECT_LE(worstLatencyMs, bufferMs);
+    ALOGD("record %zu@%u playback %zu@%u: frameCount %zu (%.1f ms) legacy %zu (%.1f ms)"
+            " worst mean latency %.2f ms",
+            recordFrameCount, recordSampleRate, playbackFrameCount, playbackSampleRate,
+            frameCount, bufferMs, legacyFrameCount,
+            legacyFrameCount * 1e3 / playbackSampleRate, worstLatencyMs);
+}
+
+// Each thread may wake up late by almost a whole period: the shared buffer must still be able
+// to take every record burst.  Starting at the first frame may glitch, as documented in
+// PatchPanel, so only overruns are checked here.
+TEST_P(SoftwarePatchSizingTest, MarginAbsorbsSchedulingJitter) {
+    const auto [recordFrameCount, recordSampleRate, playbackFrameCount, playbackSampleRate] =
+            GetParam();
+    const size_t frameCount = softwarePatchFrameCount(recordFrameCount, recordSampleRate,
+            playbackFrameCount, playbackSampleRate, 1 /* frameCountToBeReady */);
+    for (int i = 0; i < kPhases; ++i) {
+        const BridgeResult result = simulateBridge(recordFrameCount, recordSampleRate,
+                playbackFrameCount, playbackSampleRate, 1 /* frameCountToBeReady */,
+                (double)i / kPhases, 0.95 /* jitter */, i + 1 /* seed */);
+        EXPECT_LE(result.maxFill, frameCount) << "phase " << i;
+    }
+}
+
+// The FM bridge keeps the prebuffer it had with the legacy sizing, and the buffer still has
+// the jitter margin on top of it.
+TEST_P(SoftwarePatchSizingTest, FmBridgeKeepsPrebuffer) {
+    const auto [recordFrameCount, recordSampleRate, playbackFrameCount, playbackSampleRate] =
+            GetParam();
+    const size_t frameCountToBeReady =
+            fmBridgeFrameCountToBeReady(recordFrameCount, playbackFrameCount);
+    EXPECT_EQ(legacySoftwarePatchFrameCount(recordFrameCount, playbackFrameCount) / 4,
+            frameCountToBeReady);
+    const size_t frameCount = softwarePatchFrameCount(recordFrameCount, recordSampleRate,
+            playbackFrameCount, playbackSampleRate, frameCountToBeReady);
+    EXPECT_GE(frameCount, frameCountToBeReady + 2 * (recordFrameCount + playbackFrameCount));
+    for (int i = 0; i < kPhases; ++i) {
+        const BridgeResult result = simulateBridge(recordFrameCount, recordSampleRate,
+                playbackFrameCount, playbackSampleRate, frameCountToBeReady,
+                (double)i / kPhases, 0.95 /* jitter */, i + 1 /* seed */);
+        EXPECT_LE(result.maxFill, frameCount) << "phase " << i;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(SoftwarePatchSizing, SoftwarePatchSizingTest, ::testing::Values(
+        PatchConfig{480, 48000, 480, 48000},
+        PatchConfig{256, 48000, 480, 48000},
+        PatchConfig{480, 48000, 256, 48000},
+        PatchConfig{960, 48000, 192, 48000},
+        PatchConfig{192, 48000, 1024, 48000},
+        PatchConfig{320, 16000, 480, 48000},   // e.g. FM tuner at 16 kHz
+        PatchConfig{480, 48000, 441, 44100}    // e.g. USB input to a 44.1 kHz output
+        ));
+
+// With the usual FM tuner configurations the prebuffer lets the bridge play through late
+// wake ups of almost a period on both sides without glitching.
+TEST(SoftwarePatchSizingTests, FmBridgeAbsorbsSchedulingJitter) {
+    for (const auto& [recordFrameCount, recordSampleRate, playbackFrameCount, playbackSampleRate]
+            : {PatchConfig{480, 48000, 480, 48000}, PatchConfig{320, 16000, 480, 48000}}) {
+        const size_t frameCountToBeReady =
+                fmBridgeFrameCountToBeReady(recordFrameCount, playbackFrameCount);
+        for (int i = 0; i < kPhases; ++i) {
+            const BridgeResult result = simulateBridge(recordFrameCount, recordSampleRate,
+                    playbackFrameCount, playbackSampleRate, frameCountToBeReady,
+                    (double)i / kPhases, 0.95 /* jitter */, i + 1 /* seed */);
+            EXPECT_EQ(0u, result.underruns) << "record " << recordFrameCount << " phase " << i;
+        }
+    }
+}
+
+TEST(SoftwarePatchSizingTests, FmBridgeFrameCountToBeReady) {
+    // Two 480 frame threads used a 7200 frame buffer and started after a quarter of it.
+    EXPECT_EQ(1800u, fmBridgeFrameCountToBeReady(480, 480));
+    EXPECT_EQ(1u, fmBridgeFrameCountToBeReady(0, 480));
+}
+
+TEST(SoftwarePatchSizingTests, Degenerate) {
+    EXPECT_EQ(1441u, softwarePatchFrameCount(0, 48000, 480, 48000, 1 /* frameCountToBeReady */));
+    EXPECT_EQ(1441u, softwarePatchFrameCount(480, 0, 0, 48000, 1 /* frameCountToBeReady */));
+}
+
+} // namespace
@@ -447,6 +447,7 @@ Status ResourceManagerService::addResource(const ClientInfoParcel& clientInfo,
             }
             onFirstAdded(res, info);
             info.resources[resType] = res;
+            mResourceIndex.add(pid, info.clientId, res);
         } else {
             mergeResources(info.resources[resType], res);
         }
@@ -518,6 +519,7 @@ Status ResourceManagerService::removeResource(const ClientInfoParcel& clientInfo
             } else {
                 onLastRemoved(res, info);
                 actualRemoved.value = resource.value;
+                mResourceIndex.remove(pid, info.clientId, resource);
                 info.resources.erase(resType);
             }
 
@@ -581,6 +583,7 @@ Status ResourceManagerService::removeResource(const ClientInfoParcel& clientInfo
         mObserverService->onResourceRemoved(info.uid, pid, info.resources);
     }
 
+    mResourceIndex.removeClient(pid, info.clientId, info.resources);
     infos.erase(foundClient);
     return Status::ok();
 }
@@ -778,6 +781,7 @@ bool ResourceManagerService::reclaimUnconditionallyFrom(
         for (auto& [pid, infos] : mMap) {
             for (const auto& [id, info] : infos) {
                 if (info.client == failedClient) {
+                    mResourceIndex.removeClient(pid, id, info.resources);
                     infos.erase(id);
                     found = true;
                     break;
@@ -989,17 +993,26 @@ bool ResourceManagerService::getAllClients_l(
     MediaResource::Type type = resourceRequestInfo.mResource->type;
     MediaResource::SubType subType = resourceRequestInfo.mResource->subType;
 
-    for (auto& [pid, infos] : mMap) {
-        for (const auto& [id, info] : infos) {
-            if (hasResourceType(type, subType, info.resources)) {
-                if (!isCallingPriorityHigher_l(resourceRequestInfo.mCallingPid, pid)) {
-                    // some higher/equal priority process owns the resource,
-                    // this request can't be fulfilled.
-                    ALOGE("%s: can't reclaim resource %s from pid %d",
-                          __func__, asString(type), pid);
-                    clientsInfo.clear();
-                    return false;
-                }
+    const ResourceIndex::PidClientRefs* holders = mResourceIndex.find(type, subType);
+    if (holders != nullptr) {
+        // The priority of each process is only queried once.
+        int callingPriority;
+        bool hasCallingPriority = getPriority_l(resourceRequestInfo.mCallingPid,
+                                                &callingPriority);
+        for (const auto& [pid, clients] : *holders) {
+            int priority;
+            if (!hasCallingPriority || !getPriority_l(pid, &priority)
+                    || callingPriority >= priority) {
+                // some higher/equal priority process owns the resource,
+                // this request can't be fulfilled.
+                ALOGE("%s: can't reclaim resource %s from pid %d",
+                      __func__, asString(type), pid);
+                clientsInfo.clear();
+                return false;
+            }
+            const ResourceInfos& infos = mMap.at(pid);
+            for (const auto& [id, refs] : clients) {
+                const ResourceInfo& info = infos.at(id);
                 clientsInfo.emplace_back(pid, info.uid, info.client);
             }
         }
@@ -1052,17 +1065,14 @@ bool ResourceManagerService::getLowestPriorityBiggestClient_l(
 
 bool ResourceManagerService::getLowestPriorityPid_l(MediaResource::Type type,
         MediaResource::SubType subType, int *lowestPriorityPid, int *lowestPriority) {
+    const ResourceIndex::PidClientRefs* holders = mResourceIndex.find(type, subType);
+    if (holders == nullptr) {
+        // no process has the requested resource type
+        return false;
+    }
     int pid = -1;
     int priority = -1;
-    for (auto& [tempPid, infos] : mMap) {
-        if (infos.size() == 0) {
-            // no client on this process.
-            continue;
-        }
-        if (!hasResourceType(type, subType, infos)) {
-            // doesn't have the requested resource type
-            continue;
-        }
+    for (const auto& [tempPid, clients] : *holders) {
         int tempPriority = -1;
         if (!getPriority_l(tempPid, &tempPriority)) {
             ALOGV("getLowestPriorityPid_l: can't get priority of pid %d, skipped", tempPid);
@@ -1116,18 +1126,22 @@ bool ResourceManagerService::getBiggestClient_l(int pid, MediaResource::Type typ
     std::shared_ptr<IResourceManagerClient> clientTemp;
     uint64_t largestValue = 0;
     const ResourceInfos& infos = found->second;
-    for (const auto& [id, info] : infos) {
-        const ResourceList& resources = info.resources;
-        if (pendingRemovalOnly && !info.pendingRemoval) {
-            continue;
-        }
-        for (auto it = resources.begin(); it != resources.end(); it++) {
-            const MediaResourceParcel &resource = it->second;
-            if (hasResourceType(type, subType, resource)) {
-                if (resource.value > largestValue) {
-                    largestValue = resource.value;
-                    clientTemp = info.client;
-                    uid = info.uid;
+    const ResourceIndex::ClientRefs* clients = mResourceIndex.find(type, subType, pid);
+    if (clients != nullptr) {
+        for (const auto& [id, refs] : *clients) {
+            const ResourceInfo& info = infos.at(id);
+            if (pendingRemovalOnly && !info.pendingRemoval) {
+                continue;
+            }
+            const ResourceList& resources = info.resources;
+            for (auto it = resources.begin(); it != resources.end(); it++) {
+                const MediaResourceParcel &resource = it->second;
+                if (hasResourceType(type, subType, resource)) {
+                    if (resource.value > largestValue) {
+                        largestValue = resource.value;
+                        clientTemp = info.client;
+                        uid = info.uid;
+                    }
                 }
             }
         }
@@ -97,6 +97,40 @@ struct ClientInfo {
 typedef std::map<int64_t, ResourceInfo> ResourceInfos;
 typedef std::map<int, ResourceInfos> PidResourceInfosMap;
 
+/*
+ * Index of the clients that hold each kind of resource, kept up to date as resources
+ * are added and removed, so that reclaim only visits the processes and clients that
+ * hold the requested resource instead of walking every resource list.
+ * Like hasResourceType(), codec resources are indexed by type and subtype and the
+ * other resources by type only.
+ */
+class ResourceIndex {
+public:
+    // Number of resource entries of the indexed kind that each client holds.
+    typedef std::map<int64_t, int> ClientRefs;
+    // Clients holding the indexed kind of resource, by pid.
+    typedef std::map<int, ClientRefs> PidClientRefs;
+
+    void add(int pid, int64_t clientId, const MediaResourceParcel& resource);
+    void remove(int pid, int64_t clientId, const MediaResourceParcel& resource);
+    // Removes the entries of all the given resources of the client.
+    void removeClient(int pid, int64_t clientId, const ResourceList& resources);
+
+    // Returns the clients holding resources of the given type and subtype,
+    // or nullptr if there are none.
+    const PidClientRefs* find(MediaResource::Type type, MediaResource::SubType subType) const;
+    // Returns the clients of pid holding resources of the given type and subtype,
+    // or nullptr if there are none.
+    const ClientRefs* find(MediaResource::Type type, MediaResource::SubType subType,
+                           int pid) const;
+
+private:
+    typedef std::pair<MediaResource::Type, MediaResource::SubType> Key;
+    static Key getKey(MediaResource::Type type, MediaResource::SubType subType);
+
+    std::map<Key, PidClientRefs> mIndex;
+};
+
 class ResourceManagerService : public BnResourceManagerService {
 public:
     struct SystemCallbackInterface : public RefBase {
@@ -231,6 +265,8 @@ private:
     sp<SystemCallbackInterface> mSystemCB;
     sp<ServiceLog> mServiceLog;
     PidResourceInfosMap mMap;
+    // Clients of mMap by resource type, updated along with mMap.
+    ResourceIndex mResourceIndex;
     bool mSupportsMultipleSecureCodecs;
     bool mSupportsSecureWithNonSecureCodec;
     int32_t mCpuBoostCount;
@@ -95,4 +95,69 @@ ResourceInfo& getResourceInfoForEdit(const ClientInfoParcel& clientInfo,
     return found->second;
 }
 
+ResourceIndex::Key ResourceIndex::getKey(MediaResource::Type type,
+        MediaResource::SubType subType) {
+    switch (type) {
+        // Codec subtypes are separate resources, see hasResourceType().
+        case MediaResource::Type::kSecureCodec:
+        case MediaResource::Type::kNonSecureCodec:
+            return Key(type, subType);
+        default:
+            return Key(type, MediaResource::SubType::kUnspecifiedSubType);
+    }
+}
+
+void ResourceIndex::add(int pid, int64_t clientId, const MediaResourceParcel& resource) {
+    mIndex[getKey(resource.type, resource.subType)][pid][clientId]++;
+}
+
+void ResourceIndex::remove(int pid, int64_t clientId, const MediaResourceParcel& resource) {
+    auto foundKey = mIndex.find(getKey(resource.type, resource.subType));
+    if (foundKey == mIndex.end()) {
+        return;
+    }
+    PidClientRefs& pids = foundKey->second;
+    auto foundPid = pids.find(pid);
+    if (foundPid == pids.end()) {
+        return;
+    }
+    ClientRefs& clients = foundPid->second;
+    auto foundClient = clients.find(clientId);
+    if (foundClient == clients.end()) {
+        return;
+    }
+    if (--foundClient->second > 0) {
+        return;
+    }
+    clients.erase(foundClient);
+    if (clients.empty()) {
+        pids.erase(foundPid);
+        if (pids.empty()) {
+            mIndex.erase(foundKey);
+        }
+    }
+}
+
+void ResourceIndex::removeClient(int pid, int64_t clientId, const ResourceList& resources) {
+    for (const auto& [resType, resource] : resources) {
+        remove(pid, clientId, resource);
+    }
+}
+
+const ResourceIndex::PidClientRefs* ResourceIndex::find(MediaResource::Type type,
+        MediaResource::SubType subType) const {
+    auto found = mIndex.find(getKey(type, subType));
+    return found == mIndex.end() ? nullptr : &found->second;
+}
+
+const ResourceIndex::ClientRefs* ResourceIndex::find(MediaResource::Type type,
+        MediaResource::SubType subType, int pid) const {
+    const PidClientRefs* pids = find(type, subType);
+    if (pids == nullptr) {
+        return nullptr;
+    }
+    auto found = pids->find(pid);
+    return found == pids->end() ? nullptr : &found->second;
+}
+
 } // namespace android
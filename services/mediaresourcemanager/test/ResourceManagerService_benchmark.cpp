@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks reclaimResource with hundreds of processes holding codecs, while
+// several high priority processes reclaim video codecs concurrently. Half of the
+// processes only hold audio codecs. Each reclaimed client gives up its codec and
+// adds it back, so the number of clients stays the same.
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <aidl/android/media/BnResourceManagerClient.h>
+#include <benchmark/benchmark.h>
+#include <media/MediaResource.h>
+#include <mediautils/ProcessInfoInterface.h>
+
+#include "ResourceManagerService.h"
+
+using namespace android;
+using ::aidl::android::media::BnResourceManagerClient;
+
+namespace {
+
+constexpr int kClientsPerProcess = 4;
+constexpr int kFirstClientPid = 1000;
+constexpr int kFirstCallerPid = 10;
+
+// The priority of a process is its pid: lower values have higher priority.
+// Counts the queries, which are binder calls to the activity manager on a device.
+struct BenchmarkProcessInfo : public ProcessInfoInterface {
+    bool getPriority(int pid, int* priority) override {
+        mQueries++;
+        *priority = pid;
+        return true;
+    }
+    bool isPidTrusted(int /* pid */) override { return true; }
+    bool isPidUidTrusted(int /* pid */, int /* uid */) override { return true; }
+    bool overrideProcessInfo(int /* pid */, int /* procState */, int /* oomScore */) override {
+        return true;
+    }
+    void removeProcessInfoOverride(int /* pid */) override {}
+
+    std::atomic<int64_t> mQueries{0};
+};
+
+struct BenchmarkSystemCallback : public ResourceManagerService::SystemCallbackInterface {
+    void noteStartVideo(int /* uid */) override {}
+    void noteStopVideo(int /* uid */) override {}
+    void noteResetVideo() override {}
+    bool requestCpusetBoost(bool /* enable */) override { return true; }
+};
+
+std::vector<MediaResourceParcel> getCodecResources(bool video) {
+    if (!video) {
+        return {MediaResource::CodecResource(false /* secure */,
+                                             MediaResource::SubType::kSwAudioCodec)};
+    }
+    return {MediaResource::CodecResource(false /* secure */,
+                                         MediaResource::SubType::kHwVideoCodec),
+            MediaResource::GraphicMemoryResource(4096)};
+}
+
+// Gives its codec back when reclaimed and takes it again, like an app that
+// restarts playback.
+class BenchmarkClient : public BnResourceManagerClient {
+public:
+    BenchmarkClient(int pid, bool video, const std::shared_ptr<ResourceManagerService>& service)
+        : mClientInfo{.pid = pid, .uid = pid, .id = reinterpret_cast<int64_t>(this),
+                      .name = "benchmark"},
+          mVideo(video),
+          mService(service) {}
+
+    void addResources() {
+        mService->addResource(mClientInfo, ref<BenchmarkClient>(), getCodecResources(mVideo));
+    }
+
+    ::ndk::ScopedAStatus reclaimResource(bool* _aidl_return) override {
+        mService->removeClient(mClientInfo);
+        addResources();
+        *_aidl_return = true;
+        return ::ndk::ScopedAStatus::ok();
+    }
+
+    ::ndk::ScopedAStatus getName(std::string* _aidl_return) override {
+        *_aidl_return = mClientInfo.name;
+        return ::ndk::ScopedAStatus::ok();
+    }
+
+private:
+    const ClientInfoParcel mClientInfo;
+    const bool mVideo;
+    std::shared_ptr<ResourceManagerService> mService;
+};
+
+sp<BenchmarkProcessInfo> gProcessInfo;
+std::shared_ptr<ResourceManagerService> gService;
+std::vector<std::shared_ptr<BenchmarkClient>> gClients;
+
+}  // namespace
+
+static void BM_ReclaimResource(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        gProcessInfo = new BenchmarkProcessInfo;
+        gService = ::ndk::SharedRefBase::make<ResourceManagerService>(
+                gProcessInfo, new BenchmarkSystemCallback);
+        for (int i = 0; i < state.range(0); i++) {
+            for (int j = 0; j < kClientsPerProcess; j++) {
+                gClients.push_back(::ndk::SharedRefBase::make<BenchmarkClient>(
+                        kFirstClientPid + i, i % 2 == 0 /* video */, gService));
+                gClients.back()->addResources();
+            }
+        }
+        gProcessInfo->mQueries = 0;
+    }
+
+    const int callerPid = kFirstCallerPid + state.thread_index();
+    const ClientInfoParcel callerInfo{.pid = callerPid, .uid = callerPid, .id = 0,
+                                      .name = "caller"};
+    const std::vector<MediaResourceParcel> request = getCodecResources(true /* video */);
+    for (auto _ : state) {
+        bool reclaimed = false;
+        gService->reclaimResource(callerInfo, request, &reclaimed);
+        if (!reclaimed) {
+            state.SkipWithError("reclaimResource failed");
+            break;
+        }
+    }
+
+    if (state.thread_index() == 0) {
+        state.counters["priorityQueries"] = benchmark::Counter(
+                gProcessInfo->mQueries, benchmark::Counter::kAvgIterations);
+        gClients.clear();
+        gService.reset();
+        gProcessInfo.clear();
+    }
+}
+
+BENCHMARK(BM_ReclaimResource)
+        ->ArgName("processes")
+        ->Arg(100)
+        ->Arg(500)
+        ->Threads(1)
+        ->Threads(8)
+        ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -476,6 +476,69 @@ public:
         EXPECT_EQ(mTestClient3, infos2.at(getId(mTestClient3)).client);
     }
 
+    void testResourceIndex() {
+        const ResourceIndex &index = mService->mResourceIndex;
+        const MediaResource::SubType kUnspecified = MediaResource::SubType::kUnspecifiedSubType;
+        EXPECT_EQ(nullptr, index.find(MediaResource::Type::kGraphicMemory, kUnspecified));
+
+        addResource();
+
+        // Non-codec resources are indexed regardless of the subtype.
+        const ResourceIndex::PidClientRefs *graphicMemory =
+                index.find(MediaResource::Type::kGraphicMemory, kUnspecified);
+        ASSERT_NE(nullptr, graphicMemory);
+        EXPECT_EQ(graphicMemory, index.find(MediaResource::Type::kGraphicMemory,
+                                            MediaResource::SubType::kHwVideoCodec));
+        EXPECT_EQ(2u, graphicMemory->size());
+        EXPECT_EQ(1u, graphicMemory->at(kTestPid1).size());
+        EXPECT_EQ(2u, graphicMemory->at(kTestPid2).size());
+
+        // Codec resources are indexed by subtype.
+        const ResourceIndex::PidClientRefs *secureCodec =
+                index.find(MediaResource::Type::kSecureCodec, kUnspecified);
+        ASSERT_NE(nullptr, secureCodec);
+        EXPECT_EQ(2u, secureCodec->size());
+        EXPECT_EQ(nullptr, index.find(MediaResource::Type::kSecureCodec,
+                                      MediaResource::SubType::kHwVideoCodec));
+
+        // Removing part of a resource keeps the client in the index.
+        ClientInfoParcel client1Info{.pid = static_cast<int32_t>(kTestPid1),
+                                     .uid = static_cast<int32_t>(kTestUid1),
+                                     .id = getId(mTestClient1),
+                                     .name = "none"};
+        std::vector<MediaResourceParcel> resources;
+        resources.push_back(MediaResource(MediaResource::Type::kGraphicMemory, 100));
+        mService->removeResource(client1Info, resources);
+        EXPECT_NE(nullptr,
+                  index.find(MediaResource::Type::kGraphicMemory, kUnspecified, kTestPid1));
+
+        // Removing all of it removes the client.
+        resources[0].value = 300;
+        mService->removeResource(client1Info, resources);
+        EXPECT_EQ(nullptr,
+                  index.find(MediaResource::Type::kGraphicMemory, kUnspecified, kTestPid1));
+        EXPECT_NE(nullptr,
+                  index.find(MediaResource::Type::kSecureCodec, kUnspecified, kTestPid1));
+
+        // Removing the clients removes all their resources.
+        mService->removeClient(client1Info);
+        ClientInfoParcel client2Info{.pid = static_cast<int32_t>(kTestPid2),
+                                     .uid = static_cast<int32_t>(kTestUid2),
+                                     .id = getId(mTestClient2),
+                                     .name = "none"};
+        mService->removeClient(client2Info);
+        EXPECT_EQ(nullptr, index.find(MediaResource::Type::kNonSecureCodec, kUnspecified));
+        ASSERT_NE(nullptr, index.find(MediaResource::Type::kSecureCodec, kUnspecified));
+        EXPECT_EQ(1u, index.find(MediaResource::Type::kSecureCodec, kUnspecified)->size());
+        ClientInfoParcel client3Info{.pid = static_cast<int32_t>(kTestPid2),
+                                     .uid = static_cast<int32_t>(kTestUid2),
+                                     .id = getId(mTestClient3),
+                                     .name = "none"};
+        mService->removeClient(client3Info);
+        EXPECT_EQ(nullptr, index.find(MediaResource::Type::kSecureCodec, kUnspecified));
+        EXPECT_EQ(nullptr, index.find(MediaResource::Type::kGraphicMemory, kUnspecified));
+    }
+
     void testGetAllClients() {
         addResource();
 
@@ -1536,6 +1599,10 @@ TEST_F(ResourceManagerServiceTest, removeClient) {
     testRemoveClient();
 }
 
+TEST_F(ResourceManagerServiceTest, resourceIndex) {
+    testResourceIndex();
+}
+
 TEST_F(ResourceManagerServiceTest, reclaimResource) {
     testReclaimResourceSecure();
     testReclaimResourceNonSecure();